@@ -74,6 +74,10 @@ yell start simple request test
 try python test-request.py --no-ledger --iterations 100 \
      --logfile __screen__ --loglevel warn
 
+yell start state delta request test
+try python test-request.py --no-ledger --state-delta --iterations 40 \
+     --logfile __screen__ --loglevel warn
+
 yell start simple integer-key contract test
 try python test-contract.py --no-ledger --contract integer-key \
      --logfile __screen__ --loglevel warn
@@ -82,7 +82,10 @@ def send_to_contract(state, save_file, enclave, message, quiet=False, wait=False
         except Exception as e :
             raise Exception('failed to save the new state; {0}'.format(str(e)))
 
-        contract.set_state(update_response.encrypted_state)
+        contract.set_state(update_response.encrypted_state,
+                           update_response.encrypted_state_delta,
+                           enclave_id = update_response.enclave_service.enclave_id,
+                           state_hash = update_response.new_state_hash)
         contract.contract_state.save_to_cache(data_dir = data_directory)
 
     return update_response.result
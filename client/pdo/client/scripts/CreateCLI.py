@@ -162,7 +162,8 @@ def LocalMain(commands, config) :
                 ledger_config, client_keys, contract_code, provisioning_service_keys)
 
             logger.info('Registered contract %s with id %s', contract_name, contract_id)
-            contract_state = ContractState.create_new_state(contract_id)
+            chunked_state = contract_config.get('ChunkedState', False)
+            contract_state = ContractState.create_new_state(contract_id, chunked_state=chunked_state)
             contract = Contract(contract_code, contract_state, contract_id, client_keys.identity)
             contract.save_to_file(save_file, data_dir=data_directory)
         except Exception as e :
@@ -237,6 +238,7 @@ def Main(commands) :
     parser.add_argument('--contract', help='Name of the contract', required = True, type = str)
     parser.add_argument('--source', help='Gipsy Scheme source for the contract', required=True, type=str)
     parser.add_argument('--save-file', help='Name of the file where contract data is stored', type=str)
+    parser.add_argument('--chunked-state', help='Encrypt the contract state in verifiable chunks', action='store_true')
 
     parser.add_argument('--key-dir', help='Directories to search for key files', nargs='+')
 
@@ -319,6 +321,8 @@ def Main(commands) :
     config['Contract']['SourceName'] = options.source
     if options.save_file :
         config['Contract']['SaveFile'] = options.save_file
+    if options.chunked_state :
+        config['Contract']['ChunkedState'] = True
 
     # GO!!!
     LocalMain(commands, config)
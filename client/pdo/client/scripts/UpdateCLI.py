@@ -82,6 +82,8 @@ def LocalMain(config, message) :
         logger.error('failed to load the contract; %s', str(e))
         sys.exit(-1)
 
+    contract.contract_state.emit_state_delta = contract_config.get('EmitStateDelta', False)
+
     # ---------- load the invoker's keys ----------
     try :
         keyfile = key_config['FileName']
@@ -149,7 +151,11 @@ def LocalMain(config, message) :
             logger.error('failed to save the new state; %s', str(e))
             sys.exit(-1)
 
-        contract.set_state(update_response.encrypted_state)
+        contract.set_state(
+            update_response.encrypted_state,
+            update_response.encrypted_state_delta,
+            update_response.enclave_service.enclave_id,
+            update_response.new_state_hash)
         contract.contract_state.save_to_cache(data_dir = data_directory)
 
     sys.exit(0)
@@ -207,6 +213,7 @@ def Main() :
     parser.add_argument('--key-dir', help='Directories to search for key files', nargs='+')
 
     parser.add_argument('--enclave', help='URL of the enclave service to use', type=str)
+    parser.add_argument('--state-delta', help='Ask the enclave for state deltas rather than full states', action='store_true')
 
     parser.add_argument('message', help="Message to evaluate", type=str)
 
@@ -276,6 +283,8 @@ def Main() :
             'SaveFile' : options.save_file
         }
     config['Contract']['SaveFile'] = options.save_file
+    if options.state_delta :
+        config['Contract']['EmitStateDelta'] = True
 
     # GO!
     LocalMain(config, options.message)
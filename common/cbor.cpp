@@ -0,0 +1,184 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "error.h"
+#include "cbor.h"
+
+namespace pe = pdo::error;
+
+// major types from RFC 7049 section 2.1, shifted into the initial byte
+#define CBOR_UNSIGNED 0x00
+#define CBOR_BYTES    0x40
+#define CBOR_STRING   0x60
+#define CBOR_ARRAY    0x80
+#define CBOR_MAP      0xa0
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+CborWriter::CborWriter(ByteArray& output, size_t size_hint) : output_(output)
+{
+    output_.reserve(output_.size() + size_hint);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the argument goes in the initial byte when it is below 24, otherwise
+// in the smallest of 1, 2, 4 or 8 big endian bytes that holds it
+void CborWriter::Head(uint8_t major, uint64_t value)
+{
+    int length;
+    if (value < 24)
+    {
+        output_.push_back(major | static_cast<uint8_t>(value));
+        return;
+    }
+    else if (value <= 0xff)
+    {
+        output_.push_back(major | 24);
+        length = 1;
+    }
+    else if (value <= 0xffff)
+    {
+        output_.push_back(major | 25);
+        length = 2;
+    }
+    else if (value <= 0xffffffffULL)
+    {
+        output_.push_back(major | 26);
+        length = 4;
+    }
+    else
+    {
+        output_.push_back(major | 27);
+        length = 8;
+    }
+
+    for (int i = length - 1; i >= 0; i--)
+        output_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CborWriter::BeginArray(size_t count)
+{
+    Head(CBOR_ARRAY, count);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CborWriter::BeginMap(size_t count)
+{
+    Head(CBOR_MAP, count);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CborWriter::Unsigned(uint64_t value)
+{
+    Head(CBOR_UNSIGNED, value);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CborWriter::Bytes(const uint8_t* data, size_t size)
+{
+    Head(CBOR_BYTES, size);
+    output_.insert(output_.end(), data, data + size);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CborWriter::Bytes(const ByteArray& value)
+{
+    Bytes(value.data(), value.size());
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CborWriter::String(const std::string& value)
+{
+    Head(CBOR_STRING, value.size());
+    output_.insert(output_.end(), value.begin(), value.end());
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+CborReader::CborReader(const uint8_t* data, size_t size) :
+    data_(data),
+    size_(size),
+    position_(0)
+{
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+uint64_t CborReader::ReadHead(uint8_t major)
+{
+    pe::ThrowIf<pe::ValueError>(position_ >= size_, "cbor; unexpected end of data");
+
+    uint8_t initial = data_[position_++];
+    pe::ThrowIf<pe::ValueError>((initial & 0xe0) != major, "cbor; unexpected item type");
+
+    uint8_t info = initial & 0x1f;
+    if (info < 24)
+        return info;
+
+    // 31 marks an indefinite length which is not part of the subset
+    pe::ThrowIf<pe::ValueError>(info > 27, "cbor; unsupported item length");
+
+    size_t length = static_cast<size_t>(1) << (info - 24);
+    pe::ThrowIf<pe::ValueError>(size_ - position_ < length, "cbor; unexpected end of data");
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; i++)
+        value = (value << 8) | data_[position_++];
+
+    return value;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// every entry takes at least one byte so a count larger than what is
+// left of the buffer cannot be valid
+size_t CborReader::ReadArray(void)
+{
+    uint64_t count = ReadHead(CBOR_ARRAY);
+    pe::ThrowIf<pe::ValueError>(count > size_ - position_, "cbor; invalid array length");
+    return static_cast<size_t>(count);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t CborReader::ReadMap(void)
+{
+    uint64_t count = ReadHead(CBOR_MAP);
+    pe::ThrowIf<pe::ValueError>(count > (size_ - position_) / 2, "cbor; invalid map length");
+    return static_cast<size_t>(count);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+uint64_t CborReader::ReadUnsigned(void)
+{
+    return ReadHead(CBOR_UNSIGNED);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CborReader::ReadBytes(ByteArray& value)
+{
+    uint64_t length = ReadHead(CBOR_BYTES);
+    pe::ThrowIf<pe::ValueError>(length > size_ - position_, "cbor; invalid byte string length");
+
+    value.assign(data_ + position_, data_ + position_ + length);
+    position_ += length;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+std::string CborReader::ReadString(void)
+{
+    uint64_t length = ReadHead(CBOR_STRING);
+    pe::ThrowIf<pe::ValueError>(length > size_ - position_, "cbor; invalid text string length");
+
+    std::string value(reinterpret_cast<const char*>(data_ + position_), length);
+    position_ += length;
+    return value;
+}
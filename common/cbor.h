@@ -0,0 +1,75 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <string>
+
+#include "types.h"
+
+// The binary wire format is the subset of CBOR (RFC 7049) needed to
+// carry requests: unsigned integers, byte and text strings, arrays and
+// maps, all with definite lengths. Byte strings hold ciphertext as is
+// rather than base64 encoded.
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// CborWriter appends items to a ByteArray; containers are written as a
+// header with the number of entries followed by the entries themselves
+class CborWriter
+{
+public:
+    // size_hint is added to the capacity of the output up front
+    CborWriter(ByteArray& output, size_t size_hint = 0);
+
+    void BeginArray(size_t count);
+    void BeginMap(size_t count);
+
+    void Unsigned(uint64_t value);
+    void Bytes(const uint8_t* data, size_t size);
+    void Bytes(const ByteArray& value);
+    void String(const std::string& value);
+
+private:
+    ByteArray& output_;
+
+    void Head(uint8_t major, uint64_t value);
+};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// CborReader walks a buffer item by item; every read checks the type of
+// the next item and throws ValueError if it does not match or runs past
+// the end of the buffer. The buffer must outlive the reader.
+class CborReader
+{
+public:
+    CborReader(const uint8_t* data, size_t size);
+
+    // both return the number of entries that follow
+    size_t ReadArray(void);
+    size_t ReadMap(void);
+
+    uint64_t ReadUnsigned(void);
+    void ReadBytes(ByteArray& value);
+    std::string ReadString(void);
+
+    bool AtEnd(void) const { return position_ == size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_;
+
+    uint64_t ReadHead(uint8_t major);
+};
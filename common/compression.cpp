@@ -0,0 +1,290 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <vector>
+
+#include "error.h"
+#include "compression.h"
+
+namespace pe = pdo::error;
+
+// constants of the LZ4 block format: matches are at least MIN_MATCH
+// bytes, the last LAST_LITERALS bytes are always literals and no match
+// starts in the last MATCH_LIMIT bytes
+#define MIN_MATCH 4
+#define LAST_LITERALS 5
+#define MATCH_LIMIT 12
+#define MAX_OFFSET 65535
+
+#define HASH_LOG 12
+
+#define ENVELOPE_VERSION 1
+#define ENVELOPE_HEADER_SIZE 9
+
+static const uint8_t envelope_magic[] = {0x00, 'P', 'D', 'Z'};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static inline uint32_t Read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// lengths that do not fit in the token continue in bytes of 255 ended
+// by a byte less than 255
+static uint8_t* WriteLength(uint8_t* out, size_t length)
+{
+    while (length >= 255)
+    {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = static_cast<uint8_t>(length);
+    return out;
+}
+
+static size_t ReadLength(const uint8_t*& position, const uint8_t* end)
+{
+    size_t length = 0;
+    uint8_t value;
+    do
+    {
+        pe::ThrowIf<pe::ValueError>(position == end, "invalid compressed data; truncated length");
+        value = *position++;
+        length += value;
+    } while (value == 255);
+
+    return length;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the final sequence of a block has literals only, match_length is zero
+static uint8_t* WriteSequence(uint8_t* out,
+    const uint8_t* literals,
+    size_t literal_length,
+    size_t offset,
+    size_t match_length)
+{
+    size_t match_code = match_length > 0 ? match_length - MIN_MATCH : 0;
+    uint8_t* token = out++;
+    *token = (literal_length < 15 ? literal_length : 15) << 4;
+    *token |= (match_code < 15 ? match_code : 15);
+
+    if (literal_length >= 15)
+        out = WriteLength(out, literal_length - 15);
+    if (literal_length > 0)
+        memcpy(out, literals, literal_length);
+    out += literal_length;
+
+    if (match_length == 0)
+        return out;
+
+    *out++ = offset & 0xFF;
+    *out++ = (offset >> 8) & 0xFF;
+    if (match_code >= 15)
+        out = WriteLength(out, match_code - 15);
+    return out;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// length of the common prefix of a and b, compared a word at a time,
+// that ends before limit
+static inline size_t MatchLength(const uint8_t* a, const uint8_t* b, const uint8_t* limit)
+{
+    const uint8_t* start = a;
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (a + sizeof(uint64_t) <= limit)
+    {
+        uint64_t x, y;
+        memcpy(&x, a, sizeof(x));
+        memcpy(&y, b, sizeof(y));
+        if (x != y)
+            return (a - start) + (__builtin_ctzll(x ^ y) >> 3);
+        a += sizeof(uint64_t);
+        b += sizeof(uint64_t);
+    }
+#endif
+
+    while (a < limit && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return a - start;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the table maps the hash of four bytes to the last position they were
+// seen at; a candidate is confirmed by comparing the bytes so stale or
+// colliding entries only cost a missed match. The search skips ahead
+// faster the longer it goes without a match so incompressible data
+// passes through quickly. Output goes into space sized for the worst
+// case, which is trimmed at the end.
+void pdo::compression::Compress(const uint8_t* data, size_t size, ByteArray& output)
+{
+    size_t base = output.size();
+    output.resize(base + size + size / 255 + 16);
+    uint8_t* out = output.data() + base;
+
+    size_t anchor = 0;
+    if (size > MATCH_LIMIT)
+    {
+        std::vector<uint32_t> table(1 << HASH_LOG, 0);
+        const size_t limit = size - MATCH_LIMIT;
+        const uint8_t* match_end = data + size - LAST_LITERALS;
+
+        size_t position = 1;
+        while (position < limit)
+        {
+            uint32_t sequence = Read32(data + position);
+            uint32_t hash = Hash(sequence);
+            size_t candidate = table[hash];
+            table[hash] = position;
+
+            if (position - candidate > MAX_OFFSET || Read32(data + candidate) != sequence)
+            {
+                position += 1 + ((position - anchor) >> 6);
+                continue;
+            }
+
+            while (position > anchor && candidate > 0 && data[position - 1] == data[candidate - 1])
+            {
+                position--;
+                candidate--;
+            }
+
+            size_t length = MIN_MATCH + MatchLength(data + position + MIN_MATCH,
+                                            data + candidate + MIN_MATCH, match_end);
+
+            out = WriteSequence(out, data + anchor, position - anchor, position - candidate, length);
+            position += length;
+            anchor = position;
+
+            if (position - 2 < limit)
+                table[Hash(Read32(data + position - 2))] = position - 2;
+        }
+    }
+
+    out = WriteSequence(out, data + anchor, size - anchor, 0, 0);
+    output.resize(out - output.data());
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// every length and offset is checked against both buffers before it is
+// used; a match may overlap the bytes it produces
+void pdo::compression::Decompress(
+    const uint8_t* data, size_t size, size_t decompressed_size, ByteArray& output)
+{
+    size_t base = output.size();
+    output.resize(base + decompressed_size);
+    uint8_t* out = output.data() + base;
+    size_t written = 0;
+
+    const uint8_t* position = data;
+    const uint8_t* end = data + size;
+    while (true)
+    {
+        pe::ThrowIf<pe::ValueError>(position == end, "invalid compressed data; truncated block");
+        uint8_t token = *position++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15)
+            literal_length += ReadLength(position, end);
+
+        pe::ThrowIf<pe::ValueError>(
+            literal_length > (size_t)(end - position) ||
+                literal_length > decompressed_size - written,
+            "invalid compressed data; literals out of range");
+        if (literal_length > 0)
+            memcpy(out + written, position, literal_length);
+        position += literal_length;
+        written += literal_length;
+
+        if (position == end)
+            break;
+
+        pe::ThrowIf<pe::ValueError>(end - position < 2, "invalid compressed data; truncated offset");
+        size_t offset = position[0] | (position[1] << 8);
+        position += 2;
+        pe::ThrowIf<pe::ValueError>(
+            offset == 0 || offset > written, "invalid compressed data; offset out of range");
+
+        size_t match_length = token & 0x0F;
+        if (match_length == 15)
+            match_length += ReadLength(position, end);
+        match_length += MIN_MATCH;
+        pe::ThrowIf<pe::ValueError>(
+            match_length > decompressed_size - written, "invalid compressed data; match out of range");
+
+        const uint8_t* match = out + written - offset;
+        if (offset >= match_length)
+            memcpy(out + written, match, match_length);
+        else
+            for (size_t i = 0; i < match_length; i++)
+                out[written + i] = match[i];
+        written += match_length;
+    }
+
+    pe::ThrowIf<pe::ValueError>(
+        written != decompressed_size, "invalid compressed data; size mismatch");
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool pdo::compression::CompressEnvelope(const uint8_t* data, size_t size, ByteArray& envelope)
+{
+    if (size > 0xFFFFFFFFULL)
+        return false;
+
+    envelope.assign(envelope_magic, envelope_magic + sizeof(envelope_magic));
+    envelope.push_back(ENVELOPE_VERSION);
+    envelope.push_back((size >> 24) & 0xFF);
+    envelope.push_back((size >> 16) & 0xFF);
+    envelope.push_back((size >> 8) & 0xFF);
+    envelope.push_back(size & 0xFF);
+
+    Compress(data, size, envelope);
+    return envelope.size() < size;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool pdo::compression::IsCompressedEnvelope(const uint8_t* data, size_t size)
+{
+    return size >= ENVELOPE_HEADER_SIZE &&
+           memcmp(data, envelope_magic, sizeof(envelope_magic)) == 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void pdo::compression::DecompressEnvelope(const uint8_t* data, size_t size, ByteArray& output)
+{
+    pe::ThrowIf<pe::ValueError>(
+        !IsCompressedEnvelope(data, size), "invalid compressed data; not an envelope");
+    pe::ThrowIf<pe::ValueError>(data[sizeof(envelope_magic)] != ENVELOPE_VERSION,
+        "invalid compressed data; unsupported envelope version");
+
+    const uint8_t* length = data + sizeof(envelope_magic) + 1;
+    size_t decompressed_size = ((size_t)length[0] << 24) | ((size_t)length[1] << 16) |
+                               ((size_t)length[2] << 8) | (size_t)length[3];
+
+    output.clear();
+    Decompress(data + ENVELOPE_HEADER_SIZE, size - ENVELOPE_HEADER_SIZE, decompressed_size, output);
+}
@@ -0,0 +1,56 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <stdint.h>
+
+#include "types.h"
+
+// Contract state is compressed with an LZ4 block format compressor
+// (greedy matching over a single hash table). It needs no allocation
+// beyond its output and a fixed size table and has no dependencies, so
+// the same code runs in and out of the enclave.
+//
+// A compressed state is wrapped in a versioned envelope:
+//
+//     0x00 'P' 'D' 'Z' | version (1 byte) | uncompressed size (32 bit
+//     big endian) | LZ4 block
+//
+// Serialized state never starts with a NUL so an envelope is never
+// mistaken for a plain state and plain states need no envelope.
+
+namespace pdo
+{
+namespace compression
+{
+    // append the LZ4 block for size bytes of data to output
+    void Compress(const uint8_t* data, size_t size, ByteArray& output);
+
+    // append the decompressed block to output, throws ValueError unless
+    // the block is well formed and expands to exactly decompressed_size
+    void Decompress(
+        const uint8_t* data, size_t size, size_t decompressed_size, ByteArray& output);
+
+    // replace envelope with the compressed envelope of data, returns false
+    // (envelope unspecified) if compression does not make it smaller
+    bool CompressEnvelope(const uint8_t* data, size_t size, ByteArray& envelope);
+
+    bool IsCompressedEnvelope(const uint8_t* data, size_t size);
+
+    // replace output with the contents of an envelope, throws ValueError
+    // if the envelope is malformed or of an unknown version
+    void DecompressEnvelope(const uint8_t* data, size_t size, ByteArray& output);
+}  // namespace compression
+}  // namespace pdo
@@ -17,6 +17,10 @@
 #include <openssl/sha.h>
 #include "crypto_shared.h"
 #include "crypto_utils.h"
+#include "ecdh.h"
+#include "ecdh_private_key.h"
+#include "ecdh_public_key.h"
+#include "merkle.h"
 #include "pkenc.h"
 #include "pkenc_private_key.h"
 #include "pkenc_public_key.h"
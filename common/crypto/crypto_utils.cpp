@@ -88,3 +88,30 @@ ByteArray pcrypto::ComputeMessageHash(const ByteArray& message)
     SHA256Hash((const unsigned char*)message.data(), message.size(), hash.data());
     return hash;
 }  // pcrypto::ComputeMessageHash
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pcrypto::MessageHash::MessageHash()
+{
+    SHA256_Init(&context_);
+}  // pcrypto::MessageHash::MessageHash
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void pcrypto::MessageHash::Update(const uint8_t* data, size_t size)
+{
+    SHA256_Update(&context_, data, size);
+}  // pcrypto::MessageHash::Update
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void pcrypto::MessageHash::Update(const ByteArray& data)
+{
+    SHA256_Update(&context_, data.data(), data.size());
+}  // pcrypto::MessageHash::Update
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// returns ByteArray containing raw binary data
+ByteArray pcrypto::MessageHash::Finish(void)
+{
+    ByteArray hash(SHA256_DIGEST_LENGTH);
+    SHA256_Final(hash.data(), &context_);
+    return hash;
+}  // pcrypto::MessageHash::Finish
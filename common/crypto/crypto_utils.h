@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <openssl/sha.h>
 #include <vector>
 #include "types.h"
 
@@ -25,6 +26,21 @@ namespace crypto
     // SHA256 hashing
     ByteArray ComputeMessageHash(const ByteArray& message);
 
+    // SHA256 hashing of a message fed a piece at a time, the digest
+    // equals ComputeMessageHash of the concatenated pieces
+    class MessageHash
+    {
+    public:
+        MessageHash();
+
+        void Update(const uint8_t* data, size_t size);
+        void Update(const ByteArray& data);
+        ByteArray Finish(void);
+
+    private:
+        SHA256_CTX context_;
+    };
+
     // Generate cryptographically strong reandom bitstring
     // throws RuntimeError
     ByteArray RandomBitString(size_t length);
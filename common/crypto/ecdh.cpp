@@ -0,0 +1,126 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecdh.h"
+#include <openssl/ecdh.h>
+#include <openssl/sha.h>
+#include <memory>
+#include <vector>
+#include "crypto_shared.h"
+#include "error.h"
+#include "pkenc.h"
+#include "skenc.h"
+/***Conditional compile untrusted/trusted***/
+#if _UNTRUSTED_
+#include <openssl/crypto.h>
+#include <stdio.h>
+#else
+#include "tSgxSSL_api.h"
+#endif
+/***END Conditional compile untrusted/trusted***/
+
+namespace pcrypto = pdo::crypto;
+namespace constants = pdo::crypto::constants;
+
+// Typedefs for memory management
+// Specify type and destroy function type for unique_ptrs
+typedef std::unique_ptr<BN_CTX, void (*)(BN_CTX*)> BN_CTX_ptr;
+
+// Error handling
+namespace Error = pdo::error;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Compressed encoding of the public point of an EC key
+// throws RuntimeError
+ByteArray pcrypto::ecdh::EncodePoint(const EC_KEY* key)
+{
+    const EC_GROUP* group = EC_KEY_get0_group(key);
+    const EC_POINT* point = EC_KEY_get0_public_key(key);
+    if (!group || !point)
+    {
+        std::string msg("Crypto Error (EncodePoint): Key has no public point");
+        throw Error::RuntimeError(msg);
+    }
+
+    BN_CTX_ptr context(BN_CTX_new(), BN_CTX_free);
+    if (!context)
+    {
+        std::string msg("Crypto Error (EncodePoint): Could not create new CTX");
+        throw Error::RuntimeError(msg);
+    }
+
+    ByteArray encoded(constants::ECDH_POINT_LEN);
+    size_t len = EC_POINT_point2oct(group, point, POINT_CONVERSION_COMPRESSED, encoded.data(),
+        encoded.size(), context.get());
+    if (len != encoded.size())
+    {
+        std::string msg("Crypto Error (EncodePoint): Could not encode EC point");
+        throw Error::RuntimeError(msg);
+    }
+
+    return encoded;
+}  // pcrypto::ecdh::EncodePoint
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// ECDH followed by the ANSI X9.63 KDF, a single SHA256 block covers the
+// AES key so the counter is always 1
+// throws RuntimeError
+ByteArray pcrypto::ecdh::AgreeKey(const EC_KEY* private_key,
+    const EC_POINT* peer_point,
+    const ByteArray& ephemeral_point,
+    const ByteArray& recipient_point)
+{
+    unsigned char shared[SHA256_DIGEST_LENGTH];
+    int shared_len = ECDH_compute_key(shared, sizeof(shared), peer_point, private_key, NULL);
+    if (shared_len <= 0)
+    {
+        std::string msg("Crypto Error (AgreeKey): Could not compute shared secret");
+        throw Error::RuntimeError(msg);
+    }
+
+    const unsigned char counter[4] = {0, 0, 0, 1};
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    SHA256_Update(&sha256, shared, shared_len);
+    SHA256_Update(&sha256, counter, sizeof(counter));
+    SHA256_Update(&sha256, ephemeral_point.data(), ephemeral_point.size());
+    SHA256_Update(&sha256, recipient_point.data(), recipient_point.size());
+    SHA256_Final(digest, &sha256);
+
+    ByteArray key(digest, digest + constants::SYM_KEY_LEN);
+
+    OPENSSL_cleanse(shared, sizeof(shared));
+    OPENSSL_cleanse(digest, sizeof(digest));
+    OPENSSL_cleanse(&sha256, sizeof(sha256));
+
+    return key;
+}  // pcrypto::ecdh::AgreeKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// An RSA ciphertext always has the size of the modulus, which is
+// larger than the envelope of a session key but not of every message,
+// so the size is checked along with the version byte
+bool pcrypto::ecdh::IsEnvelope(const ByteArray& ciphertext)
+{
+    if (ciphertext.size() <= (size_t)constants::ECDH_ENVELOPE_HEADER_LEN)
+        return false;
+
+    if (ciphertext.size() == (size_t)(constants::RSA_KEY_SIZE >> 3))
+        return false;
+
+    return ciphertext[0] == constants::ECDH_ENVELOPE_VERSION;
+}  // pcrypto::ecdh::IsEnvelope
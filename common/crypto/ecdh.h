@@ -0,0 +1,63 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <openssl/ec.h>
+#include <openssl/obj_mac.h>
+#include "skenc.h"
+#include "types.h"
+
+namespace pdo
+{
+namespace crypto
+{
+    namespace constants
+    {
+        // Key agreement curve; P-256 rather than the signing curve since
+        // OpenSSL has a constant time, assembly optimized implementation
+        const int ECDH_CURVE = NID_X9_62_prime256v1;
+        // Compressed encoding of a point on the key agreement curve
+        const int ECDH_POINT_LEN = 33;
+        // Leading byte of a key agreement envelope; RSA ciphertexts are
+        // told apart by their fixed size
+        const uint8_t ECDH_ENVELOPE_VERSION = 0x01;
+        // VERSION || EPHEMERAL POINT || IV || TAG, followed by the ciphertext
+        const int ECDH_ENVELOPE_HEADER_LEN = 1 + ECDH_POINT_LEN + IV_TAG_LEN;
+    }
+
+    // Public key encryption with ephemeral ECDH; the sender generates a
+    // fresh key pair for every message, derives an AES-GCM key from the
+    // shared secret and the two public points and sends its public point
+    // along with the ciphertext
+    namespace ecdh
+    {
+        // Compressed encoding of the public point of a key
+        // throws RuntimeError
+        ByteArray EncodePoint(const EC_KEY* key);
+
+        // Compute the shared secret between private_key and peer_point and
+        // derive the AES-GCM key with the ANSI X9.63 KDF (SHA256) over the
+        // shared x coordinate and both encoded public points
+        // throws RuntimeError
+        ByteArray AgreeKey(const EC_KEY* private_key,
+            const EC_POINT* peer_point,
+            const ByteArray& ephemeral_point,
+            const ByteArray& recipient_point);
+
+        // true if the ciphertext is laid out as a key agreement envelope
+        bool IsEnvelope(const ByteArray& ciphertext);
+    }
+}
+}
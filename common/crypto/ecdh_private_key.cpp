@@ -0,0 +1,254 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecdh_private_key.h"
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <memory>
+#include <vector>
+#include "crypto_shared.h"
+#include "ecdh.h"
+#include "ecdh_public_key.h"
+#include "error.h"
+#include "skenc.h"
+/***Conditional compile untrusted/trusted***/
+#if _UNTRUSTED_
+#include <openssl/crypto.h>
+#include <stdio.h>
+#else
+#include "tSgxSSL_api.h"
+#endif
+/***END Conditional compile untrusted/trusted***/
+
+namespace pcrypto = pdo::crypto;
+namespace constants = pdo::crypto::constants;
+
+// Typedefs for memory management
+// Specify type and destroy function type for unique_ptrs
+typedef std::unique_ptr<BIO, void (*)(BIO*)> BIO_ptr;
+typedef std::unique_ptr<BN_CTX, void (*)(BN_CTX*)> BN_CTX_ptr;
+typedef std::unique_ptr<EC_POINT, void (*)(EC_POINT*)> EC_POINT_ptr;
+
+// Error handling
+namespace Error = pdo::error;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Utility function: Deserialize ECDH Private Key
+// throws RuntimeError, ValueError
+static EC_KEY* deserializeECDHPrivateKey(const std::string& encoded)
+{
+    BIO_ptr bio(BIO_new_mem_buf(encoded.c_str(), -1), BIO_free_all);
+    if (!bio)
+    {
+        std::string msg("Crypto Error (deserializeECDHPrivateKey): Could not create BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    EC_KEY* private_key = PEM_read_bio_ECPrivateKey(bio.get(), NULL, NULL, NULL);
+    if (!private_key)
+    {
+        std::string msg(
+            "Crypto Error (deserializeECDHPrivateKey): Could not "
+            "deserialize private ECDH key");
+        throw Error::ValueError(msg);
+    }
+
+    if (EC_GROUP_get_curve_name(EC_KEY_get0_group(private_key)) != constants::ECDH_CURVE ||
+        EC_KEY_get0_public_key(private_key) == NULL)
+    {
+        EC_KEY_free(private_key);
+        std::string msg("Crypto Error (deserializeECDHPrivateKey): Invalid ECDH key");
+        throw Error::ValueError(msg);
+    }
+
+    return private_key;
+}  // deserializeECDHPrivateKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Constructor
+// throws RuntimeError
+pcrypto::ecdh::PrivateKey::PrivateKey()
+{
+    private_key_ = EC_KEY_new_by_curve_name(constants::ECDH_CURVE);
+    if (!private_key_)
+    {
+        std::string msg("Crypto Error (ecdh::PrivateKey()): Could not create new EC_KEY");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (!EC_KEY_generate_key(private_key_))
+    {
+        EC_KEY_free(private_key_);
+        std::string msg("Crypto Error (ecdh::PrivateKey()): Could not generate EC_KEY");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::ecdh::PrivateKey::PrivateKey
+
+// Constructor from encoded string
+// throws RuntimeError, ValueError
+pcrypto::ecdh::PrivateKey::PrivateKey(const std::string& encoded)
+{
+    private_key_ = deserializeECDHPrivateKey(encoded);
+}  // pcrypto::ecdh::PrivateKey::PrivateKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Copy constructor
+// throws RuntimeError
+pcrypto::ecdh::PrivateKey::PrivateKey(const pcrypto::ecdh::PrivateKey& privateKey)
+{
+    private_key_ = EC_KEY_dup(privateKey.private_key_);
+    if (!private_key_)
+    {
+        std::string msg("Crypto Error (ecdh::PrivateKey() copy): Could not copy private key");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::ecdh::PrivateKey::PrivateKey (copy constructor)
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Move constructor
+// throws RuntimeError
+pcrypto::ecdh::PrivateKey::PrivateKey(pcrypto::ecdh::PrivateKey&& privateKey)
+{
+    private_key_ = privateKey.private_key_;
+    privateKey.private_key_ = nullptr;
+    if (!private_key_)
+    {
+        std::string msg("Crypto Error (ecdh::PrivateKey() move): Cannot move null private key");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::ecdh::PrivateKey::PrivateKey (move constructor)
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Destructor
+pcrypto::ecdh::PrivateKey::~PrivateKey()
+{
+    if (private_key_)
+        EC_KEY_free(private_key_);
+}  // pcrypto::ecdh::PrivateKey::~PrivateKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// assignment operator overload
+// throws RuntimeError
+pcrypto::ecdh::PrivateKey& pcrypto::ecdh::PrivateKey::operator=(
+    const pcrypto::ecdh::PrivateKey& privateKey)
+{
+    if (this == &privateKey)
+        return *this;
+    if (private_key_)
+        EC_KEY_free(private_key_);
+    private_key_ = EC_KEY_dup(privateKey.private_key_);
+    if (!private_key_)
+    {
+        std::string msg("Crypto Error (ecdh::PrivateKey operator =): Could not copy private key");
+        throw Error::RuntimeError(msg);
+    }
+    return *this;
+}  // pcrypto::ecdh::PrivateKey::operator =
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Deserialize ECDH Private Key
+// throws RuntimeError, ValueError
+void pcrypto::ecdh::PrivateKey::Deserialize(const std::string& encoded)
+{
+    EC_KEY* key = deserializeECDHPrivateKey(encoded);
+    if (private_key_)
+        EC_KEY_free(private_key_);
+    private_key_ = key;
+}  // pcrypto::ecdh::PrivateKey::Deserialize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Derive key agreement public key from private key
+// throws RuntimeError
+pcrypto::ecdh::PublicKey pcrypto::ecdh::PrivateKey::GetPublicKey() const
+{
+    PublicKey publicKey(*this);
+    return publicKey;
+}  // pcrypto::ecdh::GetPublicKey()
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Serialize ECDH PrivateKey
+// throws RuntimeError
+std::string pcrypto::ecdh::PrivateKey::Serialize() const
+{
+    BIO_ptr bio(BIO_new(BIO_s_mem()), BIO_free_all);
+    if (!bio)
+    {
+        std::string msg("Crypto Error (Serialize): Could not create BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (!PEM_write_bio_ECPrivateKey(bio.get(), private_key_, NULL, NULL, 0, 0, NULL))
+    {
+        std::string msg("Crypto Error (Serialize): Could not write to BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    int keylen = BIO_pending(bio.get());
+    ByteArray pem_str(keylen + 1);
+    if (!BIO_read(bio.get(), pem_str.data(), keylen))
+    {
+        std::string msg("Crypto Error (Serialize): Could not read BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    pem_str[keylen] = '\0';
+    std::string str(reinterpret_cast<char*>(pem_str.data()));
+    OPENSSL_cleanse(pem_str.data(), pem_str.size());
+
+    return str;
+}  // pcrypto::ecdh::PrivateKey::Serialize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Decrypt an envelope created by PublicKey::EncryptMessage
+// throws RuntimeError, ValueError, CryptoError
+ByteArray pcrypto::ecdh::PrivateKey::DecryptMessage(const ByteArray& ct) const
+{
+    if (!IsEnvelope(ct))
+    {
+        std::string msg("Crypto Error (DecryptMessage): Ciphertext is not an ECDH envelope");
+        throw Error::ValueError(msg);
+    }
+
+    const EC_GROUP* group = EC_KEY_get0_group(private_key_);
+    EC_POINT_ptr point(EC_POINT_new(group), EC_POINT_free);
+    BN_CTX_ptr context(BN_CTX_new(), BN_CTX_free);
+    if (!point || !context)
+    {
+        std::string msg("Crypto Error (DecryptMessage): Could not create EC_POINT");
+        throw Error::RuntimeError(msg);
+    }
+
+    // oct2point verifies that the point is on the curve
+    ByteArray ephemeral_point(ct.begin() + 1, ct.begin() + 1 + constants::ECDH_POINT_LEN);
+    if (!EC_POINT_oct2point(group, point.get(), ephemeral_point.data(), ephemeral_point.size(),
+            context.get()))
+    {
+        std::string msg("Crypto Error (DecryptMessage): Invalid ephemeral point");
+        throw Error::ValueError(msg);
+    }
+
+    ByteArray recipient_point = EncodePoint(private_key_);
+    ByteArray key = AgreeKey(private_key_, point.get(), ephemeral_point, recipient_point);
+
+    const uint8_t* encrypted = ct.data() + 1 + constants::ECDH_POINT_LEN;
+    size_t encrypted_size = ct.size() - 1 - constants::ECDH_POINT_LEN;
+
+    ByteArray message(skenc::DecryptedSize(encrypted_size));
+    skenc::CipherContext cipher(key);
+    OPENSSL_cleanse(key.data(), key.size());
+
+    cipher.Decrypt(encrypted, encrypted_size, message.data());
+    return message;
+}  // pcrypto::ecdh::PrivateKey::DecryptMessage
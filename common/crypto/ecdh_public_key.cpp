@@ -0,0 +1,255 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ecdh_public_key.h"
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "crypto_shared.h"
+#include "ecdh.h"
+#include "ecdh_private_key.h"
+#include "error.h"
+#include "skenc.h"
+/***Conditional compile untrusted/trusted***/
+#if _UNTRUSTED_
+#include <openssl/crypto.h>
+#include <stdio.h>
+#else
+#include "tSgxSSL_api.h"
+#endif
+/***END Conditional compile untrusted/trusted***/
+
+namespace pcrypto = pdo::crypto;
+namespace constants = pdo::crypto::constants;
+
+// Typedefs for memory management
+// Specify type and destroy function type for unique_ptrs
+typedef std::unique_ptr<BIO, void (*)(BIO*)> BIO_ptr;
+typedef std::unique_ptr<EC_KEY, void (*)(EC_KEY*)> EC_KEY_ptr;
+
+// Error handling
+namespace Error = pdo::error;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Utility function: deserialize ECDH Public Key
+// throws RuntimeError, ValueError
+static EC_KEY* deserializeECDHPublicKey(const std::string& encoded)
+{
+    BIO_ptr bio(BIO_new_mem_buf(encoded.c_str(), -1), BIO_free_all);
+    if (!bio)
+    {
+        std::string msg("Crypto Error (deserializeECDHPublicKey): Could not create BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    EC_KEY* public_key = PEM_read_bio_EC_PUBKEY(bio.get(), NULL, NULL, NULL);
+    if (!public_key)
+    {
+        std::string msg(
+            "Crypto Error (deserializeECDHPublicKey): Could not "
+            "deserialize public ECDH key");
+        throw Error::ValueError(msg);
+    }
+
+    if (EC_GROUP_get_curve_name(EC_KEY_get0_group(public_key)) != constants::ECDH_CURVE)
+    {
+        EC_KEY_free(public_key);
+        std::string msg("Crypto Error (deserializeECDHPublicKey): Wrong curve for ECDH key");
+        throw Error::ValueError(msg);
+    }
+
+    return public_key;
+}  // deserializeECDHPublicKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// constructor
+pcrypto::ecdh::PublicKey::PublicKey()
+{
+    public_key_ = nullptr;
+}  // pcrypto::ecdh::PublicKey::PublicKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Constructor from PrivateKey
+// throws RuntimeError
+pcrypto::ecdh::PublicKey::PublicKey(const pcrypto::ecdh::PrivateKey& privateKey)
+{
+    EC_KEY_ptr public_key(EC_KEY_new_by_curve_name(constants::ECDH_CURVE), EC_KEY_free);
+    if (!public_key)
+    {
+        std::string msg("Crypto Error (ecdh::PublicKey()): Could not create new public EC_KEY");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (!EC_KEY_set_public_key(
+            public_key.get(), EC_KEY_get0_public_key(privateKey.private_key_)))
+    {
+        std::string msg("Crypto Error (ecdh::PublicKey()): Could not set public EC_KEY");
+        throw Error::RuntimeError(msg);
+    }
+
+    public_key_ = public_key.release();
+}  // pcrypto::ecdh::PublicKey::PublicKey
+
+// Constructor from encoded string
+// throws RuntimeError, ValueError
+pcrypto::ecdh::PublicKey::PublicKey(const std::string& encoded)
+{
+    public_key_ = deserializeECDHPublicKey(encoded);
+}  // pcrypto::ecdh::PublicKey::PublicKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Copy constructor
+// throws RuntimeError
+pcrypto::ecdh::PublicKey::PublicKey(const pcrypto::ecdh::PublicKey& publicKey)
+{
+    public_key_ = EC_KEY_dup(publicKey.public_key_);
+    if (!public_key_)
+    {
+        std::string msg("Crypto Error (ecdh::PublicKey() copy): Could not copy public key");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::ecdh::PublicKey::PublicKey (copy constructor)
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Move constructor
+// throws RuntimeError
+pcrypto::ecdh::PublicKey::PublicKey(pcrypto::ecdh::PublicKey&& publicKey)
+{
+    public_key_ = publicKey.public_key_;
+    publicKey.public_key_ = nullptr;
+    if (!public_key_)
+    {
+        std::string msg("Crypto Error (ecdh::PublicKey() move): Cannot move null public key");
+        throw Error::RuntimeError(msg);
+    }
+}  // pcrypto::ecdh::PublicKey::PublicKey (move constructor)
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Destructor
+pcrypto::ecdh::PublicKey::~PublicKey()
+{
+    if (public_key_)
+        EC_KEY_free(public_key_);
+}  // pcrypto::ecdh::PublicKey::~PublicKey
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// assignment operator overload
+// throws RuntimeError
+pcrypto::ecdh::PublicKey& pcrypto::ecdh::PublicKey::operator=(
+    const pcrypto::ecdh::PublicKey& publicKey)
+{
+    if (this == &publicKey)
+        return *this;
+    if (public_key_)
+        EC_KEY_free(public_key_);
+    public_key_ = EC_KEY_dup(publicKey.public_key_);
+    if (!public_key_)
+    {
+        std::string msg("Crypto Error (ecdh::PublicKey::operator =): Could not copy public key");
+        throw Error::RuntimeError(msg);
+    }
+    return *this;
+}  // pcrypto::ecdh::PublicKey::operator =
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Deserialize Public Key
+// throws RuntimeError, ValueError
+void pcrypto::ecdh::PublicKey::Deserialize(const std::string& encoded)
+{
+    EC_KEY* key = deserializeECDHPublicKey(encoded);
+    if (public_key_)
+        EC_KEY_free(public_key_);
+    public_key_ = key;
+}  // pcrypto::ecdh::PublicKey::Deserialize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Serialize Public Key
+// throws RuntimeError
+std::string pcrypto::ecdh::PublicKey::Serialize() const
+{
+    if (public_key_ == nullptr)
+    {
+        std::string msg("Crypto Error (Serialize): PublicKey is not initialized");
+        throw Error::RuntimeError(msg);
+    }
+
+    BIO_ptr bio(BIO_new(BIO_s_mem()), BIO_free_all);
+    if (!bio)
+    {
+        std::string msg("Crypto Error (Serialize): Could not create BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (!PEM_write_bio_EC_PUBKEY(bio.get(), public_key_))
+    {
+        std::string msg("Crypto Error (Serialize): Could not write to BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    int keylen = BIO_pending(bio.get());
+    ByteArray pem_str(keylen + 1);
+    if (!BIO_read(bio.get(), pem_str.data(), keylen))
+    {
+        std::string msg("Crypto Error (Serialize): Could not read BIO");
+        throw Error::RuntimeError(msg);
+    }
+
+    pem_str[keylen] = '\0';
+    std::string str(reinterpret_cast<char*>(pem_str.data()));
+    return str;
+}  // pcrypto::ecdh::PublicKey::Serialize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Encrypt message to the public key with a fresh ephemeral key pair,
+// returns VERSION || EPHEMERAL POINT || IV || TAG || CIPHERTEXT
+// throws RuntimeError
+ByteArray pcrypto::ecdh::PublicKey::EncryptMessage(const ByteArray& message) const
+{
+    if (public_key_ == nullptr)
+    {
+        std::string msg("Crypto Error (EncryptMessage): PublicKey is not initialized");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (message.size() == 0)
+    {
+        std::string msg("Crypto Error (EncryptMessage): ECDH plaintext cannot be empty");
+        throw Error::RuntimeError(msg);
+    }
+
+    EC_KEY_ptr ephemeral_key(EC_KEY_new_by_curve_name(constants::ECDH_CURVE), EC_KEY_free);
+    if (!ephemeral_key || !EC_KEY_generate_key(ephemeral_key.get()))
+    {
+        std::string msg("Crypto Error (EncryptMessage): Could not generate ephemeral EC_KEY");
+        throw Error::RuntimeError(msg);
+    }
+
+    ByteArray ephemeral_point = EncodePoint(ephemeral_key.get());
+    ByteArray recipient_point = EncodePoint(public_key_);
+    ByteArray key = AgreeKey(ephemeral_key.get(), EC_KEY_get0_public_key(public_key_),
+        ephemeral_point, recipient_point);
+
+    ByteArray envelope(1 + ephemeral_point.size() + skenc::EncryptedSize(message.size()));
+    envelope[0] = constants::ECDH_ENVELOPE_VERSION;
+    std::copy(ephemeral_point.begin(), ephemeral_point.end(), envelope.begin() + 1);
+
+    skenc::CipherContext context(key);
+    context.Encrypt(message.data(), message.size(), envelope.data() + 1 + ephemeral_point.size());
+
+    OPENSSL_cleanse(key.data(), key.size());
+    return envelope;
+}  // pcrypto::ecdh::PublicKey::EncryptMessage
@@ -0,0 +1,65 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <openssl/ec.h>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace pdo
+{
+namespace crypto
+{
+    namespace ecdh
+    {
+        class PrivateKey;
+
+        class PublicKey
+        {
+            friend PrivateKey;
+
+        public:
+            // default constructor: UNINITIALIZED PublicKey!
+            PublicKey();
+            // copy constructor
+            // throws RuntimeError
+            PublicKey(const PublicKey& publicKey);
+            // move constructor
+            // throws RuntimeError
+            PublicKey(PublicKey&& publicKey);
+            // throws RuntimeError
+            PublicKey(const PrivateKey& privateKey);
+            // deserializing constructor
+            // throws RuntimeError, ValueError
+            PublicKey(const std::string& encoded);
+            ~PublicKey();
+            // throws RuntimeError
+            PublicKey& operator=(const PublicKey& publicKey);
+            // throws RuntimeError, ValueError
+            void Deserialize(const std::string& encoded);
+            // throws RuntimeError
+            std::string Serialize() const;
+            // Encrypt message.data() to the key with a fresh ephemeral key
+            // pair and return the envelope described in ecdh.h
+            // throws RuntimeError
+            ByteArray EncryptMessage(const ByteArray& message) const;
+
+        private:
+            EC_KEY* public_key_;
+        };
+    }
+}
+}
@@ -0,0 +1,144 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "merkle.h"
+#include <openssl/sha.h>
+#include <string>
+#include <vector>
+#include "crypto_shared.h"
+#include "error.h"
+
+namespace pcrypto = pdo::crypto;
+
+// Error handling
+namespace Error = pdo::error;
+
+//***Private functions***//
+
+static const unsigned char LEAF_PREFIX = 0x00;
+static const unsigned char NODE_PREFIX = 0x01;
+
+static ByteArray HashNode(const ByteArray& left, const ByteArray& right)
+{
+    ByteArray hash(SHA256_DIGEST_LENGTH);
+
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    SHA256_Update(&sha256, &NODE_PREFIX, 1);
+    SHA256_Update(&sha256, left.data(), left.size());
+    SHA256_Update(&sha256, right.data(), right.size());
+    SHA256_Final(hash.data(), &sha256);
+
+    return hash;
+}  // HashNode
+
+static void ReduceLevel(std::vector<ByteArray>& level)
+{
+    size_t count = level.size();
+    for (size_t i = 0; i < count / 2; i++)
+        level[i] = HashNode(level[2 * i], level[2 * i + 1]);
+
+    if (count % 2)
+        level[count / 2] = level[count - 1];
+
+    level.resize((count + 1) / 2);
+}  // ReduceLevel
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray pcrypto::merkle::ComputeLeafHash(const ByteArray& data)
+{
+    ByteArray hash(SHA256_DIGEST_LENGTH);
+
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+    SHA256_Update(&sha256, &LEAF_PREFIX, 1);
+    SHA256_Update(&sha256, data.data(), data.size());
+    SHA256_Final(hash.data(), &sha256);
+
+    return hash;
+}  // pcrypto::merkle::ComputeLeafHash
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws: ValueError
+ByteArray pcrypto::merkle::ComputeRoot(const std::vector<ByteArray>& leaf_hashes)
+{
+    if (leaf_hashes.size() == 0)
+    {
+        std::string msg("Crypto Error (ComputeRoot): no leaves");
+        throw Error::ValueError(msg);
+    }
+
+    std::vector<ByteArray> level(leaf_hashes);
+    while (level.size() > 1)
+        ReduceLevel(level);
+
+    return level[0];
+}  // pcrypto::merkle::ComputeRoot
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws: ValueError
+std::vector<ByteArray> pcrypto::merkle::ComputeProof(
+    const std::vector<ByteArray>& leaf_hashes, size_t index)
+{
+    if (index >= leaf_hashes.size())
+    {
+        std::string msg("Crypto Error (ComputeProof): leaf index out of range");
+        throw Error::ValueError(msg);
+    }
+
+    std::vector<ByteArray> proof;
+    std::vector<ByteArray> level(leaf_hashes);
+    while (level.size() > 1)
+    {
+        size_t sibling = index ^ 1;
+        if (sibling < level.size())
+            proof.push_back(level[sibling]);
+
+        ReduceLevel(level);
+        index /= 2;
+    }
+
+    return proof;
+}  // pcrypto::merkle::ComputeProof
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool pcrypto::merkle::VerifyProof(const ByteArray& root,
+    const ByteArray& leaf_hash,
+    size_t index,
+    size_t leaf_count,
+    const std::vector<ByteArray>& proof)
+{
+    if (index >= leaf_count)
+        return false;
+
+    ByteArray hash(leaf_hash);
+    std::vector<ByteArray>::const_iterator sibling = proof.begin();
+    for (size_t count = leaf_count; count > 1; count = (count + 1) / 2)
+    {
+        // the last node of an odd level is promoted without a sibling
+        if ((index ^ 1) < count)
+        {
+            if (sibling == proof.end())
+                return false;
+
+            hash = (index & 1) ? HashNode(*sibling, hash) : HashNode(hash, *sibling);
+            sibling++;
+        }
+
+        index /= 2;
+    }
+
+    return sibling == proof.end() && hash == root;
+}  // pcrypto::merkle::VerifyProof
@@ -0,0 +1,51 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+#include "types.h"
+
+namespace pdo
+{
+namespace crypto
+{
+    // Binary Merkle tree over SHA256. Leaves and interior nodes are hashed
+    // with distinct prefixes (0x00 and 0x01) so a leaf can never be passed
+    // off as an interior node; a node without a sibling is promoted to the
+    // next level unchanged.
+    namespace merkle
+    {
+        ByteArray ComputeLeafHash(const ByteArray& data);
+
+        // throws ValueError
+        ByteArray ComputeRoot(const std::vector<ByteArray>& leaf_hashes);
+
+        // Sibling hashes from the leaf up to (but excluding) the root;
+        // levels where the node was promoted contribute nothing
+        // throws ValueError
+        std::vector<ByteArray> ComputeProof(
+            const std::vector<ByteArray>& leaf_hashes, size_t index);
+
+        // true if leaf_hash is leaf number index of a tree with leaf_count
+        // leaves and the given root
+        bool VerifyProof(const ByteArray& root,
+            const ByteArray& leaf_hash,
+            size_t index,
+            size_t leaf_count,
+            const std::vector<ByteArray>& proof);
+    }
+}
+}
@@ -61,6 +61,50 @@ static void SHA256Hash(
     SHA256_Final(hash, &sha256);
 }  // pcrypto::SHA256Hash
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Order of the signing curve and half of it, used to canonicalize s
+class CurveOrder
+{
+public:
+    BIGNUM* order_;
+    BIGNUM* half_order_;
+
+    // throws RuntimeError
+    CurveOrder()
+    {
+        EC_GROUP_ptr ec_group(EC_GROUP_new_by_curve_name(constants::CURVE), EC_GROUP_clear_free);
+        BIGNUM_ptr order(BN_new(), BN_free);
+        BIGNUM_ptr half_order(BN_new(), BN_free);
+        if (!ec_group || !order || !half_order)
+        {
+            std::string msg("Crypto Error (CurveOrder): Could not allocate curve order");
+            throw Error::RuntimeError(msg);
+        }
+
+        if (!EC_GROUP_get_order(ec_group.get(), order.get(), NULL) ||
+            !BN_rshift(half_order.get(), order.get(), 1))
+        {
+            std::string msg("Crypto Error (CurveOrder): Could not compute curve order");
+            throw Error::RuntimeError(msg);
+        }
+
+        order_ = order.release();
+        half_order_ = half_order.release();
+    }
+
+    ~CurveOrder()
+    {
+        BN_free(order_);
+        BN_free(half_order_);
+    }
+};
+
+static const CurveOrder& GetCurveOrder()
+{
+    static CurveOrder order;
+    return order;
+}  // GetCurveOrder
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // Utility function: Deserialize ECDSA Private Key
 // throws RuntimeError, ValueError
@@ -254,74 +298,51 @@ ByteArray pcrypto::sig::PrivateKey::SignMessage(const ByteArray& message) const
     }
     const BIGNUM* sc;
     const BIGNUM* rc;
-    BIGNUM* r = nullptr;
-    BIGNUM* s = nullptr;
 
     ECDSA_SIG_get0(sig.get(), &rc, &sc);
 
-    s = BN_dup(sc);
-    if (!s)
-    {
-        std::string msg("Crypto Error (SignMessage): Could not dup BIGNUM for s");
-        throw Error::RuntimeError(msg);
-    }
-    r = BN_dup(rc);
-    if (!r)
-    {
-        std::string msg("Crypto Error (SignMessage): Could not dup BIGNUM for r");
-        throw Error::RuntimeError(msg);
-    }
-    BIGNUM_ptr ord(BN_new(), BN_free);
-    if (!ord)
-    {
-        std::string msg("Crypto Error (SignMessage): Could not create BIGNUM for ord");
-        throw Error::RuntimeError(msg);
-    }
-
-    BIGNUM_ptr ordh(BN_new(), BN_free);
-    if (!ordh)
+    // canonicalize to low s; the group order is computed once since every
+    // key uses the same curve, and new BIGNUMs are needed only when s is
+    // actually replaced
+    const CurveOrder& order = GetCurveOrder();
+    if (BN_cmp(sc, order.half_order_) >= 0)
     {
-        std::string msg("Crypto Error (SignMessage): Could not create BIGNUM for ordh");
-        throw Error::RuntimeError(msg);
-    }
-
-    int res = EC_GROUP_get_order(EC_KEY_get0_group(private_key_), ord.get(), NULL);
-    if (!res)
-    {
-        std::string msg("Crypto Error (SignMessage): Could not get order");
-        throw Error::RuntimeError(msg);
-    }
-
-    res = BN_rshift(ordh.get(), ord.get(), 1);
+        BIGNUM_ptr s(BN_new(), BN_free);
+        if (!s)
+        {
+            std::string msg("Crypto Error (SignMessage): Could not create BIGNUM for s");
+            throw Error::RuntimeError(msg);
+        }
 
-    if (!res)
-    {
-        std::string msg("Crypto Error (SignMessage): Could not shft order BN");
-        throw Error::RuntimeError(msg);
-    }
+        BIGNUM_ptr r(BN_dup(rc), BN_free);
+        if (!r)
+        {
+            std::string msg("Crypto Error (SignMessage): Could not dup BIGNUM for r");
+            throw Error::RuntimeError(msg);
+        }
 
-    if (BN_cmp(s, ordh.get()) >= 0)
-    {
-        res = BN_sub(s, ord.get(), s);
-        if (!res)
+        if (!BN_sub(s.get(), order.order_, sc))
         {
             std::string msg("Crypto Error (SignMessage): Could not sub BNs");
             throw Error::RuntimeError(msg);
         }
-    }
 
-    res = ECDSA_SIG_set0(sig.get(), r, s);
-    if (!res)
-    {
-        std::string msg("Crypto Error (SignMessage): Could not set r and s");
-        throw Error::RuntimeError(msg);
+        if (!ECDSA_SIG_set0(sig.get(), r.get(), s.get()))
+        {
+            std::string msg("Crypto Error (SignMessage): Could not set r and s");
+            throw Error::RuntimeError(msg);
+        }
+
+        // the signature owns r and s now
+        r.release();
+        s.release();
     }
 
     // The -1 here is because we canonoicalize the signature as in Bitcoin
     unsigned int der_sig_size = i2d_ECDSA_SIG(sig.get(), nullptr);
     ByteArray der_SIG(der_sig_size, 0);
     unsigned char* data = der_SIG.data();
-    res = i2d_ECDSA_SIG(sig.get(), &data);
+    int res = i2d_ECDSA_SIG(sig.get(), &data);
 
     if (!res)
     {
@@ -89,35 +89,105 @@ ByteArray pcrypto::skenc::GenerateIV(const std::string& IVstring)
 }  // pcrypto::skenc::GenerateIV
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// Encrypt message.data() using authenticated encryption
-// throws RuntimeError, ValueError
-ByteArray pcrypto::skenc::EncryptMessage(
-    const ByteArray& key, const ByteArray& iv, const ByteArray& message)
+// Fill iv with IV_LEN random bytes
+// throws RuntimeError
+static void RandomIV(uint8_t* iv)
+{
+    char err[constants::ERR_BUF_LEN];
+
+    if (RAND_bytes(iv, constants::IV_LEN) != 1)
+    {
+        std::string msg("Crypto Error (RandomIV): ");
+        ERR_load_crypto_strings();
+        ERR_error_string(ERR_get_error(), err);
+        msg += err;
+        throw Error::RuntimeError(msg);
+    }
+}  // RandomIV
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Authenticated decryption with a context that already holds the key,
+// the first prefix_size bytes of plaintext are written to prefix and
+// the rest to out
+// throws RuntimeError, CryptoError
+static void DecryptWithContext(EVP_CIPHER_CTX* context,
+    const uint8_t* iv,
+    const uint8_t* tag,
+    const uint8_t* message,
+    size_t message_size,
+    uint8_t* prefix,
+    size_t prefix_size,
+    uint8_t* out)
 {
-    unsigned char tag[constants::TAG_LEN];
+    unsigned char final_block[EVP_MAX_BLOCK_LENGTH];
     int len;
-    int ct_len;
-    int pt_len = message.size();
-    unsigned char* pt = (unsigned char*)message.data();
-    int ct_buf_len = pt_len + EVP_MAX_BLOCK_LENGTH;
 
-    ByteArray ct(ct_buf_len);
+    if (!EVP_DecryptInit_ex(context, NULL, NULL, NULL, iv))
+    {
+        std::string msg("Crypto Error (Decrypt): OpenSSL could not initialize AES-GCM IV");
+        throw Error::RuntimeError(msg);
+    }
 
-    if (key.size() != constants::SYM_KEY_LEN)
+    if (!EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG, constants::TAG_LEN, (void*)tag))
     {
-        std::string msg("Crypto Error (EncryptMessage): Wrong AES-GCM key length");
-        throw Error::ValueError(msg);
+        std::string msg("Crypto Error (Decrypt): OpenSSL could not set AES-GCM TAG");
+        throw Error::RuntimeError(msg);
     }
 
-    if (iv.size() != constants::IV_LEN)
+    if (prefix_size > 0 && !EVP_DecryptUpdate(context, prefix, &len, message, prefix_size))
     {
-        std::string msg("Crypto Error (EncryptMessage): Wrong AES-GCM IV length");
+        std::string msg("Crypto Error (Decrypt): OpenSSL could not decrypt with AES-GCM");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (message_size > prefix_size && !EVP_DecryptUpdate(context, out, &len,
+                                          message + prefix_size, message_size - prefix_size))
+    {
+        std::string msg("Crypto Error (Decrypt): OpenSSL could not decrypt with AES-GCM");
+        throw Error::RuntimeError(msg);
+    }
+
+    if (EVP_DecryptFinal_ex(context, final_block, &len) < 1)
+    {
+        std::string msg(
+            "Crypto Error (Decrypt): AES_GCM authentication "
+            "failed, plaintext is not "
+            "trustworthy");
+        throw Error::CryptoError(msg);
+    }
+}  // DecryptWithContext
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t pcrypto::skenc::EncryptedSize(size_t message_size)
+{
+    return message_size + constants::IV_TAG_LEN;
+}  // pcrypto::skenc::EncryptedSize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws ValueError
+size_t pcrypto::skenc::DecryptedSize(size_t encrypted_size)
+{
+    if (encrypted_size < constants::IV_TAG_LEN)
+    {
+        std::string msg(
+            "Crypto Error (DecryptedSize): AES-GCM message smaller "
+            "than minimum length (IV length + TAG "
+            "length)");
         throw Error::ValueError(msg);
     }
 
-    if (message.size() == 0)
+    return encrypted_size - constants::IV_TAG_LEN;
+}  // pcrypto::skenc::DecryptedSize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Create an AES-GCM encryption or decryption context with the key
+// already expanded, the caller owns the context
+// throws RuntimeError, ValueError
+static EVP_CIPHER_CTX* CreateKeyedContext(const ByteArray& key, bool encrypt)
+{
+    if (key.size() != constants::SYM_KEY_LEN)
     {
-        std::string msg("Crypto Error (EncryptMessage): Cannot encrypt the empty message");
+        std::string msg("Crypto Error (CipherContext): Wrong AES-GCM key length");
         throw Error::ValueError(msg);
     }
 
@@ -125,267 +195,379 @@ ByteArray pcrypto::skenc::EncryptMessage(
     if (!context)
     {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not create "
+            "Crypto Error (CipherContext): OpenSSL could not create "
             "new EVP_CIPHER_CTX");
         throw Error::RuntimeError(msg);
     }
 
-    if (EVP_EncryptInit_ex(context.get(), EVP_aes_128_gcm(), NULL, NULL, NULL) != 1)
+    if (EVP_CipherInit_ex(context.get(), EVP_aes_128_gcm(), NULL,
+            (const unsigned char*)key.data(), NULL, encrypt ? 1 : 0) != 1)
     {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not "
+            "Crypto Error (CipherContext): OpenSSL could not "
             "initialize EVP_CIPHER_CTX with "
-            "AES-GCM");
+            "AES-GCM key");
         throw Error::RuntimeError(msg);
     }
 
-    if (EVP_EncryptInit_ex(context.get(), NULL, NULL, (const unsigned char*)key.data(),
-            (const unsigned char*)iv.data()) != 1)
+    return context.release();
+}  // CreateKeyedContext
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Create encryption and decryption contexts and expand the key once
+// throws RuntimeError, ValueError
+pcrypto::skenc::CipherContext::CipherContext(const ByteArray& key)
+{
+    CTX_ptr encrypt_context(CreateKeyedContext(key, true), EVP_CIPHER_CTX_free);
+    decrypt_context_ = CreateKeyedContext(key, false);
+    encrypt_context_ = encrypt_context.release();
+}  // pcrypto::skenc::CipherContext::CipherContext
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pcrypto::skenc::CipherContext::~CipherContext()
+{
+    EVP_CIPHER_CTX_free(encrypt_context_);
+    EVP_CIPHER_CTX_free(decrypt_context_);
+}  // pcrypto::skenc::CipherContext::~CipherContext
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, ValueError
+void pcrypto::skenc::CipherContext::Encrypt(const uint8_t* iv,
+    const uint8_t* message,
+    size_t message_size,
+    uint8_t* tag,
+    uint8_t* out)
+{
+    unsigned char final_block[EVP_MAX_BLOCK_LENGTH];
+    int len;
+
+    if (message_size == 0)
     {
-        std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not "
-            "initialize AES-GCM key and IV");
+        std::string msg("Crypto Error (Encrypt): Cannot encrypt the empty message");
+        throw Error::ValueError(msg);
+    }
+
+    if (EVP_EncryptInit_ex(encrypt_context_, NULL, NULL, NULL, iv) != 1)
+    {
+        std::string msg("Crypto Error (Encrypt): OpenSSL could not initialize AES-GCM IV");
         throw Error::RuntimeError(msg);
     }
 
-    if (EVP_EncryptUpdate(context.get(), ct.data(), &len, pt, pt_len) != 1)
+    if (EVP_EncryptUpdate(encrypt_context_, out, &len, message, message_size) != 1)
     {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not update "
+            "Crypto Error (Encrypt): OpenSSL could not update "
             "AES-GCM encryption");
         throw Error::RuntimeError(msg);
     }
-    ct_len = len;
-    if (EVP_EncryptFinal_ex(context.get(), ct.data() + len, &len) != 1)
+
+    // GCM is a stream mode, finalizing never produces more output
+    if (EVP_EncryptFinal_ex(encrypt_context_, final_block, &len) != 1)
     {
         std::string msg(
-            "Crypto Error (EncryptMessage): OpenSSL could not finalize "
+            "Crypto Error (Encrypt): OpenSSL could not finalize "
             "AES-GCM encryption");
         throw Error::RuntimeError(msg);
     }
-    ct_len += len;
 
-    if (EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_GET_TAG, constants::TAG_LEN, tag) != 1)
+    if (EVP_CIPHER_CTX_ctrl(encrypt_context_, EVP_CTRL_GCM_GET_TAG, constants::TAG_LEN, tag) != 1)
     {
-        std::string msg("Crypto Error (EncryptMessage): OpenSSL could not get AES-GCM TAG");
+        std::string msg("Crypto Error (Encrypt): OpenSSL could not get AES-GCM TAG");
         throw Error::RuntimeError(msg);
     }
-    ct.resize(ct_len);
-    ByteArray out;
-    out.insert(out.end(), tag, tag + constants::TAG_LEN);
-    // build output string
-    out.insert(out.end(), ct.begin(), ct.end());
+}  // pcrypto::skenc::CipherContext::Encrypt
 
-    return out;
-}  // pcrypto::skenc::EncryptMessage
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, ValueError
+void pcrypto::skenc::CipherContext::Encrypt(
+    const uint8_t* message, size_t message_size, uint8_t* out)
+{
+    RandomIV(out);
+    Encrypt(out, message, message_size, out + constants::IV_LEN, out + constants::IV_TAG_LEN);
+}  // pcrypto::skenc::CipherContext::Encrypt
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// Encrypt message.data() using authenticated encryption with random IV
-// prepended to ciphertext
 // throws RuntimeError, ValueError
-ByteArray pcrypto::skenc::EncryptMessage(const ByteArray& key, const ByteArray& message)
+void pcrypto::skenc::CipherContext::EncryptInPlace(uint8_t* buffer, size_t buffer_size)
 {
-    if (message.size() == 0)
+    if (buffer_size <= constants::IV_TAG_LEN)
     {
-        std::string msg("Crypto Error (EncryptMessage): Cannot encrypt the empty message");
+        std::string msg("Crypto Error (EncryptInPlace): Cannot encrypt the empty message");
         throw Error::ValueError(msg);
     }
 
-    if (key.size() != constants::SYM_KEY_LEN)
+    uint8_t* message = buffer + constants::IV_TAG_LEN;
+    RandomIV(buffer);
+    Encrypt(buffer, message, buffer_size - constants::IV_TAG_LEN, buffer + constants::IV_LEN,
+        message);
+}  // pcrypto::skenc::CipherContext::EncryptInPlace
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, CryptoError
+void pcrypto::skenc::CipherContext::Decrypt(const uint8_t* iv,
+    const uint8_t* tag,
+    const uint8_t* message,
+    size_t message_size,
+    uint8_t* out)
+{
+    DecryptWithContext(decrypt_context_, iv, tag, message, message_size, NULL, 0, out);
+}  // pcrypto::skenc::CipherContext::Decrypt
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, ValueError, CryptoError
+size_t pcrypto::skenc::CipherContext::Decrypt(
+    const uint8_t* message, size_t message_size, uint8_t* out)
+{
+    return Decrypt(message, message_size, NULL, 0, out);
+}  // pcrypto::skenc::CipherContext::Decrypt
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, ValueError, CryptoError
+size_t pcrypto::skenc::CipherContext::Decrypt(const uint8_t* message,
+    size_t message_size,
+    uint8_t* prefix,
+    size_t prefix_size,
+    uint8_t* out)
+{
+    size_t pt_size = DecryptedSize(message_size);
+    if (prefix_size > pt_size)
     {
-        std::string msg("Crypto Error (EncryptMessage): Wrong AES-GCM key length");
+        std::string msg("Crypto Error (Decrypt): AES-GCM message shorter than expected prefix");
         throw Error::ValueError(msg);
     }
 
-    ByteArray iv = pcrypto::skenc::GenerateIV();
-    ByteArray ct = pcrypto::skenc::EncryptMessage(key, iv, message);
-    ct.insert(ct.begin(), iv.begin(), iv.end());
-    return ct;
-}  // pcrypto::skenc::EncryptMessage
+    DecryptWithContext(decrypt_context_, message, message + constants::IV_LEN,
+        message + constants::IV_TAG_LEN, pt_size, prefix, prefix_size, out);
+    return pt_size - prefix_size;
+}  // pcrypto::skenc::CipherContext::Decrypt
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// Decrypt message.data() using authenticated decryption
-// throwss RuntimeError, ValueError, CryptoError
-ByteArray pcrypto::skenc::DecryptMessage(
-    const ByteArray& key, const ByteArray& iv, const ByteArray& message)
+// throws RuntimeError, ValueError, CryptoError
+size_t pcrypto::skenc::CipherContext::DecryptInPlace(uint8_t* buffer, size_t buffer_size)
 {
-    int res;
-    unsigned char* ct = (unsigned char*)message.data();
-    int len;
-    int ct_len = message.size();
-    int pt_len = ct_len - constants::TAG_LEN;
-    int pt_buf_len = ct_len;
-    ByteArray pt(pt_buf_len);
-    if (key.size() != constants::SYM_KEY_LEN)
+    size_t pt_size = DecryptedSize(buffer_size);
+    uint8_t* message = buffer + constants::IV_TAG_LEN;
+    DecryptWithContext(decrypt_context_, buffer, buffer + constants::IV_LEN, message, pt_size,
+        NULL, 0, message);
+    return pt_size;
+}  // pcrypto::skenc::CipherContext::DecryptInPlace
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, ValueError
+pcrypto::skenc::StreamEncryptor::StreamEncryptor(const ByteArray& key)
+    : context_(CreateKeyedContext(key, true)), message_size_(0)
+{
+}  // pcrypto::skenc::StreamEncryptor::StreamEncryptor
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pcrypto::skenc::StreamEncryptor::~StreamEncryptor()
+{
+    EVP_CIPHER_CTX_free(context_);
+}  // pcrypto::skenc::StreamEncryptor::~StreamEncryptor
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError
+void pcrypto::skenc::StreamEncryptor::Begin(uint8_t* header)
+{
+    RandomIV(header);
+    message_size_ = 0;
+
+    if (EVP_EncryptInit_ex(context_, NULL, NULL, NULL, header) != 1)
     {
-        std::string msg("Crypto Error (DecryptMessage): Wrong AES-GCM key length");
-        throw Error::ValueError(msg);
+        std::string msg("Crypto Error (StreamEncryptor): OpenSSL could not initialize AES-GCM IV");
+        throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamEncryptor::Begin
 
-    if (iv.size() != constants::IV_LEN)
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError
+void pcrypto::skenc::StreamEncryptor::Update(
+    const uint8_t* message, size_t message_size, uint8_t* out)
+{
+    int len;
+
+    if (message_size == 0)
+        return;
+
+    if (EVP_EncryptUpdate(context_, out, &len, message, message_size) != 1)
     {
-        std::string msg("Crypto Error (DecryptMessage): Wrong AES-GCM IV length");
-        throw Error::ValueError(msg);
+        std::string msg(
+            "Crypto Error (StreamEncryptor): OpenSSL could not update "
+            "AES-GCM encryption");
+        throw Error::RuntimeError(msg);
     }
 
-    if (message.size() < constants::TAG_LEN)
+    message_size_ += message_size;
+}  // pcrypto::skenc::StreamEncryptor::Update
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, ValueError
+void pcrypto::skenc::StreamEncryptor::Finish(uint8_t* header)
+{
+    unsigned char final_block[EVP_MAX_BLOCK_LENGTH];
+    int len;
+
+    if (message_size_ == 0)
     {
-        std::string msg(
-            "Crypto Error (DecryptMessage): AES-GCM message smaller "
-            "than minimum length (TAG "
-            "length)");
+        std::string msg("Crypto Error (StreamEncryptor): Cannot encrypt the empty message");
         throw Error::ValueError(msg);
     }
 
-    CTX_ptr context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-    if (!context)
+    if (EVP_EncryptFinal_ex(context_, final_block, &len) != 1)
     {
         std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not create "
-            "new EVP_CIPHER_CTX");
+            "Crypto Error (StreamEncryptor): OpenSSL could not finalize "
+            "AES-GCM encryption");
         throw Error::RuntimeError(msg);
     }
 
-    if (!EVP_DecryptInit_ex(context.get(), EVP_aes_128_gcm(), NULL, NULL, NULL))
+    if (EVP_CIPHER_CTX_ctrl(context_, EVP_CTRL_GCM_GET_TAG, constants::TAG_LEN,
+            header + constants::IV_LEN) != 1)
     {
-        std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not "
-            "initialize EVP_CIPHER_CTX with "
-            "AES-GCM");
+        std::string msg("Crypto Error (StreamEncryptor): OpenSSL could not get AES-GCM TAG");
         throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamEncryptor::Finish
 
-    if (!EVP_DecryptInit_ex(context.get(), NULL, NULL, (const unsigned char*)key.data(),
-            (const unsigned char*)iv.data()))
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError, ValueError
+pcrypto::skenc::StreamDecryptor::StreamDecryptor(const ByteArray& key)
+    : context_(CreateKeyedContext(key, false))
+{
+}  // pcrypto::skenc::StreamDecryptor::StreamDecryptor
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pcrypto::skenc::StreamDecryptor::~StreamDecryptor()
+{
+    EVP_CIPHER_CTX_free(context_);
+}  // pcrypto::skenc::StreamDecryptor::~StreamDecryptor
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError
+void pcrypto::skenc::StreamDecryptor::Begin(const uint8_t* header)
+{
+    if (!EVP_DecryptInit_ex(context_, NULL, NULL, NULL, header))
     {
-        std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not "
-            "initialize AES-GCM key and IV");
+        std::string msg("Crypto Error (StreamDecryptor): OpenSSL could not initialize AES-GCM IV");
         throw Error::RuntimeError(msg);
     }
 
-    if (!EVP_DecryptUpdate(
-            context.get(), pt.data(), &len, ct + constants::TAG_LEN, ct_len - constants::TAG_LEN))
+    if (!EVP_CIPHER_CTX_ctrl(context_, EVP_CTRL_GCM_SET_TAG, constants::TAG_LEN,
+            (void*)(header + constants::IV_LEN)))
     {
-        std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not decrypt "
-            "with AES-GCM");
+        std::string msg("Crypto Error (StreamDecryptor): OpenSSL could not set AES-GCM TAG");
         throw Error::RuntimeError(msg);
     }
-    pt_len = len;
+}  // pcrypto::skenc::StreamDecryptor::Begin
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws RuntimeError
+void pcrypto::skenc::StreamDecryptor::Update(
+    const uint8_t* message, size_t message_size, uint8_t* out)
+{
+    int len;
+
+    if (message_size == 0)
+        return;
 
-    if (!EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_SET_TAG, constants::TAG_LEN, ct))
+    if (!EVP_DecryptUpdate(context_, out, &len, message, message_size))
     {
-        std::string msg("Crypto Error (DecryptMessage): OpenSSL could not get AES-GCM TAG");
+        std::string msg(
+            "Crypto Error (StreamDecryptor): OpenSSL could not decrypt "
+            "with AES-GCM");
         throw Error::RuntimeError(msg);
     }
+}  // pcrypto::skenc::StreamDecryptor::Update
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// throws CryptoError
+void pcrypto::skenc::StreamDecryptor::Finish(void)
+{
+    unsigned char final_block[EVP_MAX_BLOCK_LENGTH];
+    int len;
 
-    res = EVP_DecryptFinal_ex(context.get(), pt.data() + len, &len);
-    if (res < 1)
+    if (EVP_DecryptFinal_ex(context_, final_block, &len) < 1)
     {
         std::string msg(
-            "Crypto Error (DecryptMessage): AES_GCM authentication "
+            "Crypto Error (StreamDecryptor): AES_GCM authentication "
             "failed, plaintext is not "
             "trustworthy");
         throw Error::CryptoError(msg);
     }
-    else
-    {
-        pt_len += len;
-        // build output string
-    }
-    pt.resize(pt_len);
-    return pt;
-}  // pcrypto::skenc::DecryptMessage
+}  // pcrypto::skenc::StreamDecryptor::Finish
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-// Decrypt message.data() using authenticated encryption
-// expects IV prepended to message ciphertext
+// Encrypt message.data() using authenticated encryption
 // throws RuntimeError, ValueError
-ByteArray pcrypto::skenc::DecryptMessage(const ByteArray& key, const ByteArray& message)
+ByteArray pcrypto::skenc::EncryptMessage(
+    const ByteArray& key, const ByteArray& iv, const ByteArray& message)
 {
-    int res;
-    unsigned char* ct = (unsigned char*)message.data();
-    int len;
-    int ct_len = message.size();
-    int pt_len = ct_len - constants::TAG_LEN;
-    int pt_buf_len = ct_len;
-    ByteArray pt(pt_buf_len);
+    CipherContext context(key);
 
-    if (key.size() != constants::SYM_KEY_LEN)
+    if (iv.size() != constants::IV_LEN)
     {
-        std::string msg("Crypto Error (DecryptMessage): Wrong AES-GCM key length");
+        std::string msg("Crypto Error (EncryptMessage): Wrong AES-GCM IV length");
         throw Error::ValueError(msg);
     }
 
-    if (message.size() < constants::IV_LEN + constants::TAG_LEN)
-    {
-        std::string msg(
-            "Crypto Error (DecryptMessage): AES-GCM message smaller "
-            "than minimum length (IV length + TAG "
-            "length)");
-        throw Error::ValueError(msg);
-    }
+    // build output string as TAG || CT
+    ByteArray out(constants::TAG_LEN + message.size());
+    context.Encrypt(
+        iv.data(), message.data(), message.size(), out.data(), out.data() + constants::TAG_LEN);
+    return out;
+}  // pcrypto::skenc::EncryptMessage
 
-    CTX_ptr context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
-    if (!context)
-    {
-        std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not create "
-            "new EVP_CIPHER_CTX");
-        throw Error::RuntimeError(msg);
-    }
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Encrypt message.data() using authenticated encryption with random IV
+// prepended to ciphertext
+// throws RuntimeError, ValueError
+ByteArray pcrypto::skenc::EncryptMessage(const ByteArray& key, const ByteArray& message)
+{
+    CipherContext context(key);
 
-    if (!EVP_DecryptInit_ex(context.get(), EVP_aes_128_gcm(), NULL, NULL, NULL))
-    {
-        std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not "
-            "initialize EVP_CIPHER_CTX with "
-            "AES-GCM");
-        throw Error::RuntimeError(msg);
-    }
+    ByteArray out(EncryptedSize(message.size()));
+    context.Encrypt(message.data(), message.size(), out.data());
+    return out;
+}  // pcrypto::skenc::EncryptMessage
 
-    if (!EVP_DecryptInit_ex(context.get(), NULL, NULL, (const unsigned char*)key.data(),
-            (const unsigned char*)message.data()))
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Decrypt message.data() using authenticated decryption
+// throwss RuntimeError, ValueError, CryptoError
+ByteArray pcrypto::skenc::DecryptMessage(
+    const ByteArray& key, const ByteArray& iv, const ByteArray& message)
+{
+    CipherContext context(key);
+
+    if (iv.size() != constants::IV_LEN)
     {
-        std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not "
-            "initialize AES-GCM key and IV");
-        throw Error::RuntimeError(msg);
+        std::string msg("Crypto Error (DecryptMessage): Wrong AES-GCM IV length");
+        throw Error::ValueError(msg);
     }
 
-    if (!EVP_DecryptUpdate(context.get(), pt.data(), &len,
-            ct + constants::IV_LEN + constants::TAG_LEN,
-            ct_len - constants::IV_LEN - constants::TAG_LEN))
+    if (message.size() < constants::TAG_LEN)
     {
         std::string msg(
-            "Crypto Error (DecryptMessage): OpenSSL could not decrypt "
-            "with AES-GCM");
-        throw Error::RuntimeError(msg);
+            "Crypto Error (DecryptMessage): AES-GCM message smaller "
+            "than minimum length (TAG "
+            "length)");
+        throw Error::ValueError(msg);
     }
-    pt_len = len;
 
-    if (!EVP_CIPHER_CTX_ctrl(
-            context.get(), EVP_CTRL_GCM_SET_TAG, constants::TAG_LEN, ct + constants::IV_LEN))
-    {
-        std::string msg("Crypto Error (DecryptMessage): OpenSSL could not get AES-GCM TAG");
-        throw Error::RuntimeError(msg);
-    }
+    ByteArray pt(message.size() - constants::TAG_LEN);
+    context.Decrypt(iv.data(), message.data(), message.data() + constants::TAG_LEN, pt.size(),
+        pt.data());
+    return pt;
+}  // pcrypto::skenc::DecryptMessage
 
-    res = EVP_DecryptFinal_ex(context.get(), pt.data() + len, &len);
-    if (res < 1)
-    {
-        std::string msg(
-            "Crypto Error (DecryptMessage): AES_GCM authentication "
-            "failed, plaintext is not "
-            "trustworthy");
-        throw Error::CryptoError(msg);
-    }
-    else
-    {
-        pt_len += len;
-        // build output string
-    }
-    pt.resize(pt_len);
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Decrypt message.data() using authenticated encryption
+// expects IV prepended to message ciphertext
+// throws RuntimeError, ValueError
+ByteArray pcrypto::skenc::DecryptMessage(const ByteArray& key, const ByteArray& message)
+{
+    CipherContext context(key);
+
+    ByteArray pt(DecryptedSize(message.size()));
+    context.Decrypt(message.data(), message.size(), pt.data());
     return pt;
-}  // pcrypto::skenc::EncryptMessage
+}  // pcrypto::skenc::DecryptMessage
@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <openssl/evp.h>
 #include <string>
 #include <vector>
 #include "types.h"
@@ -29,6 +30,7 @@ namespace crypto
         const int IV_LEN = 12;       // AES-GCM IV length
         const int SYM_KEY_LEN = 16;  // AES-GCM Key length. move to 32 for post-quantum security
         const int TAG_LEN = 16;      // AES-GCM TAG length, move to 32 for post-quantum security
+        const int IV_TAG_LEN = IV_LEN + TAG_LEN;  // IV || TAG header of a ciphertext
     }
 
     // Authenticated encryption
@@ -52,6 +54,128 @@ namespace crypto
         // throws RuntimeError, ValueError, CryptoError (message authentication failure)
         // expects IV prepended to message ciphertext
         ByteArray DecryptMessage(const ByteArray& key, const ByteArray& message);
+
+        // Size of IV || TAG || ciphertext for a message of message_size bytes
+        size_t EncryptedSize(size_t message_size);
+        // Size of the plaintext of an IV || TAG || ciphertext message
+        // throws ValueError
+        size_t DecryptedSize(size_t encrypted_size);
+
+        // CipherContext keeps an encryption and a decryption context with
+        // the AES-GCM key schedule already expanded, each message only sets
+        // a new IV. A context is not safe for concurrent use. Buffers may
+        // be the same (in place) but must not otherwise overlap.
+        class CipherContext
+        {
+        public:
+            // throws RuntimeError, ValueError
+            CipherContext(const ByteArray& key);
+            ~CipherContext();
+
+            // Encrypt message_size bytes into out with an explicit IV;
+            // the TAG_LEN byte tag is written to tag
+            // throws RuntimeError, ValueError
+            void Encrypt(const uint8_t* iv,
+                const uint8_t* message,
+                size_t message_size,
+                uint8_t* tag,
+                uint8_t* out);
+            // Encrypt with a random IV, out receives EncryptedSize(message_size)
+            // bytes laid out as IV || TAG || ciphertext
+            // throws RuntimeError, ValueError
+            void Encrypt(const uint8_t* message, size_t message_size, uint8_t* out);
+            // buffer holds IV_TAG_LEN bytes of space followed by the
+            // message; the message is encrypted in place and the IV and
+            // tag written to the front
+            // throws RuntimeError, ValueError
+            void EncryptInPlace(uint8_t* buffer, size_t buffer_size);
+
+            // Decrypt message_size bytes of ciphertext into out
+            // throws RuntimeError, CryptoError (message authentication failure)
+            void Decrypt(const uint8_t* iv,
+                const uint8_t* tag,
+                const uint8_t* message,
+                size_t message_size,
+                uint8_t* out);
+            // Decrypt IV || TAG || ciphertext, out receives
+            // DecryptedSize(message_size) bytes; returns the plaintext size
+            // throws RuntimeError, ValueError, CryptoError
+            size_t Decrypt(const uint8_t* message, size_t message_size, uint8_t* out);
+            // As above but the first prefix_size bytes of the plaintext go
+            // to prefix and only the rest to out, so a fixed header can be
+            // stripped without moving the plaintext; returns the size
+            // written to out
+            // throws RuntimeError, ValueError, CryptoError
+            size_t Decrypt(const uint8_t* message,
+                size_t message_size,
+                uint8_t* prefix,
+                size_t prefix_size,
+                uint8_t* out);
+            // Decrypt IV || TAG || ciphertext in place, the plaintext is
+            // left at buffer + IV_TAG_LEN; returns the plaintext size
+            // throws RuntimeError, ValueError, CryptoError
+            size_t DecryptInPlace(uint8_t* buffer, size_t buffer_size);
+
+        private:
+            EVP_CIPHER_CTX* encrypt_context_;
+            EVP_CIPHER_CTX* decrypt_context_;
+
+            CipherContext(const CipherContext&);
+            CipherContext& operator=(const CipherContext&);
+        };
+
+        // StreamEncryptor produces the IV || TAG || ciphertext format a
+        // piece at a time; the caller reserves IV_TAG_LEN bytes of header
+        // in front of the ciphertext, Begin writes the random IV and
+        // Finish the tag into it. The encrypted message must not be empty.
+        class StreamEncryptor
+        {
+        public:
+            // throws RuntimeError, ValueError
+            StreamEncryptor(const ByteArray& key);
+            ~StreamEncryptor();
+
+            // throws RuntimeError
+            void Begin(uint8_t* header);
+            // Encrypt message_size bytes into out, may be in place
+            // throws RuntimeError
+            void Update(const uint8_t* message, size_t message_size, uint8_t* out);
+            // throws RuntimeError, ValueError
+            void Finish(uint8_t* header);
+
+        private:
+            EVP_CIPHER_CTX* context_;
+            size_t message_size_;
+
+            StreamEncryptor(const StreamEncryptor&);
+            StreamEncryptor& operator=(const StreamEncryptor&);
+        };
+
+        // StreamDecryptor consumes an IV || TAG || ciphertext message a
+        // piece at a time. Plaintext produced by Update is not
+        // authenticated until Finish returns and must not be used before.
+        class StreamDecryptor
+        {
+        public:
+            // throws RuntimeError, ValueError
+            StreamDecryptor(const ByteArray& key);
+            ~StreamDecryptor();
+
+            // header points to the IV_TAG_LEN bytes that precede the ciphertext
+            // throws RuntimeError
+            void Begin(const uint8_t* header);
+            // Decrypt message_size bytes into out, may be in place
+            // throws RuntimeError
+            void Update(const uint8_t* message, size_t message_size, uint8_t* out);
+            // throws CryptoError (message authentication failure)
+            void Finish(void);
+
+        private:
+            EVP_CIPHER_CTX* context_;
+
+            StreamDecryptor(const StreamDecryptor&);
+            StreamDecryptor& operator=(const StreamDecryptor&);
+        };
     };
 }
 }
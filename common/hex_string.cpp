@@ -14,38 +14,192 @@
  */
 
 #include <algorithm>
-#include <ctype.h>
+#include <string.h>
 #include "hex_string.h"
 #include "error.h"
 
+#if _UNTRUSTED_ && defined(__x86_64__) && defined(__GNUC__)
+#define HEX_USE_SIMD 1
+#include <immintrin.h>
+#else
+#define HEX_USE_SIMD 0
+#endif
+
 namespace pdo {
 
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    // nibble value of every character, 0xff for characters that are
+    // not hex digits so that or-ing the values of a buffer together
+    // validates the whole buffer at once
+#define XX 0xff
+    static const uint8_t hexValues[256] = {
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+         0,  1,  2,  3,  4,  5,  6,  7,  8,  9, XX, XX, XX, XX, XX, XX,
+        XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, 10, 11, 12, 13, 14, 15, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+        XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+    };
+#undef XX
+
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-    static inline uint8_t HexToNibble(
-        char hex
+    // Decode count bytes; returns false if any digit was invalid, the
+    // output is unspecified in that case
+    static bool DecodeHexScalar(
+        const char* inHex,
+        size_t count,
+        uint8_t* outData
         )
     {
-        hex = toupper(hex);
+        const uint8_t* hex = reinterpret_cast<const uint8_t*>(inHex);
+        uint8_t invalid = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint8_t hi = hexValues[hex[2 * i]];
+            uint8_t lo = hexValues[hex[2 * i + 1]];
+            invalid |= hi | lo;
+            outData[i] = static_cast<uint8_t>((hi << 4) | (lo & 0x0F));
+        }
 
-        if (hex >= 'A' && hex <= 'F') { // A-F case
-            return 10 + (hex - 'A');
+        return (invalid & 0xF0) == 0;
+    } // DecodeHexScalar
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    static void EncodeHexScalar(
+        const uint8_t* inData,
+        size_t count,
+        char* outHex
+        )
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            outHex[2 * i] = hexDigits[inData[i] >> 4];
+            outHex[2 * i + 1] = hexDigits[inData[i] & 0x0F];
         }
-        if (hex >= '0' && hex <= '9') { // 0-9 case
-            return hex - '0';
+    } // EncodeHexScalar
+
+#if HEX_USE_SIMD
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    // SSSE3 decoding of eight bytes (sixteen digits) per step; digits
+    // are classified by range and the invalid lanes of every block are
+    // accumulated so the buffer is validated once at the end
+    __attribute__((target("ssse3")))
+    static bool DecodeHexSSSE3(
+        const char* inHex,
+        size_t count,
+        uint8_t* outData
+        )
+    {
+        __m128i invalid = _mm_setzero_si128();
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inHex + 2 * i));
+            __m128i folded = _mm_or_si128(in, _mm_set1_epi8(0x20));
+
+            __m128i digit = _mm_and_si128(
+                _mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)),
+                _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1)));
+            __m128i alpha = _mm_and_si128(
+                _mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+                _mm_cmplt_epi8(folded, _mm_set1_epi8('f' + 1)));
+            invalid = _mm_or_si128(invalid, _mm_andnot_si128(_mm_or_si128(digit, alpha), _mm_set1_epi8(-1)));
+
+            __m128i values = _mm_or_si128(
+                _mm_and_si128(digit, _mm_sub_epi8(in, _mm_set1_epi8('0'))),
+                _mm_and_si128(alpha, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10))));
+
+            // high nibble * 16 + low nibble for every pair of digits
+            __m128i words = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0110));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(outData + i), _mm_packus_epi16(words, words));
         }
 
-        throw error::ValueError("Hex digit is not valid");
-    } // HexToNibble
+        bool valid = _mm_movemask_epi8(invalid) == 0;
+        return DecodeHexScalar(inHex + 2 * i, count - i, outData + i) && valid;
+    } // DecodeHexSSSE3
 
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-    static inline uint8_t HexToByte(
-        const char* inHexDigits
+    // SSSE3 encoding of sixteen bytes per step, nibbles are interleaved
+    // and mapped to digits with a single shuffle
+    __attribute__((target("ssse3")))
+    static void EncodeHexSSSE3(
+        const uint8_t* inData,
+        size_t count,
+        char* outHex
         )
     {
-        uint8_t c1 = HexToNibble(inHexDigits[0]);
-        uint8_t c2 = HexToNibble(inHexDigits[1]);
-        return (c1 << 4) | c2;
-    } // HexToByte
+        const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hexDigits));
+        const __m128i mask = _mm_set1_epi8(0x0F);
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inData + i));
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+            __m128i lo = _mm_and_si128(in, mask);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(outHex + 2 * i),
+                _mm_shuffle_epi8(digits, _mm_unpacklo_epi8(hi, lo)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(outHex + 2 * i + 16),
+                _mm_shuffle_epi8(digits, _mm_unpackhi_epi8(hi, lo)));
+        }
+
+        EncodeHexScalar(inData + i, count - i, outHex + 2 * i);
+    } // EncodeHexSSSE3
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    static bool HaveSSSE3(void)
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3");
+    } // HaveSSSE3
+#endif
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    static bool DecodeHex(
+        const char* inHex,
+        size_t count,
+        uint8_t* outData
+        )
+    {
+#if HEX_USE_SIMD
+        static const bool simd = HaveSSSE3();
+        if (simd)
+            return DecodeHexSSSE3(inHex, count, outData);
+#endif
+        return DecodeHexScalar(inHex, count, outData);
+    } // DecodeHex
+
+    // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+    static void EncodeHex(
+        const uint8_t* inData,
+        size_t count,
+        char* outHex
+        )
+    {
+#if HEX_USE_SIMD
+        static const bool simd = HaveSSSE3();
+        if (simd)
+        {
+            EncodeHexSSSE3(inData, count, outHex);
+            return;
+        }
+#endif
+        EncodeHexScalar(inData, count, outHex);
+    } // EncodeHex
 
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
     std::vector<uint8_t> HexStringToBinary(
@@ -56,7 +210,7 @@ namespace pdo {
         // implementation to do the actual conversion
         std::vector<uint8_t> binaryData(inHexString.length() / 2);
 
-        HexStringToBinary(&binaryData[0], binaryData.size(), inHexString);
+        HexStringToBinary(binaryData.data(), binaryData.size(), inHexString);
 
         return binaryData;
     } // HexStringToBinary
@@ -73,15 +227,10 @@ namespace pdo {
             (inHexString.length() % 2) != 0,
             "Hex encoded string is not an even length");
 
-        const char* pHex = inHexString.c_str();
-        size_t len = inHexString.length();
-        inBinaryDataLength = std::min(inBinaryDataLength, len / 2);
-        size_t pos = 0;
-        size_t opos = 0;
-        while (pos < len && opos < inBinaryDataLength) {
-            outBinaryData[opos++] = HexToByte(&pHex[pos]);
-            pos += 2;
-        }
+        size_t count = std::min(inBinaryDataLength, inHexString.length() / 2);
+        error::ThrowIf<error::ValueError>(
+            ! DecodeHex(inHexString.data(), count, outBinaryData),
+            "Hex digit is not valid");
     } // HexStringToBinary
 
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -89,7 +238,7 @@ namespace pdo {
         const std::vector<uint8_t>& inBinaryData
         )
     {
-        return BinaryToHexString(&inBinaryData[0], inBinaryData.size());
+        return BinaryToHexString(inBinaryData.data(), inBinaryData.size());
     } // BinaryToHexString
 
     // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -98,21 +247,9 @@ namespace pdo {
         size_t inBinaryDataLength
         )
     {
-        static const char *hexDigits = "0123456789ABCDEF";
-
-        // Create a string and give a hint to its final size (twice the size
-        // of the input binary data)
-        std::string hexString;
-        hexString.reserve(inBinaryDataLength * 2);
-
-        // Run through the binary data and convert to a hex string
-        std::for_each(
-            inBinaryData,
-            inBinaryData + inBinaryDataLength,
-            [&hexString](uint8_t inputByte) {
-                hexString.push_back(hexDigits[inputByte >> 4]);
-                hexString.push_back(hexDigits[inputByte & 0x0F]);
-            });
+        std::string hexString(inBinaryDataLength * 2, '\0');
+        if (inBinaryDataLength > 0)
+            EncodeHex(inBinaryData, inBinaryDataLength, &hexString[0]);
 
         return hexString;
     } // BinaryToHexString
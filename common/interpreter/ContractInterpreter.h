@@ -18,6 +18,8 @@
 #include <string>
 #include <map>
 
+#include "request_statistics.h"
+
 #include "ContractState.h"
 #include "ContractCode.h"
 #include "ContractMessage.h"
@@ -26,6 +28,17 @@ namespace pdo
 {
     namespace contracts
     {
+        // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        // told as each phase of handling a message completes so the
+        // caller can attribute the time spent since the previous one
+        class PhaseObserver
+        {
+        public:
+            virtual ~PhaseObserver(void) {}
+
+            virtual void phase_complete(pdo_request_phase_t phase) = 0;
+        };
+
         // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
         class ContractInterpreter
         {
@@ -18,6 +18,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include "crypto.h"
 #include "error.h"
@@ -61,13 +62,23 @@ extern void Log(
     ...
     );
 
-std::map<uint64_t, size_t> safe_malloc_map;
+// allocations are tracked per interpreter so that more than one
+// interpreter can be alive at a time; the allocation callbacks carry
+// no context so the heap for the interpreter currently running on this
+// thread is selected by the constructor and each entry point
+static thread_local GipsyHeap* safe_malloc_heap = NULL;
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 void *safe_malloc_for_scheme(size_t request)
 {
     void *ptr = malloc(request);
-    safe_malloc_map[(uint64_t)ptr] = request;
+    if (ptr != NULL && safe_malloc_heap != NULL)
+    {
+        safe_malloc_heap->allocations[(uint64_t)ptr] = request;
+        safe_malloc_heap->in_use += request;
+        if (safe_malloc_heap->in_use > safe_malloc_heap->peak)
+            safe_malloc_heap->peak = safe_malloc_heap->in_use;
+    }
 
     return ptr;
 }
@@ -75,14 +86,21 @@ void *safe_malloc_for_scheme(size_t request)
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 void safe_free_for_scheme(void* ptr)
 {
-    std::map<uint64_t, size_t>::iterator it = safe_malloc_map.find((uint64_t)ptr);
-    if (it == safe_malloc_map.end())
+    if (safe_malloc_heap == NULL)
+    {
+        Log(PDO_LOG_ERROR, "attempt to free memory with no active interpreter");
+        return;
+    }
+
+    std::map<uint64_t, size_t>::iterator it = safe_malloc_heap->allocations.find((uint64_t)ptr);
+    if (it == safe_malloc_heap->allocations.end())
     {
         Log(PDO_LOG_ERROR, "attempt to free memory not allocated");
         return;
     }
 
-    safe_malloc_map.erase(it);
+    safe_malloc_heap->in_use -= it->second;
+    safe_malloc_heap->allocations.erase(it);
     free(ptr);
 }
 
@@ -230,24 +248,41 @@ static void gipsy_write_to_buffer(
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 GipsyInterpreter::~GipsyInterpreter(void)
 {
+    this->select_allocator();
+
     scheme* sc = &this->interpreter;
+    if (profiler_ != NULL)
+        profiler_->detach(sc);
+
     scheme_deinit(sc);
 
     size_t total = 0;
 
-    std::map<uint64_t, size_t>::iterator it  = safe_malloc_map.begin();
-    while (it != safe_malloc_map.end())
+    std::map<uint64_t, size_t>::iterator it  = heap_.allocations.begin();
+    while (it != heap_.allocations.end())
     {
         free((void*)it->first);
         total += it->second;
         it++;
     }
+
+    heap_.allocations.clear();
+    heap_.in_use = 0;
+    safe_malloc_heap = NULL;
 }
 
-// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-GipsyInterpreter::GipsyInterpreter(void)
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::select_allocator(void)
 {
-    safe_malloc_map.clear();
+    safe_malloc_heap = &heap_;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+GipsyInterpreter::GipsyInterpreter(void) :
+    state_bytes_read_(0), state_bytes_written_(0), access_(NULL), observer_(NULL),
+    profiler_(NULL)
+{
+    this->select_allocator();
 
     /* ---------- Create the interpreter ---------- */
     scheme* sc = &this->interpreter;
@@ -379,6 +414,7 @@ void GipsyInterpreter::load_contract_state(
         pe::ThrowIf<pe::RuntimeError>(
             sc->retcode != 0,
             "failed to load the contract state");
+        state_bytes_read_ += inContractState.State.size();
 
         pointer sptr = mk_symbol(sc, "_instance");
         pe::ThrowIfNull(sptr, "unable to create the _instance symbol");
@@ -419,6 +455,7 @@ void GipsyInterpreter::save_contract_state(
     gipsy_write_to_buffer(sc, rexpr, rawstate);
 
     outContractState.State = rawstate.str();
+    state_bytes_written_ += outContractState.State.size();
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -430,12 +467,15 @@ void GipsyInterpreter::create_initial_contract_state(
     pc::ContractState& outContractState
     )
 {
+    this->select_allocator();
+    this->reset_statistics();
     scheme* sc = &this->interpreter;
 
     // the message is not currently used though we should consider
     // how it can be implemented, throug the create-object-instance fn
     // this->load_message(inMessage);
     this->load_contract_code(inContractCode);
+    this->phase_complete(PDO_PHASE_CODE_LOAD);
 
     /* --------------- Assign the symbol values --------------- */
     gipsy_put_property(sc, ":message", "originator", inMessage.OriginatorID.c_str());
@@ -458,10 +498,12 @@ void GipsyInterpreter::create_initial_contract_state(
     pe::ThrowIf<pe::ValueError>(
         sc->retcode != 0,
         report_interpreter_error(sc, "failed to create contract instance", error_msg_).c_str());
+    this->phase_complete(PDO_PHASE_EXECUTE);
 
     scheme_define(sc, sc->global_env, mk_symbol(sc, "_instance"), rexpr);
 
     this->save_contract_state(outContractState);
+    this->phase_complete(PDO_PHASE_SERIALIZE);
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -476,11 +518,16 @@ void GipsyInterpreter::send_message_to_contract(
     std::string& outMessageResult
     )
 {
+    this->select_allocator();
+    this->reset_statistics();
     scheme* sc = &this->interpreter;
 
     this->load_message(inMessage);
     this->load_contract_code(inContractCode);
+    this->phase_complete(PDO_PHASE_CODE_LOAD);
+
     this->load_contract_state(inContractState);
+    this->phase_complete(PDO_PHASE_STATE_LOAD);
 
     /* --------------- Assign the symbol values --------------- */
     gipsy_put_property(sc, ":message", "originator", inMessage.OriginatorID.c_str());
@@ -495,10 +542,18 @@ void GipsyInterpreter::send_message_to_contract(
     pointer _instance = scheme_find_symbol_value(sc, sc->envir, scheme_find_symbol(sc, "_instance"));
     pointer sendfn = scheme_find_symbol_value(sc, sc->envir, scheme_find_symbol(sc, "send"));
 
+    if (access_ != NULL)
+        this->begin_state_tracking(cdr(_instance));
+
     pointer rexpr = scheme_call(sc, cdr(sendfn), cons(sc, cdr(_instance), cdr(_message)));
+
+    if (access_ != NULL)
+        this->end_state_tracking(cdr(_instance), sc->retcode >= 0);
+
     pe::ThrowIf<pe::ValueError>(
         sc->retcode < 0,
         report_interpreter_error(sc, "method evaluation failed", error_msg_).c_str());
+    this->phase_complete(PDO_PHASE_EXECUTE);
 
     this->save_dependencies(outDependencies);
 
@@ -509,4 +564,180 @@ void GipsyInterpreter::send_message_to_contract(
 
     // save the state
     this->save_contract_state(outContractState);
+    this->phase_complete(PDO_PHASE_SERIALIZE);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::track_state_access(
+    StateAccessSet* outAccess
+    )
+{
+    access_ = outAccess;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::observe_phases(
+    pc::PhaseObserver* observer
+    )
+{
+    observer_ = observer;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::profile(
+    GipsyProfiler* profiler
+    )
+{
+    scheme* sc = &this->interpreter;
+
+    if (profiler_ != NULL)
+        profiler_->detach(sc);
+
+    profiler_ = profiler;
+
+    if (profiler_ != NULL)
+        profiler_->attach(sc);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::reset_statistics(void)
+{
+    scheme* sc = &this->interpreter;
+    memset(&sc->stats, 0, sizeof(sc->stats));
+
+    heap_.peak = heap_.in_use;
+    state_bytes_read_ = 0;
+    state_bytes_written_ = 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::get_statistics(
+    pdo_interpreter_statistics_t& outStatistics
+    ) const
+{
+    const scheme* sc = &this->interpreter;
+
+    outStatistics.eval_steps = sc->stats.eval_steps;
+    outStatistics.cells_allocated = sc->stats.cells_allocated;
+    outStatistics.gc_runs = sc->stats.gc_runs;
+    outStatistics.state_bytes_read = state_bytes_read_;
+    outStatistics.state_bytes_written = state_bytes_written_;
+    outStatistics.heap_peak_bytes = heap_.peak;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::begin_state_tracking(
+    pointer instance
+    )
+{
+    scheme* sc = &this->interpreter;
+
+    access_->clear();
+
+    tracker_.Access = access_;
+    tracker_.Before.capture(sc, instance);
+
+    sc->slot_observer = state_access_observer;
+    sc->slot_observer_data = &tracker_;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::end_state_tracking(
+    pointer instance,
+    bool succeeded
+    )
+{
+    scheme* sc = &this->interpreter;
+
+    // the serializer walks every binding, it must not count as a read
+    sc->slot_observer = NULL;
+    sc->slot_observer_data = NULL;
+
+    // a failed message leaves no trace in the state, only the reads
+    // that led to the failure matter
+    if (! succeeded)
+        return;
+
+    StateSnapshot after;
+    after.capture(sc, instance);
+
+    std::vector<std::string> changed;
+    if (! state_snapshot_diff(tracker_.Before, after, changed))
+    {
+        access_->Complete = false;
+        return;
+    }
+
+    if (changed.empty())
+        return;
+
+    pointer package = scheme_find_symbol_value(sc, sc->envir, scheme_find_symbol(sc, "oops-serialize"));
+    pe::ThrowIf<pe::RuntimeError>(package == sc->NIL, "unable to find serialization package");
+
+    pointer serialfn = scheme_find_symbol_value(sc, cdr(package), scheme_find_symbol(sc, "_serialize-item"));
+    pe::ThrowIf<pe::RuntimeError>(serialfn == sc->NIL, "unable to find serialize function");
+
+    std::vector<std::string>::const_iterator path;
+    for (path = changed.begin(); path != changed.end(); path++)
+    {
+        pointer value;
+        pe::ThrowIf<pe::RuntimeError>(
+            ! state_path_get(sc, instance, *path, value),
+            "unable to locate modified state");
+
+        pointer rexpr = scheme_call(sc, cdr(serialfn), cons(sc, value, sc->NIL));
+        pe::ThrowIf<pe::RuntimeError>(
+            sc->retcode != 0,
+            "state serialization failed");
+
+        StringArray expression(0);
+        gipsy_write_to_buffer(sc, rexpr, expression);
+        access_->Writes[*path] = expression.str();
+    }
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::load_contract_for_update(
+    const pc::ContractCode& inContractCode,
+    const pc::ContractState& inContractState
+    )
+{
+    this->select_allocator();
+
+    this->load_contract_code(inContractCode);
+    this->load_contract_state(inContractState);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::update_contract_state(
+    const std::map<std::string,std::string>& inWrites
+    )
+{
+    this->select_allocator();
+    scheme* sc = &this->interpreter;
+
+    pointer _instance = scheme_find_symbol_value(sc, sc->envir, scheme_find_symbol(sc, "_instance"));
+    pe::ThrowIf<pe::RuntimeError>(_instance == sc->NIL, "unable to find contract instance");
+
+    std::map<std::string,std::string>::const_iterator w;
+    for (w = inWrites.begin(); w != inWrites.end(); w++)
+    {
+        scheme_load_string(sc, w->second.c_str(), w->second.size());
+        pe::ThrowIf<pe::RuntimeError>(
+            sc->retcode != 0,
+            "failed to load the state update");
+
+        pe::ThrowIf<pe::RuntimeError>(
+            ! state_path_set(sc, cdr(_instance), w->first, sc->value),
+            "failed to apply the state update");
+    }
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyInterpreter::get_contract_state(
+    pc::ContractState& outContractState
+    )
+{
+    this->select_allocator();
+    this->save_contract_state(outContractState);
 }
@@ -21,12 +21,26 @@
 #include <map>
 
 #include "ContractInterpreter.h"
+#include "GipsyProfiler.h"
+#include "GipsyStateAccess.h"
 
 namespace pc = pdo::contracts;
 
 #define MAX_RESULT_SIZE 16000
 #define MAX_STATE_SIZE 64000
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// allocations made by an interpreter, see safe_malloc_for_scheme
+class GipsyHeap
+{
+public:
+    std::map<uint64_t, size_t> allocations;
+    size_t in_use;
+    size_t peak;
+
+    GipsyHeap(void) : in_use(0), peak(0) {}
+};
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 class GipsyInterpreter : public pc::ContractInterpreter
 {
@@ -34,6 +48,33 @@ private:
     std::string error_msg_;
     scheme interpreter;
 
+    GipsyHeap heap_;
+
+    // state bytes loaded and saved since the last reset, the other
+    // statistics are kept by the scheme core and the heap
+    uint64_t state_bytes_read_;
+    uint64_t state_bytes_written_;
+
+    // state access tracking for speculative execution
+    StateAccessSet* access_;
+    StateAccessTracker tracker_;
+
+    pc::PhaseObserver* observer_;
+
+    GipsyProfiler* profiler_;
+
+    void phase_complete(pdo_request_phase_t phase)
+    {
+        if (observer_ != NULL)
+            observer_->phase_complete(phase);
+    }
+
+    void select_allocator(void);
+
+    void begin_state_tracking(pointer instance);
+
+    void end_state_tracking(pointer instance, bool succeeded);
+
     // load functions with throw errors when unsuccessful
 
     void load_contract_code(
@@ -76,6 +117,49 @@ public:
         std::string& outMessageResult
         );
 
+    // when an access set is attached, send_message_to_contract records
+    // the state paths read and written by the message
+    void track_state_access(
+        StateAccessSet* outAccess
+        );
+
+    // when an observer is attached, the entry points above report the
+    // end of the code load, state load, execution and serialization
+    // phases to it
+    void observe_phases(
+        pc::PhaseObserver* observer
+        );
+
+    // while a profiler is attached it samples everything the
+    // interpreter evaluates; pass NULL to detach it
+    void profile(
+        GipsyProfiler* profiler
+        );
+
+    // the entry points above reset the statistics when they start so
+    // afterwards they cover a single request; the interpreter setup in
+    // the constructor is never included
+    void reset_statistics(void);
+
+    void get_statistics(
+        pdo_interpreter_statistics_t& outStatistics
+        ) const;
+
+    // load code and state so that the writes recorded by other
+    // interpreters can be applied to the state
+    void load_contract_for_update(
+        const pc::ContractCode& inContractCode,
+        const pc::ContractState& inContractState
+        );
+
+    void update_contract_state(
+        const std::map<std::string,std::string>& inWrites
+        );
+
+    void get_contract_state(
+        pc::ContractState& outContractState
+        );
+
     GipsyInterpreter(void);
 
     ~GipsyInterpreter(void);
@@ -0,0 +1,274 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "scheme-private.h"
+
+#include "GipsyProfiler.h"
+
+#undef cons
+#undef immutable_cons
+
+#define CLASS_SIZE 5
+#define CLASS_ENV 3
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static bool is_procedure(scheme* sc, pointer p)
+{
+    return sc->vptr->is_closure(p) || sc->vptr->is_macro(p);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// call fn(symbol, value) for each binding in the first frame of env;
+// the global frame is a hash table of slot lists, the others a list
+template<typename Function>
+static void for_each_binding(scheme* sc, pointer env, Function fn)
+{
+    pointer frame = sc->vptr->pair_car(env);
+
+    std::vector<pointer> buckets;
+    if (sc->vptr->is_vector(frame))
+    {
+        for (long i = 0; i < sc->vptr->vector_length(frame); i++)
+            buckets.push_back(sc->vptr->vector_elem(frame, i));
+    }
+    else
+    {
+        buckets.push_back(frame);
+    }
+
+    for (size_t b = 0; b < buckets.size(); b++)
+    {
+        for (pointer slots = buckets[b]; sc->vptr->is_pair(slots); slots = sc->vptr->pair_cdr(slots))
+        {
+            pointer slot = sc->vptr->pair_car(slots);
+            fn(sc->vptr->pair_car(slot), sc->vptr->pair_cdr(slot));
+        }
+    }
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static pointer class_environment(scheme* sc, pointer p)
+{
+    if (! sc->vptr->is_vector(p) || sc->vptr->vector_length(p) != CLASS_SIZE)
+        return sc->NIL;
+
+    pointer tag = sc->vptr->vector_elem(p, 0);
+    if (! sc->vptr->is_symbol(tag) || strcmp(sc->vptr->symname(tag), "class") != 0)
+        return sc->NIL;
+
+    pointer env = sc->vptr->vector_elem(p, CLASS_ENV);
+    return sc->vptr->is_environment(env) ? env : sc->NIL;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+GipsyProfiler::GipsyProfiler(unsigned long interval) :
+    Interval(interval > 0 ? interval : 1), Samples(0)
+{
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyProfiler::step_observer(scheme* sc)
+{
+    GipsyProfiler* profiler = (GipsyProfiler*)sc->profile_data;
+    if (profiler != NULL)
+        profiler->sample(sc);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyProfiler::apply_observer(scheme* sc, pointer closure)
+{
+    GipsyProfiler* profiler = (GipsyProfiler*)sc->profile_data;
+    if (profiler == NULL)
+        return;
+
+    // frames created by let and friends replace any stale entry for
+    // a reused cell
+    if (closure == sc->NIL)
+    {
+        profiler->applications_.erase(sc->envir);
+        return;
+    }
+
+    Application& application = profiler->applications_[sc->envir];
+    application.closure = closure;
+    application.code = sc->vptr->closure_code(closure);
+    application.parent = sc->vptr->pair_cdr(sc->envir);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyProfiler::attach(scheme* sc)
+{
+    sc->profile_data = this;
+    sc->step_interval = Interval;
+    sc->step_countdown = Interval;
+    sc->apply_observer = apply_observer;
+    sc->step_observer = step_observer;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyProfiler::detach(scheme* sc)
+{
+    sc->step_observer = NULL;
+    sc->apply_observer = NULL;
+    sc->profile_data = NULL;
+
+    // the heap belongs to the interpreter, none of the frames can be
+    // trusted once it runs without the hooks
+    applications_.clear();
+    names_.clear();
+    index_.clear();
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// global names win over qualified ones so that aliases such as send
+// for oops::send show up under the name used in contract code
+void GipsyProfiler::build_index(scheme* sc)
+{
+    index_.clear();
+
+    for_each_binding(sc, sc->global_env, [&](pointer symbol, pointer value) {
+            if (is_procedure(sc, value))
+                index_[sc->vptr->closure_code(value)] = sc->vptr->symname(symbol);
+        });
+
+    for_each_binding(sc, sc->global_env, [&](pointer symbol, pointer value) {
+            pointer env = sc->vptr->is_environment(value) ? value : class_environment(sc, value);
+            if (env == sc->NIL)
+                return;
+
+            std::string prefix(sc->vptr->symname(symbol));
+            prefix.append("::");
+
+            for_each_binding(sc, env, [&](pointer member, pointer mvalue) {
+                    if (is_procedure(sc, mvalue))
+                        index_.insert(std::make_pair(
+                                sc->vptr->closure_code(mvalue), prefix + sc->vptr->symname(member)));
+                });
+        });
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+const std::string& GipsyProfiler::procedure_name(scheme* sc, pointer closure)
+{
+    pointer code = sc->vptr->closure_code(closure);
+
+    std::unordered_map<pointer, std::string>::const_iterator cached = names_.find(code);
+    if (cached != names_.end())
+        return cached->second;
+
+    // procedures defined since the last scan are picked up here
+    build_index(sc);
+
+    std::string name;
+    std::unordered_map<pointer, std::string>::const_iterator indexed = index_.find(code);
+    if (indexed != index_.end())
+        name = indexed->second;
+
+    // local definitions and named lets are bound in a frame of the
+    // environment the closure was created in
+    for (pointer env = sc->vptr->closure_env(closure);
+         name.empty() && sc->vptr->is_environment(env) && env != sc->global_env;
+         env = sc->vptr->pair_cdr(env))
+    {
+        for_each_binding(sc, env, [&](pointer symbol, pointer value) {
+                if (name.empty() && is_procedure(sc, value) && sc->vptr->closure_code(value) == code)
+                    name = sc->vptr->symname(symbol);
+            });
+    }
+
+    if (name.empty())
+        name = "lambda";
+
+    return names_[code] = name;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// an entry may be left over from an environment frame that has since
+// been collected and reused; the parent of a reused cell is unlikely
+// to match so that is checked before the entry is believed. The frame
+// does not keep the closure alive, an anonymous lambda may be collected
+// while its body runs, so the closure is checked as well
+pointer GipsyProfiler::find_application(scheme* sc, pointer env)
+{
+    for ( ; sc->vptr->is_environment(env); env = sc->vptr->pair_cdr(env))
+    {
+        std::unordered_map<pointer, Application>::const_iterator it = applications_.find(env);
+        if (it == applications_.end() || it->second.parent != sc->vptr->pair_cdr(env))
+            continue;
+
+        pointer closure = it->second.closure;
+        if (is_procedure(sc, closure) && sc->vptr->closure_code(closure) == it->second.code)
+            return env;
+    }
+
+    return sc->NIL;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyProfiler::sample(scheme* sc)
+{
+    int depth = scheme_stack_depth(sc);
+
+    // successive frames from the same application are one call
+    std::string stack;
+    pointer last = sc->NIL;
+    for (int i = 0; i <= depth; i++)
+    {
+        pointer env = (i < depth ? scheme_stack_environment(sc, i) : sc->envir);
+        pointer application = find_application(sc, env);
+        if (application == sc->NIL || application == last)
+            continue;
+
+        last = application;
+        if (! stack.empty())
+            stack.append(";");
+        stack.append(procedure_name(sc, applications_[application].closure));
+    }
+
+    if (stack.empty())
+        stack = "[toplevel]";
+
+    Stacks[stack]++;
+    Samples++;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyProfiler::clear(void)
+{
+    Stacks.clear();
+    Samples = 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GipsyProfiler::write_folded(std::string& output) const
+{
+    char count[32];
+
+    std::map<std::string, uint64_t>::const_iterator it;
+    for (it = Stacks.begin(); it != Stacks.end(); it++)
+    {
+        snprintf(count, sizeof(count), " %llu\n", (unsigned long long)it->second);
+        output.append(it->first);
+        output.append(count);
+    }
+}
@@ -0,0 +1,90 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "scheme-private.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <map>
+#include <unordered_map>
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// GipsyProfiler samples the interpreter every Interval eval steps and
+// counts the stack of procedures active at each sample. The interpreter
+// does not keep track of the closure behind a stack frame, so every
+// closure application is recorded against the environment frame it
+// creates; a sample walks the environments saved on the dump stack up
+// to the nearest recorded frame.
+//
+// Procedures are named by the binding that holds them: "name" for
+// global definitions, "package::name" for definitions in a package
+// such as oops, "class::name" for methods, and the plain name for
+// local definitions and named lets. Anything else is "lambda". Names
+// are resolved once per lambda body.
+//
+// Stacks are written in the folded format read by flamegraph tools:
+// one line per distinct stack, outermost procedure first, separated by
+// semicolons and followed by the number of samples.
+class GipsyProfiler
+{
+private:
+    struct Application
+    {
+        pointer closure;
+        pointer code;
+        pointer parent;
+    };
+
+    // environment frame -> the application that created it
+    std::unordered_map<pointer, Application> applications_;
+
+    // closure code -> procedure name
+    std::unordered_map<pointer, std::string> names_;
+
+    // closure code -> qualified name, from the last scan of the
+    // global environment
+    std::unordered_map<pointer, std::string> index_;
+
+    void build_index(scheme* sc);
+
+    const std::string& procedure_name(scheme* sc, pointer closure);
+
+    pointer find_application(scheme* sc, pointer env);
+
+    static void step_observer(scheme* sc);
+    static void apply_observer(scheme* sc, pointer closure);
+
+public:
+    unsigned long Interval;
+    uint64_t Samples;
+    std::map<std::string, uint64_t> Stacks;
+
+    GipsyProfiler(unsigned long interval = 1000);
+
+    // install or remove the sampling hooks, an interpreter may only be
+    // attached to one profiler at a time
+    void attach(scheme* sc);
+    void detach(scheme* sc);
+
+    void sample(scheme* sc);
+
+    void clear(void);
+
+    // append the folded stacks to output
+    void write_folded(std::string& output) const;
+};
@@ -0,0 +1,472 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <map>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "scheme-private.h"
+
+#include "GipsyStateAccess.h"
+
+#undef cons
+#undef immutable_cons
+
+#define INSTANCE_SIZE 3
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static inline bool is_step_separator(char c)
+{
+    return c == ' ' || c == '[' || c == '(';
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static bool is_instance(scheme* sc, pointer p)
+{
+    if (! sc->vptr->is_vector(p) || sc->vptr->vector_length(p) != INSTANCE_SIZE)
+        return false;
+
+    pointer tag = sc->vptr->vector_elem(p, 0);
+    return sc->vptr->is_symbol(tag) && strcmp(sc->vptr->symname(tag), "instance") == 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// instance variables that are not part of the serialized state
+static bool is_transient_binding(const char* name)
+{
+    return name[0] == '_' || strcmp(name, "self") == 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static std::string shallow_signature(scheme* sc, pointer p)
+{
+    char buffer[64];
+
+    if (p == sc->NIL)
+        return "()";
+    if (p == sc->T)
+        return "#t";
+    if (p == sc->F)
+        return "#f";
+
+    if (is_instance(sc, p))
+        return std::string("I:") + sc->vptr->symname(sc->vptr->vector_elem(p, 1));
+
+    if (sc->vptr->is_vector(p))
+    {
+        snprintf(buffer, sizeof(buffer), "V:%ld", sc->vptr->vector_length(p));
+        return buffer;
+    }
+
+    if (sc->vptr->is_pair(p))
+    {
+        long count = 0;
+        for ( ; sc->vptr->is_pair(p); p = sc->vptr->pair_cdr(p))
+            count++;
+        snprintf(buffer, sizeof(buffer), "L:%ld%s", count, p == sc->NIL ? "" : ".");
+        return buffer;
+    }
+
+    if (sc->vptr->is_string(p))
+        return std::string("S:") + sc->vptr->string_value(p);
+
+    if (sc->vptr->is_symbol(p))
+        return std::string("Y:") + sc->vptr->symname(p);
+
+    if (sc->vptr->is_character(p))
+    {
+        snprintf(buffer, sizeof(buffer), "C:%ld", sc->vptr->charvalue(p));
+        return buffer;
+    }
+
+    if (sc->vptr->is_number(p))
+    {
+        if (sc->vptr->is_integer(p))
+            snprintf(buffer, sizeof(buffer), "N:%ld", sc->vptr->ivalue(p));
+        else
+            snprintf(buffer, sizeof(buffer), "R:%.17g", sc->vptr->rvalue(p));
+        return buffer;
+    }
+
+    // closures, ports and other objects are not serializable, identity
+    // is the best that can be done and is only compared within one heap
+    snprintf(buffer, sizeof(buffer), "O:%p", (void*)p);
+    return buffer;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void capture_value(
+    scheme* sc,
+    pointer p,
+    const std::string& path,
+    StateSnapshot& snapshot,
+    std::unordered_set<pointer>& visited
+    )
+{
+    snapshot.Signatures[path] = shallow_signature(sc, p);
+
+    if (! sc->vptr->is_vector(p) && ! sc->vptr->is_pair(p))
+        return;
+
+    // shared structure cannot be described by a single path, the state
+    // serializer would not preserve the sharing either
+    if (! visited.insert(p).second)
+    {
+        snapshot.Complete = false;
+        return;
+    }
+
+    if (is_instance(sc, p))
+    {
+        pointer env = sc->vptr->vector_elem(p, 2);
+        if (! sc->vptr->is_environment(env))
+            return;
+
+        for (pointer b = sc->vptr->pair_car(env); sc->vptr->is_pair(b); b = sc->vptr->pair_cdr(b))
+        {
+            pointer slot = sc->vptr->pair_car(b);
+            const char* name = sc->vptr->symname(sc->vptr->pair_car(slot));
+            if (is_transient_binding(name))
+                continue;
+
+            std::string bpath = path + " " + name;
+            snapshot.Slots[slot] = bpath;
+            capture_value(sc, sc->vptr->pair_cdr(slot), bpath, snapshot, visited);
+        }
+        return;
+    }
+
+    char buffer[32];
+    if (sc->vptr->is_vector(p))
+    {
+        long vlen = sc->vptr->vector_length(p);
+        for (long i = 0; i < vlen; i++)
+        {
+            snprintf(buffer, sizeof(buffer), "[%ld]", i);
+            capture_value(sc, sc->vptr->vector_elem(p, i), path + buffer, snapshot, visited);
+        }
+        return;
+    }
+
+    long i = 0;
+    for ( ; sc->vptr->is_pair(p); p = sc->vptr->pair_cdr(p), i++)
+    {
+        if (i > 0 && ! visited.insert(p).second)
+        {
+            snapshot.Complete = false;
+            return;
+        }
+
+        snprintf(buffer, sizeof(buffer), "(%ld)", i);
+        capture_value(sc, sc->vptr->pair_car(p), path + buffer, snapshot, visited);
+    }
+
+    if (p != sc->NIL)
+        capture_value(sc, p, path + "(.)", snapshot, visited);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void StateSnapshot::capture(scheme* sc, pointer instance)
+{
+    Signatures.clear();
+    Slots.clear();
+    Complete = true;
+
+    std::unordered_set<pointer> visited;
+    capture_value(sc, instance, "", *this, visited);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void state_access_observer(scheme* sc, pointer slot)
+{
+    StateAccessTracker* tracker = (StateAccessTracker*)sc->slot_observer_data;
+    if (tracker == NULL || tracker->Access == NULL)
+        return;
+
+    std::unordered_map<pointer, std::string>::const_iterator it = tracker->Before.Slots.find(slot);
+    if (it != tracker->Before.Slots.end())
+        tracker->Access->Reads.insert(it->second);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool state_path_is_ancestor(
+    const std::string& ancestor,
+    const std::string& path
+    )
+{
+    return path.size() > ancestor.size()
+        && path.compare(0, ancestor.size(), ancestor) == 0
+        && is_step_separator(path[ancestor.size()]);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool state_snapshot_diff(
+    const StateSnapshot& before,
+    const StateSnapshot& after,
+    std::vector<std::string>& outChanged
+    )
+{
+    outChanged.clear();
+
+    if (! before.Complete || ! after.Complete)
+        return false;
+
+    // both maps are sorted so every ancestor is visited before its
+    // descendants, though not necessarily immediately before them
+    std::set<std::string> changed;
+    std::map<std::string, std::string>::const_iterator b = before.Signatures.begin();
+    std::map<std::string, std::string>::const_iterator a = after.Signatures.begin();
+
+    bool consistent = true;
+    while (b != before.Signatures.end() || a != after.Signatures.end())
+    {
+        std::string path;
+        bool missing = false;
+
+        if (a == after.Signatures.end() || (b != before.Signatures.end() && b->first < a->first))
+        {
+            path = (b++)->first;
+            missing = true;
+        }
+        else if (b == before.Signatures.end() || a->first < b->first)
+        {
+            path = (a++)->first;
+            missing = true;
+        }
+        else
+        {
+            path = b->first;
+            bool same = b->second == a->second;
+            b++; a++;
+            if (same)
+                continue;
+        }
+
+        bool subsumed = false;
+        for (size_t i = 1; i < path.size() && ! subsumed; i++)
+            if (is_step_separator(path[i]))
+                subsumed = changed.count(path.substr(0, i)) > 0;
+        if (subsumed || (! path.empty() && changed.count("") > 0))
+            continue;
+
+        // a path can only appear or disappear when its container changed
+        if (missing)
+            consistent = false;
+
+        changed.insert(path);
+        outChanged.push_back(path);
+    }
+
+    return consistent;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+typedef enum {
+    LOCATION_SLOT,
+    LOCATION_VECTOR,
+    LOCATION_CAR,
+    LOCATION_CDR
+} location_kind_t;
+
+typedef struct {
+    location_kind_t kind;
+    pointer cell;
+    long index;
+} state_location_t;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static bool resolve_state_path(
+    scheme* sc,
+    pointer instance,
+    const std::string& path,
+    state_location_t& location,
+    pointer& value
+    )
+{
+    if (path.empty())
+        return false;
+
+    value = instance;
+
+    size_t pos = 0;
+    while (pos < path.size())
+    {
+        char step = path[pos++];
+        size_t end = pos;
+        while (end < path.size() && ! is_step_separator(path[end]))
+            end++;
+
+        std::string token = path.substr(pos, end - pos);
+        pos = end;
+
+        if (step == ' ')
+        {
+            if (! is_instance(sc, value))
+                return false;
+
+            pointer env = sc->vptr->vector_elem(value, 2);
+            pointer b = sc->vptr->pair_car(env);
+            for ( ; sc->vptr->is_pair(b); b = sc->vptr->pair_cdr(b))
+                if (token == sc->vptr->symname(sc->vptr->pair_car(sc->vptr->pair_car(b))))
+                    break;
+
+            if (! sc->vptr->is_pair(b))
+                return false;
+
+            location.kind = LOCATION_SLOT;
+            location.cell = sc->vptr->pair_car(b);
+            value = sc->vptr->pair_cdr(location.cell);
+            continue;
+        }
+
+        if (token.empty() || token[token.size() - 1] != (step == '[' ? ']' : ')'))
+            return false;
+        token.erase(token.size() - 1);
+
+        if (step == '[')
+        {
+            long index = strtol(token.c_str(), NULL, 10);
+            if (! sc->vptr->is_vector(value) || index < 0 || index >= sc->vptr->vector_length(value))
+                return false;
+
+            location.kind = LOCATION_VECTOR;
+            location.cell = value;
+            location.index = index;
+            value = sc->vptr->vector_elem(value, index);
+            continue;
+        }
+
+        if (! sc->vptr->is_pair(value))
+            return false;
+
+        if (token == ".")
+        {
+            while (sc->vptr->is_pair(sc->vptr->pair_cdr(value)))
+                value = sc->vptr->pair_cdr(value);
+
+            location.kind = LOCATION_CDR;
+            location.cell = value;
+            value = sc->vptr->pair_cdr(value);
+            continue;
+        }
+
+        long index = strtol(token.c_str(), NULL, 10);
+        for ( ; index > 0; index--)
+        {
+            value = sc->vptr->pair_cdr(value);
+            if (! sc->vptr->is_pair(value))
+                return false;
+        }
+
+        location.kind = LOCATION_CAR;
+        location.cell = value;
+        value = sc->vptr->pair_car(value);
+    }
+
+    return true;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool state_path_get(
+    scheme* sc,
+    pointer instance,
+    const std::string& path,
+    pointer& outValue
+    )
+{
+    state_location_t location;
+    return resolve_state_path(sc, instance, path, location, outValue);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool state_path_set(
+    scheme* sc,
+    pointer instance,
+    const std::string& path,
+    pointer value
+    )
+{
+    state_location_t location;
+    pointer current;
+    if (! resolve_state_path(sc, instance, path, location, current))
+        return false;
+
+    switch (location.kind)
+    {
+    case LOCATION_SLOT:
+    case LOCATION_CDR:
+        sc->vptr->set_cdr(location.cell, value);
+        break;
+    case LOCATION_CAR:
+        sc->vptr->set_car(location.cell, value);
+        break;
+    case LOCATION_VECTOR:
+        sc->vptr->set_vector_elem(location.cell, location.index, value);
+        break;
+    }
+
+    return true;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// a value written below a read binding is only visible to the reader
+// if no instance binding lies between the two; nested instance
+// variables are always read through their own (recorded) lookups
+static bool read_observes_write(
+    const std::string& read,
+    const std::string& write
+    )
+{
+    if (read == write || state_path_is_ancestor(write, read))
+        return true;
+
+    if (state_path_is_ancestor(read, write))
+        return write.find(' ', read.size()) == std::string::npos;
+
+    return false;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool state_access_conflicts(
+    const StateAccessSet& access,
+    const std::set<std::string>& committedWrites
+    )
+{
+    if (! access.Complete)
+        return true;
+
+    std::set<std::string>::const_iterator w;
+    for (w = committedWrites.begin(); w != committedWrites.end(); w++)
+    {
+        std::set<std::string>::const_iterator r;
+        for (r = access.Reads.begin(); r != access.Reads.end(); r++)
+            if (read_observes_write(*r, *w))
+                return true;
+
+        std::map<std::string, std::string>::const_iterator o;
+        for (o = access.Writes.begin(); o != access.Writes.end(); o++)
+            if (o->first == *w
+                || state_path_is_ancestor(o->first, *w)
+                || state_path_is_ancestor(*w, o->first))
+                return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,124 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "scheme-private.h"
+
+#include <string>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// A state path names a location in the contract state relative to the
+// contract instance. Instance bindings are written as " name", vector
+// elements as "[i]", list elements as "(i)" and the tail of an improper
+// list as "(.)". None of the separators can appear in a symbol so a
+// path can be split without ambiguity.
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// StateAccessSet records how a single message touched the contract
+// state: the instance bindings it read through variable lookups and,
+// for each minimal changed path, the serialized expression for the new
+// value. Complete is cleared when the access could not be described
+// in terms of paths (for example, a binding was added to an instance).
+class StateAccessSet
+{
+public:
+    std::set<std::string> Reads;
+    std::map<std::string, std::string> Writes;
+    bool Complete;
+
+    StateAccessSet(void) : Complete(true) {}
+
+    void clear(void)
+    {
+        Reads.clear();
+        Writes.clear();
+        Complete = true;
+    }
+};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// StateSnapshot captures a shallow signature for every path reachable
+// from the contract instance along with the binding slot that holds
+// each instance variable; comparing two snapshots of the same heap
+// yields the set of changed paths
+class StateSnapshot
+{
+public:
+    std::map<std::string, std::string> Signatures;
+    std::unordered_map<pointer, std::string> Slots;
+    bool Complete;
+
+    StateSnapshot(void) : Complete(true) {}
+
+    void capture(scheme* sc, pointer instance);
+};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// StateAccessTracker is attached to the interpreter (slot_observer_data)
+// while a message runs; reads of slots captured in the snapshot are
+// recorded in the access set
+class StateAccessTracker
+{
+public:
+    StateSnapshot Before;
+    StateAccessSet* Access;
+
+    StateAccessTracker(void) : Access(NULL) {}
+};
+
+void state_access_observer(scheme* sc, pointer slot);
+
+// true if ancestor is a proper prefix of path that ends on a step
+bool state_path_is_ancestor(
+    const std::string& ancestor,
+    const std::string& path
+    );
+
+// compute the changed paths between two snapshots, any path whose
+// ancestor changed is omitted; returns false if a change could not
+// be expressed as a replacement of an existing path
+bool state_snapshot_diff(
+    const StateSnapshot& before,
+    const StateSnapshot& after,
+    std::vector<std::string>& outChanged
+    );
+
+// locate or replace the value at a path in the heap of an interpreter;
+// both return false if the path does not exist
+bool state_path_get(
+    scheme* sc,
+    pointer instance,
+    const std::string& path,
+    pointer& outValue
+    );
+
+bool state_path_set(
+    scheme* sc,
+    pointer instance,
+    const std::string& path,
+    pointer value
+    );
+
+// true if a message with the given accesses, executed against the
+// base state, could have observed or overwritten any of the paths
+// written by messages committed since that base state
+bool state_access_conflicts(
+    const StateAccessSet& access,
+    const std::set<std::string>& committedWrites
+    );
@@ -162,9 +162,16 @@ static pointer environment_to_list(scheme * sc, pointer args)
     if (sc->vptr->is_vector(bindings))
         return unpack_hashed_environment(sc, bindings);
 
-    // handle the case where the environment is represented by a list
+    // handle the case where the environment is represented by a list,
+    // every binding is read so let any access observer know about it
     if (sc->vptr->is_pair(bindings))
+    {
+        if (sc->slot_observer)
+            for (pointer p = bindings; sc->vptr->is_pair(p); p = sc->vptr->pair_cdr(p))
+                sc->slot_observer(sc, sc->vptr->pair_car(p));
+
         return copy_list(sc, bindings);
+    }
 
     return sc->F;
 }
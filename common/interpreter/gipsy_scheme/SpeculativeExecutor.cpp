@@ -0,0 +1,179 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#if _UNTRUSTED_
+#include <atomic>
+#include <thread>
+#endif
+
+#include "error.h"
+#include "pdo_error.h"
+
+#include "GipsyInterpreter.h"
+#include "SpeculativeExecutor.h"
+
+namespace pc = pdo::contracts;
+namespace pe = pdo::error;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+SpeculativeExecutor::SpeculativeExecutor(size_t workers) :
+    workers_(workers > 0 ? workers : 1)
+{
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void SpeculativeExecutor::execute_message(
+    const std::string& ContractID,
+    const std::string& CreatorID,
+    const pc::ContractCode& inContractCode,
+    const pc::ContractMessage& inMessage,
+    const pc::ContractState& inContractState,
+    SpeculativeResult& outResult
+    )
+{
+    outResult.Succeeded = false;
+    outResult.Result.clear();
+    outResult.Error.clear();
+    outResult.Dependencies.clear();
+    outResult.State.State.clear();
+    outResult.Access.clear();
+
+    try
+    {
+        GipsyInterpreter interpreter;
+        interpreter.track_state_access(&outResult.Access);
+        interpreter.send_message_to_contract(
+            ContractID, CreatorID, inContractCode, inMessage, inContractState,
+            outResult.State, outResult.Dependencies, outResult.Result);
+
+        outResult.Succeeded = true;
+    }
+    catch (pe::Error& e)
+    {
+        outResult.Error = e.what();
+    }
+    catch (std::exception& e)
+    {
+        outResult.Error = e.what();
+        outResult.Access.Complete = false;
+    }
+
+    if (outResult.Access.Complete)
+        outResult.State.State.clear();
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void SpeculativeExecutor::execute_batch(
+    const std::string& ContractID,
+    const std::string& CreatorID,
+    const pc::ContractCode& inContractCode,
+    const std::vector<pc::ContractMessage>& inMessages,
+    const pc::ContractState& inContractState,
+    pc::ContractState& outContractState,
+    std::vector<SpeculativeResult>& outResults
+    )
+{
+    size_t count = inMessages.size();
+    outResults.clear();
+    outResults.resize(count);
+
+    /* ---------- Speculate every message against the base state ---------- */
+#if _UNTRUSTED_
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers_ && w < count; w++)
+    {
+        threads.push_back(std::thread([&]() {
+                    for (size_t i = next++; i < count; i = next++)
+                        this->execute_message(
+                            ContractID, CreatorID, inContractCode, inMessages[i],
+                            inContractState, outResults[i]);
+                }));
+    }
+
+    for (size_t w = 0; w < threads.size(); w++)
+        threads[w].join();
+#else
+    for (size_t i = 0; i < count; i++)
+        this->execute_message(
+            ContractID, CreatorID, inContractCode, inMessages[i],
+            inContractState, outResults[i]);
+#endif
+
+    /* ---------- Commit in order, re-executing on conflict ---------- */
+
+    // current holds the serialized state whenever merged is not loaded
+    // or has no uncommitted updates; the state hash stays that of the
+    // base state, see the note in SpeculativeExecutor.h
+    pc::ContractState current = inContractState;
+    std::unique_ptr<GipsyInterpreter> merged;
+    bool dirty = false;
+
+    std::set<std::string> committed;
+    for (size_t i = 0; i < count; i++)
+    {
+        SpeculativeResult& result = outResults[i];
+
+        if (state_access_conflicts(result.Access, committed))
+        {
+            if (dirty)
+            {
+                merged->get_contract_state(current);
+                dirty = false;
+            }
+
+            this->execute_message(
+                ContractID, CreatorID, inContractCode, inMessages[i], current, result);
+            result.Reexecuted = true;
+
+            // the update cannot be expressed as writes to paths, take the
+            // whole state and force everything that follows to re-execute
+            if (result.Succeeded && ! result.Access.Complete)
+            {
+                current.State = result.State.State;
+                merged.reset();
+                committed.insert("");
+                continue;
+            }
+        }
+
+        if (! result.Succeeded || result.Access.Writes.empty())
+            continue;
+
+        if (! merged)
+        {
+            merged.reset(new GipsyInterpreter());
+            merged->load_contract_for_update(inContractCode, current);
+        }
+
+        merged->update_contract_state(result.Access.Writes);
+        dirty = true;
+
+        std::map<std::string,std::string>::const_iterator w;
+        for (w = result.Access.Writes.begin(); w != result.Access.Writes.end(); w++)
+            committed.insert(w->first);
+    }
+
+    if (dirty)
+        merged->get_contract_state(current);
+
+    outContractState.State = current.State;
+}
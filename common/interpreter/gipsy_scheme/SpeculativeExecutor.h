@@ -0,0 +1,83 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+
+#include "GipsyInterpreter.h"
+#include "GipsyStateAccess.h"
+
+namespace pc = pdo::contracts;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+class SpeculativeResult
+{
+public:
+    bool Succeeded;
+    bool Reexecuted;
+    std::string Result;
+    std::string Error;
+    std::map<std::string,std::string> Dependencies;
+
+    // only retained when the access could not be tracked
+    pc::ContractState State;
+    StateAccessSet Access;
+
+    SpeculativeResult(void) : Succeeded(false), Reexecuted(false) {}
+};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// SpeculativeExecutor applies a batch of messages to one contract. Every
+// message is first run in its own interpreter against the base state
+// while the instance bindings it reads and writes are recorded. Results
+// are then committed in order; a message whose reads or writes overlap
+// the writes committed before it is re-executed against the updated
+// state. The final state and every result match serial execution, with
+// one exception: all messages in the batch see the state hash of the
+// base state in the :contract state property since intermediate states
+// are never encrypted.
+//
+// Speculative runs use worker threads in untrusted builds; the enclave
+// has no thread creation so they run one after another there.
+class SpeculativeExecutor
+{
+private:
+    size_t workers_;
+
+    void execute_message(
+        const std::string& ContractID,
+        const std::string& CreatorID,
+        const pc::ContractCode& inContractCode,
+        const pc::ContractMessage& inMessage,
+        const pc::ContractState& inContractState,
+        SpeculativeResult& outResult
+        );
+
+public:
+    SpeculativeExecutor(size_t workers = 1);
+
+    void execute_batch(
+        const std::string& ContractID,
+        const std::string& CreatorID,
+        const pc::ContractCode& inContractCode,
+        const std::vector<pc::ContractMessage>& inMessages,
+        const pc::ContractState& inContractState,
+        pc::ContractState& outContractState,
+        std::vector<SpeculativeResult>& outResults
+        );
+};
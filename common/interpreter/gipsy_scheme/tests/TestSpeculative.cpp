@@ -0,0 +1,227 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// gipsy-test runs a batch of integer-key messages through the
+// SpeculativeExecutor and compares the state and the results with those
+// of the same messages sent one at a time. Messages on keys that an
+// earlier message of the batch changed must be re-executed, the others
+// must not be.
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "crypto.h"
+#include "error.h"
+#include "pdo_error.h"
+#include "types.h"
+
+#include "GipsyInterpreter.h"
+#include "SpeculativeExecutor.h"
+#include "ContractSource.h"
+
+namespace pc = pdo::contracts;
+namespace pe = pdo::error;
+
+#ifndef GIPSY_TEST_CONTRACTS_DIR
+#define GIPSY_TEST_CONTRACTS_DIR "contracts"
+#endif
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void Log(int level, const char* fmt, ...)
+{
+    if (level < PDO_LOG_WARNING)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void SetStateHash(pc::ContractState& state)
+{
+    ByteArray serialized(state.State.begin(), state.State.end());
+    state.StateHash = ByteArrayToBase64EncodedString(pdo::crypto::ComputeMessageHash(serialized));
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static pc::ContractMessage Message(const std::string& expression)
+{
+    pc::ContractMessage message;
+    message.OriginatorID = "tom";
+    message.Message = expression;
+    return message;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// a message that fails leaves the state as it was, as in the enclave
+static bool SendSerial(
+    const pc::ContractCode& code,
+    const pc::ContractMessage& message,
+    pc::ContractState& ioState,
+    std::string& outResult
+    )
+{
+    pc::ContractState state;
+    std::map<std::string, std::string> dependencies;
+
+    try
+    {
+        GipsyInterpreter interpreter;
+        interpreter.send_message_to_contract(
+            "integer-key", "tom", code, message, ioState, state, dependencies, outResult);
+    }
+    catch (pe::Error& e)
+    {
+        outResult = e.what();
+        return false;
+    }
+
+    ioState.State = state.State;
+    return true;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static int TestSpeculativeBatch(const std::string& contractsDir)
+{
+    pc::ContractCode code =
+        LoadContract(contractsDir, "integer-key", "integer-key.scm", "integer-key");
+
+    pc::ContractState base;
+    {
+        GipsyInterpreter interpreter;
+        interpreter.create_initial_contract_state("integer-key", "tom", code, Message(""), base);
+    }
+
+    std::string result;
+    const char* keys[] = { "k0", "k1", "k2", "k3" };
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+    {
+        std::string expression = "'(create \"" + std::string(keys[i]) + "\" \"10\")";
+        if (! SendSerial(code, Message(expression), base, result))
+        {
+            printf("TestSpeculative: failed to create %s.\n%s\n", keys[i], result.c_str());
+            return -1;
+        }
+    }
+
+    // every message in the batch sees the hash of the base state
+    SetStateHash(base);
+
+    // expression and whether an earlier message in the batch changed
+    // a key the message uses
+    struct { const char* expression; bool conflicts; } batch[] = {
+        { "'(inc \"k0\" 1)", false },
+        { "'(inc \"k1\" 2)", false },
+        { "'(inc \"k0\" 3)", true },
+        { "'(dec \"k2\" 1)", false },
+        { "'(xfer \"k1\" \"k3\" 1)", true },
+        { "'(inc \"k3\" 4)", true },
+        { "'(get-value \"k2\")", true },
+        { "'(dec \"k0\" 100)", true }
+    };
+    size_t count = sizeof(batch) / sizeof(batch[0]);
+
+    std::vector<pc::ContractMessage> messages;
+    for (size_t i = 0; i < count; i++)
+        messages.push_back(Message(batch[i].expression));
+
+    pc::ContractState serial = base;
+    std::vector<std::string> serialResults(count);
+    std::vector<bool> serialSucceeded(count);
+    for (size_t i = 0; i < count; i++)
+        serialSucceeded[i] = SendSerial(code, messages[i], serial, serialResults[i]);
+
+    pc::ContractState speculative;
+    std::vector<SpeculativeResult> results;
+    SpeculativeExecutor executor(4);
+    executor.execute_batch("integer-key", "tom", code, messages, base, speculative, results);
+
+    if (results.size() != count)
+    {
+        printf("TestSpeculative: expected %zu results, got %zu.\n", count, results.size());
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (results[i].Succeeded != serialSucceeded[i])
+        {
+            printf("TestSpeculative: %s %s in the batch but %s serially.\n%s\n",
+                   batch[i].expression,
+                   results[i].Succeeded ? "succeeded" : "failed",
+                   serialSucceeded[i] ? "succeeded" : "failed",
+                   results[i].Error.c_str());
+            return -1;
+        }
+
+        if (results[i].Succeeded && results[i].Result != serialResults[i])
+        {
+            printf("TestSpeculative: %s returned %s in the batch and %s serially.\n",
+                   batch[i].expression, results[i].Result.c_str(), serialResults[i].c_str());
+            return -1;
+        }
+
+        if (results[i].Reexecuted != batch[i].conflicts)
+        {
+            printf("TestSpeculative: %s was %sre-executed.\n",
+                   batch[i].expression, results[i].Reexecuted ? "" : "not ");
+            return -1;
+        }
+    }
+
+    if (speculative.State != serial.State)
+    {
+        printf("TestSpeculative: batch state differs from the serial state.\n");
+        return -1;
+    }
+
+    printf("TestSpeculative: batch of %zu messages matches serial execution.\n", count);
+    return 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+int main(int argc, char* argv[])
+{
+    std::string contractsDir = argc > 1 ? argv[1] : GIPSY_TEST_CONTRACTS_DIR;
+
+    printf("Test gipsy speculative execution.\n");
+
+    int result;
+    try
+    {
+        result = TestSpeculativeBatch(contractsDir);
+    }
+    catch (std::exception& e)
+    {
+        printf("TestSpeculative: unexpected exception.\n%s\n", e.what());
+        result = -1;
+    }
+
+    if (result != 0)
+    {
+        printf("ERROR: gipsy speculative execution test FAILED.\n");
+        return -1;
+    }
+
+    printf("Test gipsy speculative execution SUCCESSFUL!\n");
+    return 0;
+}
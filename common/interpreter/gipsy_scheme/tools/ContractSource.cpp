@@ -0,0 +1,118 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "error.h"
+#include "pdo_error.h"
+
+#include "ContractSource.h"
+
+namespace pc = pdo::contracts;
+namespace pe = pdo::error;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static bool FindFile(
+    const std::string& file,
+    const std::vector<std::string>& searchPath,
+    std::string& outPath
+    )
+{
+    for (size_t i = 0; i < searchPath.size(); i++)
+    {
+        std::string path = searchPath[i] + "/" + file;
+        std::ifstream probe(path.c_str());
+        if (probe)
+        {
+            outPath = path;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the equivalent of build-contract in contract-builder.scm: required
+// files are included once in place of the require expression, the
+// files named by require-when are left out since no build arguments
+// such as "debug" are given here. Require expressions are expected on
+// a line of their own as they are throughout the contracts tree.
+static void AssembleSource(
+    const std::string& file,
+    const std::vector<std::string>& searchPath,
+    std::set<std::string>& ioIncluded,
+    std::string& outSource
+    )
+{
+    std::string path;
+    pe::ThrowIf<pe::ValueError>(
+        ! FindFile(file, searchPath, path), ("unable to locate " + file).c_str());
+
+    if (! ioIncluded.insert(path).second)
+        return;
+
+    std::ifstream input(path.c_str());
+    std::string line;
+    while (std::getline(input, line))
+    {
+        size_t start = line.find_first_not_of(" \t");
+        if (start != std::string::npos && line.compare(start, 13, "(require-when") == 0)
+            continue;
+
+        if (start == std::string::npos || line.compare(start, 9, "(require ") != 0)
+        {
+            outSource.append(line);
+            outSource.append("\n");
+            continue;
+        }
+
+        for (size_t open = line.find('"', start); open != std::string::npos; )
+        {
+            size_t close = line.find('"', open + 1);
+            pe::ThrowIf<pe::ValueError>(close == std::string::npos, "malformed require expression");
+
+            AssembleSource(line.substr(open + 1, close - open - 1), searchPath, ioIncluded, outSource);
+            open = line.find('"', close + 1);
+        }
+    }
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pc::ContractCode LoadContract(
+    const std::string& contractsDir,
+    const std::string& directory,
+    const std::string& file,
+    const std::string& name,
+    const char* extra
+    )
+{
+    std::vector<std::string> searchPath;
+    searchPath.push_back(contractsDir + "/" + directory);
+    searchPath.push_back(contractsDir + "/packages");
+    searchPath.push_back(contractsDir + "/../common/interpreter/gipsy_scheme/packages");
+
+    pc::ContractCode code;
+    std::set<std::string> included;
+    AssembleSource(file, searchPath, included, code.Code);
+    if (extra != NULL)
+        code.Code.append(extra);
+
+    code.Name = name;
+    return code;
+}
@@ -0,0 +1,34 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "GipsyInterpreter.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// LoadContract assembles the source of a contract from the contracts
+// tree for the host tools: the file is looked up in contractsDir/directory,
+// the contract packages and the gipsy packages, and every file it
+// requires is included in place. extra, when given, is appended to the
+// assembled source.
+pdo::contracts::ContractCode LoadContract(
+    const std::string& contractsDir,
+    const std::string& directory,
+    const std::string& file,
+    const std::string& name,
+    const char* extra = NULL
+    );
@@ -0,0 +1,495 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// gipsy-bench runs the integer-key and auction contracts through the
+// gipsy interpreter outside the enclave and reports the latency of each
+// operation. The request sequences follow integer-key-test.scm and
+// auction-test.scm, but every message is a separate request: a fresh
+// interpreter loads the code and the serialized state, runs the method
+// and serializes the state again, as the enclave does. Encryption and
+// the enclave transitions are not part of the measurement.
+//
+//     gipsy-bench [-c contracts-dir] [-w workload] [-n iterations] [-s sizes]
+//
+// -w selects integer-key, integer-key-batch, auction or all; -s is a
+// comma separated list of state sizes, the number of counters created
+// before the integer-key measurement starts or the number of bidders in
+// the auction; the defaults are 10 iterations and a state size of 10.
+// The integer-key-batch workload sends one batch of increments over all
+// counters, serially and through the SpeculativeExecutor. Signatures
+// the test scripts compute on the client side come from a small agent
+// contract that holds the signing keys and is not measured.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "crypto.h"
+#include "error.h"
+#include "pdo_error.h"
+#include "types.h"
+
+#include "GipsyInterpreter.h"
+#include "SpeculativeExecutor.h"
+#include "ContractSource.h"
+
+namespace pc = pdo::contracts;
+namespace pe = pdo::error;
+
+typedef std::chrono::steady_clock bench_clock;
+
+#ifndef GIPSY_BENCH_CONTRACTS_DIR
+#define GIPSY_BENCH_CONTRACTS_DIR "contracts"
+#endif
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void Log(int level, const char* fmt, ...)
+{
+    if (level < PDO_LOG_WARNING)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Contract source
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+// the agent signs bids and escrow releases in place of the asset
+// contract keys and agent keys the test scripts create locally
+static const char* AgentSource =
+    "(define-class bench-agent (super-class base-contract))\n"
+    "(define-method bench-agent (make-bid owner key value)\n"
+    "  (let* ((externalized `((key ,key) (value ,value) (owner ,owner)))\n"
+    "         (expression (list externalized ())))\n"
+    "    (list externalized () (send contract-signing-keys 'sign-expression expression))))\n"
+    "(define-method bench-agent (sign-attestation attestation)\n"
+    "  (let ((expression (list (car attestation) (cadr attestation))))\n"
+    "    (list (cadr attestation) (send contract-signing-keys 'sign-expression expression))))\n";
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Measurement
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+class Measurements
+{
+public:
+    // operation -> latency of each request in milliseconds, operations
+    // are reported in the order they were first measured
+    std::vector<std::string> Operations;
+    std::map<std::string, std::vector<double> > Latencies;
+
+    void add(const std::string& operation, double milliseconds)
+    {
+        std::vector<double>& latencies = Latencies[operation];
+        if (latencies.empty())
+            Operations.push_back(operation);
+        latencies.push_back(milliseconds);
+    }
+};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// a contract whose state is carried from one request to the next, a
+// request that fails leaves the state as it was
+class BenchContract
+{
+private:
+    std::string id_;
+    pc::ContractCode code_;
+    pc::ContractState state_;
+    Measurements* measurements_;
+
+    void set_state(const pc::ContractState& state)
+    {
+        ByteArray serialized(state.State.begin(), state.State.end());
+        state_.State = state.State;
+        state_.StateHash = ByteArrayToBase64EncodedString(pdo::crypto::ComputeMessageHash(serialized));
+    }
+
+public:
+    BenchContract(const std::string& id, const pc::ContractCode& code, Measurements* measurements) :
+        id_(id), code_(code), measurements_(measurements)
+    {
+    }
+
+    size_t state_size(void) const
+    {
+        return state_.State.size();
+    }
+
+    const pc::ContractState& state(void) const
+    {
+        return state_;
+    }
+
+    void initialize(const std::string& originator)
+    {
+        pc::ContractMessage message;
+        message.OriginatorID = originator;
+
+        pc::ContractState state;
+        bench_clock::time_point start = bench_clock::now();
+        {
+            GipsyInterpreter interpreter;
+            interpreter.create_initial_contract_state(id_, originator, code_, message, state);
+        }
+        std::chrono::duration<double, std::milli> elapsed = bench_clock::now() - start;
+
+        if (measurements_ != NULL)
+            measurements_->add("initialize", elapsed.count());
+        set_state(state);
+    }
+
+    // operation names the measurement, NULL sends the request without
+    // measuring it
+    std::string send(const char* operation, const std::string& originator, const std::string& expression)
+    {
+        pc::ContractMessage message;
+        message.OriginatorID = originator;
+        message.Message = expression;
+
+        pc::ContractState state;
+        std::map<std::string, std::string> dependencies;
+        std::string result;
+
+        bench_clock::time_point start = bench_clock::now();
+        {
+            GipsyInterpreter interpreter;
+            interpreter.send_message_to_contract(
+                id_, originator, code_, message, state_, state, dependencies, result);
+        }
+        std::chrono::duration<double, std::milli> elapsed = bench_clock::now() - start;
+
+        if (operation != NULL && measurements_ != NULL)
+            measurements_->add(operation, elapsed.count());
+        set_state(state);
+
+        return result;
+    }
+};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static double Percentile(const std::vector<double>& sorted, double fraction)
+{
+    size_t rank = (size_t)(fraction * sorted.size() + 0.5);
+    if (rank > 0)
+        rank--;
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void Report(const Measurements& measurements)
+{
+    printf("    %-20s %6s %9s %9s %9s %9s %9s %9s\n",
+           "operation", "count", "mean ms", "p50 ms", "p90 ms", "p99 ms", "max ms", "ops/s");
+
+    size_t totalCount = 0;
+    double totalTime = 0;
+
+    for (size_t i = 0; i < measurements.Operations.size(); i++)
+    {
+        std::vector<double> sorted = measurements.Latencies.find(measurements.Operations[i])->second;
+        std::sort(sorted.begin(), sorted.end());
+
+        double sum = 0;
+        for (size_t j = 0; j < sorted.size(); j++)
+            sum += sorted[j];
+
+        totalCount += sorted.size();
+        totalTime += sum;
+
+        printf("    %-20s %6zu %9.3f %9.3f %9.3f %9.3f %9.3f %9.1f\n",
+               measurements.Operations[i].c_str(), sorted.size(), sum / sorted.size(),
+               Percentile(sorted, 0.50), Percentile(sorted, 0.90), Percentile(sorted, 0.99),
+               sorted.back(), sorted.size() * 1000.0 / sum);
+    }
+
+    if (totalCount > 0)
+        printf("    %-20s %6zu %9.3f %49.1f\n",
+               "all", totalCount, totalTime / totalCount, totalCount * 1000.0 / totalTime);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static std::string Quote(const std::string& value)
+{
+    return "\"" + value + "\"";
+}
+
+// the elements of a list returned by a method, for splicing into the
+// next message
+static std::string Splice(const std::string& result)
+{
+    pe::ThrowIf<pe::ValueError>(
+        result.size() < 2 || result[0] != '(' || result[result.size() - 1] != ')',
+        "method result is not a list");
+    return result.substr(1, result.size() - 2);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Workloads
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// integer-key-test.scm: two owners create counters, change and
+// transfer their values, then escrow a counter and release it with a
+// signature from the escrow agent
+static void RunIntegerKey(
+    const std::string& contractsDir,
+    size_t stateSize,
+    size_t iterations,
+    BenchContract& agent
+    )
+{
+    Measurements measurements;
+    BenchContract contract(
+        "integer-key", LoadContract(contractsDir, "integer-key", "integer-key.scm", "integer-key"),
+        &measurements);
+
+    contract.initialize("tom");
+
+    // counters owned by the creator, the destination of transfers
+    for (size_t i = 0; i < std::max<size_t>(stateSize, 1); i++)
+        contract.send(NULL, "tom", "'(create " + Quote("key" + std::to_string(i)) + " \"0\")");
+
+    std::string agentKey = agent.send(NULL, "agent", "'(get-public-signing-key)");
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        std::string a = Quote("a" + std::to_string(i));
+        std::string b = Quote("b" + std::to_string(i));
+        std::string c = Quote("key" + std::to_string(i % std::max<size_t>(stateSize, 1)));
+
+        contract.send("create", "sam", "'(create " + a + " \"0\")");
+        contract.send("create", "martha", "'(create " + b + " \"0\")");
+        contract.send("inc", "sam", "'(inc " + a + " \"5\")");
+        contract.send("inc", "martha", "'(inc " + b + " \"5\")");
+        contract.send("dec", "martha", "'(dec " + b + " \"1\")");
+        contract.send("xfer", "martha", "'(xfer " + b + " " + c + " 1)");
+        contract.send("get-value", "sam", "'(get-value " + a + ")");
+
+        contract.send("escrow", "sam", "'(escrow " + a + " " + agentKey + ")");
+        std::string attestation = contract.send("escrow-attestation", "sam", "'(escrow-attestation " + a + ")");
+        std::string release = agent.send(NULL, "agent", "'(sign-attestation " + attestation + ")");
+        contract.send("disburse", "sam", "'(disburse " + a + " " + Splice(release) + ")");
+    }
+
+    printf("integer-key: %zu counters, %zu iterations, final state %zu bytes\n",
+           stateSize, iterations, contract.state_size());
+    Report(measurements);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// one increment for every counter followed by a second increment for
+// every fourth counter, so a fifth of the batch conflicts with earlier
+// messages; the batch is sent one message at a time and then through
+// the SpeculativeExecutor, both against the same state
+static void RunIntegerKeyBatch(
+    const std::string& contractsDir,
+    size_t stateSize,
+    size_t iterations
+    )
+{
+    Measurements measurements;
+    pc::ContractCode code = LoadContract(contractsDir, "integer-key", "integer-key.scm", "integer-key");
+    BenchContract contract("integer-key", code, NULL);
+
+    size_t counters = std::max<size_t>(stateSize, 1);
+    contract.initialize("tom");
+    for (size_t i = 0; i < counters; i++)
+        contract.send(NULL, "tom", "'(create " + Quote("key" + std::to_string(i)) + " \"0\")");
+
+    std::vector<pc::ContractMessage> messages;
+    for (size_t i = 0; i < counters + (counters + 3) / 4; i++)
+    {
+        pc::ContractMessage message;
+        message.OriginatorID = "tom";
+        message.Message = "'(inc " + Quote("key" + std::to_string(i < counters ? i : (i - counters) * 4)) + " 1)";
+        messages.push_back(message);
+    }
+
+    size_t workers = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    SpeculativeExecutor executor(workers);
+    size_t reexecuted = 0;
+
+    for (size_t n = 0; n < iterations; n++)
+    {
+        BenchContract serial(contract);
+        bench_clock::time_point start = bench_clock::now();
+        for (size_t i = 0; i < messages.size(); i++)
+            serial.send(NULL, "tom", messages[i].Message);
+        std::chrono::duration<double, std::milli> elapsed = bench_clock::now() - start;
+        measurements.add("serial batch", elapsed.count());
+
+        pc::ContractState state;
+        std::vector<SpeculativeResult> results;
+        start = bench_clock::now();
+        executor.execute_batch("integer-key", "tom", code, messages, contract.state(), state, results);
+        elapsed = bench_clock::now() - start;
+        measurements.add("speculative batch", elapsed.count());
+
+        pe::ThrowIf<pe::RuntimeError>(
+            state.State != serial.state().State, "speculative batch state differs from serial state");
+
+        reexecuted = 0;
+        for (size_t i = 0; i < results.size(); i++)
+            reexecuted += results[i].Reexecuted ? 1 : 0;
+    }
+
+    printf("integer-key-batch: %zu counters, %zu messages, %zu re-executed, %zu workers, %zu iterations\n",
+           counters, messages.size(), reexecuted, workers, iterations);
+    Report(measurements);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// auction-test.scm: the creator primes the auction, bidders submit
+// bids, then in turn look up the maximum bid, cancel their bid and
+// submit a higher one before the creator closes the auction
+static void RunAuction(
+    const std::string& contractsDir,
+    size_t stateSize,
+    size_t iterations,
+    BenchContract& agent
+    )
+{
+    Measurements measurements;
+    BenchContract contract(
+        "auction", LoadContract(contractsDir, "auction", "auction.scm", "auction"),
+        &measurements);
+
+    size_t bidders = std::max<size_t>(stateSize, 1);
+    std::string creator = "person0";
+
+    contract.initialize(creator);
+
+    std::string assetKey = agent.send(NULL, "agent", "'(get-public-signing-key)");
+    contract.send("initialize-auction", creator, "'(initialize " + assetKey + ")");
+
+    std::string bid = agent.send(NULL, "agent", "'(make-bid \"person0\" \"person0_asset\" 1)");
+    contract.send("prime-auction", creator, "'(prime-auction* " + Splice(bid) + ")");
+
+    for (size_t p = 1; p <= bidders; p++)
+    {
+        std::string person = "person" + std::to_string(p);
+        bid = agent.send(NULL, "agent",
+                         "'(make-bid " + Quote(person) + " " + Quote(person + "_0") + " " +
+                         std::to_string(p % 50 + 2) + ")");
+        contract.send("submit-bid", person, "'(submit-bid* " + Splice(bid) + ")");
+    }
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        std::string person = "person" + std::to_string(i % bidders + 1);
+
+        std::string maximum = contract.send("max-bid", person, "'(max-bid)");
+        contract.send("cancel-bid", person, "'(cancel-bid)");
+
+        bid = agent.send(NULL, "agent",
+                         "'(make-bid " + Quote(person) + " " + Quote(person + "_" + std::to_string(i + 1)) +
+                         " " + std::to_string(atol(maximum.c_str()) + 1) + ")");
+        contract.send("submit-bid", person, "'(submit-bid* " + Splice(bid) + ")");
+        contract.send("check-bid", person, "'(check-bid)");
+    }
+
+    contract.send("close-bidding", creator, "'(close-bidding)");
+    contract.send("exchange-attestation", creator, "'(exchange-attestation)");
+
+    printf("auction: %zu bidders, %zu iterations, final state %zu bytes\n",
+           stateSize, iterations, contract.state_size());
+    Report(measurements);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void Usage(const char* program)
+{
+    fprintf(stderr,
+            "usage: %s [-c contracts-dir] [-w integer-key|integer-key-batch|auction|all] [-n iterations] [-s sizes]\n",
+            program);
+    exit(2);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+int main(int argc, char* argv[])
+{
+    std::string contractsDir = GIPSY_BENCH_CONTRACTS_DIR;
+    std::string workload = "all";
+    size_t iterations = 10;
+    std::vector<size_t> sizes;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            contractsDir = argv[++i];
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            workload = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            iterations = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            std::stringstream list(argv[++i]);
+            std::string size;
+            while (std::getline(list, size, ','))
+                sizes.push_back(strtoul(size.c_str(), NULL, 10));
+        }
+        else
+            Usage(argv[0]);
+    }
+
+    if (workload != "all" && workload != "integer-key" && workload != "integer-key-batch" &&
+        workload != "auction")
+        Usage(argv[0]);
+
+    if (sizes.empty())
+        sizes.push_back(10);
+
+    try
+    {
+        BenchContract agent(
+            "agent",
+            LoadContract(contractsDir, "packages", "contract-base.scm", "bench-agent", AgentSource),
+            NULL);
+        agent.initialize("agent");
+
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            if (workload == "all" || workload == "integer-key")
+                RunIntegerKey(contractsDir, sizes[i], iterations, agent);
+            if (workload == "all" || workload == "integer-key-batch")
+                RunIntegerKeyBatch(contractsDir, sizes[i], iterations);
+            if (workload == "all" || workload == "auction")
+                RunAuction(contractsDir, sizes[i], iterations, agent);
+        }
+    }
+    catch (std::exception& e)
+    {
+        fprintf(stderr, "gipsy-bench: benchmark failed.\n%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,222 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// gipsy-profile replays a log of contract requests through the gipsy
+// interpreter outside the enclave and writes the sampled stacks in the
+// folded format read by flamegraph tools. The log is written by the
+// python client when PDO_REQUEST_LOG names a file, one JSON object per
+// request; contract state is kept per contract id as requests are
+// replayed so the log must start with the initialize request of every
+// contract it references.
+//
+//     gipsy-profile [-i interval] [-o output] [-u] request-log
+//
+// -i sets the number of eval steps between samples, -o writes the
+// stacks to a file rather than stdout and -u leaves the initialize
+// requests out of the profile.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "crypto.h"
+#include "error.h"
+#include "jsonvalue.h"
+#include "packages/parson/parson.h"
+#include "pdo_error.h"
+#include "types.h"
+
+#include "GipsyInterpreter.h"
+#include "GipsyProfiler.h"
+
+namespace pc = pdo::contracts;
+namespace pe = pdo::error;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void Log(int level, const char* fmt, ...)
+{
+    if (level < PDO_LOG_WARNING)
+        return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static std::string GetString(const JSON_Object* object, const char* name)
+{
+    const char* value = json_object_dotget_string(object, name);
+    pe::ThrowIf<pe::ValueError>(value == NULL, "missing field in recorded request");
+    return std::string(value);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the enclave hashes the encrypted state, the plaintext serves as well
+// here since the hash only has to change when the state does
+static void SetStateHash(pc::ContractState& state)
+{
+    ByteArray serialized(state.State.begin(), state.State.end());
+    state.StateHash = ByteArrayToBase64EncodedString(pdo::crypto::ComputeMessageHash(serialized));
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void Replay(
+    const std::string& inRequest,
+    std::map<std::string, pc::ContractState>& ioStates,
+    GipsyProfiler& profiler,
+    bool inProfileInitialize
+    )
+{
+    JsonValue parsed(json_parse_string(inRequest.c_str()));
+    pe::ThrowIf<pe::ValueError>(parsed.value == NULL, "recorded request is not valid JSON");
+
+    const JSON_Object* request = json_value_get_object(parsed);
+    pe::ThrowIf<pe::ValueError>(request == NULL, "recorded request is not a JSON object");
+
+    std::string operation = GetString(request, "Operation");
+    std::string contractID = GetString(request, "ContractID");
+    std::string creatorID = GetString(request, "CreatorID");
+
+    pc::ContractCode code;
+    code.Code = GetString(request, "ContractCode.Code");
+    code.Name = GetString(request, "ContractCode.Name");
+
+    pc::ContractMessage message;
+    message.Message = GetString(request, "ContractMessage.Expression");
+    message.OriginatorID = GetString(request, "ContractMessage.OriginatorVerifyingKey");
+
+    GipsyInterpreter interpreter;
+
+    if (operation == "initialize")
+    {
+        if (inProfileInitialize)
+            interpreter.profile(&profiler);
+
+        pc::ContractState state;
+        interpreter.create_initial_contract_state(contractID, creatorID, code, message, state);
+        SetStateHash(state);
+        ioStates[contractID] = state;
+        return;
+    }
+
+    pe::ThrowIf<pe::ValueError>(operation != "update", "unknown operation in recorded request");
+
+    std::map<std::string, pc::ContractState>::iterator current = ioStates.find(contractID);
+    pe::ThrowIf<pe::ValueError>(
+        current == ioStates.end(), "update for a contract that was not initialized in the log");
+
+    interpreter.profile(&profiler);
+
+    pc::ContractState state;
+    std::map<std::string, std::string> dependencies;
+    std::string result;
+    interpreter.send_message_to_contract(
+        contractID, creatorID, code, message, current->second, state, dependencies, result);
+
+    SetStateHash(state);
+    current->second = state;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void Usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [-i interval] [-o output] [-u] request-log\n", program);
+    exit(2);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+int main(int argc, char* argv[])
+{
+    unsigned long interval = 1000;
+    const char* output = NULL;
+    const char* input = NULL;
+    bool updatesOnly = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            interval = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "-u") == 0)
+            updatesOnly = true;
+        else if (argv[i][0] != '-' && input == NULL)
+            input = argv[i];
+        else
+            Usage(argv[0]);
+    }
+
+    if (input == NULL || interval == 0)
+        Usage(argv[0]);
+
+    std::ifstream log(input);
+    if (! log)
+    {
+        fprintf(stderr, "unable to open %s\n", input);
+        return 1;
+    }
+
+    GipsyProfiler profiler(interval);
+    std::map<std::string, pc::ContractState> states;
+    size_t replayed = 0, failed = 0;
+
+    std::string line;
+    while (std::getline(log, line))
+    {
+        if (line.empty())
+            continue;
+
+        try
+        {
+            Replay(line, states, profiler, ! updatesOnly);
+            replayed++;
+        }
+        catch (std::exception& e)
+        {
+            fprintf(stderr, "request %zu failed: %s\n", replayed + failed + 1, e.what());
+            failed++;
+        }
+    }
+
+    std::string folded;
+    profiler.write_folded(folded);
+
+    if (output == NULL)
+        std::cout << folded;
+    else
+    {
+        std::ofstream out(output);
+        out << folded;
+        if (! out)
+        {
+            fprintf(stderr, "unable to write %s\n", output);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "%zu requests replayed, %zu failed, %llu samples\n",
+            replayed, failed, (unsigned long long)profiler.Samples);
+
+    return replayed > 0 || failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "error.h"
+#include "json_writer.h"
+#include "packages/base64/base64.h"
+
+namespace pe = pdo::error;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+JsonWriter::JsonWriter(ByteArray& output, size_t size_hint) :
+    output_(output),
+    after_key_(false)
+{
+    output_.reserve(output_.size() + size_hint);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::BeginObject(void)
+{
+    BeginValue();
+    output_.push_back('{');
+    empty_.push_back(true);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::EndObject(void)
+{
+    pe::ThrowIf<pe::RuntimeError>(
+        empty_.empty() || after_key_, "json writer; no object to end");
+
+    empty_.pop_back();
+    output_.push_back('}');
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::BeginArray(void)
+{
+    BeginValue();
+    output_.push_back('[');
+    empty_.push_back(true);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::EndArray(void)
+{
+    pe::ThrowIf<pe::RuntimeError>(
+        empty_.empty() || after_key_, "json writer; no array to end");
+
+    empty_.pop_back();
+    output_.push_back(']');
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::Key(const char* key)
+{
+    pe::ThrowIf<pe::RuntimeError>(
+        empty_.empty() || after_key_, "json writer; key outside of an object");
+
+    if (! empty_.back())
+        output_.push_back(',');
+    empty_.back() = false;
+
+    AppendEscaped(key, strlen(key));
+    output_.push_back(':');
+    after_key_ = true;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::String(const char* value)
+{
+    BeginValue();
+    AppendEscaped(value, strlen(value));
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::String(const std::string& value)
+{
+    BeginValue();
+    AppendEscaped(value.data(), value.size());
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// base64 never needs escaping, it is encoded in place between the quotes
+void JsonWriter::Base64(const ByteArray& value)
+{
+    BeginValue();
+
+    size_t position = output_.size();
+    output_.resize(position + BASE64_ENCODED_LENGTH(value.size()) + 2);
+    output_[position] = '"';
+    size_t length = base64_encode(
+        value.data(), value.size(), reinterpret_cast<char*>(output_.data() + position + 1));
+    output_[position + length + 1] = '"';
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::Boolean(bool value)
+{
+    BeginValue();
+    if (value)
+        Append("true", 4);
+    else
+        Append("false", 5);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::Number(int64_t value)
+{
+    BeginValue();
+
+    char digits[24];
+    size_t count = 0;
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : value;
+    do
+    {
+        digits[count++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    if (value < 0)
+        output_.push_back('-');
+    while (count > 0)
+        output_.push_back(digits[--count]);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::Terminate(void)
+{
+    pe::ThrowIf<pe::RuntimeError>(
+        ! empty_.empty() || after_key_, "json writer; document is incomplete");
+
+    output_.push_back('\0');
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// separate array elements; an object value must follow its key
+void JsonWriter::BeginValue(void)
+{
+    if (after_key_)
+    {
+        after_key_ = false;
+        return;
+    }
+
+    if (empty_.empty())
+        return;
+
+    // only arrays reach here with an open container, objects take keys
+    if (! empty_.back())
+        output_.push_back(',');
+    empty_.back() = false;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void JsonWriter::Append(const char* data, size_t size)
+{
+    output_.insert(output_.end(), data, data + size);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// runs that need no escaping are copied whole; '/' is left as is and
+// other control characters are written raw as the parson serializer
+// did, parson has no support for \u escapes when reading them back
+void JsonWriter::AppendEscaped(const char* data, size_t size)
+{
+    output_.push_back('"');
+
+    size_t start = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        char escape;
+        switch (data[i])
+        {
+        case '"': escape = '"'; break;
+        case '\\': escape = '\\'; break;
+        case '\b': escape = 'b'; break;
+        case '\f': escape = 'f'; break;
+        case '\n': escape = 'n'; break;
+        case '\r': escape = 'r'; break;
+        case '\t': escape = 't'; break;
+        default: continue;
+        }
+
+        Append(data + start, i - start);
+        start = i + 1;
+
+        output_.push_back('\\');
+        output_.push_back(escape);
+    }
+
+    Append(data + start, size - start);
+    output_.push_back('"');
+}
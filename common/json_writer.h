@@ -0,0 +1,65 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// JsonWriter emits a JSON document in a single pass, appending to a
+// ByteArray in the order values are written; keys are neither sorted
+// nor checked for duplicates so the caller writes them in the order
+// the document requires. Strings are escaped as they are copied and
+// base64 values are encoded straight into the output. Anything already
+// in the output is kept, which leaves room for a header such as the
+// IV and tag that CipherContext::EncryptInPlace writes.
+class JsonWriter
+{
+public:
+    // size_hint is added to the capacity of the output up front
+    JsonWriter(ByteArray& output, size_t size_hint = 0);
+
+    void BeginObject(void);
+    void EndObject(void);
+    void BeginArray(void);
+    void EndArray(void);
+
+    // name of the next value written inside an object
+    void Key(const char* key);
+
+    void String(const char* value);
+    void String(const std::string& value);
+    void Base64(const ByteArray& value);
+    void Boolean(bool value);
+    void Number(int64_t value);
+
+    // append the string terminator that parson includes in its
+    // serialization; the document must be complete
+    void Terminate(void);
+
+private:
+    ByteArray& output_;
+
+    // one entry per open container, true until it holds a value
+    std::vector<bool> empty_;
+    bool after_key_;
+
+    void BeginValue(void);
+    void Append(const char* data, size_t size);
+    void AppendEscaped(const char* data, size_t size);
+};
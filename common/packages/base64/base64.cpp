@@ -35,102 +35,420 @@
 
 
 #include "base64.h"
-#include <ctype.h>
-#include <iostream>
 
-static const std::string base64_chars =
+#include <stdint.h>
+#include <string.h>
+
+#if _UNTRUSTED_ && defined(__x86_64__) && defined(__GNUC__)
+#define BASE64_USE_SIMD 1
+#include <immintrin.h>
+#else
+#define BASE64_USE_SIMD 0
+#endif
+
+static const char base64_chars[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-static inline bool is_base64(unsigned char c)
+// decoding table, 0xff marks every character that ends the encoding
+// including the padding character
+#define XX 0xff
+static const uint8_t base64_values[256] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, XX, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
+#undef XX
+
+/* ---------- Portable scalar codec, the only one in the enclave ---------- */
+
+// encode whole groups of three bytes, returns the number of bytes consumed
+static size_t encode_scalar(const uint8_t* data, size_t size, char* out)
 {
-    return (isalnum(c) || (c == '+') || (c == '/'));
+    size_t i = 0;
+    for (; i + 3 <= size; i += 3)
+    {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        *out++ = base64_chars[(v >> 18) & 0x3f];
+        *out++ = base64_chars[(v >> 12) & 0x3f];
+        *out++ = base64_chars[(v >> 6) & 0x3f];
+        *out++ = base64_chars[v & 0x3f];
+    }
+
+    return i;
 }
 
-Base64EncodedString base64_encode(const ByteArray& buf)
+// decode whole groups of four characters up to the first character that
+// is not base64, returns the number of characters consumed
+static size_t decode_scalar(const char* data, size_t size, uint8_t* out)
 {
-    std::string ret;
-    int i = 0;
-    int j = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-    int in_len = buf.size();
-    unsigned char const* bytes_to_encode = buf.data();
-    while (in_len--)
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
     {
-        char_array_3[i++] = *(bytes_to_encode++);
-        if (i == 3)
-        {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for (i = 0; (i < 4); i++)
-                ret += base64_chars[char_array_4[i]];
-            i = 0;
-        }
+        uint32_t a = base64_values[in[i]];
+        uint32_t b = base64_values[in[i + 1]];
+        uint32_t c = base64_values[in[i + 2]];
+        uint32_t d = base64_values[in[i + 3]];
+        if ((a | b | c | d) == 0xff)
+            break;
+
+        uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+        *out++ = static_cast<uint8_t>(v >> 16);
+        *out++ = static_cast<uint8_t>(v >> 8);
+        *out++ = static_cast<uint8_t>(v);
     }
 
-    if (i)
+    return i;
+}
+
+#if BASE64_USE_SIMD
+/* ---------- SSSE3 and AVX2 codecs for untrusted builds ---------- */
+
+// The vector codecs follow the approach of Mula and Lemire: bytes are
+// shuffled into place and split into sextets with multiplies, sextets
+// are mapped to characters by range with a small shuffle table, and
+// decoding validates and translates each character by range before
+// packing four sextets back into three bytes. Each codec processes
+// whole blocks only and leaves the rest to the scalar code.
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+__attribute__((target("ssse3")))
+static inline __m128i sextets_to_chars_128(__m128i indices)
+{
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+    const __m128i shift = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+__attribute__((target("ssse3")))
+static size_t encode_ssse3(const uint8_t* data, size_t size, char* out)
+{
+    const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+    // each block reads sixteen bytes and encodes the first twelve
+    size_t i = 0;
+    for (; i + 16 <= size; i += 12)
     {
-        for (j = i; j < 3; j++)
-            char_array_3[j] = '\0';
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        in = _mm_shuffle_epi8(in, spread);
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+        __m128i hi = _mm_mulhi_epu16(
+            _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i lo = _mm_mullo_epi16(
+            _mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
 
-        for (j = 0; (j < i + 1); j++)
-            ret += base64_chars[char_array_4[j]];
+        __m128i chars = sextets_to_chars_128(_mm_or_si128(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+        out += 16;
+    }
+
+    return i;
+}
 
-        while ((i++ < 3))
-            ret += '=';
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// translate sixteen characters into sextets, false if any is not base64
+__attribute__((target("ssse3")))
+static inline bool chars_to_sextets_128(__m128i in, __m128i& values)
+{
+    // signed compares, so bytes with the high bit set match no range
+    __m128i upper = _mm_and_si128(
+        _mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('Z' + 1)));
+    __m128i lower = _mm_and_si128(
+        _mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(
+        _mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1)));
+    __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+    if (_mm_movemask_epi8(valid) != 0xffff)
+        return false;
+
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+
+    values = _mm_add_epi8(in, shift);
+    return true;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// pack the sextets of each 32 bit lane into three bytes at the bottom
+// of the lane, in output order
+__attribute__((target("ssse3")))
+static inline void store_packed_128(__m128i values, uint8_t* out)
+{
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    packed = _mm_shuffle_epi8(packed,
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+    // only twelve bytes are valid, never write past them
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+    uint32_t tail = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 8)));
+    memcpy(out + 8, &tail, sizeof(tail));
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+__attribute__((target("ssse3")))
+static size_t decode_ssse3(const char* data, size_t size, uint8_t* out)
+{
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i values;
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        if (! chars_to_sextets_128(in, values))
+            break;
+
+        store_packed_128(values, out);
+        out += 12;
     }
 
-    return ret;
+    return i;
 }
 
-ByteArray base64_decode(const Base64EncodedString& encoded_string)
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+__attribute__((target("avx2")))
+static size_t encode_avx2(const uint8_t* data, size_t size, char* out)
 {
-    int in_len = encoded_string.size();
-    int i = 0;
-    int j = 0;
-    int in_ = 0;
-    unsigned char char_array_4[4], char_array_3[3];
-    ByteArray ret;
-
-    while (in_len-- && (encoded_string[in_] != '=') && is_base64(encoded_string[in_]))
+    const __m256i spread = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shift = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+
+    // each block encodes twenty four bytes, twelve per 128 bit lane, and
+    // the second lane reads sixteen bytes starting at the twelfth
+    size_t i = 0;
+    for (; i + 28 <= size; i += 24)
     {
-        char_array_4[i++] = encoded_string[in_];
-        in_++;
-        if (i == 4)
-        {
-            for (i = 0; i < 4; i++)
-                char_array_4[i] = base64_chars.find(char_array_4[i]);
-
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-            for (i = 0; (i < 3); i++)
-                ret.push_back(char_array_3[i]);
-            i = 0;
-        }
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 12)), 1);
+        in = _mm256_shuffle_epi8(in, spread);
+
+        __m256i hi = _mm256_mulhi_epu16(
+            _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i lo = _mm256_mullo_epi16(
+            _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(hi, lo);
+
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+
+        __m256i chars = _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+        out += 32;
     }
 
-    if (i)
+    return i;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+__attribute__((target("avx2")))
+static size_t decode_avx2(const char* data, size_t size, uint8_t* out)
+{
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
     {
-        for (j = 0; j < i; j++)
-            char_array_4[j] = base64_chars.find(char_array_4[j]);
+        __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
 
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+        __m256i upper = _mm256_and_si256(
+            _mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), in));
+        __m256i lower = _mm256_and_si256(
+            _mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), in));
+        __m256i digit = _mm256_and_si256(
+            _mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)),
+            _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), in));
+        __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+        __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
 
-        for (j = 0; (j < i - 1); j++)
-            ret.push_back(char_array_3[j]);
+        __m256i valid = _mm256_or_si256(
+            _mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(plus, slash)));
+        if (_mm256_movemask_epi8(valid) != -1)
+            break;
+
+        __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(plus, _mm256_set1_epi8(62 - '+')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(slash, _mm256_set1_epi8(63 - '/')));
+
+        __m256i values = _mm256_add_epi8(in, shift);
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        packed = _mm256_shuffle_epi8(packed, _mm256_setr_epi8(
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+        __m128i lane0 = _mm256_castsi256_si128(packed);
+        __m128i lane1 = _mm256_extracti128_si256(packed, 1);
+        uint32_t tail;
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), lane0);
+        tail = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(lane0, 8)));
+        memcpy(out + 8, &tail, sizeof(tail));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 12), lane1);
+        tail = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(lane1, 8)));
+        memcpy(out + 20, &tail, sizeof(tail));
+        out += 24;
+    }
+
+    return i;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+typedef size_t (*encode_block_function)(const uint8_t*, size_t, char*);
+typedef size_t (*decode_block_function)(const char*, size_t, uint8_t*);
+
+static encode_block_function select_encoder(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return encode_avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return encode_ssse3;
+    return encode_scalar;
+}
+
+static decode_block_function select_decoder(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return decode_avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return decode_ssse3;
+    return decode_scalar;
+}
+#endif
+
+/* ---------- Public interface ---------- */
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t base64_encode(const uint8_t* data, size_t size, char* out)
+{
+    size_t consumed = 0;
+    char* start = out;
+
+#if BASE64_USE_SIMD
+    static const encode_block_function encode_blocks = select_encoder();
+    consumed = encode_blocks(data, size, out);
+    out += consumed / 3 * 4;
+#endif
+
+    size_t done = encode_scalar(data + consumed, size - consumed, out);
+    consumed += done;
+    out += done / 3 * 4;
+
+    size_t remaining = size - consumed;
+    if (remaining > 0)
+    {
+        uint32_t v = data[consumed] << 16;
+        if (remaining > 1)
+            v |= data[consumed + 1] << 8;
+
+        *out++ = base64_chars[(v >> 18) & 0x3f];
+        *out++ = base64_chars[(v >> 12) & 0x3f];
+        *out++ = (remaining > 1) ? base64_chars[(v >> 6) & 0x3f] : '=';
+        *out++ = '=';
     }
 
+    return out - start;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t base64_decode(const char* data, size_t size, uint8_t* out)
+{
+    size_t consumed = 0;
+    uint8_t* start = out;
+
+#if BASE64_USE_SIMD
+    static const decode_block_function decode_blocks = select_decoder();
+    consumed = decode_blocks(data, size, out);
+    out += consumed / 4 * 3;
+#endif
+
+    size_t done = decode_scalar(data + consumed, size - consumed, out);
+    consumed += done;
+    out += done / 4 * 3;
+
+    // a partial group of n characters, whether the string ended or the
+    // decode stopped at padding or an invalid character, yields n - 1
+    // bytes
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+    uint32_t v = 0;
+    size_t n = 0;
+    for (; n < 3 && consumed + n < size; n++)
+    {
+        uint8_t c = base64_values[in[consumed + n]];
+        if (c == 0xff)
+            break;
+        v |= static_cast<uint32_t>(c) << (18 - 6 * n);
+    }
+
+    if (n > 1)
+        *out++ = static_cast<uint8_t>(v >> 16);
+    if (n > 2)
+        *out++ = static_cast<uint8_t>(v >> 8);
+
+    return out - start;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+Base64EncodedString base64_encode(const ByteArray& buf)
+{
+    Base64EncodedString ret;
+    if (buf.empty())
+        return ret;
+
+    ret.resize(BASE64_ENCODED_LENGTH(buf.size()));
+    size_t length = base64_encode(buf.data(), buf.size(), &ret[0]);
+    ret.resize(length);
+
+    return ret;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray base64_decode(const Base64EncodedString& encoded_string)
+{
+    ByteArray ret(BASE64_DECODED_SIZE(encoded_string.size()));
+    size_t length = base64_decode(encoded_string.data(), encoded_string.size(), ret.data());
+    ret.resize(length);
+
     return ret;
 }
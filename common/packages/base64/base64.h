@@ -11,8 +11,16 @@
 
 #include "types.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define BASE64_SIZE(x) (static_cast<size_t>(((((x) - 1) / 3) * 4 + 4) + 1))
 
+// exact number of characters written by base64_encode, and an upper bound
+// on the number of bytes written by base64_decode
+#define BASE64_ENCODED_LENGTH(x) (static_cast<size_t>((((x) + 2) / 3) * 4))
+#define BASE64_DECODED_SIZE(x) (static_cast<size_t>(((x) / 4) * 3 + 2))
+
 Base64EncodedString base64_encode(
     const ByteArray& raw_buffer
     );
@@ -20,3 +28,21 @@ Base64EncodedString base64_encode(
 ByteArray base64_decode(
     const Base64EncodedString& encoded_string
     );
+
+// Encode size bytes into out, which must hold BASE64_ENCODED_LENGTH(size)
+// characters; no terminator is written. Returns the number of characters
+// written.
+size_t base64_encode(
+    const uint8_t* data,
+    size_t size,
+    char* out
+    );
+
+// Decode up to the first padding or non-base64 character into out, which
+// must hold BASE64_DECODED_SIZE(size) bytes. Returns the number of bytes
+// written.
+size_t base64_decode(
+    const char* data,
+    size_t size,
+    uint8_t* out
+    );
@@ -66,13 +66,16 @@ typedef union json_value_value {
 struct json_value_t {
   JSON_Value_Type     type;
   JSON_Value_Value    value;
+  int                 borrowed; /* string points into an in situ parse buffer */
 };
 
 struct json_object_t {
-  char       **names;
-  JSON_Value **values;
-  size_t       count;
-  size_t       capacity;
+  char          **names;
+  unsigned long  *hashes;
+  JSON_Value    **values;
+  size_t          count;
+  size_t          capacity;
+  int             borrowed_names; /* names point into an in situ parse buffer */
 };
 
 struct json_array_t {
@@ -94,6 +97,9 @@ static int    is_decimal(const char *string, size_t length);
 /* JSON Object */
 static JSON_Object * json_object_init(void);
 static JSON_Status   json_object_add(JSON_Object *object, const char *name, JSON_Value *value);
+static JSON_Status   json_object_add_name(JSON_Object *object, char *name, JSON_Value *value);
+static JSON_Status   json_object_own_names(JSON_Object *object);
+static unsigned long json_object_hash(const char *name, size_t n);
 static JSON_Status   json_object_resize(JSON_Object *object, size_t new_capacity);
 static JSON_Value  * json_object_nget_value(const JSON_Object *object, const char *name, size_t n);
 static void          json_object_free(JSON_Object *object);
@@ -111,14 +117,15 @@ static JSON_Value * json_value_init_string_no_copy(char *string);
 static void         skip_quotes(const char **string);
 static int          parse_utf_16(const char **unprocessed, char **processed);
 static char *       process_string(const char *input, size_t len);
-static char *       get_quoted_string(const char **string);
-static JSON_Value * parse_object_value(const char **string, size_t nesting);
-static JSON_Value * parse_array_value(const char **string, size_t nesting);
-static JSON_Value * parse_string_value(const char **string);
+static char *       process_string_in_situ(char *input, size_t len);
+static char *       get_quoted_string(const char **string, int in_situ);
+static JSON_Value * parse_object_value(const char **string, size_t nesting, int in_situ);
+static JSON_Value * parse_array_value(const char **string, size_t nesting, int in_situ);
+static JSON_Value * parse_string_value(const char **string, int in_situ);
 static JSON_Value * parse_boolean_value(const char **string);
 static JSON_Value * parse_number_value(const char **string);
 static JSON_Value * parse_null_value(const char **string);
-static JSON_Value * parse_value(const char **string, size_t nesting);
+static JSON_Value * parse_value(const char **string, size_t nesting, int in_situ);
 
 /* Serialization */
 static int    json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, int is_pretty, char *num_buf, size_t buf_length);
@@ -290,18 +297,40 @@ static JSON_Object * json_object_init(void) {
   if (!new_obj)
     return NULL;
   new_obj->names = (char**)NULL;
+  new_obj->hashes = (unsigned long*)NULL;
   new_obj->values = (JSON_Value**)NULL;
   new_obj->capacity = 0;
   new_obj->count = 0;
+  new_obj->borrowed_names = 0;
   return new_obj;
 }
 
 static JSON_Status json_object_add(JSON_Object *object, const char *name, JSON_Value *value) {
-  size_t index = 0;
+  char *new_name = NULL;
   if (object == NULL || name == NULL || value == NULL) {
     return JSONFailure;
   }
-  if (json_object_get_value(object, name) != NULL) {
+  /* names of an in situ object cannot be mixed with allocated ones */
+  if (json_object_own_names(object) == JSONFailure) {
+    return JSONFailure;
+  }
+  new_name = parson_strdup(name);
+  if (new_name == NULL)
+    return JSONFailure;
+  if (json_object_add_name(object, new_name, value) == JSONFailure) {
+    parson_free(new_name);
+    return JSONFailure;
+  }
+  return JSONSuccess;
+}
+
+/* Adds a name that is either owned by the object or, for in situ objects,
+   borrowed from the parse buffer */
+static JSON_Status json_object_add_name(JSON_Object *object, char *name, JSON_Value *value) {
+  size_t index = 0;
+  unsigned long hash = 0;
+  size_t name_length = strlen(name);
+  if (json_object_nget_value(object, name, name_length) != NULL) {
     return JSONFailure;
   }
   if (object->count >= object->capacity) {
@@ -311,17 +340,46 @@ static JSON_Status json_object_add(JSON_Object *object, const char *name, JSON_V
     if (json_object_resize(object, new_capacity) == JSONFailure)
       return JSONFailure;
   }
+  hash = json_object_hash(name, name_length);
   index = object->count;
-  object->names[index] = parson_strdup(name);
-  if (object->names[index] == NULL)
-    return JSONFailure;
+  object->names[index] = name;
+  object->hashes[index] = hash;
   object->values[index] = value;
   object->count++;
   return JSONSuccess;
 }
 
+static JSON_Status json_object_own_names(JSON_Object *object) {
+  size_t i = 0;
+  if (!object->borrowed_names)
+    return JSONSuccess;
+  for (i = 0; i < object->count; i++) {
+    char *name = parson_strdup(object->names[i]);
+    if (name == NULL) {
+      while (i--)
+        parson_free(object->names[i]);
+      return JSONFailure;
+    }
+    object->names[i] = name;
+  }
+  object->borrowed_names = 0;
+  return JSONSuccess;
+}
+
+/* FNV-1a, compared before the names themselves on lookup */
+static unsigned long json_object_hash(const char *name, size_t n) {
+  unsigned long hash = 2166136261UL;
+  size_t i = 0;
+  for (i = 0; i < n; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
 static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity) {
   char **temp_names = NULL;
+  unsigned long *temp_hashes = NULL;
   JSON_Value **temp_values = NULL;
 
   if ((object->names == NULL && object->values != NULL) ||
@@ -334,31 +392,44 @@ static JSON_Status json_object_resize(JSON_Object *object, size_t new_capacity)
   if (temp_names == NULL)
     return JSONFailure;
 
+  temp_hashes = (unsigned long*)parson_malloc(new_capacity * sizeof(unsigned long));
+  if (temp_hashes == NULL) {
+    parson_free(temp_names);
+    return JSONFailure;
+  }
+
   temp_values = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
   if (temp_values == NULL) {
     parson_free(temp_names);
+    parson_free(temp_hashes);
     return JSONFailure;
   }
 
   if (object->names != NULL && object->values != NULL && object->count > 0) {
     memcpy(temp_names, object->names, object->count * sizeof(char*));
+    memcpy(temp_hashes, object->hashes, object->count * sizeof(unsigned long));
     memcpy(temp_values, object->values, object->count * sizeof(JSON_Value*));
   }
   parson_free(object->names);
+  parson_free(object->hashes);
   parson_free(object->values);
   object->names = temp_names;
+  object->hashes = temp_hashes;
   object->values = temp_values;
   object->capacity = new_capacity;
   return JSONSuccess;
 }
 
 static JSON_Value * json_object_nget_value(const JSON_Object *object, const char *name, size_t n) {
-  size_t i, name_length;
-  for (i = 0; i < json_object_get_count(object); i++) {
-    name_length = strlen(object->names[i]);
-    if (name_length != n)
+  size_t i;
+  unsigned long hash;
+  if (json_object_get_count(object) == 0)
+    return NULL;
+  hash = json_object_hash(name, n);
+  for (i = 0; i < object->count; i++) {
+    if (object->hashes[i] != hash)
       continue;
-    if (strncmp(object->names[i], name, n) == 0)
+    if (strncmp(object->names[i], name, n) == 0 && object->names[i][n] == '\0')
       return object->values[i];
   }
   return NULL;
@@ -366,10 +437,12 @@ static JSON_Value * json_object_nget_value(const JSON_Object *object, const char
 
 static void json_object_free(JSON_Object *object) {
   while(object->count--) {
-    parson_free(object->names[object->count]);
+    if (!object->borrowed_names)
+      parson_free(object->names[object->count]);
     json_value_free(object->values[object->count]);
   }
   parson_free(object->names);
+  parson_free(object->hashes);
   parson_free(object->values);
   parson_free(object);
 }
@@ -430,6 +503,7 @@ static JSON_Value * json_value_init_string_no_copy(char *string) {
     return NULL;
   new_value->type = JSONString;
   new_value->value.string = string;
+  new_value->borrowed = 0;
   return new_value;
 }
 
@@ -505,27 +579,62 @@ error:
   return NULL;
 }
 
+/* Processes a string in place, escapes only ever shorten it so the
+   output never overtakes the input. The terminator lands on or before
+   the closing quote, which the parser has already passed. */
+static char * process_string_in_situ(char *input, size_t len) {
+  char *input_ptr = input;
+  char *output_ptr = input;
+  while ((*input_ptr != '\0') && (size_t)(input_ptr - input) < len) {
+    if (*input_ptr == '\\') {
+      input_ptr++;
+      switch (*input_ptr) {
+        case '\"': *output_ptr = '\"'; break;
+        case '\\': *output_ptr = '\\'; break;
+        case '/':  *output_ptr = '/';  break;
+        case 'b':  *output_ptr = '\b'; break;
+        case 'f':  *output_ptr = '\f'; break;
+        case 'n':  *output_ptr = '\n'; break;
+        case 'r':  *output_ptr = '\r'; break;
+        case 't':  *output_ptr = '\t'; break;
+        default:
+                   return NULL; /* \u is not supported, see parse_utf_16 */
+      }
+    } else if ((unsigned char)*input_ptr < 0x20) {
+      return NULL;
+    } else if (output_ptr != input_ptr) {
+      *output_ptr = *input_ptr;
+    }
+    output_ptr++;
+    input_ptr++;
+  }
+  *output_ptr = '\0';
+  return input;
+}
+
 /* Return processed contents of a string between quotes and
    skips passed argument to a matching quote. */
-static char * get_quoted_string(const char **string) {
+static char * get_quoted_string(const char **string, int in_situ) {
   const char *string_start = *string;
   size_t string_len = 0;
   skip_quotes(string);
   string_len = *string - string_start - 2; /* length without quotes */
+  if (in_situ)
+    return process_string_in_situ((char*)string_start + 1, string_len);
   return process_string(string_start + 1, string_len);
 }
 
-static JSON_Value * parse_value(const char **string, size_t nesting) {
+static JSON_Value * parse_value(const char **string, size_t nesting, int in_situ) {
   if (nesting > MAX_NESTING)
     return NULL;
   SKIP_WHITESPACES(string);
   switch (**string) {
     case '{':
-      return parse_object_value(string, nesting + 1);
+      return parse_object_value(string, nesting + 1, in_situ);
     case '[':
-      return parse_array_value(string, nesting + 1);
+      return parse_array_value(string, nesting + 1, in_situ);
     case '\"':
-      return parse_string_value(string);
+      return parse_string_value(string, in_situ);
     case 'f': case 't':
       return parse_boolean_value(string);
     case '-':
@@ -539,12 +648,13 @@ static JSON_Value * parse_value(const char **string, size_t nesting) {
   }
 }
 
-static JSON_Value * parse_object_value(const char **string, size_t nesting) {
+static JSON_Value * parse_object_value(const char **string, size_t nesting, int in_situ) {
   JSON_Value *output_value = json_value_init_object(), *new_value = NULL;
   JSON_Object *output_object = json_value_get_object(output_value);
   char *new_key = NULL;
   if (output_value == NULL)
     return NULL;
+  output_object->borrowed_names = in_situ;
   SKIP_CHAR(string);
   SKIP_WHITESPACES(string);
   if (**string == '}') { /* empty object */
@@ -552,26 +662,30 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
     return output_value;
   }
   while (**string != '\0') {
-    new_key = get_quoted_string(string);
+    new_key = get_quoted_string(string, in_situ);
     SKIP_WHITESPACES(string);
     if (new_key == NULL || **string != ':') {
+      if (!in_situ)
+        parson_free(new_key);
       json_value_free(output_value);
       return NULL;
     }
     SKIP_CHAR(string);
-    new_value = parse_value(string, nesting);
+    new_value = parse_value(string, nesting, in_situ);
     if (new_value == NULL) {
-      parson_free(new_key);
+      if (!in_situ)
+        parson_free(new_key);
       json_value_free(output_value);
       return NULL;
     }
-    if(json_object_add(output_object, new_key, new_value) == JSONFailure) {
-      parson_free(new_key);
-      parson_free(new_value);
+    /* the object takes the key, it is not copied again */
+    if(json_object_add_name(output_object, new_key, new_value) == JSONFailure) {
+      if (!in_situ)
+        parson_free(new_key);
+      json_value_free(new_value);
       json_value_free(output_value);
       return NULL;
     }
-    parson_free(new_key);
     SKIP_WHITESPACES(string);
     if (**string != ',')
       break;
@@ -588,7 +702,7 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
   return output_value;
 }
 
-static JSON_Value * parse_array_value(const char **string, size_t nesting) {
+static JSON_Value * parse_array_value(const char **string, size_t nesting, int in_situ) {
   JSON_Value *output_value = json_value_init_array(), *new_array_value = NULL;
   JSON_Array *output_array = json_value_get_array(output_value);
   if (!output_value)
@@ -600,7 +714,7 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
     return output_value;
   }
   while (**string != '\0') {
-    new_array_value = parse_value(string, nesting);
+    new_array_value = parse_value(string, nesting, in_situ);
     if (!new_array_value) {
       json_value_free(output_value);
       return NULL;
@@ -626,16 +740,18 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
   return output_value;
 }
 
-static JSON_Value * parse_string_value(const char **string) {
+static JSON_Value * parse_string_value(const char **string, int in_situ) {
   JSON_Value *value = NULL;
-  char *new_string = get_quoted_string(string);
+  char *new_string = get_quoted_string(string, in_situ);
   if (new_string == NULL)
     return NULL;
   value = json_value_init_string_no_copy(new_string);
   if (value == NULL) {
-    parson_free(new_string);
+    if (!in_situ)
+      parson_free(new_string);
     return NULL;
   }
+  value->borrowed = in_situ;
   return value;
 }
 
@@ -878,7 +994,13 @@ static int append_string(char *buf, const char *string) {
 JSON_Value * json_parse_string(const char *string) {
   if (string == NULL)
     return NULL;
-  return parse_value((const char**)&string, 0);
+  return parse_value((const char**)&string, 0, 0);
+}
+
+JSON_Value * json_parse_string_in_situ(char *string) {
+  if (string == NULL)
+    return NULL;
+  return parse_value((const char**)&string, 0, 1);
 }
 
 JSON_Value * json_parse_string_with_comments(const char *string) {
@@ -890,7 +1012,7 @@ JSON_Value * json_parse_string_with_comments(const char *string) {
   remove_comments(string_mutable_copy, "/*", "*/");
   remove_comments(string_mutable_copy, "//", "\n");
   string_mutable_copy_ptr = string_mutable_copy;
-  result = parse_value((const char**)&string_mutable_copy_ptr, 0);
+  result = parse_value((const char**)&string_mutable_copy_ptr, 0, 0);
   parson_free(string_mutable_copy);
   return result;
 }
@@ -1029,7 +1151,7 @@ void json_value_free(JSON_Value *value) {
       json_object_free(value->value.object);
       break;
     case JSONString:
-      if (value->value.string) { parson_free(value->value.string); }
+      if (value->value.string && !value->borrowed) { parson_free(value->value.string); }
       break;
     case JSONArray:
       json_array_free(value->value.array);
@@ -1553,10 +1675,12 @@ JSON_Status json_object_remove(JSON_Object *object, const char *name) {
   last_item_index = json_object_get_count(object) - 1;
   for (i = 0; i < json_object_get_count(object); i++) {
     if (strcmp(object->names[i], name) == 0) {
-      parson_free(object->names[i]);
+      if (!object->borrowed_names)
+        parson_free(object->names[i]);
       json_value_free(object->values[i]);
       if (i != last_item_index) { /* Replace key value pair with one from the end */
         object->names[i] = object->names[last_item_index];
+        object->hashes[i] = object->hashes[last_item_index];
         object->values[i] = object->values[last_item_index];
       }
       object->count -= 1;
@@ -1590,10 +1714,12 @@ JSON_Status json_object_clear(JSON_Object *object) {
     return JSONFailure;
   }
   for (i = 0; i < json_object_get_count(object); i++) {
-    parson_free(object->names[i]);
+    if (!object->borrowed_names)
+      parson_free(object->names[i]);
     json_value_free(object->values[i]);
   }
   object->count = 0;
+  object->borrowed_names = 0;
   return JSONSuccess;
 }
 
@@ -74,6 +74,11 @@ extern "C"
       returns NULL in case of error */
   JSON_Value * json_parse_string_with_comments(const char *string);
 
+  /*  Parses first JSON value in a string without copying strings, the string
+      is modified in place and string values and object names point into it,
+      so it must outlive the returned value; returns NULL in case of error */
+  JSON_Value * json_parse_string_in_situ(char *string);
+
   /* Serialization */
   size_t      json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
   JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
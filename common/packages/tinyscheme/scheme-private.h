@@ -140,6 +140,28 @@ long gensym_cnt;
 struct scheme_interface *vptr;
 void *dump_base;    /* pointer to base of allocated dump stack */
 int dump_size;      /* number of frames allocated for dump stack */
+
+/* optional observer called with the slot found by a variable lookup */
+void (*slot_observer)(struct scheme *sc, pointer slot);
+void *slot_observer_data;
+
+/* execution counters, zeroed by scheme_init and otherwise left to
+   the application to read and clear */
+struct {
+  unsigned long eval_steps;      /* iterations of the eval loop */
+  unsigned long cells_allocated; /* cells taken from the free list */
+  unsigned long gc_runs;         /* garbage collections */
+} stats;
+
+/* optional profiling hooks: step_observer is called every
+   step_interval iterations of the eval loop, apply_observer each time
+   a closure is applied, with the frame for its arguments in envir;
+   apply_observer also sees every other new frame with closure NIL */
+void (*step_observer)(struct scheme *sc);
+void (*apply_observer)(struct scheme *sc, pointer closure);
+void *profile_data;
+unsigned long step_interval;
+unsigned long step_countdown;
 };
 
 /* operator code */
@@ -194,6 +216,11 @@ int is_environment(pointer p);
 int is_immutable(pointer p);
 void setimmutable(pointer p);
 
+/* frames saved on the dump stack, frame 0 is the outermost; the
+   environment is the one restored when the frame returns */
+int scheme_stack_depth(scheme *sc);
+pointer scheme_stack_environment(scheme *sc, int frame);
+
 #ifdef __cplusplus
 }
 #endif
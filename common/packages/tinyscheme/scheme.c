@@ -790,6 +790,7 @@ static INLINE pointer get_cell_x(scheme * sc, pointer a, pointer b)
 	pointer x = sc->free_cell;
 	sc->free_cell = cdr(x);
 	--sc->fcells;
+	++sc->stats.cells_allocated;
 	return (x);
     }
     return _get_cell(sc, a, b);
@@ -819,6 +820,7 @@ static pointer _get_cell(scheme * sc, pointer a, pointer b)
     x = sc->free_cell;
     sc->free_cell = cdr(x);
     --sc->fcells;
+    ++sc->stats.cells_allocated;
     return (x);
 }
 
@@ -910,6 +912,7 @@ static pointer find_consecutive_cells(scheme * sc, int n)
 	    pointer x = *pp;
 	    *pp = cdr(*pp + n - 1);
 	    sc->fcells -= n;
+	    sc->stats.cells_allocated += n;
 	    return x;
 	}
 	pp = &cdr(*pp + cnt - 1);
@@ -1469,6 +1472,7 @@ static void gc(scheme * sc, pointer a, pointer b)
     if (sc->gc_verbose) {
 	putstr(sc, "gc...");
     }
+    ++sc->stats.gc_runs;
 
     /* mark system globals */
     mark(sc->oblist);
@@ -2465,6 +2469,8 @@ static void new_frame_in_env(scheme * sc, pointer old_env)
 
     sc->envir = immutable_cons(sc, new_frame, old_env);
     setenvironment(sc->envir);
+    if (sc->apply_observer != 0)
+	sc->apply_observer(sc, sc->NIL);
 }
 
 static INLINE void new_slot_spec_in_env(scheme * sc, pointer env,
@@ -2521,6 +2527,8 @@ static INLINE void new_frame_in_env(scheme * sc, pointer old_env)
 {
     sc->envir = immutable_cons(sc, sc->NIL, old_env);
     setenvironment(sc->envir);
+    if (sc->apply_observer != 0)
+	sc->apply_observer(sc, sc->NIL);
 }
 
 static INLINE void new_slot_spec_in_env(scheme * sc, pointer env,
@@ -2732,6 +2740,18 @@ static INLINE void dump_stack_mark(scheme * sc)
     }
 }
 
+int scheme_stack_depth(scheme * sc)
+{
+    return (int) sc->dump;
+}
+
+pointer scheme_stack_environment(scheme * sc, int frame)
+{
+    if (frame < 0 || frame >= (int) sc->dump)
+	return sc->NIL;
+    return ((struct dump_stack_frame *) sc->dump_base + frame)->envir;
+}
+
 #else
 
 static INLINE void dump_stack_reset(scheme * sc)
@@ -2774,6 +2794,26 @@ static INLINE void dump_stack_mark(scheme * sc)
 {
     mark(sc->dump);
 }
+
+int scheme_stack_depth(scheme * sc)
+{
+    int n = 0;
+    pointer p;
+    for (p = sc->dump; p != sc->NIL; p = cddddr(p))
+	n++;
+    return n;
+}
+
+pointer scheme_stack_environment(scheme * sc, int frame)
+{
+    int n = scheme_stack_depth(sc) - 1 - frame;
+    pointer p = sc->dump;
+    if (frame < 0 || n < 0)
+	return sc->NIL;
+    while (n-- > 0)
+	p = cddddr(p);
+    return caddr(p);
+}
 #endif
 
 #define s_retbool(tf)    s_return(sc,(tf) ? sc->T : sc->F)
@@ -2861,6 +2901,8 @@ static pointer opexe_0(scheme * sc, enum scheme_opcodes op)
 	if (is_symbol(sc->code)) {	/* symbol */
 	    x = find_slot_in_env(sc, sc->envir, sc->code, 1);
 	    if (x != sc->NIL) {
+		if (sc->slot_observer)
+		    sc->slot_observer(sc, x);
 		s_return(sc, slot_value_in_env(x));
 	    } else {
 		Error_1(sc, "eval: unbound variable:", sc->code);
@@ -2956,6 +2998,8 @@ static pointer opexe_0(scheme * sc, enum scheme_opcodes op)
 	    else {
 		Error_1(sc, "syntax error in closure: not a symbol:", x);
 	    }
+	    if (sc->apply_observer != 0)
+		sc->apply_observer(sc, sc->code);
 	    sc->code = cdr(closure_code(sc->code));
 	    sc->args = sc->NIL;
 	    s_goto(sc, OP_BEGIN);
@@ -4750,6 +4794,11 @@ static void Eval_Cycle(scheme * sc, enum scheme_opcodes op)
     sc->op = op;
     for (;;) {
 	op_code_info *pcd = dispatch_table + sc->op;
+	++sc->stats.eval_steps;
+	if (sc->step_observer != 0 && --sc->step_countdown == 0) {
+	    sc->step_countdown = sc->step_interval;
+	    sc->step_observer(sc);
+	}
 	if (pcd->name != 0) {	/* if built-in function, check arguments */
 	    char msg[STRBUFFSIZE];
 	    int ok = 1;
@@ -5031,6 +5080,14 @@ int scheme_init_custom_alloc(scheme * sc, func_alloc malloc,
     sc->vptr = &vtbl;
 #endif
     sc->gensym_cnt = 0;
+    sc->slot_observer = 0;
+    sc->slot_observer_data = 0;
+    memset(&sc->stats, 0, sizeof(sc->stats));
+    sc->step_observer = 0;
+    sc->apply_observer = 0;
+    sc->profile_data = 0;
+    sc->step_interval = 0;
+    sc->step_countdown = 0;
     sc->malloc = malloc;
     sc->free = free;
     sc->last_cell_seg = -1;
@@ -0,0 +1,96 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// Phases of a contract request in the contract enclave, in the order
+// they run. The enclave times each phase of every request and keeps
+// running totals that the untrusted side reads with
+// ecall_GetRequestStatistics.
+typedef enum {
+    PDO_PHASE_SESSION_KEY = 0,          // decrypt the session key
+    PDO_PHASE_REQUEST_PARSE = 1,        // decrypt and parse the request
+    PDO_PHASE_STATE_DECRYPT = 2,        // decrypt the state and apply deltas
+    PDO_PHASE_MESSAGE_VERIFY = 3,       // verify the message signature
+    PDO_PHASE_INTERPRETER_BOOTSTRAP = 4, // create the interpreter
+    PDO_PHASE_CODE_LOAD = 5,            // load the message and the contract code
+    PDO_PHASE_STATE_LOAD = 6,           // load the contract state
+    PDO_PHASE_EXECUTE = 7,              // evaluate the method
+    PDO_PHASE_SERIALIZE = 8,            // write out the result and the new state
+    PDO_PHASE_STATE_ENCRYPT = 9,        // encrypt the new state
+    PDO_PHASE_RESPONSE = 10,            // serialize, sign and encrypt the response
+    PDO_PHASE_COUNT = 11
+} pdo_request_phase_t;
+
+// times are in nanoseconds from the untrusted clock, count is the
+// number of requests timed through the phase; a request that ends in
+// an error inside the enclave is not counted at all
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} pdo_phase_statistics_t;
+
+typedef struct {
+    pdo_phase_statistics_t phases[PDO_PHASE_COUNT];
+} pdo_request_statistics_t;
+
+// work done by the interpreter for one request, from the start of
+// the code load to the end of state serialization
+typedef struct {
+    uint64_t eval_steps;            // iterations of the scheme eval loop
+    uint64_t cells_allocated;       // cells taken from the free list
+    uint64_t gc_runs;               // garbage collections
+    uint64_t state_bytes_read;      // serialized state loaded
+    uint64_t state_bytes_written;   // serialized state saved
+    uint64_t heap_peak_bytes;       // high water mark of the interpreter heap
+} pdo_interpreter_statistics_t;
+
+// the enclave adds up the interpreter statistics of successful
+// requests per contract name, read with ecall_GetContractStatistics;
+// names that do not fit in the table or in name are folded into the
+// entry named PDO_CONTRACT_STATISTICS_OTHER
+#define PDO_CONTRACT_NAME_SIZE 64
+#define PDO_CONTRACT_STATISTICS_MAX 32
+#define PDO_CONTRACT_STATISTICS_OTHER "*other*"
+
+typedef struct {
+    char name[PDO_CONTRACT_NAME_SIZE];
+    uint64_t requests;
+    pdo_interpreter_statistics_t total;
+    pdo_interpreter_statistics_t max;   // largest value seen for each field
+} pdo_contract_statistics_t;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static inline const char* pdo_request_phase_name(int phase)
+{
+    switch (phase)
+    {
+    case PDO_PHASE_SESSION_KEY: return "session_key";
+    case PDO_PHASE_REQUEST_PARSE: return "request_parse";
+    case PDO_PHASE_STATE_DECRYPT: return "state_decrypt";
+    case PDO_PHASE_MESSAGE_VERIFY: return "message_verify";
+    case PDO_PHASE_INTERPRETER_BOOTSTRAP: return "interpreter_bootstrap";
+    case PDO_PHASE_CODE_LOAD: return "code_load";
+    case PDO_PHASE_STATE_LOAD: return "state_load";
+    case PDO_PHASE_EXECUTE: return "execute";
+    case PDO_PHASE_SERIALIZE: return "serialize";
+    case PDO_PHASE_STATE_ENCRYPT: return "state_encrypt";
+    case PDO_PHASE_RESPONSE: return "response";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,529 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//***Micro Benchmarks***////
+#include "benchCrypto.h"
+#include "base64.h"
+#include "compression.h"
+#include "crypto.h"
+#include "error.h"
+
+#include <openssl/ecdsa.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+#include <ctype.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hex_string.h"
+
+namespace pcrypto = pdo::crypto;
+
+// Error handling
+namespace Error = pdo::error;
+
+// minimum wall clock time spent on each measurement
+#define BENCH_SECONDS 1.0
+
+typedef std::chrono::steady_clock bench_clock;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// run op repeatedly for BENCH_SECONDS and return operations per second
+template <typename Op>
+static double OperationsPerSecond(Op op)
+{
+    size_t count = 0;
+    bench_clock::time_point start = bench_clock::now();
+    std::chrono::duration<double> elapsed;
+    do
+    {
+        op();
+        count++;
+        elapsed = bench_clock::now() - start;
+    } while (elapsed.count() < BENCH_SECONDS);
+
+    return count / elapsed.count();
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the signing path as it was before the cached curve order: a freshly
+// parsed key and per signature BIGNUM
+// allocations for low s normalization
+static void SignGeneric(EC_KEY* key, const ByteArray& message)
+{
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(message.data(), message.size(), hash);
+
+    ECDSA_SIG* sig = ECDSA_do_sign(hash, SHA256_DIGEST_LENGTH, key);
+    if (!sig)
+        throw Error::RuntimeError("benchCrypto: ECDSA_do_sign failed");
+
+    const BIGNUM* rc;
+    const BIGNUM* sc;
+    ECDSA_SIG_get0(sig, &rc, &sc);
+
+    BIGNUM* r = BN_dup(rc);
+    BIGNUM* s = BN_dup(sc);
+    BIGNUM* ord = BN_new();
+    BIGNUM* ordh = BN_new();
+    EC_GROUP_get_order(EC_KEY_get0_group(key), ord, NULL);
+    BN_rshift(ordh, ord, 1);
+    if (BN_cmp(s, ordh) >= 0)
+        BN_sub(s, ord, s);
+    ECDSA_SIG_set0(sig, r, s);
+    BN_free(ord);
+    BN_free(ordh);
+
+    ByteArray der(i2d_ECDSA_SIG(sig, nullptr));
+    unsigned char* data = der.data();
+    i2d_ECDSA_SIG(sig, &data);
+    ECDSA_SIG_free(sig);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static int benchSignature()
+{
+    std::string text("contract response state hash and message hash");
+    ByteArray message(text.begin(), text.end());
+
+    pcrypto::sig::PrivateKey private_key;
+    pcrypto::sig::PublicKey public_key(private_key);
+    ByteArray signature = private_key.SignMessage(message);
+
+    std::string encoded = private_key.Serialize();
+    BIO* bio = BIO_new_mem_buf(encoded.c_str(), -1);
+    EC_KEY* generic_key = PEM_read_bio_ECPrivateKey(bio, NULL, NULL, NULL);
+    BIO_free_all(bio);
+    if (!generic_key)
+    {
+        printf("benchCrypto: unable to load the generic signing key\n");
+        return -1;
+    }
+
+    double generic = OperationsPerSecond([&]() { SignGeneric(generic_key, message); });
+    double cached = OperationsPerSecond([&]() { private_key.SignMessage(message); });
+    double verify = OperationsPerSecond([&]() { public_key.VerifySignature(message, signature); });
+    EC_KEY_free(generic_key);
+
+    printf("ECDSA sign (generic):      %10.1f ops/s\n", generic);
+    printf("ECDSA sign (cached order): %10.1f ops/s (%.2fx)\n", cached, cached / generic);
+    printf("ECDSA verify:              %10.1f ops/s\n", verify);
+
+    return 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// a provisioning secret as the contract enclave receives it: the hex
+// encoded secret and signature encrypted with the enclave key
+class BenchSecret
+{
+public:
+    std::string pspk_;
+    ByteArray encrypted_secret_;
+};
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the per secret work of secret verification in the contract enclave
+static void VerifyBenchSecret(const pcrypto::pkenc::PrivateKey& enclave_key,
+    const BenchSecret& secret,
+    const ByteArray& suffix,
+    const pcrypto::sig::PublicKey* verifying_key)
+{
+    const size_t encoded_size = HEX_STRING_SIZE(pcrypto::constants::SYM_KEY_LEN);
+
+    ByteArray decrypted = enclave_key.DecryptMessage(secret.encrypted_secret_);
+    std::string decrypted_secret(decrypted.begin(), decrypted.end());
+    ByteArray signature = pdo::HexStringToBinary(decrypted_secret.substr(encoded_size));
+
+    ByteArray message(encoded_size + suffix.size());
+    std::copy(decrypted_secret.begin(), decrypted_secret.begin() + encoded_size, message.begin());
+    std::copy(suffix.begin(), suffix.end(), message.begin() + encoded_size);
+
+    int result;
+    if (verifying_key == NULL)
+        result = pcrypto::sig::PublicKey(secret.pspk_).VerifySignature(message, signature);
+    else
+        result = verifying_key->VerifySignature(message, signature);
+
+    if (result <= 0)
+        throw Error::RuntimeError("benchCrypto: secret signature verification failed");
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// secret lists verified per second for contracts provisioned by 1, 5
+// and 20 provisioning services; the threaded figure splits the list
+// across hardware threads, which the single TCS contract enclave cannot
+// do, and is reported for comparison only
+static int benchSecrets()
+{
+    pcrypto::pkenc::PrivateKey enclave_key;
+    pcrypto::pkenc::PublicKey enclave_encryption_key(enclave_key);
+
+    std::string ids("enclave id" "contract id" "creator id");
+    ByteArray suffix(ids.begin(), ids.end());
+
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t service_counts[] = {1, 5, 20};
+    for (size_t c = 0; c < sizeof(service_counts) / sizeof(service_counts[0]); c++)
+    {
+        size_t count = service_counts[c];
+        std::vector<BenchSecret> secrets(count);
+        std::map<std::string, pcrypto::sig::PublicKey> verifying_keys;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            pcrypto::sig::PrivateKey service_key;
+            secrets[i].pspk_ = pcrypto::sig::PublicKey(service_key).Serialize();
+            verifying_keys[secrets[i].pspk_] = pcrypto::sig::PublicKey(service_key);
+
+            std::string encoded_secret = pdo::BinaryToHexString(pcrypto::skenc::GenerateKey());
+            ByteArray message(encoded_secret.begin(), encoded_secret.end());
+            message.insert(message.end(), suffix.begin(), suffix.end());
+            std::string plaintext =
+                encoded_secret + pdo::BinaryToHexString(service_key.SignMessage(message));
+
+            secrets[i].encrypted_secret_ = enclave_encryption_key.EncryptMessage(
+                ByteArray(plaintext.begin(), plaintext.end()));
+        }
+
+        double parsed = OperationsPerSecond([&]() {
+            for (size_t i = 0; i < count; i++)
+                VerifyBenchSecret(enclave_key, secrets[i], suffix, NULL);
+        });
+
+        double cached = OperationsPerSecond([&]() {
+            for (size_t i = 0; i < count; i++)
+                VerifyBenchSecret(
+                    enclave_key, secrets[i], suffix, &verifying_keys[secrets[i].pspk_]);
+        });
+
+        double threaded = OperationsPerSecond([&]() {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads && t < count; t++)
+                workers.push_back(std::thread([&, t]() {
+                    for (size_t i = t; i < count; i += threads)
+                        VerifyBenchSecret(enclave_key, secrets[i], suffix,
+                            &verifying_keys.find(secrets[i].pspk_)->second);
+                }));
+            for (size_t t = 0; t < workers.size(); t++)
+                workers[t].join();
+        });
+
+        printf("verify %2zu secrets (parse keys):  %10.1f lists/s\n", count, parsed);
+        printf("verify %2zu secrets (cached keys): %10.1f lists/s (%.2fx)\n", count, cached,
+            cached / parsed);
+        printf("verify %2zu secrets (%2zu threads): %10.1f lists/s (%.2fx)\n", count, threads,
+            threaded, threaded / parsed);
+    }
+
+    return 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// session keys encrypted by the client and decrypted by the enclave
+// per second, RSA-OAEP compared with the ephemeral ECDH envelope
+static int benchSessionKeys()
+{
+    ByteArray session_key = pcrypto::skenc::GenerateKey();
+
+    pcrypto::pkenc::PrivateKey rsa_private_key;
+    pcrypto::pkenc::PublicKey rsa_public_key(rsa_private_key);
+    ByteArray rsa_encrypted = rsa_public_key.EncryptMessage(session_key);
+
+    pcrypto::ecdh::PrivateKey ecdh_private_key;
+    pcrypto::ecdh::PublicKey ecdh_public_key(ecdh_private_key);
+    ByteArray ecdh_encrypted = ecdh_public_key.EncryptMessage(session_key);
+
+    double rsa_encrypt =
+        OperationsPerSecond([&]() { rsa_public_key.EncryptMessage(session_key); });
+    double rsa_decrypt =
+        OperationsPerSecond([&]() { rsa_private_key.DecryptMessage(rsa_encrypted); });
+    double ecdh_encrypt =
+        OperationsPerSecond([&]() { ecdh_public_key.EncryptMessage(session_key); });
+    double ecdh_decrypt =
+        OperationsPerSecond([&]() { ecdh_private_key.DecryptMessage(ecdh_encrypted); });
+
+    printf("session key encrypt (RSA-OAEP):   %10.1f keys/s\n", rsa_encrypt);
+    printf("session key encrypt (ECDH):       %10.1f keys/s (%.2fx)\n", ecdh_encrypt,
+        ecdh_encrypt / rsa_encrypt);
+    printf("session key decrypt (RSA-OAEP):   %10.1f keys/s\n", rsa_decrypt);
+    printf("session key decrypt (ECDH):       %10.1f keys/s (%.2fx)\n", ecdh_decrypt,
+        ecdh_decrypt / rsa_decrypt);
+
+    return 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the codec as it was before the table driven rewrite: one character
+// appended at a time and a search of the alphabet for every character
+static const std::string generic_base64_chars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static std::string Base64EncodeGeneric(const ByteArray& buf)
+{
+    std::string ret;
+    size_t i = 0;
+    for (; i + 3 <= buf.size(); i += 3)
+    {
+        ret += generic_base64_chars[buf[i] >> 2];
+        ret += generic_base64_chars[((buf[i] & 0x03) << 4) | (buf[i + 1] >> 4)];
+        ret += generic_base64_chars[((buf[i + 1] & 0x0f) << 2) | (buf[i + 2] >> 6)];
+        ret += generic_base64_chars[buf[i + 2] & 0x3f];
+    }
+
+    return ret;
+}
+
+static ByteArray Base64DecodeGeneric(const std::string& encoded)
+{
+    ByteArray ret;
+    size_t i = 0;
+    for (; i + 4 <= encoded.size(); i += 4)
+    {
+        unsigned char c[4];
+        for (size_t j = 0; j < 4; j++)
+        {
+            size_t value = generic_base64_chars.find(encoded[i + j]);
+            if (value == std::string::npos)
+                return ret;
+            c[j] = value;
+        }
+
+        ret.push_back((c[0] << 2) + ((c[1] & 0x30) >> 4));
+        ret.push_back(((c[1] & 0xf) << 4) + ((c[2] & 0x3c) >> 2));
+        ret.push_back(((c[2] & 0x3) << 6) + c[3]);
+    }
+
+    return ret;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// base64 throughput on an encrypted state sized buffer, a multiple of
+// three bytes so the generic encoder needs no padding
+static int benchBase64()
+{
+    const size_t size = 3 << 18;
+    ByteArray raw = pcrypto::RandomBitString(size);
+    Base64EncodedString encoded = base64_encode(raw);
+    if (base64_decode(encoded) != raw || Base64EncodeGeneric(raw) != encoded ||
+        Base64DecodeGeneric(encoded) != raw)
+    {
+        printf("benchCrypto: base64 round trip failed\n");
+        return -1;
+    }
+
+    double megabytes = size / (1024.0 * 1024.0);
+    double generic_encode = megabytes * OperationsPerSecond([&]() { Base64EncodeGeneric(raw); });
+    double generic_decode = megabytes * OperationsPerSecond([&]() { Base64DecodeGeneric(encoded); });
+    double encode = megabytes * OperationsPerSecond([&]() { base64_encode(raw); });
+    double decode = megabytes * OperationsPerSecond([&]() { base64_decode(encoded); });
+
+    printf("base64 encode (generic):          %10.1f MB/s\n", generic_encode);
+    printf("base64 encode:                    %10.1f MB/s (%.2fx)\n", encode, encode / generic_encode);
+    printf("base64 decode (generic):          %10.1f MB/s\n", generic_decode);
+    printf("base64 decode:                    %10.1f MB/s (%.2fx)\n", decode, decode / generic_decode);
+
+    return 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// hex decoding as it was before the lookup table: toupper and a range
+// check per digit with an exception for an invalid one
+static uint8_t HexToNibbleGeneric(char hex)
+{
+    hex = toupper(hex);
+    if (hex >= 'A' && hex <= 'F')
+        return 10 + (hex - 'A');
+    if (hex >= '0' && hex <= '9')
+        return hex - '0';
+
+    throw Error::ValueError("Hex digit is not valid");
+}
+
+static ByteArray HexDecodeGeneric(const std::string& hex)
+{
+    ByteArray ret(hex.size() / 2);
+    for (size_t i = 0; i < ret.size(); i++)
+        ret[i] = (HexToNibbleGeneric(hex[2 * i]) << 4) | HexToNibbleGeneric(hex[2 * i + 1]);
+
+    return ret;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// hex decodes per second of a signature, the most common hex field, and
+// throughput on a large buffer
+static int benchHex()
+{
+    pcrypto::sig::PrivateKey private_key;
+    std::string signature = pdo::BinaryToHexString(private_key.SignMessage(ByteArray(32, 1)));
+    ByteArray raw = pcrypto::RandomBitString(1 << 20);
+    std::string encoded = pdo::BinaryToHexString(raw);
+    if (pdo::HexStringToBinary(encoded) != raw || HexDecodeGeneric(encoded) != raw)
+    {
+        printf("benchCrypto: hex round trip failed\n");
+        return -1;
+    }
+
+    double generic = OperationsPerSecond([&]() { HexDecodeGeneric(signature); });
+    double decode = OperationsPerSecond([&]() { pdo::HexStringToBinary(signature); });
+    double generic_large = OperationsPerSecond([&]() { HexDecodeGeneric(encoded); });
+    double decode_large = OperationsPerSecond([&]() { pdo::HexStringToBinary(encoded); });
+    double encode_large = OperationsPerSecond([&]() { pdo::BinaryToHexString(raw); });
+
+    printf("hex decode signature (generic):   %10.1f ops/s\n", generic);
+    printf("hex decode signature:             %10.1f ops/s (%.2fx)\n", decode, decode / generic);
+    printf("hex decode (generic):             %10.1f MB/s\n", generic_large);
+    printf("hex decode:                       %10.1f MB/s (%.2fx)\n", decode_large,
+        decode_large / generic_large);
+    printf("hex encode:                       %10.1f MB/s\n", encode_large);
+
+    return 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// serialized state in the shape oops-serialize produces for the
+// integer-key and auction contracts: the base contract keys followed by
+// a key store of escrow counters (the auction keeps its bids in one)
+// owned by a handful of identities
+static std::string QuoteState(const std::string& value)
+{
+    std::string quoted = "\"";
+    for (size_t i = 0; i < value.size(); i++)
+    {
+        if (value[i] == '\n')
+            quoted += "\\n";
+        else
+            quoted += value[i];
+    }
+    return quoted + "\"";
+}
+
+static std::string CounterStoreState(const std::string& class_name,
+    const std::string& extra_vars,
+    size_t count)
+{
+    pcrypto::sig::PrivateKey signing_key;
+    pcrypto::pkenc::PrivateKey encryption_key;
+
+    std::vector<std::string> owners;
+    for (size_t i = 0; i < 4; i++)
+        owners.push_back(QuoteState(pcrypto::sig::PrivateKey().GetPublicKey().Serialize()));
+
+    // the store is a hash table of 347 buckets holding association lists
+    std::vector<std::string> buckets(347);
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string key = QuoteState("key" + std::to_string(i));
+        buckets[(i * 7919) % buckets.size()] += "(" + key +
+            " make-instance escrow-counter (key " + key + ") (value " + std::to_string(i * 37) +
+            ") (owner " + owners[i % owners.size()] + ") (active #t) (escrow-key \"\"))";
+    }
+
+    std::string store;
+    for (size_t i = 0; i < buckets.size(); i++)
+        store += (i > 0 ? " (" : "(") + buckets[i] + ")";
+
+    return "(make-instance " + class_name + " (creator " + owners[0] + ")" +
+           " (contract-signing-keys (make-instance signing-keys (private-key " +
+           QuoteState(signing_key.Serialize()) + ") (public-key " +
+           QuoteState(signing_key.GetPublicKey().Serialize()) + ")))" +
+           " (contract-encryption-keys (make-instance encryption-keys (private-key " +
+           QuoteState(encryption_key.Serialize()) + ") (public-key " +
+           QuoteState(encryption_key.GetPublicKey().Serialize()) + ")))" + extra_vars +
+           " (state (make-instance key-store (store #(" + store + ")))))";
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// compression ratio and speed on contract states, and the cost of the
+// compressed envelope next to state encryption
+static int benchCompression()
+{
+    const std::string auction_vars =
+        " (auction-inited #t) (auction-primed #t) (auction-closed #f) (offered-asset #f)"
+        " (maximum-bid #f) (asset-contract-public-key \"\")";
+    const size_t counts[] = {10, 100, 1000};
+    ByteArray state_key = pcrypto::skenc::GenerateKey();
+
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        const std::string states[] = {CounterStoreState("integer-key", "", counts[c]),
+            CounterStoreState("auction", auction_vars, counts[c])};
+        const char* names[] = {"integer-key", "auction"};
+
+        for (size_t i = 0; i < 2; i++)
+        {
+            ByteArray state(states[i].begin(), states[i].end());
+            ByteArray envelope;
+            ByteArray expanded;
+            if (!pdo::compression::CompressEnvelope(state.data(), state.size(), envelope) ||
+                (pdo::compression::DecompressEnvelope(envelope.data(), envelope.size(), expanded),
+                    expanded != state))
+            {
+                printf("benchCrypto: compression round trip failed\n");
+                return -1;
+            }
+
+            double megabytes = state.size() / (1024.0 * 1024.0);
+            double compress = megabytes * OperationsPerSecond([&]() {
+                pdo::compression::CompressEnvelope(state.data(), state.size(), envelope);
+            });
+            double decompress = megabytes * OperationsPerSecond([&]() {
+                pdo::compression::DecompressEnvelope(envelope.data(), envelope.size(), expanded);
+            });
+            double encrypt = megabytes * OperationsPerSecond(
+                                             [&]() { pcrypto::skenc::EncryptMessage(state_key, state); });
+
+            printf("compress %-11s %4zu keys: %8zu -> %7zu bytes (%.2fx)\n", names[i], counts[c],
+                state.size(), envelope.size(), (double)state.size() / envelope.size());
+            printf("    compress %8.1f MB/s, decompress %8.1f MB/s, encrypt %8.1f MB/s\n", compress,
+                decompress, encrypt);
+        }
+    }
+
+    return 0;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+int pcrypto::benchCrypto()
+{
+    try
+    {
+        if (benchSignature() != 0)
+            return -1;
+        if (benchSecrets() != 0)
+            return -1;
+        if (benchSessionKeys() != 0)
+            return -1;
+        if (benchBase64() != 0)
+            return -1;
+        if (benchHex() != 0)
+            return -1;
+        if (benchCompression() != 0)
+            return -1;
+    }
+    catch (const std::exception& e)
+    {
+        printf("benchCrypto: benchmark failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    return 0;
+}
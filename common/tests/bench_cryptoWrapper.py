@@ -0,0 +1,55 @@
+# Copyright 2018 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Round trip a 10 MB buffer through the crypto bindings; every call
+# crosses the Python/C++ boundary twice so the times are dominated by
+# ByteArray marshalling for anything but encryption
+
+import pdo.common.crypto as crypto
+import os
+import sys
+import time
+
+SIZE = 10 * 1024 * 1024
+ROUNDS = 5
+
+def bench(name, op) :
+    start = time.time()
+    for i in range(ROUNDS) :
+        result = op()
+    elapsed = (time.time() - start) / ROUNDS
+    print('{0:32} {1:8.2f} ms {2:8.1f} MB/s'.format(name, elapsed * 1000, SIZE / elapsed / 1e6))
+    return result
+
+data = os.urandom(SIZE)
+key = crypto.SKENC_GenerateKey()
+encoded = crypto.byte_array_to_base64(data)
+ciphertext = crypto.SKENC_EncryptMessage(key, data)
+
+bench('hash (bytes)', lambda : crypto.compute_message_hash(data))
+bench('hash (memoryview)', lambda : crypto.compute_message_hash(memoryview(data)))
+bench('base64 encode', lambda : crypto.byte_array_to_base64(data))
+decoded = bench('base64 decode', lambda : crypto.base64_to_byte_array(encoded))
+bench('encrypt', lambda : crypto.SKENC_EncryptMessage(key, data))
+plaintext = bench('decrypt', lambda : crypto.SKENC_DecryptMessage(key, ciphertext))
+
+if bytes(decoded) != data or bytes(plaintext) != data :
+    print('round trip mismatch')
+    sys.exit(-1)
+
+# the element by element representation that the bindings still accept
+data_tuple = tuple(data)
+bench('hash (tuple)', lambda : crypto.compute_message_hash(data_tuple))
+
+sys.exit(0)
@@ -16,8 +16,14 @@
 //***Unit Test***////
 #include "testCrypto.h"
 #include "base64.h"
+#include "cbor.h"
+#include "compression.h"
 #include "crypto.h"
 #include "error.h"
+#include "hex_string.h"
+
+#include <algorithm>
+#include <ctype.h>
 
 #if _UNTRUSTED_
 
@@ -438,6 +444,84 @@ int pcrypto::testCrypto()
     }
     printf("testCrypto: RSA encryption/decryption test passed!\n\n");
 
+    // Test ECDH key agreement encryption/decryption
+    pcrypto::ecdh::PrivateKey eprivateKey;
+    pcrypto::ecdh::PublicKey epublicKey(eprivateKey);
+    ByteArray ect;
+    try
+    {
+        pcrypto::ecdh::PrivateKey eprivateKey1(eprivateKey.Serialize());
+        pcrypto::ecdh::PublicKey epublicKey1(epublicKey.Serialize());
+        if (epublicKey1.Serialize() != eprivateKey1.GetPublicKey().Serialize())
+        {
+            printf("testCrypto: ECDH keypair serialize test failed.\n");
+            return -1;
+        }
+
+        ByteArray session_key = pcrypto::skenc::GenerateKey();
+        ect = epublicKey1.EncryptMessage(session_key);
+        if (!pcrypto::ecdh::IsEnvelope(ect) || pcrypto::ecdh::IsEnvelope(ct))
+        {
+            printf("testCrypto: ECDH envelope detection test failed.\n");
+            return -1;
+        }
+
+        pt = eprivateKey.DecryptMessage(ect);
+        if (pt != session_key)
+        {
+            printf("testCrypto: ECDH encryption/decryption test failed.\n");
+            return -1;
+        }
+
+        // every message uses a fresh ephemeral key
+        if (epublicKey.EncryptMessage(session_key) == ect)
+        {
+            printf("testCrypto: ECDH ephemeral key reuse detected.\n");
+            return -1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: ECDH encryption/decryption test failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    try
+    {
+        ect[ect.size() - 1] ^= 1;
+        pt = eprivateKey.DecryptMessage(ect);
+        printf("testCrypto: ECDH tampered ciphertext undetected.\n");
+        return -1;
+    }
+    catch (const Error::CryptoError& e)
+    {
+        printf("testCrypto: ECDH tampered ciphertext correctly detected!\n");
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: ECDH decryption internal error.\n%s\n", e.what());
+        return -1;
+    }
+
+    try
+    {
+        pcrypto::ecdh::PrivateKey eprivateKey2;
+        ect = epublicKey.EncryptMessage(msg);
+        pt = eprivateKey2.DecryptMessage(ect);
+        printf("testCrypto: ECDH decryption with wrong key undetected.\n");
+        return -1;
+    }
+    catch (const Error::CryptoError& e)
+    {
+        printf("testCrypto: ECDH decryption with wrong key correctly detected!\n");
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: ECDH decryption internal error.\n%s\n", e.what());
+        return -1;
+    }
+    printf("testCrypto: ECDH encryption/decryption test passed!\n\n");
+
     // Test symmetric encryption functions
 
     ByteArray key;
@@ -721,5 +805,463 @@ int pcrypto::testCrypto()
         return -1;
     }
     printf("testCrypto: user seeded IV generation successful!\n\n");
+
+    // Test reusable cipher contexts and the in place variants
+    try
+    {
+        pcrypto::skenc::CipherContext context(key);
+
+        ByteArray buffer(constants::IV_TAG_LEN);
+        buffer.insert(buffer.end(), msg.begin(), msg.end());
+        context.EncryptInPlace(buffer.data(), buffer.size());
+        if (pcrypto::skenc::DecryptMessage(key, buffer) != msg)
+        {
+            printf("testCrypto: AES-GCM in place encryption test failed.\n");
+            return -1;
+        }
+
+        ctAES.resize(pcrypto::skenc::EncryptedSize(msg.size()));
+        context.Encrypt(msg.data(), msg.size(), ctAES.data());
+
+        ByteArray prefix(4);
+        ptAES.resize(pcrypto::skenc::DecryptedSize(ctAES.size()) - prefix.size());
+        context.Decrypt(ctAES.data(), ctAES.size(), prefix.data(), prefix.size(), ptAES.data());
+        prefix.insert(prefix.end(), ptAES.begin(), ptAES.end());
+        if (prefix != msg)
+        {
+            printf("testCrypto: AES-GCM prefix decryption test failed.\n");
+            return -1;
+        }
+
+        size_t length = context.DecryptInPlace(ctAES.data(), ctAES.size());
+        if (!std::equal(msg.begin(), msg.end(), ctAES.begin() + constants::IV_TAG_LEN) ||
+            length != msg.size())
+        {
+            printf("testCrypto: AES-GCM in place decryption test failed.\n");
+            return -1;
+        }
+        printf("testCrypto: AES-GCM cipher context test successful!\n\n");
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: AES-GCM cipher context test failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    try
+    {
+        pcrypto::skenc::CipherContext context(key);
+        ctAES = pcrypto::skenc::EncryptMessage(key, msg);
+        ctAES[ctAES.size() - 1]++;
+        context.DecryptInPlace(ctAES.data(), ctAES.size());
+        printf("testCrypto: AES-GCM in place decryption test failed, tampering undetected.\n");
+        return -1;
+    }
+    catch (const Error::CryptoError& e)
+    {
+        printf("testCrypto: AES-GCM in place decryption correct, tampering detected!\n\n");
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: AES-GCM in place decryption test failed\n%s\n", e.what());
+        return -1;
+    }
+
+    // Test streaming encryption, decryption and hashing in uneven pieces
+    try
+    {
+        ByteArray big(10000);
+        for (size_t i = 0; i < big.size(); i++)
+            big[i] = (uint8_t)(i * 7);
+
+        pcrypto::skenc::StreamEncryptor encryptor(key);
+        ctAES.resize(pcrypto::skenc::EncryptedSize(big.size()));
+        encryptor.Begin(ctAES.data());
+        for (size_t offset = 0; offset < big.size(); offset += 999)
+        {
+            size_t length = std::min((size_t)999, big.size() - offset);
+            encryptor.Update(big.data() + offset, length,
+                ctAES.data() + constants::IV_TAG_LEN + offset);
+        }
+        encryptor.Finish(ctAES.data());
+        if (pcrypto::skenc::DecryptMessage(key, ctAES) != big)
+        {
+            printf("testCrypto: AES-GCM stream encryption test failed.\n");
+            return -1;
+        }
+
+        pcrypto::MessageHash hash;
+        pcrypto::skenc::StreamDecryptor decryptor(key);
+        ptAES.resize(big.size());
+        decryptor.Begin(ctAES.data());
+        hash.Update(ctAES.data(), constants::IV_TAG_LEN);
+        for (size_t offset = 0; offset < big.size(); offset += 1234)
+        {
+            size_t length = std::min((size_t)1234, big.size() - offset);
+            const uint8_t* piece = ctAES.data() + constants::IV_TAG_LEN + offset;
+            decryptor.Update(piece, length, ptAES.data() + offset);
+            hash.Update(piece, length);
+        }
+        decryptor.Finish();
+        if (ptAES != big || hash.Finish() != pcrypto::ComputeMessageHash(ctAES))
+        {
+            printf("testCrypto: AES-GCM stream decryption test failed.\n");
+            return -1;
+        }
+        printf("testCrypto: AES-GCM stream encryption test successful!\n\n");
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: AES-GCM stream encryption test failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    try
+    {
+        pcrypto::skenc::StreamDecryptor decryptor(key);
+        ctAES = pcrypto::skenc::EncryptMessage(key, msg);
+        ctAES[constants::IV_LEN]++;
+        ptAES.resize(pcrypto::skenc::DecryptedSize(ctAES.size()));
+        decryptor.Begin(ctAES.data());
+        decryptor.Update(ctAES.data() + constants::IV_TAG_LEN, ptAES.size(), ptAES.data());
+        decryptor.Finish();
+        printf("testCrypto: AES-GCM stream decryption test failed, tampering undetected.\n");
+        return -1;
+    }
+    catch (const Error::CryptoError& e)
+    {
+        printf("testCrypto: AES-GCM stream decryption correct, tampering detected!\n\n");
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: AES-GCM stream decryption test failed\n%s\n", e.what());
+        return -1;
+    }
+
+    // Test Merkle tree inclusion proofs
+    try
+    {
+        for (size_t count = 1; count <= 9; count++)
+        {
+            std::vector<ByteArray> leaves;
+            for (size_t i = 0; i < count; i++)
+                leaves.push_back(pcrypto::merkle::ComputeLeafHash(ByteArray(i + 1, (uint8_t)i)));
+
+            ByteArray root = pcrypto::merkle::ComputeRoot(leaves);
+            for (size_t i = 0; i < count; i++)
+            {
+                std::vector<ByteArray> proof = pcrypto::merkle::ComputeProof(leaves, i);
+                if (!pcrypto::merkle::VerifyProof(root, leaves[i], i, count, proof))
+                {
+                    printf("testCrypto: Merkle proof verification failed.\n");
+                    return -1;
+                }
+
+                if (pcrypto::merkle::VerifyProof(root, leaves[(i + 1) % count], i, count, proof) &&
+                    count > 1)
+                {
+                    printf("testCrypto: Merkle proof for wrong leaf undetected.\n");
+                    return -1;
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: Merkle proof test failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    try
+    {
+        std::vector<ByteArray> none;
+        pcrypto::merkle::ComputeRoot(none);
+        printf("testCrypto: Merkle root of empty tree undetected.\n");
+        return -1;
+    }
+    catch (const Error::ValueError& e)
+    {
+        printf("testCrypto: Merkle root of empty tree detected!\n");
+    }
+
+    printf("testCrypto: Merkle proof test successful!\n\n");
+
+    // Test base64 encoding and decoding
+    {
+        const char* vectors[][2] = {
+            {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+            {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}};
+        for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++)
+        {
+            std::string text(vectors[i][0]);
+            ByteArray raw(text.begin(), text.end());
+            if (base64_encode(raw) != vectors[i][1] || base64_decode(vectors[i][1]) != raw)
+            {
+                printf("testCrypto: base64 test vector %d failed.\n", (int)i);
+                return -1;
+            }
+        }
+
+        // lengths on either side of every vector block size
+        for (size_t size = 0; size < 200; size++)
+        {
+            ByteArray raw = pcrypto::RandomBitString(size + 1);
+            raw.resize(size);
+            Base64EncodedString encoded = base64_encode(raw);
+            if (encoded.size() != BASE64_ENCODED_LENGTH(size) || base64_decode(encoded) != raw)
+            {
+                printf("testCrypto: base64 round trip of %d bytes failed.\n", (int)size);
+                return -1;
+            }
+        }
+
+        // decoding stops at the first character that is not base64, a
+        // trailing group of n characters yields n - 1 bytes
+        ByteArray raw = pcrypto::RandomBitString(96);
+        Base64EncodedString encoded = base64_encode(raw);
+        for (size_t position = 0; position < encoded.size(); position++)
+        {
+            Base64EncodedString broken(encoded);
+            broken[position] = (position % 2) ? '\n' : '\xc3';
+            ByteArray decoded = base64_decode(broken);
+            size_t expected = position / 4 * 3 + (position % 4 ? position % 4 - 1 : 0);
+            if (decoded.size() != expected || !std::equal(decoded.begin(), decoded.end(), raw.begin()))
+            {
+                printf("testCrypto: base64 decode stopped incorrectly at %d.\n", (int)position);
+                return -1;
+            }
+        }
+    }
+    printf("testCrypto: base64 test successful!\n\n");
+
+    // Test hex encoding and decoding
+    try
+    {
+        for (size_t size = 0; size < 80; size++)
+        {
+            ByteArray raw = pcrypto::RandomBitString(size + 1);
+            raw.resize(size);
+            std::string encoded = pdo::BinaryToHexString(raw);
+            if (encoded.size() != HEX_STRING_SIZE(size) || pdo::HexStringToBinary(encoded) != raw)
+            {
+                printf("testCrypto: hex round trip of %d bytes failed.\n", (int)size);
+                return -1;
+            }
+
+            std::string folded(encoded);
+            std::transform(folded.begin(), folded.end(), folded.begin(), ::tolower);
+            if (pdo::HexStringToBinary(folded) != raw)
+            {
+                printf("testCrypto: lower case hex decode of %d bytes failed.\n", (int)size);
+                return -1;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        printf("testCrypto: hex round trip failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    {
+        // an invalid digit anywhere in the buffer is reported once
+        std::string encoded = pdo::BinaryToHexString(pcrypto::RandomBitString(40));
+        const char invalid[] = {'g', 'G', '/', ':', '@', '`', ' ', '\xc3'};
+        for (size_t position = 0; position < encoded.size(); position++)
+        {
+            std::string broken(encoded);
+            broken[position] = invalid[position % sizeof(invalid)];
+            try
+            {
+                pdo::HexStringToBinary(broken);
+                printf("testCrypto: invalid hex digit at %d undetected.\n", (int)position);
+                return -1;
+            }
+            catch (const Error::ValueError& e)
+            {
+            }
+        }
+
+        try
+        {
+            pdo::HexStringToBinary(encoded.substr(1));
+            printf("testCrypto: odd length hex string undetected.\n");
+            return -1;
+        }
+        catch (const Error::ValueError& e)
+        {
+        }
+    }
+    printf("testCrypto: hex test successful!\n\n");
+
+    // Test the CBOR subset used for request batches
+    try
+    {
+        // 1000 and a two byte array nested in a one entry map, RFC 7049 appendix A
+        ByteArray encoded;
+        CborWriter writer(encoded);
+        writer.BeginMap(1);
+        writer.String("a");
+        writer.BeginArray(2);
+        writer.Unsigned(1000);
+        writer.Bytes(ByteArray{1, 2});
+        ByteArray expected = {0xa1, 0x61, 0x61, 0x82, 0x19, 0x03, 0xe8, 0x42, 0x01, 0x02};
+        if (encoded != expected)
+        {
+            printf("testCrypto: cbor encoding does not match the expected value.\n");
+            return -1;
+        }
+
+        CborReader reader(encoded.data(), encoded.size());
+        ByteArray value;
+        if (reader.ReadMap() != 1 || reader.ReadString() != "a" || reader.ReadArray() != 2 ||
+            reader.ReadUnsigned() != 1000 || (reader.ReadBytes(value), value != ByteArray{1, 2}) ||
+            ! reader.AtEnd())
+        {
+            printf("testCrypto: cbor decoding does not match the encoded value.\n");
+            return -1;
+        }
+
+        // byte strings of every length class
+        const size_t sizes[] = {0, 23, 24, 255, 256, 65535, 65536};
+        encoded.clear();
+        writer.BeginArray(sizeof(sizes) / sizeof(sizes[0]));
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+            writer.Bytes(ByteArray(sizes[i], (uint8_t)i));
+
+        CborReader sized(encoded.data(), encoded.size());
+        if (sized.ReadArray() != sizeof(sizes) / sizeof(sizes[0]))
+        {
+            printf("testCrypto: cbor array length mismatch.\n");
+            return -1;
+        }
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        {
+            sized.ReadBytes(value);
+            if (value != ByteArray(sizes[i], (uint8_t)i))
+            {
+                printf("testCrypto: cbor byte string of %d bytes failed.\n", (int)sizes[i]);
+                return -1;
+            }
+        }
+    }
+    catch (const Error::ValueError& e)
+    {
+        printf("testCrypto: cbor round trip failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    // truncated items, wrong types and indefinite lengths are rejected
+    {
+        const ByteArray invalid[] = {
+            {}, {0x19, 0x03}, {0x42, 0x01}, {0x01}, {0x5f, 0x40, 0xff}, {0x9b, 0xff, 0xff, 0xff,
+            0xff, 0xff, 0xff, 0xff, 0xff}};
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+        {
+            try
+            {
+                CborReader reader(invalid[i].data(), invalid[i].size());
+                ByteArray value;
+                if (i < 2)
+                    reader.ReadUnsigned();
+                else if (i < 5)
+                    reader.ReadBytes(value);
+                else
+                    reader.ReadArray();
+                printf("testCrypto: invalid cbor item %d undetected.\n", (int)i);
+                return -1;
+            }
+            catch (const Error::ValueError& e)
+            {
+            }
+        }
+    }
+    printf("testCrypto: cbor test successful!\n\n");
+
+    // Test state compression: repetitive text must shrink and every
+    // input, including overlapping matches and random data, must survive
+    // the round trip
+    try
+    {
+        std::string text;
+        for (int i = 0; i < 200; i++)
+            text += "(make-instance escrow-counter (key \"key" + std::to_string(i) +
+                    "\") (value " + std::to_string(i * 7) + ") (active #t))";
+
+        const ByteArray inputs[] = {ByteArray(), ByteArray(1, 'a'), ByteArray(13, 'a'),
+            ByteArray(100000, 'x'), ByteArray(text.begin(), text.end()),
+            pcrypto::RandomBitString(70000)};
+        for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+        {
+            ByteArray compressed;
+            pdo::compression::Compress(inputs[i].data(), inputs[i].size(), compressed);
+            ByteArray decompressed;
+            pdo::compression::Decompress(
+                compressed.data(), compressed.size(), inputs[i].size(), decompressed);
+            if (decompressed != inputs[i])
+            {
+                printf("testCrypto: compression round trip %d failed.\n", (int)i);
+                return -1;
+            }
+        }
+
+        ByteArray envelope;
+        if (!pdo::compression::CompressEnvelope(
+                (const uint8_t*)text.data(), text.size(), envelope) ||
+            envelope.size() * 4 > text.size() ||
+            !pdo::compression::IsCompressedEnvelope(envelope.data(), envelope.size()))
+        {
+            printf("testCrypto: state text did not compress.\n");
+            return -1;
+        }
+
+        ByteArray expanded;
+        pdo::compression::DecompressEnvelope(envelope.data(), envelope.size(), expanded);
+        if (ByteArrayToString(expanded) != text ||
+            pdo::compression::IsCompressedEnvelope(expanded.data(), expanded.size()))
+        {
+            printf("testCrypto: compression envelope round trip failed.\n");
+            return -1;
+        }
+
+        ByteArray random = pcrypto::RandomBitString(4096);
+        if (pdo::compression::CompressEnvelope(random.data(), random.size(), envelope))
+        {
+            printf("testCrypto: random data should not compress.\n");
+            return -1;
+        }
+    }
+    catch (const Error::ValueError& e)
+    {
+        printf("testCrypto: compression round trip failed.\n%s\n", e.what());
+        return -1;
+    }
+
+    // bad offsets, truncated blocks, size mismatches and unknown
+    // envelope versions are rejected
+    {
+        const ByteArray invalid[] = {{}, {0x00, 0x01, 0x00}, {0x1f, 'a', 0x02, 0x00},
+            {0x10, 'a', 0x01}, {0x20, 'a', 'b'}, {0xf0, 0xff}, {0x00, 'P', 'D', 'Z', 0x02, 0, 0,
+            0, 1, 0x10, 'a'}};
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+        {
+            try
+            {
+                ByteArray output;
+                if (i < 6)
+                    pdo::compression::Decompress(invalid[i].data(), invalid[i].size(), 1, output);
+                else
+                    pdo::compression::DecompressEnvelope(
+                        invalid[i].data(), invalid[i].size(), output);
+                printf("testCrypto: invalid compressed data %d undetected.\n", (int)i);
+                return -1;
+            }
+            catch (const Error::ValueError& e)
+            {
+            }
+        }
+    }
+    printf("testCrypto: compression test successful!\n\n");
+
     return 0;
 }  // pcrypto::testCrypto()
@@ -15,6 +15,8 @@
 import pdo.common.crypto as crypto
 import logging
 import sys
+import os
+import importlib.util
 logger = logging.getLogger(__name__)
 logger.setLevel(logging.DEBUG)
 logger = logging.getLogger()
@@ -309,5 +311,37 @@ bhash = bytearray(hash)
 b64hash = crypto.byte_array_to_base64(bhash)
 logger.debug("Hash computed!")
 crypto.base64_to_byte_array(b64hash)
+# TEST MERKLE PROOFS AGAINST THE SAWTOOTH VERIFIER
+merkle_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '../../sawtooth/common/pdo_merkle.py')
+merkle_spec = importlib.util.spec_from_file_location('pdo_merkle', merkle_path)
+pdo_merkle = importlib.util.module_from_spec(merkle_spec)
+merkle_spec.loader.exec_module(pdo_merkle)
+try:
+ for count in range(1, 10):
+  leaves = [bytes('leaf{0}'.format(i), 'ascii') for i in range(count)]
+  leaf_hashes = [crypto.MERKLE_ComputeLeafHash(leaf) for leaf in leaves]
+  root = bytes(crypto.MERKLE_ComputeRoot(leaf_hashes))
+  for index in range(count):
+   proof = [bytes(p) for p in crypto.MERKLE_ComputeProof(leaf_hashes, index)]
+   if not crypto.MERKLE_VerifyProof(root, leaf_hashes[index], index, count, proof):
+    raise ValueError("C++ rejected proof {0} of {1}".format(index, count))
+   if not pdo_merkle.verify_merkle_proof(root, leaves[index], index, count, proof):
+    raise ValueError("python rejected proof {0} of {1}".format(index, count))
+except Exception as exc:
+ logger.error("ERROR: Merkle proof verification test failed: ", exc)
+ sys.exit(-1)
+logger.debug("Merkle proof verification test successful!")
+leaves = [bytes('leaf{0}'.format(i), 'ascii') for i in range(5)]
+leaf_hashes = [crypto.MERKLE_ComputeLeafHash(leaf) for leaf in leaves]
+root = bytes(crypto.MERKLE_ComputeRoot(leaf_hashes))
+proof = [bytes(p) for p in crypto.MERKLE_ComputeProof(leaf_hashes, 2)]
+tampered = [bytes([proof[0][0] ^ 1]) + proof[0][1:]] + proof[1:]
+if pdo_merkle.verify_merkle_proof(root, leaves[2], 2, 5, tampered):
+ logger.error("ERROR: Merkle tampered proof detection test failed: not detected.")
+ sys.exit(-1)
+if pdo_merkle.verify_merkle_proof(root, leaves[2], 3, 5, proof):
+ logger.error("ERROR: Merkle wrong index detection test failed: not detected.")
+ sys.exit(-1)
+logger.debug("Merkle tampered proof detection test successful!")
 logger.debug("SWIG CRYPTO_WRAPPER TEST SUCCESSFUL!")
 sys.exit(0)
@@ -15,6 +15,7 @@
 
 #include "enclave_t.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -22,8 +23,9 @@
 #include <sgx_tseal.h>
 #include <sgx_utils.h>
 
+#include "cbor.h"
+#include "crypto.h"
 #include "error.h"
-#include "packages/base64/base64.h"
 #include "pdo_error.h"
 #include "types.h"
 #include "zero.h"
@@ -36,8 +38,11 @@
 #include "signup_enclave.h"
 
 #include "contract_request.h"
+#include "contract_statistics.h"
 #include "contract_response.h"
 #include "contract_secrets.h"
+#include "contract_session.h"
+#include "request_timing.h"
 
 ByteArray last_result;
 
@@ -125,6 +130,26 @@ pdo_err_t ecall_VerifySecrets(const uint8_t* inSealedSignupData,
     return result;
 }
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void HandleRequest(const EnclaveData& enclaveData,
+    const ByteArray& session_key,
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    size_t* outSerializedResponseSize)
+{
+    ByteArray encrypted_request(
+        inSerializedRequest, inSerializedRequest + inSerializedRequestSize);
+    ContractRequest request(session_key, encrypted_request);
+
+    ContractResponse response(request.process_request());
+    last_result = response.SerializeAndEncrypt(session_key, enclaveData);
+    MarkRequestPhase(PDO_PHASE_RESPONSE);
+    EndRequestTiming();
+
+    // save the response and return the size of the buffer required for it
+    (*outSerializedResponseSize) = last_result.size();
+}
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 pdo_err_t ecall_HandleContractRequest(const uint8_t* inSealedSignupData,
     size_t inSealedSignupDataSize,
@@ -146,19 +171,14 @@ pdo_err_t ecall_HandleContractRequest(const uint8_t* inSealedSignupData,
         // Unseal the enclave persistent data
         EnclaveData enclaveData(inSealedSignupData);
 
+        BeginRequestTiming();
         ByteArray encrypted_key(
             inEncryptedSessionKey, inEncryptedSessionKey + inEncryptedSessionKeySize);
-        ByteArray session_key = enclaveData.decrypt_message(encrypted_key);
+        ByteArray session_key = enclaveData.decrypt_session_key(encrypted_key);
+        MarkRequestPhase(PDO_PHASE_SESSION_KEY);
 
-        ByteArray encrypted_request(
-            inSerializedRequest, inSerializedRequest + inSerializedRequestSize);
-        ContractRequest request(session_key, encrypted_request);
-
-        ContractResponse response(request.process_request());
-        last_result = response.SerializeAndEncrypt(session_key, enclaveData);
-
-        // save the response and return the size of the buffer required for it
-        (*outSerializedResponseSize) = last_result.size();
+        HandleRequest(enclaveData, session_key, inSerializedRequest, inSerializedRequestSize,
+            outSerializedResponseSize);
     }
     catch (pdo::error::Error& e)
     {
@@ -177,6 +197,240 @@ pdo_err_t ecall_HandleContractRequest(const uint8_t* inSealedSignupData,
     return result;
 }
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Process a batch of requests and sign the Merkle root of the successful
+// responses once. The batch is a CBOR array with an array of two byte
+// strings, the encrypted session key and the encrypted request, for each
+// request. The result is a CBOR array with one encrypted response per
+// request, or an empty byte string for a request that could not be
+// decrypted.
+static void HandleRequestBatch(const EnclaveData& enclaveData,
+    const uint8_t* inSerializedBatch,
+    size_t inSerializedBatchSize,
+    size_t* outSerializedResponseSize)
+{
+    CborReader reader(inSerializedBatch, inSerializedBatchSize);
+
+    size_t count = reader.ReadArray();
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        count == 0 || count > RESPONSE_BATCH_MAX_SIZE, "invalid request batch size");
+
+    // the framing of the whole batch is checked before any request runs
+    std::vector<ByteArray> encrypted_keys(count);
+    std::vector<ByteArray> encrypted_requests(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            reader.ReadArray() != 2, "invalid request batch entry");
+        reader.ReadBytes(encrypted_keys[i]);
+        reader.ReadBytes(encrypted_requests[i]);
+    }
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        ! reader.AtEnd(), "invalid request batch; trailing data");
+
+    std::vector<ByteArray> session_keys(count);
+    std::vector<std::unique_ptr<ContractResponse>> responses(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        try
+        {
+            BeginRequestTiming();
+            ByteArray session_key = enclaveData.decrypt_session_key(encrypted_keys[i]);
+            MarkRequestPhase(PDO_PHASE_SESSION_KEY);
+            ContractRequest request(session_key, encrypted_requests[i]);
+
+            responses[i].reset(new ContractResponse(request.process_request()));
+            session_keys[i] = session_key;
+            EndRequestTiming();
+        }
+        catch (pdo::error::Error& e)
+        {
+            SAFE_LOG(PDO_LOG_ERROR, "failed to process batch request %zu: %s", i, e.what());
+        }
+    }
+
+    // leaves are the successful responses in request order
+    std::vector<ByteArray> leaf_hashes;
+    std::vector<size_t> leaf_index(count, 0);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (responses[i] && responses[i]->operation_succeeded_)
+        {
+            leaf_index[i] = leaf_hashes.size();
+            leaf_hashes.push_back(responses[i]->ComputeLeafHash());
+        }
+    }
+
+    ResponseBatchProof batch_proof;
+    if (leaf_hashes.size() > 0)
+    {
+        batch_proof.root_ = pdo::crypto::merkle::ComputeRoot(leaf_hashes);
+        batch_proof.count_ = leaf_hashes.size();
+        batch_proof.signature_ = enclaveData.sign_message(
+            ResponseBatchProof::SerializeForSigning(batch_proof.root_, batch_proof.count_));
+    }
+
+    last_result.clear();
+    CborWriter writer(last_result);
+    writer.BeginArray(count);
+
+    // the response phase of each request is timed on its own since the
+    // responses can only be built once every request has run
+    for (size_t i = 0; i < count; i++)
+    {
+        ByteArray encrypted_response;
+        if (responses[i])
+        {
+            BeginRequestTiming();
+            const ResponseBatchProof* proof = NULL;
+            if (responses[i]->operation_succeeded_)
+            {
+                batch_proof.index_ = leaf_index[i];
+                batch_proof.proof_ = pdo::crypto::merkle::ComputeProof(leaf_hashes, leaf_index[i]);
+                proof = &batch_proof;
+            }
+
+            encrypted_response =
+                responses[i]->SerializeAndEncrypt(session_keys[i], enclaveData, proof);
+            MarkRequestPhase(PDO_PHASE_RESPONSE);
+            EndRequestTiming();
+        }
+
+        writer.Bytes(encrypted_response);
+    }
+
+    (*outSerializedResponseSize) = last_result.size();
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t ecall_HandleContractRequestBatch(const uint8_t* inSealedSignupData,
+    size_t inSealedSignupDataSize,
+    const uint8_t* inSerializedBatch,
+    size_t inSerializedBatchSize,
+    size_t* outSerializedResponseSize)
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        pdo::error::ThrowIfNull(inSealedSignupData, "Sealed signup data pointer is NULL");
+        pdo::error::ThrowIfNull(inSerializedBatch, "Serialized batch pointer is NULL");
+        pdo::error::ThrowIfNull(outSerializedResponseSize, "Response size pointer is NULL");
+
+        // Unseal the enclave persistent data
+        EnclaveData enclaveData(inSealedSignupData);
+
+        HandleRequestBatch(
+            enclaveData, inSerializedBatch, inSerializedBatchSize, outSerializedResponseSize);
+    }
+    catch (pdo::error::Error& e)
+    {
+        SAFE_LOG(PDO_LOG_ERROR,
+            "Error in contract enclave (ecall_HandleContractRequestBatch): %04X -- %s",
+            e.error_code(), e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    }
+    catch (...)
+    {
+        SAFE_LOG(PDO_LOG_ERROR,
+            "Unknown error in contract enclave (ecall_HandleContractRequestBatch)");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t ecall_CreateSession(const uint8_t* inSealedSignupData,
+    size_t inSealedSignupDataSize,
+    const uint8_t* inEncryptedSessionKey,
+    size_t inEncryptedSessionKeySize,
+    uint8_t* outSessionId,
+    size_t inSessionIdSize)
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        pdo::error::ThrowIfNull(inSealedSignupData, "Sealed signup data pointer is NULL");
+        pdo::error::ThrowIfNull(inEncryptedSessionKey, "Session key pointer is NULL");
+        pdo::error::ThrowIfNull(outSessionId, "Session id pointer is NULL");
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            inSessionIdSize != SESSION_ID_SIZE, "Session id size is incorrect");
+
+        // Unseal the enclave persistent data
+        EnclaveData enclaveData(inSealedSignupData);
+
+        ByteArray encrypted_key(
+            inEncryptedSessionKey, inEncryptedSessionKey + inEncryptedSessionKeySize);
+        ByteArray session_key = enclaveData.decrypt_session_key(encrypted_key);
+
+        ByteArray session_id = CreateSession(session_key);
+        memcpy_s(outSessionId, inSessionIdSize, session_id.data(), session_id.size());
+    }
+    catch (pdo::error::Error& e)
+    {
+        SAFE_LOG(PDO_LOG_ERROR, "Error in contract enclave (ecall_CreateSession): %04X -- %s",
+            e.error_code(), e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    }
+    catch (...)
+    {
+        SAFE_LOG(PDO_LOG_ERROR, "Unknown error in contract enclave (ecall_CreateSession)");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t ecall_HandleSessionRequest(const uint8_t* inSealedSignupData,
+    size_t inSealedSignupDataSize,
+    const uint8_t* inSessionId,
+    size_t inSessionIdSize,
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    size_t* outSerializedResponseSize)
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        pdo::error::ThrowIfNull(inSealedSignupData, "Sealed signup data pointer is NULL");
+        pdo::error::ThrowIfNull(inSessionId, "Session id pointer is NULL");
+        pdo::error::ThrowIfNull(inSerializedRequest, "Serialized request pointer is NULL");
+        pdo::error::ThrowIfNull(outSerializedResponseSize, "Response size pointer is NULL");
+
+        // Unseal the enclave persistent data
+        EnclaveData enclaveData(inSealedSignupData);
+
+        BeginRequestTiming();
+        ByteArray session_id(inSessionId, inSessionId + inSessionIdSize);
+        ByteArray session_key = UseSession(session_id);
+
+        HandleRequest(enclaveData, session_key, inSerializedRequest, inSerializedRequestSize,
+            outSerializedResponseSize);
+    }
+    catch (pdo::error::Error& e)
+    {
+        SAFE_LOG(PDO_LOG_ERROR,
+            "Error in contract enclave (ecall_HandleSessionRequest): %04X -- %s", e.error_code(),
+            e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    }
+    catch (...)
+    {
+        SAFE_LOG(PDO_LOG_ERROR, "Unknown error in contract enclave (ecall_HandleSessionRequest)");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 pdo_err_t ecall_GetSerializedResponse(const uint8_t* inSealedSignupData,
     size_t inSealedSignupDataSize,
@@ -214,3 +468,61 @@ pdo_err_t ecall_GetSerializedResponse(const uint8_t* inSealedSignupData,
 
     return result;
 }
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t ecall_GetRequestStatistics(pdo_request_statistics_t* outStatistics, int inReset)
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        pdo::error::ThrowIfNull(outStatistics, "Statistics pointer is NULL");
+        GetRequestStatistics(*outStatistics, inReset != 0);
+    }
+    catch (pdo::error::Error& e)
+    {
+        SAFE_LOG(PDO_LOG_ERROR,
+            "Error in contract enclave (ecall_GetRequestStatistics): %04X -- %s", e.error_code(),
+            e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    }
+    catch (...)
+    {
+        SAFE_LOG(PDO_LOG_ERROR, "Unknown error in contract enclave (ecall_GetRequestStatistics)");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t ecall_GetContractStatistics(pdo_contract_statistics_t* outStatistics,
+    size_t inCount,
+    size_t* outCount,
+    int inReset)
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        pdo::error::ThrowIfNull(outStatistics, "Statistics pointer is NULL");
+        pdo::error::ThrowIfNull(outCount, "Count pointer is NULL");
+        (*outCount) = GetContractStatistics(outStatistics, inCount, inReset != 0);
+    }
+    catch (pdo::error::Error& e)
+    {
+        SAFE_LOG(PDO_LOG_ERROR,
+            "Error in contract enclave (ecall_GetContractStatistics): %04X -- %s", e.error_code(),
+            e.what());
+        ocall_SetErrorMessage(e.what());
+        result = e.error_code();
+    }
+    catch (...)
+    {
+        SAFE_LOG(PDO_LOG_ERROR, "Unknown error in contract enclave (ecall_GetContractStatistics)");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
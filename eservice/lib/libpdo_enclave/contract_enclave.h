@@ -21,6 +21,7 @@ DESCRIPTION:   Function declarations for the contract enclave
 #pragma once
 
 #include "error.h"
+#include "request_statistics.h"
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 extern pdo_err_t ecall_VerifySecrets(const uint8_t* inSealedSignupData,
@@ -47,8 +48,42 @@ extern pdo_err_t ecall_UpdateContract(const uint8_t* inSealedSignupData,
     const char* inSerializedRequest,
     size_t* outSerializedResponseSize);
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+extern pdo_err_t ecall_HandleContractRequestBatch(const uint8_t* inSealedSignupData,
+    size_t inSealedSignupDataSize,
+    const uint8_t* inSerializedBatch,
+    size_t inSerializedBatchSize,
+    size_t* outSerializedResponseSize);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+extern pdo_err_t ecall_CreateSession(const uint8_t* inSealedSignupData,
+    size_t inSealedSignupDataSize,
+    const uint8_t* inEncryptedSessionKey,
+    size_t inEncryptedSessionKeySize,
+    uint8_t* outSessionId,
+    size_t inSessionIdSize);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+extern pdo_err_t ecall_HandleSessionRequest(const uint8_t* inSealedSignupData,
+    size_t inSealedSignupDataSize,
+    const uint8_t* inSessionId,
+    size_t inSessionIdSize,
+    const uint8_t* inSerializedRequest,
+    size_t inSerializedRequestSize,
+    size_t* outSerializedResponseSize);
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 extern pdo_err_t ecall_GetSerializedResponse(const uint8_t* inSealedSignupData,
     size_t inSealedSignupDataSize,
     char* outSerializedResponse,
     size_t inSerializedResponseSize);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+extern pdo_err_t ecall_GetRequestStatistics(pdo_request_statistics_t* outStatistics,
+    int inReset);
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+extern pdo_err_t ecall_GetContractStatistics(pdo_contract_statistics_t* outStatistics,
+    size_t inCount,
+    size_t* outCount,
+    int inReset);
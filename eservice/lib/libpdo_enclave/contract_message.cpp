@@ -25,6 +25,7 @@
 #include "parson.h"
 
 #include "contract_message.h"
+#include "verifying_key_cache.h"
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // Request format for create and send methods
@@ -42,11 +43,9 @@
 bool ContractMessage::VerifySignature(const ByteArray& signature) const
 {
     // verify the signature in the message came from the originator
-    pdo::crypto::sig::PublicKey verifying_key(originator_verifying_key_);
-
     std::string serialized = expression_ + channel_verifying_key_ + nonce_;
     ByteArray message(serialized.begin(), serialized.end());
-    return verifying_key.VerifySignature(message, signature) > 0;
+    return VerifyWithCachedKey(originator_verifying_key_, message, signature) > 0;
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
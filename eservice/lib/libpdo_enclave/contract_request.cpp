@@ -28,6 +28,9 @@
 #include "contract_request.h"
 #include "contract_response.h"
 #include "contract_secrets.h"
+#include "contract_state_cache.h"
+#include "contract_statistics.h"
+#include "request_timing.h"
 
 #include "enclave_utils.h"
 
@@ -57,8 +60,13 @@
 //     },
 //     "ContractState" :
 //     {
-//         "EncryptedState" : ""
-//     }
+//         "EncryptedState" : "",
+//         "EncryptedStateDeltas" : [ "<base64 encoded encrypted delta>", ... ],
+//         "EmitStateDelta" : <boolean>,
+//         "ChunkedState" : <boolean>,
+//         "StateHash" : "<base64 encoded state hash>"
+//     },
+//     "ReturnStatistics" : <boolean>
 // }
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
@@ -68,17 +76,23 @@ ContractRequest::ContractRequest(
 {
     JSON_Object* ovalue = nullptr;
 
-    ByteArray decrypted_request =
-        pdo::crypto::skenc::DecryptMessage(session_key, encrypted_request);
-    std::string request = ByteArrayToString(decrypted_request);
+    // decrypt into a terminated buffer that the request is parsed over in
+    // place, strings in the parsed request (the encoded state above all)
+    // point into it and must not outlive it
+    size_t request_size = pdo::crypto::skenc::DecryptedSize(encrypted_request.size());
+    ByteArray request(request_size + 1);
+    pdo::crypto::skenc::CipherContext context(session_key);
+    context.Decrypt(encrypted_request.data(), encrypted_request.size(), request.data());
+    request[request_size] = '\0';
 
     // Parse the contract request
-    JsonValue parsed(json_parse_string(request.c_str()));
+    JsonValue parsed(json_parse_string_in_situ(reinterpret_cast<char*>(request.data())));
     pdo::error::ThrowIfNull(
         parsed.value, "failed to parse the contract request, badly formed JSON");
 
     JSON_Object* request_object = json_value_get_object(parsed);
     pdo::error::ThrowIfNull(request_object, "Missing JSON object in contract request");
+    MarkRequestPhase(PDO_PHASE_REQUEST_PARSE);
 
     // operation
     const char* pvalue = json_object_dotget_string(request_object, "Operation");
@@ -128,12 +142,50 @@ ContractRequest::ContractRequest(
         "invalid contract id");
 
     contract_state_.Unpack(state_encryption_key_, ovalue, id_hash, contract_code_.ComputeHash());
+    apply_state_deltas();
+    MarkRequestPhase(PDO_PHASE_STATE_DECRYPT);
 
     // contract message
     ovalue = json_object_dotget_object(request_object, "ContractMessage");
     pdo::error::ThrowIf<pdo::error::ValueError>(
         !pvalue, "invalid request; failed to retrieve ContractMessage");
     contract_message_.Unpack(ovalue);
+    MarkRequestPhase(PDO_PHASE_MESSAGE_VERIFY);
+
+    // optional, -1 when absent
+    return_statistics_ = json_object_dotget_boolean(request_object, "ReturnStatistics") == 1;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the deltas carry binding updates that only make sense to the
+// interpreter, so the full state is rebuilt by loading the base state
+// and applying each delta in order
+void ContractRequest::apply_state_deltas(void)
+{
+    if (contract_state_.state_deltas_.empty())
+        return;
+
+    pdo::contracts::ContractCode code;
+    code.Code = contract_code_.code_;
+    code.Name = contract_code_.name_;
+
+    pdo::contracts::ContractState state;
+    state.State = ByteArrayToString(contract_state_.decrypted_state_);
+
+    GipsyInterpreter interpreter;
+    interpreter.load_contract_for_update(code, state);
+
+    std::vector<StateDelta>::const_iterator delta;
+    for (delta = contract_state_.state_deltas_.begin();
+         delta != contract_state_.state_deltas_.end();
+         delta++)
+        interpreter.update_contract_state(*delta);
+
+    interpreter.get_contract_state(state);
+    contract_state_.decrypted_state_.assign(state.State.begin(), state.State.end());
+
+    // the chunks no longer match the state, none may be reused
+    contract_state_.encrypted_chunks_.clear();
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -143,6 +195,8 @@ ContractResponse ContractRequest::process_initialization_request(void)
     try
     {
         GipsyInterpreter interpreter;
+        MarkRequestPhase(PDO_PHASE_INTERPRETER_BOOTSTRAP);
+        interpreter.observe_phases(RequestPhaseObserver());
 
         // interpreter.create_initial_contract_state(contractid, creatorid, contractcode, message,
         // state)
@@ -160,8 +214,19 @@ ContractResponse ContractRequest::process_initialization_request(void)
         interpreter.create_initial_contract_state(
             contract_id_, creator_id_, code, msg, new_contract_state);
 
+        pdo_interpreter_statistics_t statistics;
+        interpreter.get_statistics(statistics);
+        RecordContractStatistics(contract_code_.name_, statistics);
+
         ByteArray new_state(new_contract_state.State.begin(), new_contract_state.State.end());
         ContractResponse response(*this, dependencies, new_state, "");
+        if (return_statistics_)
+            response.SetStatistics(statistics);
+
+        MarkRequestPhase(PDO_PHASE_STATE_ENCRYPT);
+
+        CacheContractState(Base64EncodedStringToByteArray(contract_id_),
+            contract_code_.ComputeHash(), new_state, response.contract_state_);
 
         return response;
     }
@@ -212,6 +277,8 @@ ContractResponse ContractRequest::process_update_request(void)
     try
     {
         GipsyInterpreter interpreter;
+        MarkRequestPhase(PDO_PHASE_INTERPRETER_BOOTSTRAP);
+        interpreter.observe_phases(RequestPhaseObserver());
 
         // interpreter.create_initial_contract_state(contractid, creatorid, contractcode, message,
         // state)
@@ -231,11 +298,40 @@ ContractResponse ContractRequest::process_update_request(void)
         std::map<string, string> dependencies;
         std::string result;
 
+        StateAccessSet access;
+        if (contract_state_.emit_state_delta_)
+            interpreter.track_state_access(&access);
+
         interpreter.send_message_to_contract(contract_id_, creator_id_, code, msg,
             current_contract_state, new_contract_state, dependencies, result);
 
+        pdo_interpreter_statistics_t statistics;
+        interpreter.get_statistics(statistics);
+        RecordContractStatistics(contract_code_.name_, statistics);
+
         ByteArray new_state(new_contract_state.State.begin(), new_contract_state.State.end());
         ContractResponse response(*this, dependencies, new_state, result);
+        if (return_statistics_)
+            response.SetStatistics(statistics);
+
+        // no delta when the change cannot be expressed as binding updates
+        // or when the chain is due for a checkpoint, the client falls back
+        // to the full state in either case
+        if (contract_state_.emit_state_delta_ && access.Complete &&
+            contract_state_.state_deltas_.size() + 1 < STATE_DELTA_CHECKPOINT_INTERVAL)
+        {
+            response.contract_state_.EncryptStateDelta(state_encryption_key_,
+                Base64EncodedStringToByteArray(contract_id_),
+                contract_code_.ComputeHash(),
+                contract_state_.state_hash_,
+                access.Writes);
+        }
+
+        MarkRequestPhase(PDO_PHASE_STATE_ENCRYPT);
+
+        CacheContractState(Base64EncodedStringToByteArray(contract_id_),
+            contract_code_.ComputeHash(), new_state, response.contract_state_);
+
         return response;
     }
     catch (pdo::error::ValueError& e)
@@ -282,6 +378,17 @@ ContractResponse ContractRequest::process_update_request(void)
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 ContractResponse ContractRequest::process_request(void)
 {
+    // the client must send the request again with the full state
+    if (contract_state_.state_cache_miss_)
+    {
+        ByteArray error_state(0);
+        std::map<string, string> dependencies;
+        ContractResponse response(*this, dependencies, error_state, "state not available");
+        response.operation_succeeded_ = false;
+        response.state_cache_miss_ = true;
+        return response;
+    }
+
     switch (operation_)
     {
         case op_initialize:
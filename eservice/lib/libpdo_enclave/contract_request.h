@@ -39,6 +39,8 @@ protected:
     };
     Operation operation_; /* either "initialize" or "update" */
 
+    void apply_state_deltas(void);
+
     ContractResponse process_initialization_request(void);
     ContractResponse process_update_request(void);
 
@@ -51,6 +53,9 @@ public:
     ContractCode contract_code_; /*  */
     ContractMessage contract_message_;
 
+    // add the interpreter statistics to the response
+    bool return_statistics_ = false;
+
     ContractRequest(const ByteArray& session_key, const ByteArray& encrypted_request);
 
     bool is_initialize(void) const { return operation_ == op_initialize; };
@@ -21,9 +21,8 @@
 #include "pdo_error.h"
 
 #include "crypto.h"
-#include "jsonvalue.h"
+#include "json_writer.h"
 #include "packages/base64/base64.h"
-#include "parson.h"
 #include "types.h"
 
 #include "enclave_utils.h"
@@ -40,12 +39,15 @@ ContractResponse::ContractResponse(const ContractRequest& request,
     : contract_state_(request.state_encryption_key_,
           computed_state,
           Base64EncodedStringToByteArray(request.contract_id_),
-          request.contract_code_.ComputeHash()),
+          request.contract_code_.ComputeHash(),
+          request.contract_state_),
       dependencies_(dependencies)
 {
     contract_id_ = request.contract_id_;
     creator_id_ = request.creator_id_;
     operation_succeeded_ = true;
+    state_cache_miss_ = false;
+    has_statistics_ = false;
 
     contract_code_hash_ = request.contract_code_.ComputeHash();
     contract_message_hash_ = request.contract_message_.ComputeHash();
@@ -58,6 +60,14 @@ ContractResponse::ContractResponse(const ContractRequest& request,
 
     result_ = result;
 }
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void ContractResponse::SetStatistics(const pdo_interpreter_statistics_t& statistics)
+{
+    statistics_ = statistics;
+    has_statistics_ = true;
+}
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 ByteArray ContractResponse::SerializeForSigning(void) const
 {
@@ -127,91 +137,139 @@ ByteArray ContractResponse::ComputeSignature(const EnclaveData& enclave_data) co
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-ByteArray ContractResponse::SerializeAndEncrypt(
-    const ByteArray& session_key, const EnclaveData& enclave_data) const
+ByteArray ContractResponse::ComputeLeafHash(void) const
+{
+    return pdo::crypto::merkle::ComputeLeafHash(SerializeForSigning());
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray ResponseBatchProof::SerializeForSigning(const ByteArray& root, size_t count)
+{
+    ByteArray serialized(root);
+    serialized.push_back((count >> 24) & 0xFF);
+    serialized.push_back((count >> 16) & 0xFF);
+    serialized.push_back((count >> 8) & 0xFF);
+    serialized.push_back(count & 0xFF);
+
+    return serialized;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray ContractResponse::SerializeAndEncrypt(const ByteArray& session_key,
+    const EnclaveData& enclave_data,
+    const ResponseBatchProof* batch_proof) const
 {
-    // Create the response structure
-    JsonValue contract_response_value(json_value_init_object());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        !contract_response_value.value, "Failed to create the response object");
+    const ByteArray& state = contract_state_.encrypted_state_;
+    const ByteArray& delta = contract_state_.encrypted_state_delta_;
 
-    JSON_Object* contract_response_object = json_value_get_object(contract_response_value);
-    pdo::error::ThrowIfNull(
-        contract_response_object, "Failed on retrieval of response object value");
+    // a delta replaces the full state in the response; the enclave keeps
+    // the full state in its state cache and the client rebuilds requests
+    // from the last full state and the deltas that follow it
+    size_t state_size = delta.size() > 0 ? delta.size() : state.size();
 
-    // Use alphabetical order for the keys to ensure predictable
+    // the response is written once, after room for the IV and tag, and
+    // encrypted in place; the hint covers everything but the dependencies
+    ByteArray response(pdo::crypto::constants::IV_TAG_LEN);
+    JsonWriter writer(response, 1024 + result_.size() + BASE64_ENCODED_LENGTH(state_size));
+
+    // Keys are written in a fixed order to ensure predictable
     // serialization
-    JSON_Status jret;
+    writer.BeginObject();
 
     // --------------- status ---------------
-    jret = json_object_dotset_boolean(contract_response_object, "Status", operation_succeeded_);
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "failed to serialize the status");
+    writer.Key("Status");
+    writer.Boolean(operation_succeeded_);
 
     // --------------- result ---------------
-    jret = json_object_dotset_string(contract_response_object, "Result", result_.c_str());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "failed to serialize the result");
+    writer.Key("Result");
+    writer.String(result_);
+
+    if (state_cache_miss_) {
+        writer.Key("StateCacheMiss");
+        writer.Boolean(true);
+    }
 
     if (operation_succeeded_) {
         // --------------- signature ---------------
-        ByteArray signature = ComputeSignature(enclave_data);
-        Base64EncodedString encoded_signature = base64_encode(signature);
+        writer.Key("Signature");
+        writer.Base64(batch_proof ? batch_proof->signature_ : ComputeSignature(enclave_data));
 
-        jret =
-            json_object_dotset_string(contract_response_object, "Signature", encoded_signature.c_str());
-        pdo::error::ThrowIf<pdo::error::RuntimeError>(
-            jret != JSONSuccess, "failed to serialize the signature");
+        // --------------- batch proof ---------------
+        if (batch_proof)
+        {
+            writer.Key("BatchProof");
+            writer.BeginObject();
+            writer.Key("Root");
+            writer.Base64(batch_proof->root_);
+            writer.Key("Index");
+            writer.Number(batch_proof->index_);
+            writer.Key("Count");
+            writer.Number(batch_proof->count_);
+            writer.Key("Proof");
+            writer.BeginArray();
+            for (size_t i = 0; i < batch_proof->proof_.size(); i++)
+                writer.Base64(batch_proof->proof_[i]);
+            writer.EndArray();
+            writer.EndObject();
+        }
 
         // --------------- state ---------------
-        Base64EncodedString encoded_state = base64_encode(contract_state_.encrypted_state_);
-        jret = json_object_dotset_string(contract_response_object, "State", encoded_state.c_str());
-        pdo::error::ThrowIf<pdo::error::RuntimeError>(
-            jret != JSONSuccess, "failed to serialize the state");
+        if (delta.size() > 0)
+        {
+            writer.Key("StateDelta");
+            writer.Base64(delta);
+            writer.Key("StateHash");
+            writer.Base64(output_contract_state_hash_);
+        }
+        else
+        {
+            writer.Key("State");
+            writer.Base64(state);
+        }
 
         // --------------- dependencies ---------------
-        jret = json_object_set_value(contract_response_object, "Dependencies", json_value_init_array());
-        pdo::error::ThrowIf<pdo::error::RuntimeError>(
-            jret != JSONSuccess, "failed to serialize the dependencies");
-
-        JSON_Array* dependency_array = json_object_get_array(contract_response_object, "Dependencies");
-        pdo::error::ThrowIfNull(dependency_array, "failed to serialize the dependency array");
+        writer.Key("Dependencies");
+        writer.BeginArray();
 
         std::map<std::string, std::string>::const_iterator it;
         for (it = dependencies_.begin(); it != dependencies_.end(); it++)
         {
-            JSON_Value* dependency_value = json_value_init_object();
-            pdo::error::ThrowIfNull(dependency_value, "failed to create a dependency array");
-
-            JSON_Object* dependency_object = json_value_get_object(dependency_value);
-            pdo::error::ThrowIfNull(dependency_object, "failed to create a dependency value");
-
-            jret = json_object_dotset_string(dependency_object, "ContractID", it->first.c_str());
-            pdo::error::ThrowIf<pdo::error::RuntimeError>(
-                jret != JSONSuccess, "failed to serialize contract id in the dependency list");
+            writer.BeginObject();
+            writer.Key("ContractID");
+            writer.String(it->first);
+            writer.Key("StateHash");
+            writer.String(it->second);
+            writer.EndObject();
+        }
 
-            jret = json_object_dotset_string(dependency_object, "StateHash", it->second.c_str());
-            pdo::error::ThrowIf<pdo::error::RuntimeError>(
-                jret != JSONSuccess, "failed to serialize contract hash in the dependency list");
+        writer.EndArray();
 
-            jret = json_array_append_value(dependency_array, dependency_value);
-            pdo::error::ThrowIf<pdo::error::RuntimeError>(
-                jret != JSONSuccess, "failed to add dependency to the serialization array");
+        // --------------- statistics ---------------
+        if (has_statistics_)
+        {
+            writer.Key("Statistics");
+            writer.BeginObject();
+            writer.Key("EvalSteps");
+            writer.Number(statistics_.eval_steps);
+            writer.Key("CellsAllocated");
+            writer.Number(statistics_.cells_allocated);
+            writer.Key("GCRuns");
+            writer.Number(statistics_.gc_runs);
+            writer.Key("StateBytesRead");
+            writer.Number(statistics_.state_bytes_read);
+            writer.Key("StateBytesWritten");
+            writer.Number(statistics_.state_bytes_written);
+            writer.Key("HeapPeakBytes");
+            writer.Number(statistics_.heap_peak_bytes);
+            writer.EndObject();
         }
     }
 
-    // serialize the resulting json
-    size_t serializedSize = json_serialization_size(contract_response_value);
-    ByteArray serialized_response;
-    serialized_response.resize(serializedSize);
-
-    jret = json_serialize_to_buffer(contract_response_value,
-        reinterpret_cast<char*>(&serialized_response[0]), serialized_response.size());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "contract response serialization failed");
+    writer.EndObject();
+    writer.Terminate();
 
-    ByteArray encrypted_response =
-        pdo::crypto::skenc::EncryptMessage(session_key, serialized_response);
+    pdo::crypto::skenc::CipherContext context(session_key);
+    context.EncryptInPlace(response.data(), response.size());
 
-    return encrypted_response;
+    return response;
 }
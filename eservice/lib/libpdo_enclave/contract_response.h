@@ -17,13 +17,43 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "crypto.h"
+#include "request_statistics.h"
 
 #include "contract_request.h"
 #include "contract_state.h"
 #include "enclave_data.h"
 
+// upper bound on the number of requests handled in one batch; every
+// response in the batch is held in the enclave until the batch root
+// has been signed
+#ifndef RESPONSE_BATCH_MAX_SIZE
+#define RESPONSE_BATCH_MAX_SIZE 64
+#endif
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// When responses are signed as a batch, the enclave signs the Merkle
+// root over the leaf hashes of the successful responses once, and each
+// response carries the root, its position and the sibling hashes
+// needed to connect its leaf to the root
+class ResponseBatchProof
+{
+public:
+    ByteArray root_;
+    ByteArray signature_;
+    size_t index_;
+    size_t count_;
+    std::vector<ByteArray> proof_;
+
+    ResponseBatchProof(void) : index_(0), count_(0) {}
+
+    // the message signed for a batch binds the number of leaves to
+    // the root so a proof cannot be replayed against a smaller tree
+    static ByteArray SerializeForSigning(const ByteArray& root, size_t count);
+};
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 class ContractResponse
@@ -41,17 +71,31 @@ protected:
     ByteArray output_contract_state_hash_;
     bool contract_initializing_;
 
+    bool has_statistics_;
+    pdo_interpreter_statistics_t statistics_;
+
 public:
     std::map<std::string, std::string> dependencies_;
     ContractState contract_state_;
     std::string result_;
     bool operation_succeeded_;
+    bool state_cache_miss_;
 
     ContractResponse(const ContractRequest& request,
         const std::map<std::string, std::string>& dependencies,
         const ByteArray& state,
         const std::string& result);
 
-    ByteArray SerializeAndEncrypt(
-        const ByteArray& session_key, const EnclaveData& enclave_data) const;
+    // the statistics are returned as is, they are not covered by the
+    // signature
+    void SetStatistics(const pdo_interpreter_statistics_t& statistics);
+
+    // leaf hash of the response in a batch signature
+    ByteArray ComputeLeafHash(void) const;
+
+    // with a batch proof the response carries the batch signature and
+    // proof instead of a signature of its own
+    ByteArray SerializeAndEncrypt(const ByteArray& session_key,
+        const EnclaveData& enclave_data,
+        const ResponseBatchProof* batch_proof = NULL) const;
 };
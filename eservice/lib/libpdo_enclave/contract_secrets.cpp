@@ -13,6 +13,8 @@
  * limitations under the License.
  */
 
+#include <list>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -33,6 +35,7 @@
 
 #include "contract_secrets.h"
 #include "enclave_utils.h"
+#include "verifying_key_cache.h"
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 static void VerifySecretSignature(const std::string& inEnclaveId,
@@ -42,23 +45,60 @@ static void VerifySecretSignature(const std::string& inEnclaveId,
     const std::string& encoded_secret,
     const ByteArray& signature)
 {
-    pdo::crypto::sig::PublicKey ps_public_key(pspk);
-
     ByteArray message_array;
-    std::copy(encoded_secret.begin(), encoded_secret.end(), std::back_inserter(message_array));
-    std::copy(inEnclaveId.begin(), inEnclaveId.end(), std::back_inserter(message_array));
-    std::copy(inContractId.begin(), inContractId.end(), std::back_inserter(message_array));
-    std::copy(inCreatorId.begin(), inCreatorId.end(), std::back_inserter(message_array));
+    message_array.reserve(encoded_secret.size() + inEnclaveId.size() + inContractId.size() +
+                          inCreatorId.size());
+    message_array.insert(message_array.end(), encoded_secret.begin(), encoded_secret.end());
+    message_array.insert(message_array.end(), inEnclaveId.begin(), inEnclaveId.end());
+    message_array.insert(message_array.end(), inContractId.begin(), inContractId.end());
+    message_array.insert(message_array.end(), inCreatorId.begin(), inCreatorId.end());
+
+    int result = VerifyWithCachedKey(pspk, message_array, signature);
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        result <= 0, "failed to verify the secret signature");
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// a secret from the secret list, decoded but not yet decrypted
+class ProvisioningSecret
+{
+public:
+    std::string pspk_;
+    ByteArray encrypted_secret_;
+};
 
-    std::string msg = encoded_secret + inEnclaveId + inContractId + inCreatorId;
-    SAFE_LOG(PDO_LOG_WARNING, "MESSAGE: <%s>\n", msg.c_str());
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// decrypt one provisioning secret with the enclave key and check the
+// signature of the provisioning service; returns the raw secret
+static ByteArray DecryptAndVerifySecret(const EnclaveData& enclave_data,
+    const std::string& inEnclaveId,
+    const std::string& inContractId,
+    const std::string& inCreatorId,
+    const ProvisioningSecret& inSecret)
+{
+    ByteArray decrypted_secret = enclave_data.decrypt_message(inSecret.encrypted_secret_);
+    const std::string decrypted_ps_secret = ByteArrayToString(decrypted_secret);
+    ZeroV(decrypted_secret);
 
-    int result = ps_public_key.VerifySignature(message_array, signature);
     pdo::error::ThrowIf<pdo::error::ValueError>(
-        result <= 0, "failed to verify the secret signature");
+        decrypted_ps_secret.length() < ENCODED_SECRET_SIZE + ENCODED_SECRET_SIGNATURE_SIZE,
+        "Invalid secret, wrong length");
+
+    const std::string encoded_secret = decrypted_ps_secret.substr(0, ENCODED_SECRET_SIZE);
+    ByteArray signature =
+        HexEncodedStringToByteArray(decrypted_ps_secret.substr(ENCODED_SECRET_SIZE));
+
+    VerifySecretSignature(
+        inEnclaveId, inContractId, inCreatorId, inSecret.pspk_, encoded_secret, signature);
+
+    return HexEncodedStringToByteArray(encoded_secret);
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the whole list is parsed and decoded before any secret is decrypted so
+// a malformed entry fails without paying for the RSA decryptions of the
+// entries in front of it; the enclave has a single TCS so the secrets
+// are then decrypted one after another
 pdo_err_t CreateEnclaveStateEncryptionKey(const EnclaveData& enclave_data,
     const std::string& inContractId,
     const std::string& inCreatorId,
@@ -80,13 +120,13 @@ pdo_err_t CreateEnclaveStateEncryptionKey(const EnclaveData& enclave_data,
     JSON_Array* secret_array = json_value_get_array(parsed);
     pdo::error::ThrowIfNull(secret_array, "Failed to parse the secret list, expecting array");
 
-    ByteArray accumulator(ENCODED_SECRET_SIZE / 2, 0);
     const char* svalue = nullptr;
 
     int secret_count = json_array_get_count(secret_array);
     pdo::error::ThrowIf<pdo::error::ValueError>(
         secret_count < 1, "there must be at least one secret provided");
 
+    std::vector<ProvisioningSecret> secrets(secret_count);
     for (int i = 0; i < secret_count; i++)
     {
         JSON_Object* secret_object = json_array_get_object(secret_array, i);
@@ -94,46 +134,35 @@ pdo_err_t CreateEnclaveStateEncryptionKey(const EnclaveData& enclave_data,
 
         svalue = json_object_dotget_string(secret_object, "pspk");
         pdo::error::ThrowIfNull(svalue, "Invalid provisioning service public key");
-        const std::string pspk = svalue;
+        secrets[i].pspk_ = svalue;
 
         svalue = json_object_dotget_string(secret_object, "encrypted_secret");
         pdo::error::ThrowIfNull(svalue, "Invalid encrypted secret");
         const std::string encrypted_ps_secret = svalue;
 
-        std::copy(pspk.begin(), pspk.end(), std::back_inserter(message));
+        std::copy(
+            secrets[i].pspk_.begin(), secrets[i].pspk_.end(), std::back_inserter(message));
         std::copy(
             encrypted_ps_secret.begin(), encrypted_ps_secret.end(), std::back_inserter(message));
 
-        // TODO: decrypt encrypted_ps_secret
-        ByteArray encrypted_secret_buffer = Base64EncodedStringToByteArray(encrypted_ps_secret);
-        ByteArray decrypted_secret = enclave_data.decrypt_message(encrypted_secret_buffer);
-        const std::string decrypted_ps_secret = ByteArrayToString(decrypted_secret);
-
-        pdo::error::ThrowIf<pdo::error::ValueError>(
-            decrypted_ps_secret.length() < ENCODED_SECRET_SIZE + ENCODED_SECRET_SIGNATURE_SIZE,
-            "Invalid secret, wrong length");
-
-        const std::string encoded_secret = decrypted_ps_secret.substr(0, ENCODED_SECRET_SIZE);
-
-        SAFE_LOG(PDO_LOG_ERROR, "Secret: %s\nSignature: %s\n",
-            decrypted_ps_secret.substr(0, ENCODED_SECRET_SIZE).c_str(),
-            decrypted_ps_secret.substr(ENCODED_SECRET_SIZE).c_str());
-
-        ByteArray secret =
-            HexEncodedStringToByteArray(decrypted_ps_secret.substr(0, ENCODED_SECRET_SIZE));
-        ByteArray signature =
-            HexEncodedStringToByteArray(decrypted_ps_secret.substr(ENCODED_SECRET_SIZE));
+        secrets[i].encrypted_secret_ = Base64EncodedStringToByteArray(encrypted_ps_secret);
+    }
 
-        VerifySecretSignature(
-            enclave_id, inContractId, inCreatorId, pspk, encoded_secret, signature);
+    ByteArray accumulator(ENCODED_SECRET_SIZE / 2, 0);
+    for (int i = 0; i < secret_count; i++)
+    {
+        ByteArray secret = DecryptAndVerifySecret(
+            enclave_data, enclave_id, inContractId, inCreatorId, secrets[i]);
 
         // XOR the secrets together
-        for (int i = 0; i < ENCODED_SECRET_SIZE / 2; i++)
-            accumulator[i] = accumulator[i] ^ secret[i];
+        for (int j = 0; j < ENCODED_SECRET_SIZE / 2; j++)
+            accumulator[j] = accumulator[j] ^ secret[j];
+        ZeroV(secret);
     }
 
     // inContractStateEncryptionKey = Common::AES::GenerateEncodedKey(accumulator);
     contractStateEncryptionKey = accumulator;
+    ZeroV(accumulator);
 
     return result;
 }
@@ -161,6 +190,76 @@ static ByteArray CreateKeyEncryptionKey(const std::string& inContractId)
     return outKeyEncryptionKey;
 }
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// unwrapped state encryption keys of recently used contracts; an entry
+// only matches when the wrapped key in the request is the one it was
+// unwrapped from so a bad wrapped key still fails. The enclave has a
+// single TCS so the cache is only ever accessed from one thread.
+class CachedStateKey
+{
+public:
+    std::string contract_id_;
+    ByteArray encrypted_key_;
+    ByteArray state_key_;
+};
+
+typedef std::list<CachedStateKey> CachedStateKeyList;
+
+static CachedStateKeyList cached_state_keys;
+static std::map<std::string, CachedStateKeyList::iterator> cached_state_key_index;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void EvictCachedStateKey(CachedStateKeyList::iterator entry)
+{
+    ZeroV(entry->state_key_);
+    cached_state_key_index.erase(entry->contract_id_);
+    cached_state_keys.erase(entry);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static bool FindCachedStateKey(const std::string& inContractId,
+    const ByteArray& inEncryptedStateEncryptionKey,
+    ByteArray& outStateEncryptionKey)
+{
+    std::map<std::string, CachedStateKeyList::iterator>::iterator found =
+        cached_state_key_index.find(inContractId);
+    if (found == cached_state_key_index.end())
+        return false;
+
+    CachedStateKeyList::iterator entry = found->second;
+    if (entry->encrypted_key_ != inEncryptedStateEncryptionKey)
+        return false;
+
+    // move the entry to the front of the list
+    cached_state_keys.splice(cached_state_keys.begin(), cached_state_keys, entry);
+
+    outStateEncryptionKey = entry->state_key_;
+    return true;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void CacheStateKey(const std::string& inContractId,
+    const ByteArray& inEncryptedStateEncryptionKey,
+    const ByteArray& inStateEncryptionKey)
+{
+    std::map<std::string, CachedStateKeyList::iterator>::iterator existing =
+        cached_state_key_index.find(inContractId);
+    if (existing != cached_state_key_index.end())
+        EvictCachedStateKey(existing->second);
+
+    while (cached_state_keys.size() >= STATE_KEY_CACHE_SIZE)
+        EvictCachedStateKey(--cached_state_keys.end());
+
+    cached_state_keys.push_front(CachedStateKey());
+
+    CachedStateKey& entry = cached_state_keys.front();
+    entry.contract_id_ = inContractId;
+    entry.encrypted_key_ = inEncryptedStateEncryptionKey;
+    entry.state_key_ = inStateEncryptionKey;
+
+    cached_state_key_index[inContractId] = cached_state_keys.begin();
+}
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // returns base64 encoded, encrypted state encryption key
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -172,6 +271,9 @@ ByteArray EncryptStateEncryptionKey(
     ByteArray encrypted_state_encryption_key =
         pdo::crypto::skenc::EncryptMessage(key_encryption_key, inContractStateEncryptionKey);
 
+    // requests that follow initialization send back the key wrapped here
+    CacheStateKey(inContractId, encrypted_state_encryption_key, inContractStateEncryptionKey);
+
     return encrypted_state_encryption_key;
 }
 
@@ -188,11 +290,18 @@ Base64EncodedString EncodeAndEncryptStateEncryptionKey(
 ByteArray DecryptStateEncryptionKey(
     const std::string& inContractId, const ByteArray& inEncryptedStateEncryptionKey)
 {
+    ByteArray decrypted_state_encryption_key;
+    if (FindCachedStateKey(
+            inContractId, inEncryptedStateEncryptionKey, decrypted_state_encryption_key))
+        return decrypted_state_encryption_key;
+
     ByteArray key_encryption_key = CreateKeyEncryptionKey(inContractId);
 
-    ByteArray decrypted_state_encryption_key =
+    decrypted_state_encryption_key =
         pdo::crypto::skenc::DecryptMessage(key_encryption_key, inEncryptedStateEncryptionKey);
 
+    CacheStateKey(inContractId, inEncryptedStateEncryptionKey, decrypted_state_encryption_key);
+
     return decrypted_state_encryption_key;
 }
 
@@ -29,6 +29,13 @@
 #define SECRET_SIGNATURE_SIZE pdo::crypto::constants::MAX_SIG_SIZE
 #define ENCODED_SECRET_SIGNATURE_SIZE HEX_STRING_SIZE(SECRET_SIGNATURE_SIZE)
 
+// number of unwrapped state encryption keys kept by the enclave, keyed
+// by contract id; the cache lives in enclave memory and is lost when
+// the enclave is restarted
+#ifndef STATE_KEY_CACHE_SIZE
+#define STATE_KEY_CACHE_SIZE 64
+#endif
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 pdo_err_t CreateEnclaveStateEncryptionKey(const EnclaveData& enclave_data,
     const std::string& inContractId,
@@ -0,0 +1,113 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <map>
+#include <string>
+
+#include "crypto.h"
+#include "error.h"
+#include "pdo_error.h"
+#include "types.h"
+#include "zero.h"
+
+#include "contract_session.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+class Session
+{
+public:
+    ByteArray session_key_;
+    uint64_t last_used_;
+    uint64_t uses_;
+
+    ~Session(void) { Zero(session_key_.data(), session_key_.size()); }
+};
+
+// the enclave is configured with a single TCS so the table is only
+// ever accessed from one thread
+static std::map<ByteArray, Session> sessions;
+static uint64_t session_clock = 0;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static bool SessionExpired(const Session& session)
+{
+    return session.uses_ >= SESSION_MAX_REQUESTS ||
+           session_clock - session.last_used_ > SESSION_IDLE_REQUESTS;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// drop expired sessions and, if the table is still full, the least
+// recently used one
+static void MakeRoomForSession(void)
+{
+    std::map<ByteArray, Session>::iterator it = sessions.begin();
+    while (it != sessions.end())
+    {
+        if (SessionExpired(it->second))
+            sessions.erase(it++);
+        else
+            it++;
+    }
+
+    if (sessions.size() < SESSION_TABLE_SIZE)
+        return;
+
+    std::map<ByteArray, Session>::iterator oldest = sessions.begin();
+    for (it = sessions.begin(); it != sessions.end(); it++)
+    {
+        if (it->second.last_used_ < oldest->second.last_used_)
+            oldest = it;
+    }
+    sessions.erase(oldest);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray CreateSession(const ByteArray& inSessionKey)
+{
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        inSessionKey.size() != pdo::crypto::constants::SYM_KEY_LEN, "invalid session key");
+
+    session_clock++;
+    MakeRoomForSession();
+
+    ByteArray session_id = pdo::crypto::RandomBitString(SESSION_ID_SIZE);
+
+    Session& session = sessions[session_id];
+    session.session_key_ = inSessionKey;
+    session.last_used_ = session_clock;
+    session.uses_ = 0;
+
+    return session_id;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray UseSession(const ByteArray& inSessionId)
+{
+    session_clock++;
+
+    std::map<ByteArray, Session>::iterator it = sessions.find(inSessionId);
+    pdo::error::ThrowIf<pdo::error::ValueError>(it == sessions.end(), "unknown session");
+
+    if (SessionExpired(it->second))
+    {
+        sessions.erase(it);
+        throw pdo::error::ValueError("session expired");
+    }
+
+    it->second.last_used_ = session_clock;
+    it->second.uses_++;
+
+    return it->second.session_key_;
+}
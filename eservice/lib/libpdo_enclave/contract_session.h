@@ -0,0 +1,39 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "types.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// A session lets a client pay for the asymmetric decryption of its
+// session key once and then refer to the key by session id. The enclave
+// has no trusted clock, so sessions age by the number of requests the
+// enclave handles: a session expires after SESSION_MAX_REQUESTS uses or
+// once SESSION_IDLE_REQUESTS requests have been handled since it was
+// last used. When the table is full the least recently used session is
+// dropped.
+#define SESSION_ID_SIZE 16
+#define SESSION_TABLE_SIZE 64
+#define SESSION_MAX_REQUESTS 4096
+#define SESSION_IDLE_REQUESTS 16384
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// returns the id of a new session bound to the session key
+ByteArray CreateSession(const ByteArray& inSessionKey);
+
+// returns the session key and counts one use of the session
+// throws ValueError if the session is unknown or expired
+ByteArray UseSession(const ByteArray& inSessionId);
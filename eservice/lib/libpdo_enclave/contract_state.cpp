@@ -13,13 +13,19 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <string.h>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "enclave_t.h"
+
 #include "error.h"
 #include "pdo_error.h"
 
+#include "compression.h"
 #include "crypto.h"
 #include "hex_string.h"
 #include "jsonvalue.h"
@@ -31,6 +37,7 @@
 
 #include "contract_request.h"
 #include "contract_secrets.h"
+#include "contract_state_cache.h"
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 //
@@ -40,64 +47,471 @@
 //     "EncryptedStateEncryptionKey" : "<base64 encoded encrypted state encryption key>",
 //     "ContractID" : "<string>",
 //     "CreatorID" : "<string>",
-//     "EncryptedState" : ""
+//     "EncryptedState" : "",
+//     "EncryptedStateDeltas" : [ "<base64 encoded encrypted delta>", ... ],
+//     "EmitStateDelta" : <boolean>,
+//     "ChunkedState" : <boolean>,
+//     "StateHash" : "<base64 encoded state hash>"
 // }
 //
+// StateHash may be sent in place of EncryptedState. The state is taken
+// from the state cache if this enclave produced it recently and is
+// otherwise fetched from the eservice block store and verified against
+// the hash; if neither has it the request fails with a cache miss and
+// must be sent again with the full encrypted state.
+//
+// ChunkedState only matters when there is no encrypted state (that is,
+// when the contract is initialized); afterwards the layout follows the
+// encrypted state. A chunked encrypted state is the magic "PDOC", the
+// number of chunks and then each encrypted chunk preceded by its length
+// (all lengths are 32 bit big endian). A decrypted chunk holds the
+// contract id hash, the code hash, the chunk index and up to
+// STATE_CHUNK_SIZE bytes of the state; every chunk but the last is full.
+// The state hash of a chunked state is the Merkle root over the
+// encrypted chunks so a single chunk can be checked against the hash
+// recorded in the ledger with an inclusion proof.
+//
+// When the state is not chunked, the bytes after the two hashes may be
+// a compressed envelope (see compression.h) rather than the serialized
+// state itself. States of at least STATE_COMPRESSION_MIN_SIZE bytes are
+// compressed when that makes them smaller; either form is accepted on
+// decryption. Chunked states are never compressed since chunk reuse
+// depends on the plaintext lining up with the chunks.
+//
+// A decrypted delta holds the contract id hash, the code hash, the hash
+// of the state it applies to and the hash of the resulting state (each
+// SHA256_DIGEST_LENGTH bytes) followed by the JSON serialization of the
+// binding updates:
+//
+// [ [ "<state path>", "<serialized value>" ], ... ]
+//
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
+static const char CHUNKED_STATE_MAGIC[] = "PDOC";
+static const size_t CHUNKED_STATE_MAGIC_LENGTH = 4;
+
+// the base64 encoded state in a request is decoded, hashed and decrypted
+// this many characters at a time; must be a multiple of 4
+static const size_t STATE_DECODE_SEGMENT_SIZE = 16384;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void AppendUint32(ByteArray& buffer, size_t value)
+{
+    buffer.push_back((value >> 24) & 0xFF);
+    buffer.push_back((value >> 16) & 0xFF);
+    buffer.push_back((value >> 8) & 0xFF);
+    buffer.push_back(value & 0xFF);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static size_t ReadUint32(ByteArray::const_iterator position)
+{
+    return ((size_t)position[0] << 24) | ((size_t)position[1] << 16) |
+           ((size_t)position[2] << 8) | (size_t)position[3];
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// split a chunked encrypted state into its chunks, returns false if the
+// buffer is not a well formed chunked state
+static bool SplitChunkedState(const ByteArray& encrypted_state, std::vector<ByteArray>* chunks)
+{
+    size_t size = encrypted_state.size();
+    if (size < CHUNKED_STATE_MAGIC_LENGTH + 4)
+        return false;
+
+    if (!std::equal(CHUNKED_STATE_MAGIC, CHUNKED_STATE_MAGIC + CHUNKED_STATE_MAGIC_LENGTH,
+            encrypted_state.begin()))
+        return false;
+
+    ByteArray::const_iterator position = encrypted_state.begin() + CHUNKED_STATE_MAGIC_LENGTH;
+    size_t count = ReadUint32(position);
+    position += 4;
+    if (count == 0)
+        return false;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((size_t)(encrypted_state.end() - position) < 4)
+            return false;
+
+        size_t length = ReadUint32(position);
+        position += 4;
+        if ((size_t)(encrypted_state.end() - position) < length)
+            return false;
+
+        if (chunks != NULL)
+            chunks->push_back(ByteArray(position, position + length));
+        position += length;
+    }
+
+    return position == encrypted_state.end();
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// replace a decrypted state held in a compressed envelope by its contents
+static void ExpandState(ByteArray& state)
+{
+    if (!pdo::compression::IsCompressedEnvelope(state.data(), state.size()))
+        return;
+
+    ByteArray expanded;
+    pdo::compression::DecompressEnvelope(state.data(), state.size(), expanded);
+    state.swap(expanded);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// fetch an encrypted state from the eservice block store, returns false
+// if the store does not hold it; the state is copied in bounded chunks so
+// the bridge never stages the whole block on the untrusted stack
+static bool FetchStateBlock(const ByteArray& state_hash, ByteArray& encrypted_state)
+{
+    pdo_err_t presult;
+    ByteArray chunk(STATE_BLOCK_CHUNK_SIZE);
+    size_t block_size = 0;
+
+    encrypted_state.clear();
+    do
+    {
+        size_t offset = encrypted_state.size();
+        size_t chunk_size = 0;
+        size_t total_size = 0;
+
+        sgx_status_t ret = ocall_GetStateBlock(&presult, state_hash.data(), state_hash.size(),
+            offset, chunk.data(), chunk.size(), &chunk_size, &total_size);
+        pdo::error::ThrowSgxError(ret, "failed to fetch the state block");
+
+        // the block must not change between calls and every call must
+        // make progress within the bounds of the block
+        if (offset == 0)
+        {
+            block_size = total_size;
+            encrypted_state.reserve(block_size);
+        }
+
+        if (presult != PDO_SUCCESS || total_size == 0 || total_size != block_size ||
+            chunk_size == 0 || chunk_size > chunk.size() || chunk_size > block_size - offset)
+        {
+            encrypted_state.clear();
+            return false;
+        }
+
+        encrypted_state.insert(encrypted_state.end(), chunk.begin(), chunk.begin() + chunk_size);
+    } while (encrypted_state.size() < block_size);
+
+    return true;
+}
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 ContractState::ContractState(const ByteArray& state_encryption_key_,
     const ByteArray& newstate,
     const ByteArray& id_hash,
     const ByteArray& code_hash)
-    : decrypted_state_(newstate)
 {
-    EncryptState(state_encryption_key_, id_hash, code_hash);
+    EncryptState(state_encryption_key_, newstate, id_hash, code_hash);
+    state_hash_ = ComputeHash();
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ContractState::ContractState(const ByteArray& state_encryption_key_,
+    const ByteArray& newstate,
+    const ByteArray& id_hash,
+    const ByteArray& code_hash,
+    const ContractState& input_state)
+    : chunked_(input_state.chunked_)
+{
+    if (chunked_)
+    {
+        decrypted_state_ = newstate;
+        EncryptChunkedState(state_encryption_key_, id_hash, code_hash, &input_state);
+    }
+    else
+        EncryptState(state_encryption_key_, newstate, id_hash, code_hash);
+
     state_hash_ = ComputeHash();
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool ContractState::IsChunkedState(const ByteArray& encrypted_state)
+{
+    return SplitChunkedState(encrypted_state, NULL);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the hashes are decrypted into a separate buffer so the state is
+// written once, directly into decrypted_state_; the ciphertext is only
+// hashed, it is not kept
 void ContractState::DecryptState(const ByteArray& state_encryption_key_,
     const ByteArray& encrypted_state,
     const ByteArray& id_hash,
     const ByteArray& code_hash)
 {
-    encrypted_state_ = encrypted_state;
+    const size_t header_size = SHA256_DIGEST_LENGTH << 1;
+    uint8_t header[header_size];
+
+    size_t size = pdo::crypto::skenc::DecryptedSize(encrypted_state.size());
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        size < header_size, "invalid encrypted state; state too short");
 
-    decrypted_state_ = pdo::crypto::skenc::DecryptMessage(state_encryption_key_, encrypted_state_);
+    pdo::crypto::skenc::CipherContext context(state_encryption_key_);
+    decrypted_state_.resize(size - header_size);
+    context.Decrypt(encrypted_state.data(), encrypted_state.size(), header, header_size,
+        decrypted_state_.data());
 
-    ByteArray decrypted_id_hash(
-        decrypted_state_.begin(), decrypted_state_.begin() + SHA256_DIGEST_LENGTH);
     pdo::error::ThrowIf<pdo::error::ValueError>(
-        id_hash != decrypted_id_hash,
+        !std::equal(id_hash.begin(), id_hash.end(), header),
         "invalid encrypted state; contract id mismatch");
 
-    ByteArray decrypted_code_hash(decrypted_state_.begin() + SHA256_DIGEST_LENGTH,
-        decrypted_state_.begin() + (SHA256_DIGEST_LENGTH << 1));
     pdo::error::ThrowIf<pdo::error::ValueError>(
-        code_hash != decrypted_code_hash,
+        !std::equal(code_hash.begin(), code_hash.end(), header + SHA256_DIGEST_LENGTH),
         "invalid encrypted state; contract code mismatch");
 
-    decrypted_state_.erase(
-        decrypted_state_.begin(), decrypted_state_.begin() + (SHA256_DIGEST_LENGTH << 1));
+    ExpandState(decrypted_state_);
+    encrypted_state_.clear();
+    state_hash_ = pdo::crypto::ComputeMessageHash(encrypted_state);
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-ByteArray ContractState::EncryptState(
-    const ByteArray& state_encryption_key_, const ByteArray& id_hash, const ByteArray& code_hash)
+// decode, hash and decrypt a base64 encoded state one segment at a time
+// so the full ciphertext is never held in the enclave; returns false,
+// leaving the state untouched, if the state is chunked and must be
+// decoded whole. Decoding stops at the first character that is not
+// base64, the same as base64_decode.
+bool ContractState::DecryptEncodedState(const ByteArray& state_encryption_key_,
+    const char* encoded_state,
+    size_t encoded_size,
+    const ByteArray& id_hash,
+    const ByteArray& code_hash)
 {
-    decrypted_state_.insert(decrypted_state_.begin(), code_hash.begin(), code_hash.end());
-    decrypted_state_.insert(decrypted_state_.begin(), id_hash.begin(), id_hash.end());
-    encrypted_state_ = pdo::crypto::skenc::EncryptMessage(state_encryption_key_, decrypted_state_);
+    const size_t header_size = SHA256_DIGEST_LENGTH << 1;
+    uint8_t header[header_size];
+
+    // the magic is in the first six bytes, that is eight characters
+    if (encoded_size >= 8)
+    {
+        uint8_t magic[BASE64_DECODED_SIZE(8)];
+        if (base64_decode(encoded_state, 8, magic) >= CHUNKED_STATE_MAGIC_LENGTH &&
+            std::equal(CHUNKED_STATE_MAGIC, CHUNKED_STATE_MAGIC + CHUNKED_STATE_MAGIC_LENGTH, magic))
+            return false;
+    }
+
+    pdo::crypto::MessageHash hash;
+    pdo::crypto::skenc::StreamDecryptor decryptor(state_encryption_key_);
+
+    decrypted_state_.clear();
+    decrypted_state_.reserve(encoded_size / 4 * 3);
+
+    // one segment buffer is reused and decoded into directly
+    ByteArray segment(BASE64_DECODED_SIZE(STATE_DECODE_SEGMENT_SIZE));
+    for (size_t offset = 0; offset < encoded_size; offset += STATE_DECODE_SEGMENT_SIZE)
+    {
+        size_t length = std::min(STATE_DECODE_SEGMENT_SIZE, encoded_size - offset);
+        size_t decoded = base64_decode(encoded_state + offset, length, segment.data());
+        hash.Update(segment.data(), decoded);
+
+        const uint8_t* data = segment.data();
+        size_t size = decoded;
+        if (offset == 0)
+        {
+            pdo::error::ThrowIf<pdo::error::ValueError>(
+                size < pdo::crypto::constants::IV_TAG_LEN + header_size,
+                "invalid encrypted state; state too short");
+
+            decryptor.Begin(data);
+            decryptor.Update(data + pdo::crypto::constants::IV_TAG_LEN, header_size, header);
+            data += pdo::crypto::constants::IV_TAG_LEN + header_size;
+            size -= pdo::crypto::constants::IV_TAG_LEN + header_size;
+        }
+
+        size_t position = decrypted_state_.size();
+        decrypted_state_.resize(position + size);
+        decryptor.Update(data, size, decrypted_state_.data() + position);
+
+        // a short segment means decoding stopped, ignore the rest
+        if (decoded < length / 4 * 3)
+            break;
+    }
+
+    decryptor.Finish();
+
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        !std::equal(id_hash.begin(), id_hash.end(), header),
+        "invalid encrypted state; contract id mismatch");
+
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        !std::equal(code_hash.begin(), code_hash.end(), header + SHA256_DIGEST_LENGTH),
+        "invalid encrypted state; contract code mismatch");
+
+    ExpandState(decrypted_state_);
+    chunked_ = false;
+    encrypted_state_.clear();
+    state_hash_ = hash.Finish();
+    return true;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the ciphertext is written straight into encrypted_state_ behind space
+// for the IV and tag, the plaintext is never assembled
+void ContractState::EncryptState(const ByteArray& state_encryption_key_,
+    const ByteArray& newstate,
+    const ByteArray& id_hash,
+    const ByteArray& code_hash)
+{
+    ByteArray envelope;
+    const ByteArray& state =
+        (STATE_COMPRESSION_MIN_SIZE > 0 && newstate.size() >= STATE_COMPRESSION_MIN_SIZE &&
+            pdo::compression::CompressEnvelope(newstate.data(), newstate.size(), envelope))
+            ? envelope
+            : newstate;
+
+    encrypted_state_.resize(
+        pdo::crypto::skenc::EncryptedSize(id_hash.size() + code_hash.size() + state.size()));
 
-    return encrypted_state_;
+    uint8_t* out = encrypted_state_.data() + pdo::crypto::constants::IV_TAG_LEN;
+    pdo::crypto::skenc::StreamEncryptor encryptor(state_encryption_key_);
+    encryptor.Begin(encrypted_state_.data());
+    encryptor.Update(id_hash.data(), id_hash.size(), out);
+    out += id_hash.size();
+    encryptor.Update(code_hash.data(), code_hash.size(), out);
+    out += code_hash.size();
+    encryptor.Update(state.data(), state.size(), out);
+    encryptor.Finish(encrypted_state_.data());
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void ContractState::DecryptChunkedState(const ByteArray& state_encryption_key_,
+    const ByteArray& encrypted_state,
+    const ByteArray& id_hash,
+    const ByteArray& code_hash)
+{
+    const size_t header_size = (SHA256_DIGEST_LENGTH << 1) + 4;
+
+    chunked_ = true;
+    encrypted_state_ = encrypted_state;
+    encrypted_chunks_.clear();
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        !SplitChunkedState(encrypted_state_, &encrypted_chunks_),
+        "invalid encrypted state; malformed chunked state");
+
+    size_t count = encrypted_chunks_.size();
+    decrypted_state_.clear();
+    decrypted_state_.reserve(count * STATE_CHUNK_SIZE);
+
+    pdo::crypto::skenc::CipherContext context(state_encryption_key_);
+    ByteArray header(header_size);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const ByteArray& chunk = encrypted_chunks_[i];
+        size_t chunk_size = pdo::crypto::skenc::DecryptedSize(chunk.size());
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            chunk_size < header_size, "invalid encrypted state; chunk too short");
+
+        // chunk boundaries must be canonical for unchanged chunks to be
+        // recognized when the state is encrypted again
+        size_t length = chunk_size - header_size;
+        bool last = (i + 1 == count);
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            length > STATE_CHUNK_SIZE || (!last && length != STATE_CHUNK_SIZE) ||
+                (last && count > 1 && length == 0),
+            "invalid encrypted state; bad chunk size");
+
+        size_t offset = decrypted_state_.size();
+        decrypted_state_.resize(offset + length);
+        context.Decrypt(chunk.data(), chunk.size(), header.data(), header_size,
+            decrypted_state_.data() + offset);
+
+        ByteArray::const_iterator field = header.begin();
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            !std::equal(id_hash.begin(), id_hash.end(), field),
+            "invalid encrypted state; contract id mismatch");
+        field += SHA256_DIGEST_LENGTH;
+
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            !std::equal(code_hash.begin(), code_hash.end(), field),
+            "invalid encrypted state; contract code mismatch");
+        field += SHA256_DIGEST_LENGTH;
+
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            ReadUint32(field) != i, "invalid encrypted state; chunk out of order");
+    }
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// chunks whose plaintext matches the same chunk of the base state keep
+// the ciphertext of the base state; the chunk index is part of the
+// plaintext so a chunk is never reused at another position
+void ContractState::EncryptChunkedState(const ByteArray& state_encryption_key_,
+    const ByteArray& id_hash,
+    const ByteArray& code_hash,
+    const ContractState* base_state)
+{
+    size_t size = decrypted_state_.size();
+    size_t count = (size == 0) ? 1 : (size + STATE_CHUNK_SIZE - 1) / STATE_CHUNK_SIZE;
+
+    bool reuse = (base_state != NULL && base_state->chunked_);
+    size_t base_count = reuse ? base_state->encrypted_chunks_.size() : 0;
+    size_t base_size = reuse ? base_state->decrypted_state_.size() : 0;
+
+    encrypted_chunks_.clear();
+    encrypted_chunks_.reserve(count);
+
+    pdo::crypto::skenc::CipherContext context(state_encryption_key_);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t offset = i * STATE_CHUNK_SIZE;
+        size_t length = std::min((size_t)STATE_CHUNK_SIZE, size - offset);
+        ByteArray::const_iterator data = decrypted_state_.begin() + offset;
+
+        if (i < base_count && offset <= base_size &&
+            std::min((size_t)STATE_CHUNK_SIZE, base_size - offset) == length &&
+            std::equal(data, data + length, base_state->decrypted_state_.begin() + offset))
+        {
+            encrypted_chunks_.push_back(base_state->encrypted_chunks_[i]);
+            continue;
+        }
+
+        ByteArray chunk(pdo::crypto::constants::IV_TAG_LEN);
+        chunk.reserve(pdo::crypto::skenc::EncryptedSize((SHA256_DIGEST_LENGTH << 1) + 4 + length));
+        chunk.insert(chunk.end(), id_hash.begin(), id_hash.end());
+        chunk.insert(chunk.end(), code_hash.begin(), code_hash.end());
+        AppendUint32(chunk, i);
+        chunk.insert(chunk.end(), data, data + length);
+
+        context.EncryptInPlace(chunk.data(), chunk.size());
+        encrypted_chunks_.push_back(std::move(chunk));
+    }
+
+    size_t packed_size = CHUNKED_STATE_MAGIC_LENGTH + 4;
+    for (size_t i = 0; i < count; i++)
+        packed_size += 4 + encrypted_chunks_[i].size();
+
+    encrypted_state_.clear();
+    encrypted_state_.reserve(packed_size);
+    encrypted_state_.insert(encrypted_state_.end(),
+        CHUNKED_STATE_MAGIC, CHUNKED_STATE_MAGIC + CHUNKED_STATE_MAGIC_LENGTH);
+    AppendUint32(encrypted_state_, count);
+    for (size_t i = 0; i < count; i++)
+    {
+        AppendUint32(encrypted_state_, encrypted_chunks_[i].size());
+        encrypted_state_.insert(
+            encrypted_state_.end(), encrypted_chunks_[i].begin(), encrypted_chunks_[i].end());
+    }
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 ByteArray ContractState::ComputeHash(void) const
 {
     assert(encrypted_state_.size() > 0);
-    return pdo::crypto::ComputeMessageHash(encrypted_state_);
+    if (!chunked_)
+        return pdo::crypto::ComputeMessageHash(encrypted_state_);
+
+    std::vector<ByteArray> leaf_hashes;
+    leaf_hashes.reserve(encrypted_chunks_.size());
+    for (size_t i = 0; i < encrypted_chunks_.size(); i++)
+        leaf_hashes.push_back(pdo::crypto::merkle::ComputeLeafHash(encrypted_chunks_[i]));
+
+    return pdo::crypto::merkle::ComputeRoot(leaf_hashes);
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -110,14 +524,73 @@ void ContractState::Unpack(const ByteArray& state_encryption_key_,
 
     try
     {
+        ByteArray encrypted_state;
+        ByteArray requested_state_hash;
+
+        // the request is parsed in place so the encoded state is decoded
+        // straight from the request buffer
         pvalue = json_object_dotget_string(object, "EncryptedState");
         if (pvalue != NULL && pvalue[0] != '\0')
         {
-            ByteArray decoded_state = base64_decode(pvalue);
-            DecryptState(state_encryption_key_, decoded_state, id_hash, code_hash);
+            size_t encoded_size = strlen(pvalue);
+            if (!DecryptEncodedState(
+                    state_encryption_key_, pvalue, encoded_size, id_hash, code_hash))
+            {
+                encrypted_state.resize(BASE64_DECODED_SIZE(encoded_size));
+                encrypted_state.resize(
+                    base64_decode(pvalue, encoded_size, encrypted_state.data()));
+            }
+        }
+        else if ((pvalue = json_object_dotget_string(object, "StateHash")) != NULL)
+        {
+            requested_state_hash = base64_decode(pvalue);
+            if (!FindCachedContractState(id_hash, code_hash, requested_state_hash, *this))
+                state_cache_miss_ = !FetchStateBlock(requested_state_hash, encrypted_state);
+        }
+        else
+        {
+            chunked_ = (json_object_dotget_boolean(object, "ChunkedState") == 1);
+        }
 
-            state_hash_ = ComputeHash();
+        if (encrypted_state.size() > 0)
+        {
+            if (IsChunkedState(encrypted_state))
+            {
+                DecryptChunkedState(state_encryption_key_, encrypted_state, id_hash, code_hash);
+                state_hash_ = ComputeHash();
+            }
+            else
+                DecryptState(state_encryption_key_, encrypted_state, id_hash, code_hash);
+
+            // the block store is untrusted, it must return the state we asked for
+            pdo::error::ThrowIf<pdo::error::ValueError>(
+                requested_state_hash.size() > 0 && requested_state_hash != state_hash_,
+                "invalid encrypted state; state hash mismatch");
+        }
+
+        JSON_Array* deltas = json_object_dotget_array(object, "EncryptedStateDeltas");
+        if (deltas != NULL && json_array_get_count(deltas) > 0)
+        {
+            pdo::error::ThrowIf<pdo::error::ValueError>(
+                state_hash_.size() == 0,
+                "invalid state delta; no base state");
+
+            size_t count = json_array_get_count(deltas);
+            pdo::error::ThrowIf<pdo::error::ValueError>(
+                count >= STATE_DELTA_CHECKPOINT_INTERVAL,
+                "invalid state delta; chain is too long, full state required");
+
+            for (size_t i = 0; i < count; i++)
+            {
+                pvalue = json_array_get_string(deltas, i);
+                pdo::error::ThrowIfNull(pvalue, "invalid state delta; not a string");
+
+                state_deltas_.push_back(DecryptStateDelta(
+                    state_encryption_key_, base64_decode(pvalue), id_hash, code_hash));
+            }
         }
+
+        emit_state_delta_ = (json_object_dotget_boolean(object, "EmitStateDelta") == 1);
     }
     catch (...)
     {
@@ -125,3 +598,123 @@ void ContractState::Unpack(const ByteArray& state_encryption_key_,
         throw;
     }
 }
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the delta must apply to the current state hash; on success the state
+// hash moves to the hash of the state the delta produces
+StateDelta ContractState::DecryptStateDelta(const ByteArray& state_encryption_key_,
+    const ByteArray& encrypted_delta,
+    const ByteArray& id_hash,
+    const ByteArray& code_hash)
+{
+    ByteArray decrypted_delta =
+        pdo::crypto::skenc::DecryptMessage(state_encryption_key_, encrypted_delta);
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        decrypted_delta.size() < 4 * SHA256_DIGEST_LENGTH,
+        "invalid state delta; too short");
+
+    ByteArray::const_iterator field = decrypted_delta.begin();
+
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        !std::equal(id_hash.begin(), id_hash.end(), field),
+        "invalid state delta; contract id mismatch");
+    field += SHA256_DIGEST_LENGTH;
+
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        !std::equal(code_hash.begin(), code_hash.end(), field),
+        "invalid state delta; contract code mismatch");
+    field += SHA256_DIGEST_LENGTH;
+
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        state_hash_.size() != SHA256_DIGEST_LENGTH ||
+        !std::equal(state_hash_.begin(), state_hash_.end(), field),
+        "invalid state delta; base state mismatch");
+    field += SHA256_DIGEST_LENGTH;
+
+    state_hash_.assign(field, field + SHA256_DIGEST_LENGTH);
+    field += SHA256_DIGEST_LENGTH;
+
+    std::string serialized(field, ByteArray::const_iterator(decrypted_delta.end()));
+    JsonValue parsed(json_parse_string(serialized.c_str()));
+    pdo::error::ThrowIfNull(parsed.value, "invalid state delta; badly formed JSON");
+
+    JSON_Array* updates = json_value_get_array(parsed);
+    pdo::error::ThrowIfNull(updates, "invalid state delta; missing update list");
+
+    StateDelta delta;
+    for (size_t i = 0; i < json_array_get_count(updates); i++)
+    {
+        JSON_Array* update = json_array_get_array(updates, i);
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            update == NULL || json_array_get_count(update) != 2,
+            "invalid state delta; malformed update");
+
+        const char* path = json_array_get_string(update, 0);
+        const char* value = json_array_get_string(update, 1);
+        pdo::error::ThrowIf<pdo::error::ValueError>(
+            path == NULL || value == NULL,
+            "invalid state delta; malformed update");
+
+        delta[path] = value;
+    }
+
+    return delta;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void ContractState::EncryptStateDelta(const ByteArray& state_encryption_key_,
+    const ByteArray& id_hash,
+    const ByteArray& code_hash,
+    const ByteArray& base_state_hash,
+    const StateDelta& delta)
+{
+    JsonValue updates_value(json_value_init_array());
+    pdo::error::ThrowIfNull(updates_value.value, "failed to create the state delta");
+
+    JSON_Array* updates = json_value_get_array(updates_value);
+    pdo::error::ThrowIfNull(updates, "failed to create the state delta");
+
+    JSON_Status jret;
+    StateDelta::const_iterator it;
+    for (it = delta.begin(); it != delta.end(); it++)
+    {
+        JSON_Value* update_value = json_value_init_array();
+        pdo::error::ThrowIfNull(update_value, "failed to create a state delta update");
+
+        JSON_Array* update = json_value_get_array(update_value);
+        jret = json_array_append_string(update, it->first.c_str());
+        pdo::error::ThrowIf<pdo::error::RuntimeError>(
+            jret != JSONSuccess, "failed to serialize the state delta path");
+
+        jret = json_array_append_string(update, it->second.c_str());
+        pdo::error::ThrowIf<pdo::error::RuntimeError>(
+            jret != JSONSuccess, "failed to serialize the state delta value");
+
+        jret = json_array_append_value(updates, update_value);
+        pdo::error::ThrowIf<pdo::error::RuntimeError>(
+            jret != JSONSuccess, "failed to add update to the state delta");
+    }
+
+    size_t serialized_size = json_serialization_size(updates_value);
+    pdo::error::ThrowIf<pdo::error::RuntimeError>(
+        serialized_size == 0, "state delta serialization failed");
+
+    ByteArray plain_delta;
+    plain_delta.reserve(4 * SHA256_DIGEST_LENGTH + serialized_size);
+    plain_delta.insert(plain_delta.end(), id_hash.begin(), id_hash.end());
+    plain_delta.insert(plain_delta.end(), code_hash.begin(), code_hash.end());
+    plain_delta.insert(plain_delta.end(), base_state_hash.begin(), base_state_hash.end());
+    plain_delta.insert(plain_delta.end(), state_hash_.begin(), state_hash_.end());
+
+    size_t offset = plain_delta.size();
+    plain_delta.resize(offset + serialized_size);
+    jret = json_serialize_to_buffer(updates_value,
+        reinterpret_cast<char*>(&plain_delta[offset]), serialized_size);
+    pdo::error::ThrowIf<pdo::error::RuntimeError>(
+        jret != JSONSuccess, "state delta serialization failed");
+
+    // drop the terminating null written by the serializer
+    plain_delta.resize(plain_delta.size() - 1);
+
+    encrypted_state_delta_ = pdo::crypto::skenc::EncryptMessage(state_encryption_key_, plain_delta);
+}
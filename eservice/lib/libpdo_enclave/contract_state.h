@@ -15,11 +15,34 @@
 
 #pragma once
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "crypto.h"
 #include "parson.h"
 
+// length of a chain of a full state and its deltas; a full state is
+// required once a chain would reach this length, so at most
+// STATE_DELTA_CHECKPOINT_INTERVAL - 1 deltas follow a full state
+#define STATE_DELTA_CHECKPOINT_INTERVAL 16
+
+typedef std::map<std::string, std::string> StateDelta;
+
+// size of the plaintext chunks of a chunked state, only the last chunk
+// may be shorter
+#define STATE_CHUNK_SIZE 4096
+
+// largest piece of an encrypted state copied out of the eservice block
+// store by a single ocall
+#define STATE_BLOCK_CHUNK_SIZE (1 << 16)
+
+// states that are not chunked are compressed before encryption when
+// they are at least this large, 0 turns compression off
+#ifndef STATE_COMPRESSION_MIN_SIZE
+#define STATE_COMPRESSION_MIN_SIZE 512
+#endif
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 class ContractState
@@ -30,17 +53,62 @@ protected:
         const ByteArray& id_hash,
         const ByteArray& code_hash);
 
-    ByteArray EncryptState(const ByteArray& state_encryption_key_,
+    bool DecryptEncodedState(const ByteArray& state_encryption_key_,
+        const char* encoded_state,
+        size_t encoded_size,
         const ByteArray& id_hash,
         const ByteArray& code_hash);
 
+    void EncryptState(const ByteArray& state_encryption_key_,
+        const ByteArray& newstate,
+        const ByteArray& id_hash,
+        const ByteArray& code_hash);
+
+    void DecryptChunkedState(const ByteArray& state_encryption_key_,
+        const ByteArray& encrypted_state,
+        const ByteArray& id_hash,
+        const ByteArray& code_hash);
+
+    void EncryptChunkedState(const ByteArray& state_encryption_key_,
+        const ByteArray& id_hash,
+        const ByteArray& code_hash,
+        const ContractState* base_state);
+
     ByteArray ComputeHash(void) const;
 
+    StateDelta DecryptStateDelta(const ByteArray& state_encryption_key_,
+        const ByteArray& encrypted_delta,
+        const ByteArray& id_hash,
+        const ByteArray& code_hash);
+
 public:
+    // a state built from a new plaintext keeps only its ciphertext unless
+    // it is chunked; an unpacked state that is not chunked keeps only its
+    // plaintext since the ciphertext is needed for nothing but the hash
     ByteArray encrypted_state_ = {};
     ByteArray decrypted_state_ = {};
     ByteArray state_hash_ = {};
 
+    // a chunked state encrypts each STATE_CHUNK_SIZE slice of the state
+    // separately and its hash is the Merkle root over the encrypted
+    // chunks; encrypted_chunks_ is emptied once decrypted_state_ no
+    // longer matches the chunks it was decrypted from
+    bool chunked_ = false;
+    std::vector<ByteArray> encrypted_chunks_;
+
+    // deltas that follow the full state in a request, in order; they
+    // must be applied to decrypted_state_ before it is used and
+    // state_hash_ is already the hash of the final state in the chain
+    std::vector<StateDelta> state_deltas_;
+    bool emit_state_delta_ = false;
+
+    // set when the request referenced its state by hash and the state
+    // was not found in the state cache
+    bool state_cache_miss_ = false;
+
+    // delta from the input state to this state when one was requested
+    ByteArray encrypted_state_delta_ = {};
+
     ContractState(void){};
 
     ContractState(const ByteArray& state_encryption_key_,
@@ -48,8 +116,24 @@ public:
         const ByteArray& id_hash,
         const ByteArray& code_hash);
 
+    // use the layout of the input state and, for a chunked state, keep
+    // the ciphertext of every chunk that did not change
+    ContractState(const ByteArray& state_encryption_key_,
+        const ByteArray& newstate,
+        const ByteArray& id_hash,
+        const ByteArray& code_hash,
+        const ContractState& input_state);
+
+    static bool IsChunkedState(const ByteArray& encrypted_state);
+
     void Unpack(const ByteArray& state_encryption_key_,
         const JSON_Object* object,
         const ByteArray& id_hash,
         const ByteArray& code_hash);
+
+    void EncryptStateDelta(const ByteArray& state_encryption_key_,
+        const ByteArray& id_hash,
+        const ByteArray& code_hash,
+        const ByteArray& base_state_hash,
+        const StateDelta& delta);
 };
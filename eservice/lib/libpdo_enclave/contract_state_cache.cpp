@@ -0,0 +1,126 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+#include "contract_state.h"
+#include "contract_state_cache.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the enclave is configured with a single TCS so the cache is only
+// ever accessed from one thread
+class CachedState
+{
+public:
+    std::string key_;
+    ByteArray code_hash_;
+    ByteArray state_hash_;
+    ByteArray decrypted_state_;
+    bool chunked_;
+    std::vector<ByteArray> encrypted_chunks_;
+    size_t size_;
+};
+
+typedef std::list<CachedState> CachedStateList;
+
+static CachedStateList cached_states;
+static std::map<std::string, CachedStateList::iterator> cached_state_index;
+static size_t cached_state_bytes = 0;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static std::string CacheKey(const ByteArray& inContractIdHash, const ByteArray& inStateHash)
+{
+    std::string key(inContractIdHash.begin(), inContractIdHash.end());
+    key.append(inStateHash.begin(), inStateHash.end());
+    return key;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void EvictCachedState(CachedStateList::iterator entry)
+{
+    cached_state_bytes -= entry->size_;
+    cached_state_index.erase(entry->key_);
+    cached_states.erase(entry);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void CacheContractState(const ByteArray& inContractIdHash,
+    const ByteArray& inCodeHash,
+    const ByteArray& inDecryptedState,
+    const ContractState& inContractState)
+{
+    std::string key = CacheKey(inContractIdHash, inContractState.state_hash_);
+
+    std::map<std::string, CachedStateList::iterator>::iterator existing =
+        cached_state_index.find(key);
+    if (existing != cached_state_index.end())
+        EvictCachedState(existing->second);
+
+    size_t size = key.size() + inDecryptedState.size();
+    for (size_t i = 0; i < inContractState.encrypted_chunks_.size(); i++)
+        size += inContractState.encrypted_chunks_[i].size();
+
+    // a state that would displace the whole cache is not worth keeping
+    if (size > STATE_CACHE_MAX_BYTES / 2)
+        return;
+
+    while (cached_state_bytes + size > STATE_CACHE_MAX_BYTES && !cached_states.empty())
+        EvictCachedState(--cached_states.end());
+
+    cached_states.push_front(CachedState());
+
+    CachedState& entry = cached_states.front();
+    entry.key_ = key;
+    entry.code_hash_ = inCodeHash;
+    entry.state_hash_ = inContractState.state_hash_;
+    entry.decrypted_state_ = inDecryptedState;
+    entry.chunked_ = inContractState.chunked_;
+    entry.encrypted_chunks_ = inContractState.encrypted_chunks_;
+    entry.size_ = size;
+
+    cached_state_index[key] = cached_states.begin();
+    cached_state_bytes += size;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool FindCachedContractState(const ByteArray& inContractIdHash,
+    const ByteArray& inCodeHash,
+    const ByteArray& inStateHash,
+    ContractState& outContractState)
+{
+    std::map<std::string, CachedStateList::iterator>::iterator found =
+        cached_state_index.find(CacheKey(inContractIdHash, inStateHash));
+    if (found == cached_state_index.end())
+        return false;
+
+    CachedStateList::iterator entry = found->second;
+    if (entry->code_hash_ != inCodeHash)
+        return false;
+
+    // move the entry to the front of the list
+    cached_states.splice(cached_states.begin(), cached_states, entry);
+
+    outContractState.decrypted_state_ = entry->decrypted_state_;
+    outContractState.state_hash_ = entry->state_hash_;
+    outContractState.chunked_ = entry->chunked_;
+    outContractState.encrypted_chunks_ = entry->encrypted_chunks_;
+
+    return true;
+}
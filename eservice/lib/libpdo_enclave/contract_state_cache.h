@@ -0,0 +1,48 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "types.h"
+
+#include "contract_state.h"
+
+// upper bound on the plaintext (and reusable chunk) bytes held by the
+// state cache; the enclave heap must also fit the interpreter so this
+// is kept well below HeapMaxSize
+#ifndef STATE_CACHE_MAX_BYTES
+#define STATE_CACHE_MAX_BYTES (2 << 20)
+#endif
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// The state cache keeps the decrypted form of states produced by this
+// enclave, keyed by contract id hash and state hash, so that a request for
+// the next update can reference its input state by hash. Only states
+// the enclave encrypted itself are added, so a hit needs neither
+// decryption nor integrity checks. The least recently used entries are
+// evicted once the cache exceeds STATE_CACHE_MAX_BYTES.
+void CacheContractState(const ByteArray& inContractIdHash,
+    const ByteArray& inCodeHash,
+    const ByteArray& inDecryptedState,
+    const ContractState& inContractState);
+
+// on a hit fills in the decrypted state, state hash and layout of
+// outContractState and returns true
+bool FindCachedContractState(const ByteArray& inContractIdHash,
+    const ByteArray& inCodeHash,
+    const ByteArray& inStateHash,
+    ContractState& outContractState);
@@ -0,0 +1,86 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <string>
+
+#include "contract_statistics.h"
+
+// the enclave is configured with a single TCS so the table is only
+// ever accessed from one thread
+static pdo_contract_statistics_t contract_statistics[PDO_CONTRACT_STATISTICS_MAX];
+static size_t contract_statistics_count = 0;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static pdo_contract_statistics_t* FindEntry(const char* name)
+{
+    for (size_t i = 0; i < contract_statistics_count; i++)
+        if (strncmp(contract_statistics[i].name, name, PDO_CONTRACT_NAME_SIZE) == 0)
+            return &contract_statistics[i];
+
+    // keep the last slot for the overflow entry
+    if (contract_statistics_count >= PDO_CONTRACT_STATISTICS_MAX - 1 &&
+        strcmp(name, PDO_CONTRACT_STATISTICS_OTHER) != 0)
+        return FindEntry(PDO_CONTRACT_STATISTICS_OTHER);
+
+    pdo_contract_statistics_t* entry = &contract_statistics[contract_statistics_count++];
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->name, name, PDO_CONTRACT_NAME_SIZE - 1);
+    return entry;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void Accumulate(uint64_t& total, uint64_t& max, uint64_t value)
+{
+    total += value;
+    if (value > max)
+        max = value;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void RecordContractStatistics(const std::string& inContractName,
+    const pdo_interpreter_statistics_t& inStatistics)
+{
+    const char* name = inContractName.c_str();
+    if (inContractName.size() >= PDO_CONTRACT_NAME_SIZE)
+        name = PDO_CONTRACT_STATISTICS_OTHER;
+
+    pdo_contract_statistics_t* entry = FindEntry(name);
+    pdo_interpreter_statistics_t& total = entry->total;
+    pdo_interpreter_statistics_t& max = entry->max;
+
+    entry->requests++;
+    Accumulate(total.eval_steps, max.eval_steps, inStatistics.eval_steps);
+    Accumulate(total.cells_allocated, max.cells_allocated, inStatistics.cells_allocated);
+    Accumulate(total.gc_runs, max.gc_runs, inStatistics.gc_runs);
+    Accumulate(total.state_bytes_read, max.state_bytes_read, inStatistics.state_bytes_read);
+    Accumulate(total.state_bytes_written, max.state_bytes_written, inStatistics.state_bytes_written);
+    Accumulate(total.heap_peak_bytes, max.heap_peak_bytes, inStatistics.heap_peak_bytes);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t GetContractStatistics(pdo_contract_statistics_t* outStatistics,
+    size_t inCount,
+    bool inReset)
+{
+    size_t count = contract_statistics_count < inCount ? contract_statistics_count : inCount;
+    memcpy(outStatistics, contract_statistics, count * sizeof(pdo_contract_statistics_t));
+
+    if (inReset)
+        contract_statistics_count = 0;
+
+    return count;
+}
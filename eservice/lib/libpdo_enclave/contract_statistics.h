@@ -0,0 +1,37 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "request_statistics.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// The interpreter statistics of every successful request are added to
+// the totals for the name of the contract class. The table holds at
+// most PDO_CONTRACT_STATISTICS_MAX names; once it is full, requests for
+// other contracts go to a single entry named
+// PDO_CONTRACT_STATISTICS_OTHER, as do names too long for the table.
+
+// add the statistics of one request to the totals for inContractName
+void RecordContractStatistics(const std::string& inContractName,
+    const pdo_interpreter_statistics_t& inStatistics);
+
+// copy out up to inCount entries and return the number copied,
+// optionally clearing the table
+size_t GetContractStatistics(pdo_contract_statistics_t* outStatistics,
+    size_t inCount,
+    bool inReset);
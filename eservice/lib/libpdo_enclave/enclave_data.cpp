@@ -20,11 +20,13 @@
 #include <string>
 #include <vector>
 
+#include "base64.h"
 #include "crypto.h"
 #include "error.h"
 #include "pdo_error.h"
 #include "zero.h"
 
+#include "json_writer.h"
 #include "jsonvalue.h"
 #include "parson.h"
 
@@ -43,13 +45,21 @@ EnclaveData::EnclaveData(void)
     // create the public encryption key
     public_encryption_key_ = private_encryption_key_.GetPublicKey();
 
+    // create the public key agreement key and bind it to the signing key
+    public_agreement_key_ = private_agreement_key_.GetPublicKey();
+    std::string serialized_agreement_key = public_agreement_key_.Serialize();
+    ByteArray agreement_key_signature = private_signing_key_.SignMessage(
+        ByteArray(serialized_agreement_key.begin(), serialized_agreement_key.end()));
+    agreement_key_signature_ = base64_encode(agreement_key_signature);
+    has_agreement_key_ = true;
+
     SerializePrivateData();
     SerializePublicData();
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-EnclaveData::EnclaveData(const uint8_t* inSealedData)
+EnclaveData::EnclaveData(const uint8_t* inSealedData) : has_agreement_key_(false)
 {
     pdo::error::ThrowIfNull(inSealedData, "Sealed sign up data pointer is NULL");
 
@@ -118,115 +128,127 @@ void EnclaveData::DeserializeSealedData(const std::string& inSerializedEnclaveDa
 
     svalue.assign(pvalue);
     private_encryption_key_.Deserialize(svalue);
+
+    // key agreement key, missing from enclave data sealed before it was added
+    pvalue = json_object_dotget_string(keystore_object, "AgreementKey.PrivateKey");
+    if (pvalue == nullptr)
+        return;
+
+    svalue.assign(pvalue);
+    private_agreement_key_.Deserialize(svalue);
+
+    pvalue = json_object_dotget_string(keystore_object, "AgreementKey.PublicKey");
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        !pvalue, "Failed to retrieve public agreement key from the key store");
+
+    svalue.assign(pvalue);
+    public_agreement_key_.Deserialize(svalue);
+
+    pvalue = json_object_dotget_string(keystore_object, "AgreementKey.Signature");
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        !pvalue, "Failed to retrieve agreement key signature from the key store");
+
+    agreement_key_signature_.assign(pvalue);
+    has_agreement_key_ = true;
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 void EnclaveData::SerializePrivateData(void)
 {
-    JSON_Status jret;
-
-    // Create serialized wait certificate
-    JsonValue dataValue(json_value_init_object());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        !dataValue.value, "Failed to create enclave data serialization object");
-
-    JSON_Object* dataObject = json_value_get_object(dataValue);
-    pdo::error::ThrowIfNull(dataObject, "Failed to retrieve serialization object");
-
     // private signing key
     std::string b64_private_signing_key = private_signing_key_.Serialize();
     pdo::error::ThrowIf<pdo::error::RuntimeError>(
         b64_private_signing_key.empty(), "failed to serialize the private signing key");
 
-    jret = json_object_dotset_string(
-        dataObject, "SigningKey.PrivateKey", b64_private_signing_key.c_str());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed on private signing key");
-
     // public signing key
     std::string b64_public_signing_key = public_signing_key_.Serialize();
     pdo::error::ThrowIf<pdo::error::RuntimeError>(
         b64_public_signing_key.empty(), "failed to serialize the public signing key");
 
-    jret = json_object_dotset_string(
-        dataObject, "SigningKey.PublicKey", b64_public_signing_key.c_str());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed on public signing key");
-
     // private encryption key
     std::string b64_private_encryption_key = private_encryption_key_.Serialize();
     pdo::error::ThrowIf<pdo::error::RuntimeError>(
         b64_private_encryption_key.empty(), "failed to serialize the private encryption key");
 
-    jret = json_object_dotset_string(
-        dataObject, "EncryptionKey.PrivateKey", b64_private_encryption_key.c_str());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed on private encryption key");
-
     // public encryption key
     std::string b64_public_encryption_key = public_encryption_key_.Serialize();
     pdo::error::ThrowIf<pdo::error::RuntimeError>(
         b64_public_encryption_key.empty(), "failed to serialize the public encryption key");
 
-    jret = json_object_dotset_string(
-        dataObject, "EncryptionKey.PublicKey", b64_public_encryption_key.c_str());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed on public encryption key");
-
-    size_t serializedSize = json_serialization_size(dataValue);
-
-    std::vector<char> serialized_buffer;
-    serialized_buffer.resize(serializedSize + 1);
-
-    jret = json_serialize_to_buffer(dataValue, &serialized_buffer[0], serializedSize);
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed");
-
-    serialized_private_data_.assign(&serialized_buffer[0]);
+    // the keys are written straight into the serialized data without an
+    // intermediate copy of each in a json object
+    ByteArray serialized;
+    JsonWriter writer(serialized, 4096);
+    writer.BeginObject();
+
+    writer.Key("SigningKey");
+    writer.BeginObject();
+    writer.Key("PrivateKey");
+    writer.String(b64_private_signing_key);
+    writer.Key("PublicKey");
+    writer.String(b64_public_signing_key);
+    writer.EndObject();
+
+    writer.Key("EncryptionKey");
+    writer.BeginObject();
+    writer.Key("PrivateKey");
+    writer.String(b64_private_encryption_key);
+    writer.Key("PublicKey");
+    writer.String(b64_public_encryption_key);
+    writer.EndObject();
+
+    if (has_agreement_key_)
+    {
+        writer.Key("AgreementKey");
+        writer.BeginObject();
+        writer.Key("PrivateKey");
+        writer.String(private_agreement_key_.Serialize());
+        writer.Key("PublicKey");
+        writer.String(public_agreement_key_.Serialize());
+        writer.Key("Signature");
+        writer.String(agreement_key_signature_);
+        writer.EndObject();
+    }
+
+    writer.EndObject();
+
+    serialized_private_data_.assign(serialized.begin(), serialized.end());
+    ZeroV(serialized);
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 void EnclaveData::SerializePublicData(void)
 {
-    JSON_Status jret;
-
-    // Create serialized wait certificate
-    JsonValue dataValue(json_value_init_object());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        !dataValue.value, "Failed to create enclave data serialization object");
-
-    JSON_Object* dataObject = json_value_get_object(dataValue);
-    pdo::error::ThrowIfNull(dataObject, "Failed to retrieve serialization object");
-
     // public signing key
     std::string b64_public_signing_key = public_signing_key_.Serialize();
     pdo::error::ThrowIf<pdo::error::RuntimeError>(
         b64_public_signing_key.empty(), "failed to serialize the public signing key");
 
-    jret = json_object_dotset_string(dataObject, "VerifyingKey", b64_public_signing_key.c_str());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed on public signing key");
-
     // public encryption key
     std::string b64_public_encryption_key = public_encryption_key_.Serialize();
     pdo::error::ThrowIf<pdo::error::RuntimeError>(
         b64_public_encryption_key.empty(), "failed to serialize the public encryption key");
 
-    jret =
-        json_object_dotset_string(dataObject, "EncryptionKey", b64_public_encryption_key.c_str());
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed on public encryption key");
+    ByteArray serialized;
+    JsonWriter writer(serialized, 2048);
+    writer.BeginObject();
 
-    size_t serializedSize = json_serialization_size(dataValue);
+    writer.Key("VerifyingKey");
+    writer.String(b64_public_signing_key);
+    writer.Key("EncryptionKey");
+    writer.String(b64_public_encryption_key);
 
-    std::vector<char> serialized_buffer;
-    serialized_buffer.resize(serializedSize + 1);
+    if (has_agreement_key_)
+    {
+        writer.Key("AgreementKey");
+        writer.String(public_agreement_key_.Serialize());
+        writer.Key("AgreementKeySignature");
+        writer.String(agreement_key_signature_);
+    }
 
-    jret = json_serialize_to_buffer(dataValue, &serialized_buffer[0], serializedSize);
-    pdo::error::ThrowIf<pdo::error::RuntimeError>(
-        jret != JSONSuccess, "enclave data serialization failed");
+    writer.EndObject();
 
-    serialized_public_data_.assign(&serialized_buffer[0]);
+    serialized_public_data_.assign(serialized.begin(), serialized.end());
 }
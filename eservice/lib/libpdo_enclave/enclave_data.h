@@ -22,6 +22,7 @@
 #include <string>
 
 #include "crypto.h"
+#include "error.h"
 
 // JSON format for private data:
 // {
@@ -35,14 +36,28 @@
 //     {
 //         "PublicKey" : "",
 //         "PrivateKey" : "",
+//     },
+//
+//     "AgreementKey" :
+//     {
+//         "PublicKey" : "",
+//         "PrivateKey" : "",
+//         "Signature" : ""
 //     }
 // }
 //
 // JSON format for public data
 // {
-//     "SigningKey" : "",
-//     "EncryptionKey" : ""
+//     "VerifyingKey" : "",
+//     "EncryptionKey" : "",
+//     "AgreementKey" : "",
+//     "AgreementKeySignature" : ""
 // }
+//
+// The agreement key is not part of the attested report data; it is
+// signed with the signing key when it is created and the signature is
+// sealed with it. Enclave data sealed before the agreement key was
+// added has none and publishes neither field.
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 class EnclaveData
@@ -57,6 +72,10 @@ protected:
     pdo::crypto::sig::PrivateKey private_signing_key_;
     pdo::crypto::pkenc::PublicKey public_encryption_key_;
     pdo::crypto::pkenc::PrivateKey private_encryption_key_;
+    pdo::crypto::ecdh::PublicKey public_agreement_key_;
+    pdo::crypto::ecdh::PrivateKey private_agreement_key_;
+    std::string agreement_key_signature_;
+    bool has_agreement_key_;
 
     std::string serialized_private_data_;
     std::string serialized_public_data_;
@@ -81,6 +100,20 @@ public:
         return private_encryption_key_.DecryptMessage(cipher);
     };
 
+    // session keys arrive either as an ECDH envelope for the agreement
+    // key or as an RSA-OAEP ciphertext for the encryption key
+    ByteArray decrypt_session_key(const ByteArray& cipher) const
+    {
+        if (pdo::crypto::ecdh::IsEnvelope(cipher))
+        {
+            pdo::error::ThrowIf<pdo::error::ValueError>(
+                !has_agreement_key_, "enclave has no key agreement key");
+            return private_agreement_key_.DecryptMessage(cipher);
+        }
+
+        return private_encryption_key_.DecryptMessage(cipher);
+    };
+
     ByteArray sign_message(const ByteArray& message) const
     {
         return private_signing_key_.SignMessage(message);
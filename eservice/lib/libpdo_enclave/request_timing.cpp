@@ -0,0 +1,100 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "enclave_t.h"
+
+#include "error.h"
+#include "pdo_error.h"
+
+#include "request_timing.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+class RequestPhaseTimer : public pdo::contracts::PhaseObserver
+{
+public:
+    void phase_complete(pdo_request_phase_t phase) { MarkRequestPhase(phase); }
+};
+
+// the enclave is configured with a single TCS so the timing state is
+// only ever accessed from one thread
+static pdo_request_statistics_t totals;
+static uint64_t request_elapsed[PDO_PHASE_COUNT];
+static bool request_marked[PDO_PHASE_COUNT];
+static uint64_t last_mark = 0;
+static RequestPhaseTimer phase_timer;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static uint64_t Now(void)
+{
+    uint64_t timestamp = 0;
+    if (ocall_GetTimestamp(&timestamp) != SGX_SUCCESS)
+        return last_mark;
+    return timestamp;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void BeginRequestTiming(void)
+{
+    memset(request_elapsed, 0, sizeof(request_elapsed));
+    memset(request_marked, 0, sizeof(request_marked));
+    last_mark = Now();
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the untrusted clock may go backwards, such an interval counts as zero
+void MarkRequestPhase(pdo_request_phase_t inPhase)
+{
+    uint64_t now = Now();
+    if (inPhase >= 0 && inPhase < PDO_PHASE_COUNT)
+    {
+        request_elapsed[inPhase] += (now > last_mark ? now - last_mark : 0);
+        request_marked[inPhase] = true;
+    }
+    last_mark = now;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void EndRequestTiming(void)
+{
+    for (int i = 0; i < PDO_PHASE_COUNT; i++)
+    {
+        if (!request_marked[i])
+            continue;
+
+        pdo_phase_statistics_t& phase = totals.phases[i];
+        phase.count++;
+        phase.total_ns += request_elapsed[i];
+        if (request_elapsed[i] > phase.max_ns)
+            phase.max_ns = request_elapsed[i];
+    }
+
+    memset(request_marked, 0, sizeof(request_marked));
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo::contracts::PhaseObserver* RequestPhaseObserver(void)
+{
+    return &phase_timer;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void GetRequestStatistics(pdo_request_statistics_t& outStatistics, bool inReset)
+{
+    outStatistics = totals;
+    if (inReset)
+        memset(&totals, 0, sizeof(totals));
+}
@@ -0,0 +1,45 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "request_statistics.h"
+#include "interpreter/ContractInterpreter.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Requests are timed a phase at a time: each mark charges the time
+// since the previous mark to the phase that just completed. The enclave
+// has no trusted clock so timestamps come from the untrusted side with
+// one ocall per mark; the figures are only as good as that clock and
+// are meant for profiling, nothing depends on them.
+//
+// The timing of a request is kept apart until EndRequestTiming adds it
+// to the totals, so a request that throws out of the enclave is simply
+// dropped by the next BeginRequestTiming.
+
+// start timing a request from now
+void BeginRequestTiming(void);
+
+// charge the time since the last mark to phase
+void MarkRequestPhase(pdo_request_phase_t inPhase);
+
+// add the phases marked since BeginRequestTiming to the totals
+void EndRequestTiming(void);
+
+// observer that marks the phases reported by an interpreter
+pdo::contracts::PhaseObserver* RequestPhaseObserver(void);
+
+// copy out the totals, optionally clearing them
+void GetRequestStatistics(pdo_request_statistics_t& outStatistics, bool inReset);
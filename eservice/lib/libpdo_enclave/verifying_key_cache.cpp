@@ -0,0 +1,80 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "crypto.h"
+#include "types.h"
+
+#include "verifying_key_cache.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the enclave is configured with a single TCS so the cache is only
+// ever accessed from one thread
+class CachedVerifyingKey
+{
+public:
+    std::string serialized_key_;
+    pdo::crypto::sig::PublicKey verifying_key_;
+
+    CachedVerifyingKey(const std::string& serialized_key,
+        pdo::crypto::sig::PublicKey&& verifying_key)
+        : serialized_key_(serialized_key), verifying_key_(std::move(verifying_key))
+    {
+    }
+};
+
+typedef std::list<CachedVerifyingKey> CachedVerifyingKeyList;
+
+static CachedVerifyingKeyList cached_keys;
+static std::map<std::string, CachedVerifyingKeyList::iterator> cached_key_index;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static const pdo::crypto::sig::PublicKey& GetVerifyingKey(const std::string& inSerializedKey)
+{
+    std::map<std::string, CachedVerifyingKeyList::iterator>::iterator found =
+        cached_key_index.find(inSerializedKey);
+    if (found != cached_key_index.end())
+    {
+        // move the entry to the front of the list
+        cached_keys.splice(cached_keys.begin(), cached_keys, found->second);
+        return found->second->verifying_key_;
+    }
+
+    // parse before touching the cache so a bad key leaves it unchanged
+    pdo::crypto::sig::PublicKey verifying_key(inSerializedKey);
+
+    while (cached_keys.size() >= VERIFYING_KEY_CACHE_SIZE)
+    {
+        cached_key_index.erase(cached_keys.back().serialized_key_);
+        cached_keys.pop_back();
+    }
+
+    cached_keys.emplace_front(inSerializedKey, std::move(verifying_key));
+    cached_key_index[inSerializedKey] = cached_keys.begin();
+
+    return cached_keys.front().verifying_key_;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+int VerifyWithCachedKey(const std::string& inSerializedKey,
+    const ByteArray& inMessage,
+    const ByteArray& inSignature)
+{
+    return GetVerifyingKey(inSerializedKey).VerifySignature(inMessage, inSignature);
+}
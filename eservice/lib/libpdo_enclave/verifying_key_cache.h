@@ -0,0 +1,37 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "crypto.h"
+#include "types.h"
+
+// number of parsed verifying keys kept by the enclave; requests come
+// from a small set of long-lived originator and provisioning service
+// keys so a few dozen entries cover the working set
+#ifndef VERIFYING_KEY_CACHE_SIZE
+#define VERIFYING_KEY_CACHE_SIZE 32
+#endif
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Verify a signature with a PEM encoded verifying key, reusing the
+// parsed key when the same serialized key was seen recently. Returns
+// the result of PublicKey::VerifySignature; throws ValueError if the
+// key cannot be deserialized.
+int VerifyWithCachedKey(const std::string& inSerializedKey,
+    const ByteArray& inMessage,
+    const ByteArray& inSignature);
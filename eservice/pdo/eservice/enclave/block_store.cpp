@@ -0,0 +1,52 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include "error.h"
+#include "types.h"
+
+#include "block_store.h"
+
+#include "enclave/block_store.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void block_store_initialize(
+    const std::string& directory,
+    size_t max_bytes
+    )
+{
+    pdo::enclave_api::block_store::Initialize(directory, max_bytes);
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool block_store_contains(
+    const std::string& state_hash
+    )
+{
+    return pdo::enclave_api::block_store::Contains(
+        Base64EncodedStringToByteArray(state_hash));
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void block_store_put(
+    const std::string& state_hash,
+    const ByteArray& encrypted_state
+    )
+{
+    pdo::enclave_api::block_store::Put(
+        Base64EncodedStringToByteArray(state_hash),
+        encrypted_state);
+}
@@ -14,8 +14,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "error.h"
 #include "pdo_error.h"
@@ -55,10 +57,10 @@ std::map<std::string, std::string> contract_verify_secrets(
 }
 
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-std::string contract_handle_contract_request(
+ByteArray contract_handle_contract_request(
     const std::string& sealed_signup_data,
-    const std::string& encrypted_session_key,
-    const std::string& serialized_request
+    const ByteArray& encrypted_session_key,
+    const ByteArray& serialized_request
     )
 {
     pdo_err_t presult;
@@ -74,7 +76,7 @@ std::string contract_handle_contract_request(
         response_size);
     ThrowPDOError(presult);
 
-    Base64EncodedString response;
+    ByteArray response;
     presult = pdo::enclave_api::contract::GetSerializedResponse(
         sealed_signup_data,
         response_identifier,
@@ -84,3 +86,135 @@ std::string contract_handle_contract_request(
 
     return response;
 }
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray contract_create_session(
+    const std::string& sealed_signup_data,
+    const ByteArray& encrypted_session_key
+    )
+{
+    ByteArray session_id;
+
+    pdo_err_t presult = pdo::enclave_api::contract::CreateSession(
+        sealed_signup_data,
+        encrypted_session_key,
+        session_id);
+    ThrowPDOError(presult);
+
+    return session_id;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray contract_handle_session_request(
+    const std::string& sealed_signup_data,
+    const ByteArray& session_id,
+    const ByteArray& serialized_request
+    )
+{
+    pdo_err_t presult;
+
+    uint32_t response_identifier;
+    size_t response_size;
+
+    presult = pdo::enclave_api::contract::HandleSessionRequest(
+        sealed_signup_data,
+        session_id,
+        serialized_request,
+        response_identifier,
+        response_size);
+    ThrowPDOError(presult);
+
+    ByteArray response;
+    presult = pdo::enclave_api::contract::GetSerializedResponse(
+        sealed_signup_data,
+        response_identifier,
+        response_size,
+        response);
+    ThrowPDOError(presult);
+
+    return response;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray contract_handle_contract_request_batch(
+    const std::string& sealed_signup_data,
+    const ByteArray& serialized_batch
+    )
+{
+    pdo_err_t presult;
+
+    uint32_t response_identifier;
+    size_t response_size;
+
+    presult = pdo::enclave_api::contract::HandleContractRequestBatch(
+        sealed_signup_data,
+        serialized_batch,
+        response_identifier,
+        response_size);
+    ThrowPDOError(presult);
+
+    ByteArray response;
+    presult = pdo::enclave_api::contract::GetSerializedResponse(
+        sealed_signup_data,
+        response_identifier,
+        response_size,
+        response);
+    ThrowPDOError(presult);
+
+    return response;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+std::map<std::string, uint64_t> contract_request_statistics(
+    bool reset
+    )
+{
+    pdo_request_statistics_t statistics;
+    pdo_err_t presult = pdo::enclave_api::contract::GetRequestStatistics(reset, statistics);
+    ThrowPDOError(presult);
+
+    std::map<std::string, uint64_t> result;
+    for (int i = 0; i < PDO_PHASE_COUNT; i++)
+    {
+        std::string name(pdo_request_phase_name(i));
+        result[name + "_count"] = statistics.phases[i].count;
+        result[name + "_total_ns"] = statistics.phases[i].total_ns;
+        result[name + "_max_ns"] = statistics.phases[i].max_ns;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+std::map<std::string, uint64_t> contract_interpreter_statistics(
+    bool reset
+    )
+{
+    std::vector<pdo_contract_statistics_t> statistics;
+    pdo_err_t presult = pdo::enclave_api::contract::GetContractStatistics(reset, statistics);
+    ThrowPDOError(presult);
+
+    std::map<std::string, uint64_t> result;
+    for (size_t i = 0; i < statistics.size(); i++)
+    {
+        const pdo_contract_statistics_t& entry = statistics[i];
+        std::string prefix(entry.name, strnlen(entry.name, PDO_CONTRACT_NAME_SIZE));
+        prefix.append("/");
+
+        result[prefix + "requests"] = entry.requests;
+        result[prefix + "eval_steps_total"] = entry.total.eval_steps;
+        result[prefix + "eval_steps_max"] = entry.max.eval_steps;
+        result[prefix + "cells_allocated_total"] = entry.total.cells_allocated;
+        result[prefix + "cells_allocated_max"] = entry.max.cells_allocated;
+        result[prefix + "gc_runs_total"] = entry.total.gc_runs;
+        result[prefix + "gc_runs_max"] = entry.max.gc_runs;
+        result[prefix + "state_bytes_read_total"] = entry.total.state_bytes_read;
+        result[prefix + "state_bytes_read_max"] = entry.max.state_bytes_read;
+        result[prefix + "state_bytes_written_total"] = entry.total.state_bytes_written;
+        result[prefix + "state_bytes_written_max"] = entry.max.state_bytes_written;
+        result[prefix + "heap_peak_bytes_total"] = entry.total.heap_peak_bytes;
+        result[prefix + "heap_peak_bytes_max"] = entry.max.heap_peak_bytes;
+    }
+
+    return result;
+}
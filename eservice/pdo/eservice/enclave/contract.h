@@ -13,9 +13,12 @@
  * limitations under the License.
  */
 
+#include <stdint.h>
 #include <string>
 #include <map>
 
+#include "types.h"
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 std::map<std::string, std::string> contract_verify_secrets(
     const std::string& sealedSignupData, /* base64 encoded string */
@@ -23,9 +26,50 @@ std::map<std::string, std::string> contract_verify_secrets(
     const std::string& contractCreatorId, /* contract creators verifying key */
     const std::string& serializedSecretList); /* json */
 
+// Session keys, session ids, requests and responses are raw bytes as
+// they appear on the binary wire; the JSON wire format base64 encodes
+// them in the service, not here.
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray contract_handle_contract_request(
+    const std::string& sealedSignupData,
+    const ByteArray& encryptedSessionKey,
+    const ByteArray& serializedRequest
+    );
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+ByteArray contract_create_session(
+    const std::string& sealedSignupData,
+    const ByteArray& encryptedSessionKey
+    );
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
-std::string contract_handle_contract_request(
+ByteArray contract_handle_session_request(
     const std::string& sealedSignupData,
-    const std::string& encryptedSessionKey,
-    const std::string& serializedRequest
+    const ByteArray& sessionId,
+    const ByteArray& serializedRequest
+    );
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the batch is a cbor array of [encrypted session key, encrypted
+// request] pairs; returns a cbor array of encrypted responses
+ByteArray contract_handle_contract_request_batch(
+    const std::string& sealedSignupData,
+    const ByteArray& serializedBatch /* cbor */
+    );
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// per phase request timing totals from the enclave, keyed by
+// "<phase>_count", "<phase>_total_ns" and "<phase>_max_ns"; the totals
+// are cleared when reset is true
+std::map<std::string, uint64_t> contract_request_statistics(
+    bool reset
+    );
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// interpreter totals per contract name from the enclave, keyed by
+// "<name>/requests" and "<name>/<counter>_total" and "<name>/<counter>_max"
+// for each counter; the totals are cleared when reset is true
+std::map<std::string, uint64_t> contract_interpreter_statistics(
+    bool reset
     );
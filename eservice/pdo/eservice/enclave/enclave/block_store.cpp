@@ -0,0 +1,258 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <fstream>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "error.h"
+#include "hex_string.h"
+#include "log.h"
+#include "types.h"
+
+#include "enclave/block_store.h"
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// the store is used from the service thread and from ocalls made on
+// that same thread, so no locking is needed
+typedef std::list<std::pair<std::string, size_t> > BlockList;
+
+static std::string g_BlockDirectory;
+static size_t g_BlockMaxBytes = 0;
+static size_t g_BlockBytes = 0;
+static BlockList g_Blocks;
+static std::map<std::string, BlockList::iterator> g_BlockIndex;
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XX Internal helper functions                                      XX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static std::string BlockName(
+    const ByteArray& inStateHash
+    )
+{
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        inStateHash.empty(), "invalid state hash");
+    return ByteArrayToHexEncodedString(inStateHash);
+} // BlockName
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static std::string BlockPath(
+    const std::string& inName
+    )
+{
+    return g_BlockDirectory + "/" + inName;
+} // BlockPath
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void RemoveLeastRecentlyUsed(void)
+{
+    const std::string& name = g_Blocks.back().first;
+    if (remove(BlockPath(name).c_str()) != 0)
+        pdo::Log(PDO_LOG_WARNING, "failed to remove state block %s", name.c_str());
+
+    g_BlockBytes -= g_Blocks.back().second;
+    g_BlockIndex.erase(name);
+    g_Blocks.pop_back();
+} // RemoveLeastRecentlyUsed
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+static void AddBlock(
+    const std::string& inName,
+    size_t inSize
+    )
+{
+    g_Blocks.push_front(std::make_pair(inName, inSize));
+    g_BlockIndex[inName] = g_Blocks.begin();
+    g_BlockBytes += inSize;
+
+    // never remove the block just added
+    while (g_BlockBytes > g_BlockMaxBytes && g_Blocks.size() > 1)
+        RemoveLeastRecentlyUsed();
+} // AddBlock
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// open a block for reading and mark it as the most recently used
+static bool OpenBlock(
+    const std::string& inName,
+    std::ifstream& outInput,
+    size_t& outSize
+    )
+{
+    std::map<std::string, BlockList::iterator>::iterator found = g_BlockIndex.find(inName);
+    if (found == g_BlockIndex.end())
+        return false;
+
+    outInput.open(BlockPath(inName).c_str(), std::ios::in | std::ios::binary);
+    if (!outInput.good())
+    {
+        // the file was removed behind our back, forget about it
+        g_BlockBytes -= found->second->second;
+        g_Blocks.erase(found->second);
+        g_BlockIndex.erase(found);
+        return false;
+    }
+
+    outSize = found->second->second;
+
+    // keep the file times in step so the order survives a restart
+    utime(BlockPath(inName).c_str(), NULL);
+
+    g_Blocks.splice(g_Blocks.begin(), g_Blocks, found->second);
+    return true;
+} // OpenBlock
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// XX External interface                                             XX
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void pdo::enclave_api::block_store::Initialize(
+    const std::string& inDirectory,
+    size_t inMaxBytes
+    )
+{
+    pdo::error::ThrowIf<pdo::error::ValueError>(
+        inDirectory.empty(), "block store directory must be specified");
+
+    if (mkdir(inDirectory.c_str(), 0700) != 0 && errno != EEXIST)
+        throw pdo::error::IOError("unable to create the block store directory");
+
+    g_BlockDirectory = inDirectory;
+    g_BlockMaxBytes = inMaxBytes;
+    g_BlockBytes = 0;
+    g_Blocks.clear();
+    g_BlockIndex.clear();
+
+    // blocks left by an earlier run are ordered by modification time
+    DIR* directory = opendir(inDirectory.c_str());
+    if (directory == NULL)
+        throw pdo::error::IOError("unable to open the block store directory");
+
+    std::vector<std::pair<time_t, std::pair<std::string, size_t> > > existing;
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        // skip dot files and temporary files from an interrupted write
+        std::string name(entry->d_name);
+        if (name.find('.') != std::string::npos)
+            continue;
+
+        struct stat info;
+        if (stat(BlockPath(name).c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            continue;
+
+        existing.push_back(std::make_pair(info.st_mtime, std::make_pair(name, info.st_size)));
+    }
+    closedir(directory);
+
+    std::sort(existing.begin(), existing.end());
+    for (size_t i = 0; i < existing.size(); i++)
+        AddBlock(existing[i].second.first, existing[i].second.second);
+
+    pdo::Log(PDO_LOG_INFO, "block store %s holds %zu blocks",
+        inDirectory.c_str(), g_Blocks.size());
+} // pdo::enclave_api::block_store::Initialize
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool pdo::enclave_api::block_store::Contains(
+    const ByteArray& inStateHash
+    )
+{
+    return g_BlockIndex.find(BlockName(inStateHash)) != g_BlockIndex.end();
+} // pdo::enclave_api::block_store::Contains
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+void pdo::enclave_api::block_store::Put(
+    const ByteArray& inStateHash,
+    const ByteArray& inBlock
+    )
+{
+    pdo::error::ThrowIf<pdo::error::RuntimeError>(
+        g_BlockDirectory.empty(), "block store is not initialized");
+
+    std::string name = BlockName(inStateHash);
+    if (g_BlockIndex.find(name) != g_BlockIndex.end())
+        return;
+
+    // write to a temporary file so a partial block is never visible
+    std::string path = BlockPath(name);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream output(temporary.c_str(), std::ios::out | std::ios::binary);
+        pdo::error::ThrowIf<pdo::error::IOError>(
+            !output.good(), "unable to create state block");
+
+        output.write((const char*)inBlock.data(), inBlock.size());
+        pdo::error::ThrowIf<pdo::error::IOError>(
+            !output.good(), "unable to write state block");
+    }
+
+    pdo::error::ThrowIf<pdo::error::IOError>(
+        rename(temporary.c_str(), path.c_str()) != 0, "unable to save state block");
+
+    AddBlock(name, inBlock.size());
+} // pdo::enclave_api::block_store::Put
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool pdo::enclave_api::block_store::Get(
+    const ByteArray& inStateHash,
+    ByteArray& outBlock
+    )
+{
+    std::ifstream input;
+    size_t size;
+    if (!OpenBlock(BlockName(inStateHash), input, size))
+        return false;
+
+    outBlock.resize(size);
+    input.read((char*)outBlock.data(), outBlock.size());
+    return (size_t)input.gcount() == outBlock.size();
+} // pdo::enclave_api::block_store::Get
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+bool pdo::enclave_api::block_store::GetRange(
+    const ByteArray& inStateHash,
+    size_t inOffset,
+    size_t inLength,
+    ByteArray& outChunk,
+    size_t& outBlockSize
+    )
+{
+    std::ifstream input;
+    size_t size;
+    if (!OpenBlock(BlockName(inStateHash), input, size) || inOffset > size)
+        return false;
+
+    outChunk.resize(std::min(inLength, size - inOffset));
+    input.seekg(inOffset);
+    input.read((char*)outChunk.data(), outChunk.size());
+    if ((size_t)input.gcount() != outChunk.size())
+        return false;
+
+    outBlockSize = size;
+    return true;
+} // pdo::enclave_api::block_store::GetRange
@@ -0,0 +1,84 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdlib.h>
+#include <string>
+
+#include "types.h"
+
+namespace pdo
+{
+    namespace enclave_api
+    {
+        namespace block_store
+        {
+            /*
+              The block store keeps encrypted contract states as files
+              named by their state hash so that requests only need to
+              carry the hash; the enclave fetches the state through an
+              ocall. The least recently used blocks are removed once
+              the store grows beyond its size limit.
+
+              inDirectory - directory that holds the blocks, created if
+              it does not exist; blocks already there are kept
+              inMaxBytes - upper bound on the total size of the blocks
+            */
+            void Initialize(
+                const std::string& inDirectory,
+                size_t inMaxBytes
+                );
+
+            bool Contains(
+                const ByteArray& inStateHash
+                );
+
+            /*
+              The caller is responsible for checking that inStateHash
+              is the hash of inBlock; the enclave verifies the hash of
+              every block it fetches so a mismatch only results in a
+              failed request.
+            */
+            void Put(
+                const ByteArray& inStateHash,
+                const ByteArray& inBlock
+                );
+
+            /*
+              Returns false if the block is not in the store
+            */
+            bool Get(
+                const ByteArray& inStateHash,
+                ByteArray& outBlock
+                );
+
+            /*
+              Reads at most inLength bytes of the block starting at
+              inOffset into outChunk and sets outBlockSize to the size
+              of the whole block. Returns false if the block is not in
+              the store or inOffset is past its end.
+            */
+            bool GetRange(
+                const ByteArray& inStateHash,
+                size_t inOffset,
+                size_t inLength,
+                ByteArray& outChunk,
+                size_t& outBlockSize
+                );
+
+        } /* block_store */
+    }     /* enclave_api */
+}         /* pdo */
@@ -113,8 +113,8 @@ pdo_err_t pdo::enclave_api::contract::VerifySecrets(
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 pdo_err_t pdo::enclave_api::contract::HandleContractRequest(
     const Base64EncodedString& inSealedEnclaveData,
-    const Base64EncodedString& inEncryptedSessionKey,
-    const Base64EncodedString& inSerializedRequest,
+    const ByteArray& inEncryptedSessionKey,
+    const ByteArray& inSerializedRequest,
     uint32_t& outResponseIdentifier,
     size_t& outSerializedResponseSize
     )
@@ -125,12 +125,12 @@ pdo_err_t pdo::enclave_api::contract::HandleContractRequest(
     {
         size_t response_size;
         ByteArray sealed_enclave_data = Base64EncodedStringToByteArray(inSealedEnclaveData);
-        ByteArray encrypted_session_key = Base64EncodedStringToByteArray(inEncryptedSessionKey);
-        ByteArray serialized_request = Base64EncodedStringToByteArray(inSerializedRequest);
 
         // xxxxx call the enclave
         sgx_enclave_id_t enclaveid = g_Enclave.GetEnclaveId();
 
+        // the request arrives as raw bytes and is passed by reference, the
+        // call completes before this function returns
         pdo_err_t presult = PDO_SUCCESS;
         sgx_status_t sresult =
             g_Enclave.CallSgx(
@@ -138,8 +138,8 @@ pdo_err_t pdo::enclave_api::contract::HandleContractRequest(
                     enclaveid,
                     &presult,
                     sealed_enclave_data,
-                    encrypted_session_key,
-                    serialized_request,
+                    &inEncryptedSessionKey,
+                    &inSerializedRequest,
                     &response_size
                 ]
                 ()
@@ -149,10 +149,10 @@ pdo_err_t pdo::enclave_api::contract::HandleContractRequest(
                         &presult,
                         sealed_enclave_data.data(),
                         sealed_enclave_data.size(),
-                        encrypted_session_key.data(),
-                        encrypted_session_key.size(),
-                        serialized_request.data(),
-                        serialized_request.size(),
+                        inEncryptedSessionKey.data(),
+                        inEncryptedSessionKey.size(),
+                        inSerializedRequest.data(),
+                        inSerializedRequest.size(),
                         &response_size);
                     return pdo::error::ConvertErrorStatus(sresult_inner, presult);
                 }
@@ -182,19 +182,225 @@ pdo_err_t pdo::enclave_api::contract::HandleContractRequest(
     return result;
 }
 
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t pdo::enclave_api::contract::HandleContractRequestBatch(
+    const Base64EncodedString& inSealedEnclaveData,
+    const ByteArray& inSerializedBatch,
+    uint32_t& outResponseIdentifier,
+    size_t& outSerializedResponseSize
+    )
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        size_t response_size;
+        ByteArray sealed_enclave_data = Base64EncodedStringToByteArray(inSealedEnclaveData);
+
+        // xxxxx call the enclave
+        sgx_enclave_id_t enclaveid = g_Enclave.GetEnclaveId();
+
+        pdo_err_t presult = PDO_SUCCESS;
+        sgx_status_t sresult =
+            g_Enclave.CallSgx(
+                [
+                    enclaveid,
+                    &presult,
+                    sealed_enclave_data,
+                    &inSerializedBatch,
+                    &response_size
+                ]
+                ()
+                {
+                    sgx_status_t sresult_inner = ecall_HandleContractRequestBatch(
+                        enclaveid,
+                        &presult,
+                        sealed_enclave_data.data(),
+                        sealed_enclave_data.size(),
+                        inSerializedBatch.data(),
+                        inSerializedBatch.size(),
+                        &response_size);
+                    return pdo::error::ConvertErrorStatus(sresult_inner, presult);
+                }
+                );
+        pdo::error::ThrowSgxError(sresult, "SGX enclave call failed (HandleContractRequestBatch)");
+        g_Enclave.ThrowPDOError(presult);
+
+        outSerializedResponseSize = response_size;
+    }
+    catch (pdo::error::Error& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    }
+    catch (std::exception& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = PDO_ERR_UNKNOWN;
+    }
+    catch (...)
+    {
+        pdo::enclave_api::base::SetLastError("Unexpected exception");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+size_t pdo::enclave_api::contract::SessionIdSize(void)
+{
+    // must match SESSION_ID_SIZE in the enclave
+    return 16;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t pdo::enclave_api::contract::CreateSession(
+    const Base64EncodedString& inSealedEnclaveData,
+    const ByteArray& inEncryptedSessionKey,
+    ByteArray& outSessionId
+    )
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        ByteArray sealed_enclave_data = Base64EncodedStringToByteArray(inSealedEnclaveData);
+        ByteArray session_id(pdo::enclave_api::contract::SessionIdSize());
+
+        // xxxxx call the enclave
+        sgx_enclave_id_t enclaveid = g_Enclave.GetEnclaveId();
+
+        pdo_err_t presult = PDO_SUCCESS;
+        sgx_status_t sresult =
+            g_Enclave.CallSgx(
+                [
+                    enclaveid,
+                    &presult,
+                    sealed_enclave_data,
+                    &inEncryptedSessionKey,
+                    &session_id
+                ]
+                ()
+                {
+                    sgx_status_t sresult_inner = ecall_CreateSession(
+                        enclaveid,
+                        &presult,
+                        sealed_enclave_data.data(),
+                        sealed_enclave_data.size(),
+                        inEncryptedSessionKey.data(),
+                        inEncryptedSessionKey.size(),
+                        session_id.data(),
+                        session_id.size());
+                    return pdo::error::ConvertErrorStatus(sresult_inner, presult);
+                }
+                );
+        pdo::error::ThrowSgxError(sresult, "SGX enclave call failed (CreateSession)");
+        g_Enclave.ThrowPDOError(presult);
+
+        outSessionId = session_id;
+    }
+    catch (pdo::error::Error& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    }
+    catch (std::exception& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = PDO_ERR_UNKNOWN;
+    }
+    catch (...)
+    {
+        pdo::enclave_api::base::SetLastError("Unexpected exception");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t pdo::enclave_api::contract::HandleSessionRequest(
+    const Base64EncodedString& inSealedEnclaveData,
+    const ByteArray& inSessionId,
+    const ByteArray& inSerializedRequest,
+    uint32_t& outResponseIdentifier,
+    size_t& outSerializedResponseSize
+    )
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        size_t response_size;
+        ByteArray sealed_enclave_data = Base64EncodedStringToByteArray(inSealedEnclaveData);
+
+        // xxxxx call the enclave
+        sgx_enclave_id_t enclaveid = g_Enclave.GetEnclaveId();
+
+        pdo_err_t presult = PDO_SUCCESS;
+        sgx_status_t sresult =
+            g_Enclave.CallSgx(
+                [
+                    enclaveid,
+                    &presult,
+                    sealed_enclave_data,
+                    &inSessionId,
+                    &inSerializedRequest,
+                    &response_size
+                ]
+                ()
+                {
+                    sgx_status_t sresult_inner = ecall_HandleSessionRequest(
+                        enclaveid,
+                        &presult,
+                        sealed_enclave_data.data(),
+                        sealed_enclave_data.size(),
+                        inSessionId.data(),
+                        inSessionId.size(),
+                        inSerializedRequest.data(),
+                        inSerializedRequest.size(),
+                        &response_size);
+                    return pdo::error::ConvertErrorStatus(sresult_inner, presult);
+                }
+                );
+        pdo::error::ThrowSgxError(sresult, "SGX enclave call failed (HandleSessionRequest)");
+        g_Enclave.ThrowPDOError(presult);
+
+        outSerializedResponseSize = response_size;
+    }
+    catch (pdo::error::Error& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    }
+    catch (std::exception& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = PDO_ERR_UNKNOWN;
+    }
+    catch (...)
+    {
+        pdo::enclave_api::base::SetLastError("Unexpected exception");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
 // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 pdo_err_t pdo::enclave_api::contract::GetSerializedResponse(
     const Base64EncodedString& inSealedEnclaveData,
     const uint32_t inResponseIdentifier,
     const size_t inSerializedResponseSize,
-    Base64EncodedString& outSerializedResponse
+    ByteArray& outSerializedResponse
     )
 {
     pdo_err_t result = PDO_SUCCESS;
 
     try
     {
-        ByteArray serialized_response(inSerializedResponseSize);
+        outSerializedResponse.resize(inSerializedResponseSize);
         ByteArray sealed_enclave_data = Base64EncodedStringToByteArray(inSealedEnclaveData);
 
         // xxxxx call the enclave
@@ -207,7 +413,7 @@ pdo_err_t pdo::enclave_api::contract::GetSerializedResponse(
                     enclaveid,
                     &presult,
                     sealed_enclave_data,
-                    &serialized_response
+                    &outSerializedResponse
                 ]
                 ()
                 {
@@ -216,15 +422,130 @@ pdo_err_t pdo::enclave_api::contract::GetSerializedResponse(
                         &presult,
                         sealed_enclave_data.data(),
                         sealed_enclave_data.size(),
-                        serialized_response.data(),
-                        serialized_response.size());
+                        outSerializedResponse.data(),
+                        outSerializedResponse.size());
                     return pdo::error::ConvertErrorStatus(sresult_inner, presult);
                 }
                 );
         pdo::error::ThrowSgxError(sresult, "SGX enclave call failed (GetSerializedResponse)");
         g_Enclave.ThrowPDOError(presult);
+    }
+    catch (pdo::error::Error& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    }
+    catch (std::exception& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = PDO_ERR_UNKNOWN;
+    }
+    catch (...)
+    {
+        pdo::enclave_api::base::SetLastError("Unexpected exception");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t pdo::enclave_api::contract::GetRequestStatistics(
+    bool inReset,
+    pdo_request_statistics_t& outStatistics
+    )
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        // xxxxx call the enclave
+        sgx_enclave_id_t enclaveid = g_Enclave.GetEnclaveId();
+
+        pdo_err_t presult = PDO_SUCCESS;
+        sgx_status_t sresult =
+            g_Enclave.CallSgx(
+                [
+                    enclaveid,
+                    &presult,
+                    inReset,
+                    &outStatistics
+                ]
+                ()
+                {
+                    sgx_status_t sresult_inner = ecall_GetRequestStatistics(
+                        enclaveid,
+                        &presult,
+                        &outStatistics,
+                        inReset ? 1 : 0);
+                    return pdo::error::ConvertErrorStatus(sresult_inner, presult);
+                }
+                );
+        pdo::error::ThrowSgxError(sresult, "SGX enclave call failed (GetRequestStatistics)");
+        g_Enclave.ThrowPDOError(presult);
+    }
+    catch (pdo::error::Error& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = e.error_code();
+    }
+    catch (std::exception& e)
+    {
+        pdo::enclave_api::base::SetLastError(e.what());
+        result = PDO_ERR_UNKNOWN;
+    }
+    catch (...)
+    {
+        pdo::enclave_api::base::SetLastError("Unexpected exception");
+        result = PDO_ERR_UNKNOWN;
+    }
+
+    return result;
+}
+
+// XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+pdo_err_t pdo::enclave_api::contract::GetContractStatistics(
+    bool inReset,
+    std::vector<pdo_contract_statistics_t>& outStatistics
+    )
+{
+    pdo_err_t result = PDO_SUCCESS;
+
+    try
+    {
+        // the enclave never holds more than PDO_CONTRACT_STATISTICS_MAX entries
+        outStatistics.resize(PDO_CONTRACT_STATISTICS_MAX);
+        size_t count = 0;
+
+        // xxxxx call the enclave
+        sgx_enclave_id_t enclaveid = g_Enclave.GetEnclaveId();
+
+        pdo_err_t presult = PDO_SUCCESS;
+        sgx_status_t sresult =
+            g_Enclave.CallSgx(
+                [
+                    enclaveid,
+                    &presult,
+                    inReset,
+                    &outStatistics,
+                    &count
+                ]
+                ()
+                {
+                    sgx_status_t sresult_inner = ecall_GetContractStatistics(
+                        enclaveid,
+                        &presult,
+                        outStatistics.data(),
+                        outStatistics.size(),
+                        &count,
+                        inReset ? 1 : 0);
+                    return pdo::error::ConvertErrorStatus(sresult_inner, presult);
+                }
+                );
+        pdo::error::ThrowSgxError(sresult, "SGX enclave call failed (GetContractStatistics)");
+        g_Enclave.ThrowPDOError(presult);
 
-        outSerializedResponse = ByteArrayToBase64EncodedString(serialized_response);
+        outStatistics.resize(count);
     }
     catch (pdo::error::Error& e)
     {
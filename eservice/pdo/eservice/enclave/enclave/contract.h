@@ -16,9 +16,11 @@
 #pragma once
 
 #include "pdo_error.h"
+#include "request_statistics.h"
 #include "types.h"
 
 #include <string>
+#include <vector>
 #include <stdlib.h>
 
 namespace pdo
@@ -44,8 +46,35 @@ namespace pdo
             // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
             pdo_err_t HandleContractRequest(
                 const Base64EncodedString& inSealedEnclaveData,
-                const Base64EncodedString& inEncryptedSessionKey,
-                const Base64EncodedString& inSerializedRequest,
+                const ByteArray& inEncryptedSessionKey,
+                const ByteArray& inSerializedRequest,
+                uint32_t& outResponseIdentifier,
+                size_t& outSerializedResponseSize
+                );
+
+            // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+            pdo_err_t HandleContractRequestBatch(
+                const Base64EncodedString& inSealedEnclaveData,
+                const ByteArray& inSerializedBatch, /* cbor */
+                uint32_t& outResponseIdentifier,
+                size_t& outSerializedResponseSize
+                );
+
+            // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+            size_t SessionIdSize(void);
+
+            // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+            pdo_err_t CreateSession(
+                const Base64EncodedString& inSealedEnclaveData,
+                const ByteArray& inEncryptedSessionKey,
+                ByteArray& outSessionId
+                );
+
+            // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+            pdo_err_t HandleSessionRequest(
+                const Base64EncodedString& inSealedEnclaveData,
+                const ByteArray& inSessionId,
+                const ByteArray& inSerializedRequest,
                 uint32_t& outResponseIdentifier,
                 size_t& outSerializedResponseSize
                 );
@@ -55,7 +84,19 @@ namespace pdo
                 const Base64EncodedString& inSealedEnclaveData,
                 const uint32_t inResponseIdentifier,
                 const size_t inSerializedResponseSize,
-                Base64EncodedString& outSerializedResponse
+                ByteArray& outSerializedResponse
+                );
+
+            // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+            pdo_err_t GetRequestStatistics(
+                bool inReset,
+                pdo_request_statistics_t& outStatistics
+                );
+
+            // XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+            pdo_err_t GetContractStatistics(
+                bool inReset,
+                std::vector<pdo_contract_statistics_t>& outStatistics
                 );
 
         } /* contract */
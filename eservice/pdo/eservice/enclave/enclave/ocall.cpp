@@ -15,9 +15,15 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 #include "log.h"
+#include "pdo_error.h"
+#include "types.h"
+
+#include "enclave/block_store.h"
 
 std::string g_enclaveError;
 
@@ -52,4 +58,37 @@ extern "C" {
         }
     } // ocall_SetErrorMessage
 
+    pdo_err_t ocall_GetStateBlock(
+        const uint8_t* inStateHash,
+        size_t inStateHashSize,
+        size_t inOffset,
+        uint8_t* outChunk,
+        size_t inChunkSize,
+        size_t* outChunkSize,
+        size_t* outBlockSize
+        )
+    {
+        try {
+            ByteArray hash(inStateHash, inStateHash + inStateHashSize);
+            ByteArray chunk;
+            if (! pdo::enclave_api::block_store::GetRange(
+                    hash, inOffset, inChunkSize, chunk, *outBlockSize))
+                return PDO_ERR_VALUE;
+
+            std::copy(chunk.begin(), chunk.end(), outChunk);
+            *outChunkSize = chunk.size();
+            return PDO_SUCCESS;
+        } catch (...) {
+            return PDO_ERR_UNKNOWN;
+        }
+    } // ocall_GetStateBlock
+
+    void ocall_GetTimestamp(
+        uint64_t* outTimestamp
+        )
+    {
+        *outTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    } // ocall_GetTimestamp
+
 } // extern "C"
@@ -15,6 +15,7 @@
 
 %module pdo_enclave_internal
 
+%include <stdint.i>
 %include <std_vector.i>
 %include <std_map.i>
 %include <std_string.i>
@@ -22,8 +23,15 @@
 namespace std {
     %template(StringVector) vector<string>;
     %template(StringMap) map<string, string>;
+    %template(CounterMap) map<string, uint64_t>;
 }
 
+%{
+#include "types.h"
+%}
+
+%include "byte_array.i"
+
 %include <exception.i>
 
 %exception {
@@ -87,6 +95,7 @@ namespace std {
 %include "signup_info.h"
 %include "enclave_info.h"
 %include "contract.h"
+%include "block_store.h"
 %include "pdo_enclave.h"
 
 %init %{
@@ -59,6 +59,19 @@ pdo_err_t SignupInfo::DeserializeSignupInfo(
 
         encryption_key.assign(pvalue);
 
+        // --------------- agreement key (optional) ---------------
+        pvalue = json_object_dotget_string(data_object, "agreement_key");
+        if (pvalue != nullptr)
+        {
+            agreement_key.assign(pvalue);
+
+            pvalue = json_object_dotget_string(data_object, "agreement_key_signature");
+            pdo::error::ThrowIfNull(
+                pvalue, "invalid serialized signup info; missing agreement_key_signature");
+
+            agreement_key_signature.assign(pvalue);
+        }
+
         // --------------- proof data ---------------
         pvalue = json_object_dotget_string(data_object, "proof_data");
         pdo::error::ThrowIfNull(pvalue, "invalid serialized signup info; missing proof_data");
@@ -113,7 +126,9 @@ SignupInfo* deserialize_signup_info(
 static pdo_err_t DeserializePublicEnclaveData(
     const std::string& public_enclave_data,
     std::string& verifying_key,
-    std::string& encryption_key
+    std::string& encryption_key,
+    std::string& agreement_key,
+    std::string& agreement_key_signature
     )
 {
     pdo_err_t result = PDO_SUCCESS;
@@ -140,6 +155,19 @@ static pdo_err_t DeserializePublicEnclaveData(
         pdo::error::ThrowIfNull(pvalue, "invalid public enclave data; missing EncryptionKey");
 
         encryption_key.assign(pvalue);
+
+        // --------------- agreement key ---------------
+        // not present in enclave data sealed before it was added
+        pvalue = json_object_dotget_string(data_object, "AgreementKey");
+        if (pvalue != nullptr)
+        {
+            agreement_key.assign(pvalue);
+
+            pvalue = json_object_dotget_string(data_object, "AgreementKeySignature");
+            pdo::error::ThrowIfNull(pvalue, "invalid public enclave data; missing AgreementKeySignature");
+
+            agreement_key_signature.assign(pvalue);
+        }
     }
     catch (pdo::error::Error& e)
     {
@@ -185,17 +213,26 @@ std::map<std::string, std::string> create_enclave_data(
     // parse the json and save the verifying and encryption keys
     std::string verifying_key;
     std::string encryption_key;
+    std::string agreement_key;
+    std::string agreement_key_signature;
 
     presult = DeserializePublicEnclaveData(
         public_enclave_data.str(),
         verifying_key,
-        encryption_key);
+        encryption_key,
+        agreement_key,
+        agreement_key_signature);
     ThrowPDOError(presult);
 
     // save the information
     std::map<std::string, std::string> result;
     result["verifying_key"] = verifying_key;
     result["encryption_key"] = encryption_key;
+    if (! agreement_key.empty())
+    {
+        result["agreement_key"] = agreement_key;
+        result["agreement_key_signature"] = agreement_key_signature;
+    }
     result["sealed_enclave_data"] = sealed_enclave_data;
     result["enclave_quote"] = enclave_quote;
 
@@ -218,16 +255,25 @@ std::map<std::string, std::string> unseal_enclave_data(
     // parse the json and save the verifying and encryption keys
     std::string verifying_key;
     std::string encryption_key;
+    std::string agreement_key;
+    std::string agreement_key_signature;
 
     presult = DeserializePublicEnclaveData(
         public_enclave_data.str(),
         verifying_key,
-        encryption_key);
+        encryption_key,
+        agreement_key,
+        agreement_key_signature);
     ThrowPDOError(presult);
 
     std::map<std::string, std::string> result;
     result["verifying_key"] = verifying_key;
     result["encryption_key"] = encryption_key;
+    if (! agreement_key.empty())
+    {
+        result["agreement_key"] = agreement_key;
+        result["agreement_key_signature"] = agreement_key_signature;
+    }
 
     return result;
 } // _unseal_signup_data
@@ -37,6 +37,8 @@ public:
     // Signup info properties
     std::string verifying_key;
     std::string encryption_key;
+    std::string agreement_key;
+    std::string agreement_key_signature;
     std::string sealed_signup_data;
     std::string proof_data;
     std::string enclave_persistent_id;
@@ -38,13 +38,30 @@ __all__ = [
     'get_enclave_basename',
     'verify_secrets',
     'send_to_contract',
+    'send_to_contract_batch',
+    'create_session',
+    'send_to_contract_in_session',
+    'get_request_statistics',
+    'get_contract_statistics',
+    'initialize_block_store',
+    'check_state_block',
+    'push_state_block',
     'shutdown'
 ]
 
 verify_secrets = enclave.contract_verify_secrets
 send_to_contract = enclave.contract_handle_contract_request
+send_to_contract_batch = enclave.contract_handle_contract_request_batch
+create_session = enclave.contract_create_session
+send_to_contract_in_session = enclave.contract_handle_session_request
+get_request_statistics = enclave.contract_request_statistics
+get_contract_statistics = enclave.contract_interpreter_statistics
 get_enclave_public_info = enclave.unseal_enclave_data
 
+initialize_block_store = enclave.block_store_initialize
+check_state_block = enclave.block_store_contains
+push_state_block = enclave.block_store_put
+
 # -----------------------------------------------------------------
 # -----------------------------------------------------------------
 _pdo = None
@@ -216,6 +233,10 @@ def create_signup_info(originator_public_key_hash, nonce):
         'enclave_persistent_id': 'Not present'
     }
 
+    if 'agreement_key' in signup_data :
+        signup_info['agreement_key'] = signup_data['agreement_key']
+        signup_info['agreement_key_signature'] = signup_data['agreement_key_signature']
+
     # If we are not running in the simulator, we are going to go and get
     # an attestation verification report for our signup data.
     if not enclave.is_sgx_simulator():
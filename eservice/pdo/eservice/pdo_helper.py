@@ -31,9 +31,11 @@ import errno
 
 import pdo.eservice.pdo_enclave as pdo_enclave
 
+import pdo.common.cbor as cbor
 import pdo.common.keys as keys
 import pdo.common.crypto as crypto
 import pdo.common.utility as putils
+from pdo.contract.state import ContractState
 
 from pdo.submitter.submitter import Submitter
 import sawtooth.helpers.pdo_connect
@@ -41,7 +43,7 @@ import sawtooth.helpers.pdo_connect
 import logging
 logger = logging.getLogger(__name__)
 
-__all__ = [ "Enclave", "initialize_enclave" ]
+__all__ = [ "Enclave", "initialize_enclave", "initialize_block_store" ]
 
 
 # -----------------------------------------------------------------
@@ -52,6 +54,16 @@ def initialize_enclave(enclave_config) :
     """
     pdo_enclave.initialize_with_configuration(enclave_config)
 
+# -----------------------------------------------------------------
+# -----------------------------------------------------------------
+def initialize_block_store(block_store_config) :
+    """initialize_block_store -- set up the store that holds encrypted
+    contract states for the enclave
+    """
+    directory = block_store_config['Directory']
+    max_bytes = block_store_config.get('MaxBytes', 1 << 30)
+    pdo_enclave.initialize_block_store(directory, max_bytes)
+
 # -----------------------------------------------------------------
 # -----------------------------------------------------------------
 class Enclave(object) :
@@ -95,9 +107,15 @@ class Enclave(object) :
 
         try :
             public_enclave_data = pdo_enclave.get_enclave_public_info(enclave_info['sealed_data'])
-            assert public_enclave_data and len(public_enclave_data) == 2
+            assert public_enclave_data and len(public_enclave_data) >= 2
             assert enclave_info['verifying_key'] == public_enclave_data['verifying_key']
             assert enclave_info['encryption_key'] == public_enclave_data['encryption_key']
+
+            # enclave information files written before the agreement key
+            # was added do not have it, the sealed data is authoritative
+            if 'agreement_key' in public_enclave_data :
+                enclave_info['agreement_key'] = public_enclave_data['agreement_key']
+                enclave_info['agreement_key_signature'] = public_enclave_data['agreement_key_signature']
         except :
             raise Exception('sealed storage does not match enclave data file; {}'.format(full_name))
 
@@ -127,6 +145,9 @@ class Enclave(object) :
         enclave_info['sealed_data'] = enclave_data.sealed_signup_data
         enclave_info['verifying_key'] = enclave_data.verifying_key
         enclave_info['encryption_key'] = enclave_data.encryption_key
+        if enclave_data.agreement_key :
+            enclave_info['agreement_key'] = enclave_data.agreement_key
+            enclave_info['agreement_key_signature'] = enclave_data.agreement_key_signature
         enclave_info['enclave_id'] = enclave_data.verifying_key
         enclave_info['proof_data'] = ''
         if not pdo_enclave.enclave.is_sgx_simulator() :
@@ -151,7 +172,12 @@ class Enclave(object) :
         except KeyError as ke :
             raise Exception("missing enclave initialization parameter; {}".format(str(ke)))
 
-        self.enclave_keys = keys.EnclaveKeys(self.verifying_key, self.encryption_key)
+        self.agreement_key = enclave_info.get('agreement_key')
+        self.agreement_key_signature = enclave_info.get('agreement_key_signature')
+
+        self.enclave_keys = keys.EnclaveKeys(
+            self.verifying_key, self.encryption_key,
+            self.agreement_key, self.agreement_key_signature)
 
     # -------------------------------------------------------
     def send_to_contract(self, encrypted_session_key, encrypted_request) :
@@ -159,14 +185,74 @@ class Enclave(object) :
         """
         send a contract update request to the enclave
 
-        :param encrypted_session_key: base64 encoded encrypted AES key
-        :param encrypted_request: base64 encoded encrypted contract request
+        :param encrypted_session_key: encrypted AES key
+        :param encrypted_request: encrypted contract request
+        :returns: encrypted response as bytes
         """
         return pdo_enclave.send_to_contract(
             self.sealed_data,
             encrypted_session_key,
             encrypted_request)
 
+    # -------------------------------------------------------
+    def send_to_contract_batch(self, requests) :
+        """
+        send a batch of contract update requests to the enclave; the
+        successful responses share a single signature over the Merkle
+        root of the batch
+
+        :param requests: list of (encrypted_session_key, encrypted_request) pairs
+        :returns: list of encrypted responses, an empty value marks a
+        request the enclave could not process
+        """
+        batch = cbor.dumps([ [ k, r ] for (k, r) in requests ])
+        serialized_response = pdo_enclave.send_to_contract_batch(self.sealed_data, batch)
+        return cbor.loads(serialized_response)
+
+    # -------------------------------------------------------
+    def create_session(self, encrypted_session_key) :
+        """
+        decrypt a session key once in the enclave; returns the id used
+        to send requests under that key
+
+        :param encrypted_session_key: encrypted AES key
+        """
+        return pdo_enclave.create_session(self.sealed_data, encrypted_session_key)
+
+    # -------------------------------------------------------
+    def send_to_contract_in_session(self, session_id, encrypted_request) :
+        """
+        send a contract update request encrypted with the key of an
+        established session
+
+        :param session_id: session id returned by create_session
+        :param encrypted_request: encrypted contract request
+        """
+        return pdo_enclave.send_to_contract_in_session(
+            self.sealed_data,
+            session_id,
+            encrypted_request)
+
+    # -------------------------------------------------------
+    def push_state_block(self, encrypted_state) :
+        """
+        add an encrypted state to the block store so requests can
+        reference it by hash; returns the base64 encoded state hash
+
+        :param encrypted_state: encrypted contract state
+        """
+        state_hash = ContractState.compute_hash(encrypted_state, encoding='b64')
+        pdo_enclave.push_state_block(state_hash, encrypted_state)
+        return state_hash
+
+    # -------------------------------------------------------
+    def check_state_blocks(self, state_hashes) :
+        """
+        return the subset of the base64 encoded state hashes that are
+        held in the block store
+        """
+        return [ h for h in state_hashes if pdo_enclave.check_state_block(h) ]
+
     # -------------------------------------------------------
     def verify_secrets(self, contract_id, owner_id, secret_list) :
         """
@@ -183,6 +269,44 @@ class Enclave(object) :
             owner_id,
             json.dumps(secret_list))
 
+    # -------------------------------------------------------
+    def get_request_statistics(self, reset = False) :
+        """
+        return the time spent in each phase of the requests handled by
+        the enclave, a dictionary mapping the phase name to the number
+        of requests timed and the total and maximum time in nanoseconds
+
+        :param reset: clear the totals once they are read
+        """
+        counters = pdo_enclave.get_request_statistics(reset)
+
+        statistics = dict()
+        for (key, value) in counters.items() :
+            for field in [ 'count', 'total_ns', 'max_ns' ] :
+                if key.endswith('_' + field) :
+                    phase = key[:-len(field) - 1]
+                    statistics.setdefault(phase, dict())[field] = int(value)
+
+        return statistics
+
+    # -------------------------------------------------------
+    def get_contract_statistics(self, reset = False) :
+        """
+        return the interpreter work for the requests handled by the
+        enclave, a dictionary mapping the contract name to the number of
+        requests and the total and maximum of each interpreter counter
+
+        :param reset: clear the totals once they are read
+        """
+        counters = pdo_enclave.get_contract_statistics(reset)
+
+        statistics = dict()
+        for (key, value) in counters.items() :
+            (contract, field) = key.rsplit('/', 1)
+            statistics.setdefault(contract, dict())[field] = int(value)
+
+        return statistics
+
     # -------------------------------------------------------
     def get_enclave_public_info(self) :
         """
@@ -198,6 +322,9 @@ class Enclave(object) :
         enclave_info['sealed_data'] = self.sealed_data
         enclave_info['verifying_key'] = self.verifying_key
         enclave_info['encryption_key'] = self.encryption_key
+        if self.agreement_key :
+            enclave_info['agreement_key'] = self.agreement_key
+            enclave_info['agreement_key_signature'] = self.agreement_key_signature
         enclave_info['proof_data'] = self.proof_data
         enclave_info['enclave_id'] = self.enclave_id
 
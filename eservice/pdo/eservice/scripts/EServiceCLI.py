@@ -26,6 +26,7 @@ import json
 import pdo.common.config as pconfig
 import pdo.common.keys as keys
 import pdo.common.logger as plogger
+import pdo.common.wire as wire
 
 import pdo.eservice.pdo_helper as pdo_enclave_helper
 
@@ -52,12 +53,18 @@ class ContractEnclaveServer(resource.Resource):
         self.SealedData = enclave.sealed_data
         self.VerifyingKey = enclave.verifying_key
         self.EncryptionKey = enclave.encryption_key
+        self.AgreementKey = enclave.agreement_key
+        self.AgreementKeySignature = enclave.agreement_key_signature
         self.EnclaveID = enclave.enclave_id
 
         self.RequestMap = {
             'UpdateContractRequest' : self._HandleUpdateContractRequest,
+            'UpdateContractBatchRequest' : self._HandleUpdateContractBatchRequest,
+            'CreateSessionRequest' : self._HandleCreateSessionRequest,
             'EnclaveDataRequest' : self._HandleEnclaveDataRequest,
-            'VerifySecretRequest' : self._HandleVerifySecretRequest
+            'VerifySecretRequest' : self._HandleVerifySecretRequest,
+            'PushStateBlockRequest' : self._HandlePushStateBlockRequest,
+            'CheckStateBlockRequest' : self._HandleCheckStateBlockRequest
         }
 
     ## -----------------------------------------------------------------
@@ -85,8 +92,33 @@ class ContractEnclaveServer(resource.Resource):
             reactor.callLater(1, reactor.stop)
             return ""
 
+        if request.path == b'/status' :
+            return self._HandleStatusRequest(request)
+
         return self.ErrorResponse(request, http.BAD_REQUEST, 'unsupported')
 
+    ## -----------------------------------------------------------------
+    def _HandleStatusRequest(self, request) :
+        """
+        Report the time the enclave spent in each phase of the requests
+        it handled and the interpreter work per contract; GET
+        /status?reset=1 clears the totals after reading
+        """
+        reset = request.args.get(b'reset', [b'0'])[0] not in (b'0', b'false', b'')
+
+        try :
+            response = dict()
+            response['enclave_id'] = self.EnclaveID
+            response['request_phases'] = self.Enclave.get_request_statistics(reset)
+            response['contracts'] = self.Enclave.get_contract_statistics(reset)
+        except :
+            logger.exception('HandleStatusRequest')
+            return self.ErrorResponse(request, http.INTERNAL_SERVER_ERROR, 'unable to read enclave statistics')
+
+        request.setHeader('content-type', wire.JSON_ENCODING)
+        request.setResponseCode(http.OK)
+        return wire.encode_message(response, wire.JSON_ENCODING)
+
     ## -----------------------------------------------------------------
     def render_POST(self, request) :
         """
@@ -95,23 +127,18 @@ class ContractEnclaveServer(resource.Resource):
         the gossip network as is.
         """
 
+        # process the message encoding, the response uses the encoding
+        # the client accepts or else the encoding of the request
+        encoding = request.getHeader('Content-Type')
+        if encoding not in wire.SUPPORTED_ENCODINGS :
+            msg = 'unknown message encoding, {0}'.format(encoding)
+            return self.ErrorResponse(request, http.UNSUPPORTED_MEDIA_TYPE, msg)
+
+        response_encoding = wire.select_encoding(request.getHeader('Accept'), encoding)
+
         try :
-            # process the message encoding
-            encoding = request.getHeader('Content-Type')
             data = request.content.getvalue()
-
-            if encoding == 'application/json' :
-                # Attempt to decode the data if it is not already a string
-                try:
-                    data = data.decode('utf-8')
-                except AttributeError:
-                    pass
-                minfo = json.loads(data)
-            # elif encoding == 'application/cbor' :
-            #     minfo = cbor.loads(data)
-            else :
-                msg = 'unknown message encoding, {0}'.format(encoding)
-                return self.ErrorResponse(request, http.BAD_REQUEST, msg)
+            minfo = wire.decode_message(data, encoding)
 
         except :
             logger.exception('exception while decoding http request %s', request.path)
@@ -128,16 +155,13 @@ class ContractEnclaveServer(resource.Resource):
         try :
             logger.debug('received request %s', operation)
 
-            response_dict = self.RequestMap[operation](minfo)
-            if encoding == 'application/json' :
-                response = json.dumps(response_dict)
-            # elif encoding == 'application/cbor' :
-            #     response = cbor.dumps(response_dict)
+            response_dict = self.RequestMap[operation](minfo, response_encoding)
+            response = wire.encode_message(response_dict, response_encoding)
 
-            logger.debug('response[%s]: %s', encoding, response)
-            request.setHeader('content-type', encoding)
+            logger.debug('response[%s]: %d bytes', response_encoding, len(response))
+            request.setHeader('content-type', response_encoding)
             request.setResponseCode(http.OK)
-            return response.encode('utf8')
+            return response
 
         except Error as e :
             #logger.exception('exception while processing request %s', request.path)
@@ -150,26 +174,35 @@ class ContractEnclaveServer(resource.Resource):
             return self.ErrorResponse(request, http.BAD_REQUEST, msg)
 
     ## -----------------------------------------------------------------
-    def _HandleUpdateContractRequest(self, minfo) :
+    def _HandleUpdateContractRequest(self, minfo, encoding) :
         # {
-        #     "encrypted_session_key" : <>,
+        #     "encrypted_session_key" : <>,   or   "session_id" : <>,
         #     "encrypted_request" : <>
         # }
 
         try :
-            encrypted_session_key = minfo['encrypted_session_key']
-            encrypted_request = minfo['encrypted_request']
+            session_id = minfo.get('session_id')
+            if session_id is None :
+                encrypted_session_key = wire.decode_binary(minfo['encrypted_session_key'])
+            else :
+                session_id = wire.decode_binary(session_id)
+            encrypted_request = wire.decode_binary(minfo['encrypted_request'])
 
         except KeyError as ke :
             logger.error('missing field in request: %s', ke)
             raise Error(http.BAD_REQUEST, 'missing field {0}'.format(ke))
 
         try :
-            response = self.Enclave.send_to_contract(
-                encrypted_session_key,
-                encrypted_request)
+            if session_id is not None :
+                response = self.Enclave.send_to_contract_in_session(
+                    session_id,
+                    encrypted_request)
+            else :
+                response = self.Enclave.send_to_contract(
+                    encrypted_session_key,
+                    encrypted_request)
 
-            return {'result' : response}
+            return {'result' : wire.encode_binary(response, encoding)}
 
         except :
             logger.exception('api_send_message')
@@ -177,7 +210,57 @@ class ContractEnclaveServer(resource.Resource):
 
 
     ## -----------------------------------------------------------------
-    def _HandleVerifySecretRequest(self, minfo) :
+    def _HandleUpdateContractBatchRequest(self, minfo, encoding) :
+        # {
+        #     "requests" : [
+        #         {
+        #             "encrypted_session_key" : <>,
+        #             "encrypted_request" : <>
+        #         }
+        #     ]
+        # }
+
+        try :
+            requests = []
+            for request in minfo['requests'] :
+                requests.append((
+                    wire.decode_binary(request['encrypted_session_key']),
+                    wire.decode_binary(request['encrypted_request'])))
+
+        except KeyError as ke :
+            logger.error('missing field in request: %s', ke)
+            raise Error(http.BAD_REQUEST, 'missing field {0}'.format(ke))
+
+        try :
+            results = self.Enclave.send_to_contract_batch(requests)
+            return {'results' : [ wire.encode_binary(r, encoding) for r in results ]}
+
+        except :
+            logger.exception('api_send_message_batch')
+            raise Error(http.BAD_REQUEST, "api_send_message_batch")
+
+    ## -----------------------------------------------------------------
+    def _HandleCreateSessionRequest(self, minfo, encoding) :
+        # {
+        #     "encrypted_session_key" : <>
+        # }
+
+        try :
+            encrypted_session_key = wire.decode_binary(minfo['encrypted_session_key'])
+        except KeyError as ke :
+            logger.error('missing field in request: %s', ke)
+            raise Error(http.BAD_REQUEST, 'missing field {0}'.format(ke))
+
+        try :
+            session_id = self.Enclave.create_session(encrypted_session_key)
+            return {'session_id' : wire.encode_binary(session_id, encoding)}
+
+        except :
+            logger.exception('HandleCreateSessionRequest')
+            raise Error(http.BAD_REQUEST, "HandleCreateSession")
+
+    ## -----------------------------------------------------------------
+    def _HandleVerifySecretRequest(self, minfo, encoding) :
         ## {
         ##    "contract_id" : <>,
         ##    "creator_id" : <>,
@@ -215,10 +298,52 @@ class ContractEnclaveServer(resource.Resource):
             raise Error(http.BAD_REQUEST, "HandleVerifySecrets")
 
     ## -----------------------------------------------------------------
-    def _HandleEnclaveDataRequest(self, minfo) :
+    def _HandlePushStateBlockRequest(self, minfo, encoding) :
+        # {
+        #     "encrypted_state" : <>
+        # }
+
+        try :
+            encrypted_state = wire.decode_binary(minfo['encrypted_state'])
+        except KeyError as ke :
+            logger.error('missing field in request: %s', ke)
+            raise Error(http.BAD_REQUEST, 'missing field {0}'.format(ke))
+
+        try :
+            state_hash = self.Enclave.push_state_block(encrypted_state)
+            return {'state_hash' : state_hash}
+
+        except :
+            logger.exception('HandlePushStateBlockRequest')
+            raise Error(http.BAD_REQUEST, "HandlePushStateBlock")
+
+    ## -----------------------------------------------------------------
+    def _HandleCheckStateBlockRequest(self, minfo, encoding) :
+        # {
+        #     "state_hashes" : [ <>, ... ]
+        # }
+
+        try :
+            state_hashes = minfo['state_hashes']
+        except KeyError as ke :
+            logger.error('missing field in request: %s', ke)
+            raise Error(http.BAD_REQUEST, 'missing field {0}'.format(ke))
+
+        try :
+            return {'state_hashes' : self.Enclave.check_state_blocks(state_hashes)}
+
+        except :
+            logger.exception('HandleCheckStateBlockRequest')
+            raise Error(http.BAD_REQUEST, "HandleCheckStateBlock")
+
+    ## -----------------------------------------------------------------
+    def _HandleEnclaveDataRequest(self, minfo, encoding) :
         response = dict()
         response['verifying_key'] = self.VerifyingKey
         response['encryption_key'] = self.EncryptionKey
+        if self.AgreementKey :
+            response['agreement_key'] = self.AgreementKey
+            response['agreement_key_signature'] = self.AgreementKeySignature
         response['enclave_id'] = self.EnclaveID
         return response
 
@@ -300,6 +425,14 @@ def LocalMain(config) :
         logger.exception('failed to initialize enclave; %s', e)
         sys.exit(-1)
 
+    block_store_config = config.get('StateBlockStore')
+    if block_store_config :
+        try :
+            pdo_enclave_helper.initialize_block_store(block_store_config)
+        except Exception as e :
+            logger.exception('failed to initialize the state block store; %s', e)
+            sys.exit(-1)
+
     try :
         enclave_config = config.get('EnclaveData', {})
         ledger_config = config.get('Sawtooth', {})
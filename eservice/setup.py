@@ -110,17 +110,19 @@ module_files = [
     os.path.join(module_src_path, 'enclave/ocall.cpp'),
     os.path.join(module_src_path, 'enclave/base.cpp'),
     os.path.join(module_src_path, 'enclave/contract.cpp'),
+    os.path.join(module_src_path, 'enclave/block_store.cpp'),
     os.path.join(module_src_path, 'enclave/signup.cpp'),
     os.path.join(module_src_path, 'enclave/enclave.cpp'),
     os.path.join(module_src_path, 'enclave_info.cpp'),
     os.path.join(module_src_path, 'signup_info.cpp'),
-    os.path.join(module_src_path, 'contract.cpp')
+    os.path.join(module_src_path, 'contract.cpp'),
+    os.path.join(module_src_path, 'block_store.cpp')
 ]
 
 enclave_module = Extension(
     'pdo.eservice.enclave._pdo_enclave_internal',
     module_files,
-    swig_opts = ['-c++'],
+    swig_opts = ['-c++', '-I%s' % os.path.join(pdo_root_dir, 'python', 'pdo', 'common')],
     extra_compile_args = compile_args,
     libraries = libraries,
     include_dirs = include_dirs,
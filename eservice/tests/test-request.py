@@ -25,6 +25,7 @@ import pdo.service_client.enclave as eservice_helper
 import pdo.service_client.provisioning as pservice_helper
 
 import pdo.contract as contract_helper
+from pdo.contract.state import STATE_DELTA_CHECKPOINT_INTERVAL
 import pdo.common.crypto as crypto
 import pdo.common.keys as keys
 import pdo.common.secrets as secrets
@@ -41,6 +42,7 @@ enclave = None
 use_ledger = True
 use_eservice = False
 use_pservice = False
+use_state_delta = False
 
 # -----------------------------------------------------------------
 # -----------------------------------------------------------------
@@ -274,6 +276,70 @@ def UpdateTheContract(config, enclave, contract, contract_invoker_keys) :
 
         contract.set_state(update_response.encrypted_state)
 
+# -----------------------------------------------------------------
+# run the same updates on a contract that asks for state deltas and on
+# one that gets the full state every time; the encrypted states differ
+# since every encryption uses a new IV, so the results of the updates
+# and the value in the final state are compared
+# -----------------------------------------------------------------
+def CompareStateDeltaUpdates(config, enclave, contract_invoker_keys) :
+    delta_contract = CreateAndRegisterContract(config, enclave, contract_invoker_keys)
+    delta_contract.contract_state.emit_state_delta = True
+    full_contract = CreateAndRegisterContract(config, enclave, contract_invoker_keys)
+
+    # long enough for the delta chain to pass at least two checkpoints
+    iterations = max(config['iterations'], 2 * STATE_DELTA_CHECKPOINT_INTERVAL + 1)
+    delta_count = 0
+    checkpoint_count = 0
+
+    def evaluate(contract, expression, stage_state) :
+        update_request = contract.create_update_request(contract_invoker_keys, enclave, expression)
+        update_response = update_request.evaluate(stage_state = stage_state)
+        if update_response.status is False :
+            raise Exception('{0} failed; {1}'.format(expression, update_response.result))
+        return update_response
+
+    for x in range(iterations) :
+        expression = "'(inc-value)"
+
+        # alternate between the state held in the enclave state cache
+        # and the checkpoint with the deltas that follow it
+        stage_state = (x % 2 == 0)
+
+        results = []
+        for contract in [ delta_contract, full_contract ] :
+            update_response = evaluate(contract, expression, stage_state)
+            contract.set_state(
+                update_response.encrypted_state,
+                update_response.encrypted_state_delta,
+                enclave.enclave_id,
+                update_response.new_state_hash)
+            results.append(update_response.result)
+
+        if delta_contract.contract_state.encrypted_state_deltas :
+            delta_count += 1
+        else :
+            checkpoint_count += 1
+
+        if results[0] != results[1] :
+            raise Exception('state delta update diverged at {0}; {1} != {2}'.format(x, results[0], results[1]))
+
+        logger.info('{0} --> {1}'.format(expression, results[0]))
+
+    if delta_count == 0 or checkpoint_count == 0 :
+        raise Exception('state delta chain did not reach a checkpoint')
+
+    # the final value is read with the full checkpoint and the deltas
+    # so the enclave must rebuild the state from the chain
+    expression = "'(get-value)"
+    delta_value = evaluate(delta_contract, expression, False).result
+    full_value = evaluate(full_contract, expression, False).result
+    if delta_value != full_value :
+        raise Exception('final state differs; {0} != {1}'.format(delta_value, full_value))
+
+    logger.info('state delta updates match full state updates; %d deltas, %d checkpoints',
+                delta_count, checkpoint_count)
+
 # -----------------------------------------------------------------
 # -----------------------------------------------------------------
 def LocalMain(config) :
@@ -313,6 +379,16 @@ def LocalMain(config) :
         logger.error('contract execution failed; %s', str(e))
         sys.exit(-1)
 
+    if use_state_delta :
+        # --------------------------------------------------
+        logger.info('compare state delta updates with full state updates')
+        # --------------------------------------------------
+        try :
+            CompareStateDeltaUpdates(config, enclave, contract_creator_keys)
+        except Exception as e :
+            logger.error('state delta test failed; %s', str(e))
+            sys.exit(-1)
+
     sys.exit(0)
 
 ## XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
@@ -346,6 +422,7 @@ def ParseCommandLine(config, args) :
     global use_ledger
     global use_eservice
     global use_pservice
+    global use_state_delta
 
     parser = argparse.ArgumentParser()
 
@@ -356,6 +433,7 @@ def ParseCommandLine(config, args) :
     parser.add_argument('--secret-count', help='Number of secrets to generate', type=int, default=3)
     parser.add_argument('--eservice', help='URL of the enclave service to use', type=str)
     parser.add_argument('--pservice', help='URLs for provisioning services to contact', type=str, nargs='+', default=[])
+    parser.add_argument('--state-delta', help='Compare state delta updates with full state updates', action="store_true")
 
     parser.add_argument('--logfile', help='Name of the log file, __screen__ for standard output', type=str)
     parser.add_argument('--loglevel', help='Logging level', type=str)
@@ -403,6 +481,9 @@ def ParseCommandLine(config, args) :
         use_pservice = True
         config['pservice-urls'] = options.pservice
 
+    if options.state_delta :
+        use_state_delta = True
+
 # -----------------------------------------------------------------
 # -----------------------------------------------------------------
 def Main() :
@@ -36,6 +36,7 @@ import pdo.common.crypto as pcrypto
 import pdo.common.config as pconfig
 import pdo.common.logger as plogger
 import pdo.common.utility as putils
+import pdo.common.wire as wire
 
 import pdo.pservice.pdo_helper as pdo_enclave_helper
 import pdo.pservice.pdo_enclave as pdo_enclave
@@ -231,17 +232,18 @@ class ProvisioningServer(resource.Resource):
         gossip messages that should be relayed into the gossip network as is.
         """
 
-        # process the message encoding
+        # process the message encoding, the response uses the encoding
+        # the client accepts or else the encoding of the request
         encoding = request.getHeader('Content-Type')
+        if encoding not in wire.SUPPORTED_ENCODINGS :
+            logger.warn('unknown message encoding')
+            return self.ErrorResponse(request, http.UNSUPPORTED_MEDIA_TYPE, 'unknown message encoding, {0}', encoding)
+
+        response_encoding = wire.select_encoding(request.getHeader('Accept'), encoding)
         data = request.content.getvalue()
-        data = data.decode('utf-8')
 
         try :
-            if encoding == 'application/json' :
-                minfo = json.loads(data)
-            else :
-                logger.warn('unknown message encoding')
-                return self.ErrorResponse(request, http.BAD_REQUEST, 'unknown message encoding, {0}', encoding)
+            minfo = wire.decode_message(data, encoding)
 
             reqtype = minfo.get('reqType', '**UNSPECIFIED**')
             if reqtype not in self.RequestMap :
@@ -254,11 +256,11 @@ class ProvisioningServer(resource.Resource):
 
         # and finally execute the associated method and send back the results
         try :
-            response = json.dumps(self.RequestMap[reqtype](minfo))
+            response = wire.encode_message(self.RequestMap[reqtype](minfo), response_encoding)
 
-            request.responseHeaders.addRawHeader("content-type", encoding)
+            request.responseHeaders.addRawHeader("content-type", response_encoding)
             logger.debug('Return Response: %s', response)
-            return response.encode('utf-8')
+            return response
 
         except Error as e :
             logger.warn('exception while processing request; %s', str(e))
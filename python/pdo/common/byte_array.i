@@ -0,0 +1,154 @@
+/* Copyright 2018 Intel Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Typemaps that marshal ByteArray through the Python buffer protocol.
+ *
+ * Any object that exports a contiguous buffer (bytes, bytearray,
+ * memoryview, array) is copied into the ByteArray with a single memcpy
+ * and a returned ByteArray becomes a bytes object the same way. Tuples
+ * and lists of integers, the representation produced by the vector
+ * template used before, are still accepted on input.
+ *
+ * Lists of ByteArrays map to and from Python lists with the same
+ * conversion for each element.
+ */
+
+%fragment("ByteArray_Python", "header") {
+/* Convert obj into out; returns a SWIG error code */
+static int ByteArray_FromPython(PyObject* obj, ByteArray& out)
+{
+    if (PyObject_CheckBuffer(obj))
+    {
+        Py_buffer view;
+        if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS) != 0)
+        {
+            PyErr_Clear();
+            return SWIG_TypeError;
+        }
+
+        const uint8_t* data = static_cast<const uint8_t*>(view.buf);
+        out.assign(data, data + view.len);
+        PyBuffer_Release(&view);
+        return SWIG_OK;
+    }
+
+    if (PyTuple_Check(obj) || PyList_Check(obj))
+    {
+        Py_ssize_t size = PySequence_Fast_GET_SIZE(obj);
+        PyObject** items = PySequence_Fast_ITEMS(obj);
+
+        out.resize(size);
+        for (Py_ssize_t i = 0; i < size; i++)
+        {
+            long value = PyLong_AsLong(items[i]);
+            if (value == -1 && PyErr_Occurred())
+            {
+                PyErr_Clear();
+                return SWIG_TypeError;
+            }
+            if (value < 0 || value > 255)
+                return SWIG_ValueError;
+            out[i] = static_cast<uint8_t>(value);
+        }
+        return SWIG_OK;
+    }
+
+    return SWIG_TypeError;
+}
+
+static bool ByteArray_Check(PyObject* obj)
+{
+    return PyObject_CheckBuffer(obj) || PyTuple_Check(obj) || PyList_Check(obj);
+}
+
+static PyObject* ByteArray_ToPython(const ByteArray& value)
+{
+    return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(value.data()), value.size());
+}
+}
+
+/* ---------- ByteArray ---------- */
+
+%typemap(typecheck, precedence=SWIG_TYPECHECK_POINTER, fragment="ByteArray_Python")
+    const ByteArray&
+{
+    $1 = ($input == Py_None || ByteArray_Check($input)) ? 1 : 0;
+}
+
+%typemap(in, fragment="ByteArray_Python") const ByteArray& (ByteArray temp, int res)
+{
+    if ($input == Py_None)
+        SWIG_exception_fail(SWIG_ValueError,
+            "invalid null reference in method '$symname', argument $argnum of type '$type'");
+
+    res = ByteArray_FromPython($input, temp);
+    if (! SWIG_IsOK(res))
+        SWIG_exception_fail(SWIG_ArgError(res),
+            "in method '$symname', argument $argnum of type '$type'");
+
+    $1 = &temp;
+}
+
+%typemap(out, fragment="ByteArray_Python") ByteArray
+{
+    $result = ByteArray_ToPython($1);
+}
+
+/* ---------- std::vector<ByteArray> ---------- */
+
+%typemap(typecheck, precedence=SWIG_TYPECHECK_POINTER) const std::vector<ByteArray>&
+{
+    $1 = (PyTuple_Check($input) || PyList_Check($input)) ? 1 : 0;
+}
+
+%typemap(in, fragment="ByteArray_Python") const std::vector<ByteArray>& (std::vector<ByteArray> temp, int res)
+{
+    PyObject* sequence = PySequence_Fast($input, "expected a sequence of byte arrays");
+    if (sequence == NULL)
+        SWIG_exception_fail(SWIG_TypeError,
+            "in method '$symname', argument $argnum of type '$type'");
+
+    Py_ssize_t size = PySequence_Fast_GET_SIZE(sequence);
+    temp.resize(size);
+
+    res = SWIG_OK;
+    for (Py_ssize_t i = 0; i < size && SWIG_IsOK(res); i++)
+        res = ByteArray_FromPython(PySequence_Fast_GET_ITEM(sequence, i), temp[i]);
+    Py_DECREF(sequence);
+
+    if (! SWIG_IsOK(res))
+        SWIG_exception_fail(SWIG_ArgError(res),
+            "in method '$symname', argument $argnum of type '$type'");
+
+    $1 = &temp;
+}
+
+%typemap(out, fragment="ByteArray_Python") std::vector<ByteArray>
+{
+    $result = PyList_New($1.size());
+    for (size_t i = 0; $result != NULL && i < $1.size(); i++)
+    {
+        PyObject* item = ByteArray_ToPython($1[i]);
+        if (item == NULL)
+        {
+            Py_DECREF($result);
+            $result = NULL;
+            break;
+        }
+        PyList_SET_ITEM($result, i, item);
+    }
+    if ($result == NULL)
+        SWIG_fail;
+}
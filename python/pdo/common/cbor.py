@@ -0,0 +1,170 @@
+# Copyright 2018 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+cbor.py -- encoder and decoder for the subset of CBOR (RFC 7049) used
+on the binary wire: integers, byte and text strings, arrays, maps,
+booleans, null and floating point numbers, all with definite lengths.
+Byte strings carry ciphertext as is rather than base64 encoded.
+"""
+
+import struct
+
+__all__ = [ 'dumps', 'loads' ]
+
+_UNSIGNED = 0
+_NEGATIVE = 1
+_BYTES = 2
+_STRING = 3
+_ARRAY = 4
+_MAP = 5
+_TAG = 6
+_SIMPLE = 7
+
+# -----------------------------------------------------------------
+# -----------------------------------------------------------------
+def _head(major, value, output) :
+    if value < 24 :
+        output.append((major << 5) | value)
+    elif value <= 0xff :
+        output.append((major << 5) | 24)
+        output.append(value)
+    elif value <= 0xffff :
+        output.append((major << 5) | 25)
+        output += struct.pack('>H', value)
+    elif value <= 0xffffffff :
+        output.append((major << 5) | 26)
+        output += struct.pack('>I', value)
+    elif value <= 0xffffffffffffffff :
+        output.append((major << 5) | 27)
+        output += struct.pack('>Q', value)
+    else :
+        raise ValueError('integer too large for cbor')
+
+def _encode(value, output) :
+    # bool must be tested before int since it is a subclass
+    if value is None :
+        output.append(0xf6)
+    elif value is True :
+        output.append(0xf5)
+    elif value is False :
+        output.append(0xf4)
+    elif isinstance(value, int) :
+        if value >= 0 :
+            _head(_UNSIGNED, value, output)
+        else :
+            _head(_NEGATIVE, -1 - value, output)
+    elif isinstance(value, float) :
+        output.append(0xfb)
+        output += struct.pack('>d', value)
+    elif isinstance(value, str) :
+        encoded = value.encode('utf8')
+        _head(_STRING, len(encoded), output)
+        output += encoded
+    elif isinstance(value, (bytes, bytearray, memoryview)) :
+        _head(_BYTES, len(value), output)
+        output += value
+    elif isinstance(value, (list, tuple)) :
+        _head(_ARRAY, len(value), output)
+        for item in value :
+            _encode(item, output)
+    elif isinstance(value, dict) :
+        _head(_MAP, len(value), output)
+        for (k, v) in value.items() :
+            _encode(k, output)
+            _encode(v, output)
+    else :
+        raise TypeError('unable to encode {0} as cbor'.format(type(value).__name__))
+
+def dumps(value) :
+    """serialize a value to cbor, returns bytes
+    """
+    output = bytearray()
+    _encode(value, output)
+    return bytes(output)
+
+# -----------------------------------------------------------------
+# -----------------------------------------------------------------
+class _Decoder(object) :
+    def __init__(self, data) :
+        self.data = memoryview(data).cast('B')
+        self.position = 0
+
+    def take(self, count) :
+        if count > len(self.data) - self.position :
+            raise ValueError('unexpected end of cbor data')
+        start = self.position
+        self.position += count
+        return self.data[start:self.position]
+
+    def argument(self, info) :
+        if info < 24 :
+            return info
+        if info == 24 :
+            return self.take(1)[0]
+        if info == 25 :
+            return struct.unpack('>H', self.take(2))[0]
+        if info == 26 :
+            return struct.unpack('>I', self.take(4))[0]
+        if info == 27 :
+            return struct.unpack('>Q', self.take(8))[0]
+        raise ValueError('unsupported cbor item length')
+
+    def decode(self) :
+        initial = self.take(1)[0]
+        major = initial >> 5
+        info = initial & 0x1f
+
+        if major == _SIMPLE :
+            if info == 20 : return False
+            if info == 21 : return True
+            if info == 22 or info == 23 : return None
+            if info == 25 :
+                return struct.unpack('>e', self.take(2))[0]
+            if info == 26 :
+                return struct.unpack('>f', self.take(4))[0]
+            if info == 27 :
+                return struct.unpack('>d', self.take(8))[0]
+            raise ValueError('unsupported cbor simple value')
+
+        value = self.argument(info)
+        if major == _UNSIGNED :
+            return value
+        if major == _NEGATIVE :
+            return -1 - value
+        if major == _BYTES :
+            return bytes(self.take(value))
+        if major == _STRING :
+            return str(self.take(value), 'utf8')
+        if major == _ARRAY :
+            return [ self.decode() for i in range(value) ]
+        if major == _MAP :
+            result = dict()
+            for i in range(value) :
+                k = self.decode()
+                result[k] = self.decode()
+            return result
+
+        # tags carry no meaning for the wire format, return the tagged item
+        return self.decode()
+
+def loads(data) :
+    """deserialize a single cbor item from a bytes-like object; byte
+    strings are returned as bytes
+    """
+    decoder = _Decoder(data)
+    value = decoder.decode()
+    if decoder.position != len(decoder.data) :
+        raise ValueError('trailing data after cbor item')
+    return value
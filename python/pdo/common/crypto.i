@@ -81,11 +81,15 @@
 %include "std_string.i"
 %include "std_vector.i"
 %include "stdint.i"
+%include "byte_array.i"
 
 %rename(SIG_PrivateKey) pdo::crypto::sig::PrivateKey;
 %rename(SIG_PublicKey) pdo::crypto::sig::PublicKey;
 %rename(PKENC_PrivateKey) pdo::crypto::pkenc::PrivateKey;
 %rename(PKENC_PublicKey) pdo::crypto::pkenc::PublicKey;
+%rename(ECDH_PrivateKey) pdo::crypto::ecdh::PrivateKey;
+%rename(ECDH_PublicKey) pdo::crypto::ecdh::PublicKey;
+%rename(ECDH_IsEnvelope) pdo::crypto::ecdh::IsEnvelope;
 
 %rename(SKENC_GenerateKey) pdo::crypto::skenc::GenerateKey;
 %rename(SKENC_GenerateIV) pdo::crypto::skenc::GenerateIV;
@@ -99,24 +103,36 @@
 %rename(compute_message_hash) ComputeMessageHash;
 %rename(random_bit_string) RandomBitString;
 
+%rename(MERKLE_ComputeLeafHash) pdo::crypto::merkle::ComputeLeafHash;
+%rename(MERKLE_ComputeRoot) pdo::crypto::merkle::ComputeRoot;
+%rename(MERKLE_ComputeProof) pdo::crypto::merkle::ComputeProof;
+%rename(MERKLE_VerifyProof) pdo::crypto::merkle::VerifyProof;
+
 namespace std {
     %template(__byte_array__) vector<uint8_t>;
     %template(__char_array__) vector<char>;
+    %template(__byte_array_list__) vector<vector<uint8_t>>;
 }
 
 %ignore ByteArrayToString;
+%ignore pdo::crypto::ecdh::EncodePoint;
+%ignore pdo::crypto::ecdh::AgreeKey;
 
 %include "types.h"
 %include "crypto.h"
 %include "crypto_utils.h"
 %include "crypto_shared.h"
+%include "merkle.h"
 %include "sig.h"
 %include "pkenc.h"
 %include "skenc.h"
+%include "ecdh.h"
 %include "sig_private_key.h"
 %include "sig_public_key.h"
 %include "pkenc_private_key.h"
 %include "pkenc_public_key.h"
+%include "ecdh_private_key.h"
+%include "ecdh_public_key.h"
 
 %pythoncode %{
 __all__ = [
@@ -124,6 +140,9 @@ __all__ = [
     "SIG_PublicKey",
     "PKENC_PrivateKey",
     "PKENC_PublicKey",
+    "ECDH_PrivateKey",
+    "ECDH_PublicKey",
+    "ECDH_IsEnvelope",
     "SKENC_Generate_Key",
     "SKENC_GenerateIV",
     "SKENC_EncryptMessage",
@@ -135,20 +154,23 @@ __all__ = [
     "string_to_byte_array",
     "byte_array_to_string",
     "compute_message_hash",
-    "random_bit_string"
+    "random_bit_string",
+    "MERKLE_ComputeLeafHash",
+    "MERKLE_ComputeRoot",
+    "MERKLE_ComputeProof",
+    "MERKLE_VerifyProof"
 ]
 
 def string_to_byte_array(s) :
     if type(s) is str :
-        return tuple(bytes(s, 'ascii'))
+        return bytes(s, 'ascii')
     elif type(s) is bytes :
-        return tuple(s)
-    elif type(s) is tuple :
         return s
+    elif type(s) is tuple :
+        return bytes(s)
     else :
         raise ValueError('unknown type')
 
 def byte_array_to_string(b) :
-    from array import array
-    return array('B', b).tobytes().decode('ascii')
+    return bytes(b).decode('ascii')
 %}
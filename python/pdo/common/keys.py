@@ -74,19 +74,33 @@ class EnclaveKeys(object) :
     Wrapper for managing the enclave's keys, the verifying_key is an
     ECDSA public key used to verify enclave signatures, the
     encryption_key is an RSA public key for encrypting message to the
-    enclave.
+    enclave. Enclaves may also publish an agreement_key, an ECDH public
+    key signed with the verifying key; only request session keys are
+    encrypted to it, through encrypt_session_key, since the enclave
+    decrypts those much more cheaply. Everything else, provisioning
+    secrets included, must go through encrypt with the RSA key.
     """
 
     # -------------------------------------------------------
-    def __init__(self, verifying_key, encryption_key) :
+    def __init__(self, verifying_key, encryption_key, agreement_key = None, agreement_key_signature = None) :
         """
         initialize the object
 
         :param verifying_key: PEM encoded ECDSA verifying key
         :param encryption_key: PEM encoded RSA encryption key
+        :param agreement_key: PEM encoded ECDH public key, optional
+        :param agreement_key_signature: base64 encoded signature of agreement_key by the enclave
         """
         self._verifying_key = crypto.SIG_PublicKey(verifying_key)
         self._encryption_key = crypto.PKENC_PublicKey(encryption_key)
+        self._agreement_key = None
+        self._agreement_key_signature = None
+
+        if agreement_key :
+            if not agreement_key_signature or self.verify(agreement_key, agreement_key_signature) <= 0 :
+                raise ValueError('invalid signature on enclave agreement key')
+            self._agreement_key = crypto.ECDH_PublicKey(agreement_key)
+            self._agreement_key_signature = agreement_key_signature
 
     # -------------------------------------------------------
     @property
@@ -103,6 +117,9 @@ class EnclaveKeys(object) :
         result = dict()
         result['verifying_key'] = self._verifying_key.Serialize()
         result['encryption_key'] = self._encryption_key.Serialize()
+        if self._agreement_key :
+            result['agreement_key'] = self._agreement_key.Serialize()
+            result['agreement_key_signature'] = self._agreement_key_signature
         return result
 
     # -------------------------------------------------------
@@ -144,12 +161,29 @@ class EnclaveKeys(object) :
     # -------------------------------------------------------
     def encrypt(self, message, encoding = 'raw') :
         """
-        encrypt a message to send privately to the enclave
+        encrypt a message to send privately to the enclave with the
+        enclave RSA encryption key
 
         :param message: text to encrypt
         :param encoding: encoding for the encrypted cipher text, one of raw, hex, b64
         """
+        return self.__encrypt(self._encryption_key, message, encoding)
+
+    # -------------------------------------------------------
+    def encrypt_session_key(self, session_key, encoding = 'raw') :
+        """
+        encrypt a request session key for the enclave; the ECDH
+        agreement key is used when the enclave published one, only
+        session keys are decrypted by the enclave in either form
+
+        :param session_key: session key to encrypt
+        :param encoding: encoding for the encrypted cipher text, one of raw, hex, b64
+        """
+        key = self._agreement_key if self._agreement_key else self._encryption_key
+        return self.__encrypt(key, session_key, encoding)
 
+    # -------------------------------------------------------
+    def __encrypt(self, key, message, encoding) :
         if type(message) is bytes :
             message_byte_array = message
         elif type(message) is tuple :
@@ -157,7 +191,7 @@ class EnclaveKeys(object) :
         else :
             message_byte_array = bytes(message, 'ascii')
 
-        encrypted_byte_array = self._encryption_key.EncryptMessage(message_byte_array)
+        encrypted_byte_array = key.EncryptMessage(message_byte_array)
         if encoding == 'raw' :
             encoded_bytes = encrypted_byte_array
         elif encoding == 'hex' :
@@ -0,0 +1,99 @@
+# Copyright 2018 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+wire.py -- message encodings shared by the service clients and the
+HTTP servers. Requests and responses are dictionaries sent either as
+JSON or as CBOR; binary fields such as ciphertext are raw bytes in
+CBOR and base64 encoded strings in JSON.
+"""
+
+import base64
+import json
+
+import pdo.common.cbor as cbor
+
+__all__ = [
+    'JSON_ENCODING',
+    'CBOR_ENCODING',
+    'SUPPORTED_ENCODINGS',
+    'encode_message',
+    'decode_message',
+    'encode_binary',
+    'decode_binary',
+    'select_encoding'
+    ]
+
+JSON_ENCODING = 'application/json'
+CBOR_ENCODING = 'application/cbor'
+
+# in order of preference
+SUPPORTED_ENCODINGS = [ CBOR_ENCODING, JSON_ENCODING ]
+
+# -----------------------------------------------------------------
+# -----------------------------------------------------------------
+def encode_message(message, encoding) :
+    """serialize a message dictionary, returns bytes
+    """
+    if encoding == CBOR_ENCODING :
+        return cbor.dumps(message)
+    if encoding == JSON_ENCODING :
+        return json.dumps(message).encode('utf8')
+    raise ValueError('unsupported message encoding {0}'.format(encoding))
+
+def decode_message(data, encoding) :
+    """deserialize a message from the bytes received with the
+    content type in encoding
+    """
+    if encoding == CBOR_ENCODING :
+        return cbor.loads(data)
+    if encoding == JSON_ENCODING :
+        if isinstance(data, (bytes, bytearray)) :
+            data = data.decode('utf8')
+        return json.loads(data)
+    raise ValueError('unsupported message encoding {0}'.format(encoding))
+
+# -----------------------------------------------------------------
+# -----------------------------------------------------------------
+def encode_binary(value, encoding) :
+    """prepare a bytes-like value for a message in the given encoding
+    """
+    if encoding == JSON_ENCODING :
+        return base64.b64encode(value).decode('ascii')
+    return bytes(value)
+
+def decode_binary(value) :
+    """return the bytes of a binary field; a string is taken to be
+    base64 encoded so JSON peers are handled whatever the encoding
+    """
+    if isinstance(value, str) :
+        return base64.b64decode(value)
+    return bytes(value)
+
+# -----------------------------------------------------------------
+# -----------------------------------------------------------------
+def select_encoding(accept, default) :
+    """pick the response encoding from an HTTP Accept header, the
+    first supported type listed wins; without an acceptable type the
+    response uses the default, normally the encoding of the request
+    """
+    if not accept :
+        return default
+
+    for entry in accept.split(',') :
+        content_type = entry.split(';')[0].strip().lower()
+        if content_type in SUPPORTED_ENCODINGS :
+            return content_type
+
+    return default
@@ -110,8 +110,11 @@ class Contract(object) :
 
     # -------------------------------------------------------
     # state -- base64 encoded, encrypted state
-    def set_state(self, state) :
-        self.contract_state.encrypted_state = state
+    # delta -- base64 encoded, encrypted delta from the current state
+    # enclave_id -- enclave that produced the state, if it may be cached there
+    # state_hash -- hash of the new state, required with a delta
+    def set_state(self, state, delta = None, enclave_id = None, state_hash = None) :
+        self.contract_state.update_state(state, delta, enclave_id, state_hash)
 
     # -------------------------------------------------------
     def create_initialize_request(self, request_originator_keys, enclave_service) :
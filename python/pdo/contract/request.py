@@ -19,11 +19,28 @@ import pdo.common.keys as keys
 
 from pdo.contract.response import ContractResponse
 from pdo.contract.message import ContractMessage
+from pdo.contract.state import ContractState
 from pdo.submitter.submitter import Submitter
 
 import logging
 logger = logging.getLogger(__name__)
 
+# sessions established with enclaves, indexed by enclave id; each
+# entry holds the session key and the id the enclave assigned to it
+__sessions__ = {}
+
+# file that receives a copy of every request evaluated, one JSON object
+# per line; the copy holds the operation, the contract code and the
+# message but neither the state nor any key, it is the input for the
+# gipsy-profile tool that replays requests outside the enclave
+__request_log__ = os.environ.get('PDO_REQUEST_LOG')
+
+def record_requests(filename) :
+    """set the file requests are recorded to, None turns recording off
+    """
+    global __request_log__
+    __request_log__ = filename
+
 # -----------------------------------------------------------------
 # -----------------------------------------------------------------
 class ContractRequest(object) :
@@ -47,6 +64,13 @@ class ContractRequest(object) :
         self.contract_state = contract.contract_state
         self.message = ContractMessage(self.originator_keys, self.channel_keys, **kwargs)
 
+        self.send_state_by_hash = False
+        self.send_state_cached = False
+
+        # ask the enclave to return the interpreter statistics for the
+        # request, see ContractResponse.statistics
+        self.return_statistics = kwargs.get('return_statistics', False)
+
     @property
     def enclave_keys(self) :
         return self.enclave_service.enclave_keys
@@ -58,50 +82,197 @@ class ContractRequest(object) :
         result['CreatorID'] = self.creator_id
         result['EncryptedStateEncryptionKey'] = self.encrypted_state_encryption_key
 
-        result['ContractState'] = self.contract_state.serialize()
+        result['ContractState'] = self.contract_state.serialize(self.send_state_by_hash, self.send_state_cached)
         result['ContractCode'] = self.contract_code.serialize()
         result['ContractMessage'] = self.message.serialize()
 
+        if self.return_statistics :
+            result['ReturnStatistics'] = True
+
         return json.dumps(result)
 
+    def __record(self) :
+        if not __request_log__ :
+            return
+
+        record = dict()
+        record['Operation'] = self.operation
+        record['ContractID'] = self.contract_id
+        record['CreatorID'] = self.creator_id
+        record['ContractCode'] = { 'Code' : self.contract_code.code, 'Name' : self.contract_code.name }
+        record['ContractMessage'] = {
+            'Expression' : self.message.expression,
+            'OriginatorVerifyingKey' : self.message.originator_verifying_key
+        }
+
+        try :
+            with open(__request_log__, 'a') as logfile :
+                logfile.write(json.dumps(record) + '\n')
+        except Exception as e :
+            logger.warning('unable to record request; %s', str(e))
+
     def __encrypt_session_key(self) :
-        encrypted_key = self.enclave_keys.encrypt(self.session_key)
-        return crypto.byte_array_to_base64(encrypted_key)
+        return bytes(self.enclave_keys.encrypt_session_key(self.session_key))
 
-    def __encrypt_request(self) :
-        serialized_byte_array = crypto.string_to_byte_array(self.__serialize_for_encryption())
-        encrypted_request = crypto.SKENC_EncryptMessage(self.session_key, serialized_byte_array)
-        return crypto.byte_array_to_base64(encrypted_request)
+    def __establish_session(self) :
+        """reuse or create a session with the enclave so the session key is
+        decrypted once rather than on every request; returns the session
+        id or None if the enclave service does not support sessions
+        """
+        if not hasattr(self.enclave_service, 'create_session') :
+            return None
 
-    # response -- base64 encode, response encrypted with session key
-    def __decrypt_response(self, response) :
-        decoded_response = crypto.base64_to_byte_array(response)
-        return crypto.SKENC_DecryptMessage(self.session_key, decoded_response)
+        enclave_id = self.enclave_service.enclave_id
+        session = __sessions__.get(enclave_id)
+        if session is None :
+            session_id = self.enclave_service.create_session(self.__encrypt_session_key())
+            if not session_id :
+                return None
+            session = (self.session_key, session_id)
+            __sessions__[enclave_id] = session
+
+        (self.session_key, session_id) = session
+        return session_id
+
+    def __send(self) :
+        try :
+            session_id = self.__establish_session()
+            if session_id :
+                encrypted_request = self.__encrypt_request()
+                response = self.enclave_service.send_to_contract_in_session(session_id, encrypted_request)
+                if response :
+                    return response
+
+                # the session may have expired or the enclave restarted
+                __sessions__.pop(self.enclave_service.enclave_id, None)
+                self.session_key = crypto.SKENC_GenerateKey()
+        except Exception as e :
+            logger.info('session request failed; %s', str(e))
+            __sessions__.pop(self.enclave_service.enclave_id, None)
+            self.session_key = crypto.SKENC_GenerateKey()
 
-    # enclave_service -- enclave service wrapper object
-    def evaluate(self) :
         encrypted_session_key = self.__encrypt_session_key()
         encrypted_request = self.__encrypt_request()
+        return self.enclave_service.send_to_contract(encrypted_session_key, encrypted_request)
+
+    def __encrypt_request(self) :
+        serialized_byte_array = crypto.string_to_byte_array(self.__serialize_for_encryption())
+        return bytes(crypto.SKENC_EncryptMessage(self.session_key, serialized_byte_array))
+
+    def __stage_state(self) :
+        """determine if the enclave can get the state without it being in
+        the request: either the enclave produced the state and holds it in
+        its state cache or the state is in the enclave service block store,
+        in which case it is pushed there if necessary; with a delta chain
+        only the checkpoint goes to the block store
+        """
+        if not self.contract_state.state_hash :
+            return False
+
+        if self.contract_state.cached_enclave_id == self.enclave_service.enclave_id :
+            self.send_state_cached = True
+            return True
+
+        encrypted_state = self.contract_state.base_state
+
+        # local enclaves used in tests may not provide a block store
+        if not hasattr(self.enclave_service, 'push_state_block') :
+            return False
 
         try :
-            encoded_encrypted_response = self.enclave_service.send_to_contract(encrypted_session_key, encrypted_request)
-            assert encoded_encrypted_response
+            state_hash = ContractState.compute_hash(encrypted_state, encoding='b64')
+            if state_hash in self.enclave_service.check_state_blocks([state_hash]) :
+                return True
+            state_bytes = crypto.base64_to_byte_array(encrypted_state)
+            return self.enclave_service.push_state_block(state_bytes) == state_hash
+        except Exception as e :
+            logger.info('unable to stage state with the enclave service; %s', str(e))
+            return False
 
-            logger.debug("raw response from enclave: %s", encoded_encrypted_response)
-        except :
-            logger.exception('contract invocation failed')
-            raise
+    # response -- response encrypted with session key
+    def __decrypt_response(self, response) :
+        return crypto.SKENC_DecryptMessage(self.session_key, response)
 
+    # encrypted_response -- response from the enclave
+    def __process_response(self, encrypted_response) :
         try :
-            decrypted_response = self.__decrypt_response(encoded_encrypted_response)
+            decrypted_response = self.__decrypt_response(encrypted_response)
             response_string = crypto.byte_array_to_string(decrypted_response)
             response_parsed = json.loads(response_string[0:-1])
 
             logger.debug("parsed response: %s", response_parsed)
 
-            contract_response = ContractResponse(self, response_parsed)
+            return ContractResponse(self, response_parsed)
         except :
             logger.exception('contract response is invalid')
             raise
 
+    # enclave_service -- enclave service wrapper object
+    def evaluate(self, stage_state = True) :
+        self.send_state_cached = False
+        self.send_state_by_hash = stage_state and self.__stage_state()
+
+        try :
+            encrypted_response = self.__send()
+            assert encrypted_response
+
+            logger.debug("raw response from enclave: %d bytes", len(encrypted_response))
+        except :
+            logger.exception('contract invocation failed')
+            raise
+
+        contract_response = self.__process_response(encrypted_response)
+
+        # the enclave could not find the state, send the full state
+        if contract_response.state_cache_miss and self.send_state_by_hash :
+            logger.info('state not available to the enclave; resending with full state')
+            self.contract_state.cached_enclave_id = None
+            return self.evaluate(stage_state = False)
+
+        self.__record()
+        return contract_response
+
+    # the pair sent for this request as part of a batch, the full state
+    # is always included
+    def batch_entry(self) :
+        self.send_state_by_hash = False
+        self.send_state_cached = False
+        return (self.__encrypt_session_key(), self.__encrypt_request())
+
+    # encrypted_response -- the response to batch_entry
+    def batch_response(self, encrypted_response) :
+        if not encrypted_response :
+            raise Exception('contract invocation failed in batch')
+        contract_response = self.__process_response(encrypted_response)
+        self.__record()
         return contract_response
+
+# -----------------------------------------------------------------
+# requests -- list of ContractRequest objects for the same enclave service
+# -----------------------------------------------------------------
+def evaluate_batch(requests) :
+    """evaluate a list of requests with one call to the enclave service;
+    the enclave signs the responses together so each successful response
+    carries a batch proof. Returns a list with a ContractResponse or an
+    exception for each request.
+    """
+    if not requests :
+        return []
+
+    enclave_service = requests[0].enclave_service
+    if any(r.enclave_service.enclave_id != enclave_service.enclave_id for r in requests) :
+        raise ValueError('batched requests must target the same enclave')
+
+    entries = [ r.batch_entry() for r in requests ]
+    encrypted_responses = enclave_service.send_to_contract_batch(entries)
+    if encrypted_responses is None or len(encrypted_responses) != len(requests) :
+        raise Exception('contract batch invocation failed')
+
+    results = []
+    for (request, encrypted_response) in zip(requests, encrypted_responses) :
+        try :
+            results.append(request.batch_response(encrypted_response))
+        except Exception as e :
+            results.append(e)
+
+    return results
@@ -100,10 +100,19 @@ class ContractResponse(object) :
         """
         self.status = response['Status']
         self.result = response['Result']
+        self.state_cache_miss = response.get('StateCacheMiss', False)
+
+        # interpreter statistics, only present when the request asked
+        # for them; they are not covered by the signature
+        self.statistics = response.get('Statistics')
 
         if self.status :
             self.signature = response['Signature']
-            self.encrypted_state = response['State']
+            self.batch_proof = response.get('BatchProof')
+            # the enclave returns either the full state or, when asked
+            # for one, a delta from the request state and the new hash
+            self.encrypted_state = response.get('State', '')
+            self.encrypted_state_delta = response.get('StateDelta')
 
             # we have another mismatch between the field names in the enclave
             # and the field names expected in the transaction; this needs to
@@ -120,13 +129,17 @@ class ContractResponse(object) :
             self.creator_id = request.creator_id
             self.code_hash = request.contract_code.compute_hash()
             self.message_hash = request.message.compute_hash()
-            self.new_state_hash = ContractState.compute_hash(self.encrypted_state)
+            if self.encrypted_state_delta :
+                # the signature check below covers the reported hash
+                self.new_state_hash = crypto.base64_to_byte_array(response['StateHash'])
+            else :
+                self.new_state_hash = ContractState.compute_hash(self.encrypted_state)
             self.originator_keys = request.originator_keys
             self.enclave_service = request.enclave_service
 
             self.old_state_hash = ()
             if request.operation != 'initialize' :
-                self.old_state_hash = ContractState.compute_hash(request.contract_state.encrypted_state)
+                self.old_state_hash = crypto.base64_to_byte_array(request.contract_state.state_hash)
 
             if not self.__verify_enclave_signature(request.enclave_keys) :
                 raise Exception('failed to verify enclave signature')
@@ -136,8 +149,29 @@ class ContractResponse(object) :
         """verify the signature of the response
         """
         message = self.__serialize_for_signing()
+        if self.batch_proof :
+            message = self.__verify_batch_proof(message)
+            if message is None :
+                return False
+
         return enclave_keys.verify(message, self.signature, encoding = 'b64')
 
+    # -------------------------------------------------------
+    def __verify_batch_proof(self, message) :
+        """check that the response is included in the signed batch; returns
+        the message covered by the batch signature or None
+        """
+        root = crypto.base64_to_byte_array(self.batch_proof['Root'])
+        index = int(self.batch_proof['Index'])
+        count = int(self.batch_proof['Count'])
+        proof = [ crypto.base64_to_byte_array(h) for h in self.batch_proof['Proof'] ]
+
+        leaf_hash = crypto.MERKLE_ComputeLeafHash(message)
+        if not crypto.MERKLE_VerifyProof(root, leaf_hash, index, count, proof) :
+            return None
+
+        return root + count.to_bytes(4, 'big')
+
     # -------------------------------------------------------
     def __serialize_for_signing(self) :
         """serialize the response for enclave signature verification"""
@@ -189,6 +223,7 @@ class ContractResponse(object) :
             b64_new_state_hash,
             self.encrypted_state,
             b64_code_hash,
+            batch_proof = self.batch_proof,
             **extra_params)
 
         if txnid :
@@ -242,7 +277,9 @@ class ContractResponse(object) :
         if txn_dependencies :
             extra_params['transaction_dependency_list'] = list(txn_dependencies)
 
-        # now send off the transaction to the ledger
+        # now send off the transaction to the ledger; the encrypted state
+        # is optional in the transaction and is empty when the enclave
+        # returned a state delta
         txnid = update_submitter.submit_ccl_update_from_data(
             self.originator_keys.verifying_key,
             self.channel_keys.txn_public,
@@ -254,6 +291,7 @@ class ContractResponse(object) :
             b64_old_state_hash,
             self.encrypted_state,
             self.dependencies,
+            batch_proof = self.batch_proof,
             **extra_params)
 
         if txnid :
@@ -13,6 +13,7 @@
 # limitations under the License.
 import os
 import json
+import struct
 
 import pdo.common.crypto as crypto
 import pdo.common.utility as putils
@@ -21,19 +22,68 @@ import sawtooth.helpers.pdo_connect
 import logging
 logger = logging.getLogger(__name__)
 
+# must match STATE_DELTA_CHECKPOINT_INTERVAL in the enclave; a full state
+# is required once a chain would reach this length, so at most 15 deltas
+# follow a full state
+STATE_DELTA_CHECKPOINT_INTERVAL = 16
+
 # -----------------------------------------------------------------
 # -----------------------------------------------------------------
 class ContractState(object) :
     __path__ = '__state_cache__'
     __extension__ = '.ctx'
 
+    # --------------------------------------------------
+    @staticmethod
+    def split_chunked_state(state_byte_array) :
+        """split a chunked encrypted state into its encrypted chunks,
+        returns None if the state does not use the chunked layout
+        """
+        state_bytes = bytes(state_byte_array)
+        state_view = memoryview(state_bytes)
+        if len(state_bytes) < 8 or state_bytes[:4] != b'PDOC' :
+            return None
+
+        (count,) = struct.unpack_from('>I', state_bytes, 4)
+        if count == 0 :
+            return None
+
+        chunks = []
+        offset = 8
+        for i in range(count) :
+            if len(state_bytes) - offset < 4 :
+                return None
+            (length,) = struct.unpack_from('>I', state_bytes, offset)
+            offset += 4
+            if len(state_bytes) - offset < length :
+                return None
+            chunks.append(state_view[offset:offset+length])
+            offset += length
+
+        if offset != len(state_bytes) :
+            return None
+
+        return chunks
+
     # --------------------------------------------------
     @staticmethod
     def compute_hash(encrypted_state, encoding = 'raw') :
-        """ compute the hash of the encrypted state
+        """ compute the hash of the encrypted state; for a chunked
+        state this is the Merkle root over the encrypted chunks
+
+        :param encrypted_state: base64 encoded state or the decoded bytes
         """
-        state_byte_array = crypto.base64_to_byte_array(encrypted_state)
-        state_hash = crypto.compute_message_hash(state_byte_array)
+        if type(encrypted_state) is str :
+            state_byte_array = crypto.base64_to_byte_array(encrypted_state)
+        else :
+            state_byte_array = encrypted_state
+        chunks = ContractState.split_chunked_state(state_byte_array)
+        if chunks is None :
+            state_hash = crypto.compute_message_hash(state_byte_array)
+        else :
+            leaf_hashes = [ crypto.MERKLE_ComputeLeafHash(c) for c in chunks ]
+            state_hash = crypto.MERKLE_ComputeRoot(leaf_hashes)
+
         if encoding == 'raw' :
             return state_hash
         elif encoding == 'b64' :
@@ -43,6 +93,23 @@ class ContractState(object) :
 
         raise ValueError('unknown encoding; {}'.format(encoding))
 
+    # --------------------------------------------------
+    @staticmethod
+    def verify_chunk(state_hash, chunk, index, chunk_count, proof) :
+        """verify that an encrypted chunk belongs to the state with the
+        given hash without access to the rest of the state
+
+        :param state_hash: base64 encoded hash of a chunked state
+        :param chunk: base64 encoded encrypted chunk
+        :param index int: position of the chunk in the state
+        :param chunk_count int: number of chunks in the state
+        :param proof: list of base64 encoded sibling hashes
+        """
+        root = crypto.base64_to_byte_array(state_hash)
+        leaf_hash = crypto.MERKLE_ComputeLeafHash(crypto.base64_to_byte_array(chunk))
+        siblings = [ crypto.base64_to_byte_array(h) for h in proof ]
+        return crypto.MERKLE_VerifyProof(root, leaf_hash, index, chunk_count, siblings)
+
     # --------------------------------------------------
     @staticmethod
     def safe_filename(b64name) :
@@ -72,7 +139,14 @@ class ContractState(object) :
             logger.info('error reading state; %s', str(e))
             raise Exception('failed to read state from cache; {}'.format(contract_id))
 
-        return cls(state_info['ContractID'], state_info.get('EncryptedState'))
+        state = cls(state_info['ContractID'], state_info.get('EncryptedState'))
+        if state_info.get('EncryptedStateDeltas') :
+            state.checkpoint_state = state.encrypted_state
+            state.encrypted_state_deltas = state_info['EncryptedStateDeltas']
+            state.encrypted_state = None
+            state.state_hash = state_info['StateHash']
+
+        return state
 
     # --------------------------------------------------
     @staticmethod
@@ -115,27 +189,124 @@ class ContractState(object) :
 
     # --------------------------------------------------
     @classmethod
-    def create_new_state(cls, contract_id) :
-        return cls(contract_id)
+    def create_new_state(cls, contract_id, chunked_state = False) :
+        return cls(contract_id, chunked_state = chunked_state)
 
     # --------------------------------------------------
-    def __init__(self, contract_id, encrypted_state = '') :
+    def __init__(self, contract_id, encrypted_state = '', emit_state_delta = False, chunked_state = False) :
         self.contract_id = contract_id
         self.encrypted_state = encrypted_state
 
+        # base64 encoded hash of the current state, kept separately since
+        # the full state is not available when the last update was a delta
+        self.state_hash = None
+        if encrypted_state :
+            self.state_hash = ContractState.compute_hash(encrypted_state, encoding='b64')
+
+        # only used when the contract is initialized, afterwards the
+        # enclave keeps the layout of the encrypted state
+        self.chunked_state = chunked_state
+
+        # the enclave that produced the current state keeps it in its
+        # state cache so requests to that enclave need only the hash
+        self.cached_enclave_id = None
+
+        # when the enclave returns deltas, it returns no full state and
+        # requests carry the last full state (the checkpoint) and the
+        # deltas that follow it, unless the enclave holds the current
+        # state in its state cache
+        self.emit_state_delta = emit_state_delta
+        self.checkpoint_state = None
+        self.encrypted_state_deltas = []
+
+    # --------------------------------------------------
+    def update_state(self, encrypted_state, encrypted_state_delta = None, enclave_id = None, state_hash = None) :
+        """move to a new state, extending the delta chain when the
+        enclave produced a delta and starting a new checkpoint otherwise
+
+        :param encrypted_state: base64 encoded, encrypted full state, empty with a delta
+        :param encrypted_state_delta: base64 encoded, encrypted delta from the current state
+        :param enclave_id: identity of the enclave that produced the state, if known
+        :param state_hash: hash of the new state, required with a delta
+        """
+        self.cached_enclave_id = enclave_id
+
+        if encrypted_state_delta :
+            if state_hash is None :
+                raise ValueError('state hash required with a state delta')
+            if self.checkpoint_state is None :
+                self.checkpoint_state = self.encrypted_state
+            self.encrypted_state_deltas.append(encrypted_state_delta)
+            self.encrypted_state = None
+            self.state_hash = crypto.byte_array_to_base64(state_hash)
+        else :
+            self.checkpoint_state = None
+            self.encrypted_state_deltas = []
+            self.encrypted_state = encrypted_state
+            self.state_hash = ContractState.compute_hash(encrypted_state, encoding='b64')
+
+    # --------------------------------------------------
+    @property
+    def base_state(self) :
+        """the full state a request carries, the checkpoint when
+        deltas follow it
+        """
+        if self.encrypted_state_deltas :
+            return self.checkpoint_state
+        return self.encrypted_state
+
+    # --------------------------------------------------
+    def get_chunk(self, index) :
+        """return an encrypted chunk of the current state along with the
+        number of chunks and the proof that ties it to the state hash,
+        all suitable for verify_chunk
+        """
+        if not self.encrypted_state :
+            raise ValueError('full state is not available')
+
+        chunks = ContractState.split_chunked_state(crypto.base64_to_byte_array(self.encrypted_state))
+        if chunks is None :
+            raise ValueError('state is not chunked')
+
+        leaf_hashes = [ crypto.MERKLE_ComputeLeafHash(c) for c in chunks ]
+        proof = crypto.MERKLE_ComputeProof(leaf_hashes, index)
+        return (crypto.byte_array_to_base64(chunks[index]), len(chunks),
+                [ crypto.byte_array_to_base64(h) for h in proof ])
+
     # --------------------------------------------------
-    def serialize(self) :
+    def serialize(self, by_hash = False, cached = False) :
+        """serialize the state for a request
+
+        :param by_hash: the enclave can fetch the base state by its hash
+        :param cached: the enclave holds the current state in its state cache
+        """
         result = dict()
         result['ContractID'] = self.contract_id
-        if self.encrypted_state :
-            result['EncryptedState'] = self.encrypted_state
+        base_state = self.base_state
+        if cached and self.state_hash :
+            result['StateHash'] = self.state_hash
+        else :
+            if by_hash and base_state :
+                result['StateHash'] = ContractState.compute_hash(base_state, encoding='b64')
+            elif base_state :
+                result['EncryptedState'] = base_state
+            elif self.chunked_state :
+                result['ChunkedState'] = True
+
+            if base_state and self.encrypted_state_deltas :
+                result['EncryptedStateDeltas'] = self.encrypted_state_deltas
+
+        # the enclave only counts the deltas in the request, so the
+        # client ends the chain to get a new checkpoint
+        if self.emit_state_delta and len(self.encrypted_state_deltas) + 1 < STATE_DELTA_CHECKPOINT_INTERVAL :
+            result['EmitStateDelta'] = True
 
         return result
 
     # --------------------------------------------------
     def save_to_cache(self, data_dir = "./data") :
         contract_id = ContractState.safe_filename(self.contract_id)
-        state_hash = ContractState.compute_hash(self.encrypted_state, encoding='hex')
+        state_hash = crypto.byte_array_to_hex(crypto.base64_to_byte_array(self.state_hash))
 
         cache_dir = os.path.join(data_dir, self.__path__, contract_id)
         filename = putils.build_file_name(state_hash, cache_dir, '.ctx')
@@ -145,7 +316,11 @@ class ContractState(object) :
         try :
             logger.debug('save contract state to file %s', filename)
             with open(filename, 'w') as statefile :
-                json.dump(self.serialize(), statefile)
+                state_info = { 'ContractID' : self.contract_id, 'EncryptedState' : self.base_state }
+                if self.encrypted_state_deltas :
+                    state_info['EncryptedStateDeltas'] = self.encrypted_state_deltas
+                    state_info['StateHash'] = self.state_hash
+                json.dump(state_info, statefile)
         except Exception as e :
             logger.info('failed to save state; %s', str(e))
             raise Exception('unable to cache state {}'.format(filename))
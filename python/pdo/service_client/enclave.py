@@ -18,13 +18,21 @@ logger = logging.getLogger(__name__)
 from pdo.service_client.generic import GenericServiceClient
 from pdo.service_client.generic import MessageException
 from pdo.common.keys import EnclaveKeys
+import pdo.common.wire as wire
 
 class EnclaveServiceClient(GenericServiceClient) :
+    """Client for the enclave service; binary arguments and results are
+    bytes, they are sent as is with CBOR and base64 encoded with JSON
+    """
 
-    def __init__(self, url) :
-        super().__init__(url)
+    def __init__(self, url, encoding = None) :
+        super().__init__(url, encoding)
         enclave_info = self.get_enclave_public_info()
-        self.enclave_keys = EnclaveKeys(enclave_info['verifying_key'], enclave_info['encryption_key'])
+        self.enclave_keys = EnclaveKeys(
+            enclave_info['verifying_key'],
+            enclave_info['encryption_key'],
+            enclave_info.get('agreement_key'),
+            enclave_info.get('agreement_key_signature'))
 
     @property
     def verifying_key(self) :
@@ -39,17 +47,19 @@ class EnclaveServiceClient(GenericServiceClient) :
         return self.enclave_keys.identity
 
     # -----------------------------------------------------------------
-    # encrypted_session_key -- base64 aes key encrypted with enclave's rsa key
-    # encrypted_request -- base64 string encrypted with aes session key
+    # encrypted_session_key -- aes key encrypted with enclave's rsa key or
+    #     to its ecdh agreement key
+    # encrypted_request -- request encrypted with aes session key
+    # returns the encrypted response
     # -----------------------------------------------------------------
     def send_to_contract(self, encrypted_session_key, encrypted_request) :
         request = { 'operation' : 'UpdateContractRequest' }
-        request['encrypted_session_key'] = encrypted_session_key
-        request['encrypted_request'] = encrypted_request
+        request['encrypted_session_key'] = self.encode_binary(encrypted_session_key)
+        request['encrypted_request'] = self.encode_binary(encrypted_request)
 
         try :
             response = self._postmsg(request)
-            return response['result']
+            return wire.decode_binary(response['result'])
 
         except MessageException as me :
             logger.warn('unable to contact enclave service (update_contract); %s', me)
@@ -59,6 +69,113 @@ class EnclaveServiceClient(GenericServiceClient) :
             logger.exception('update_contract')
             return None
 
+    # -----------------------------------------------------------------
+    # requests -- list of (encrypted_session_key, encrypted_request) pairs
+    # returns the list of encrypted responses
+    # -----------------------------------------------------------------
+    def send_to_contract_batch(self, requests) :
+        request = { 'operation' : 'UpdateContractBatchRequest' }
+        request['requests'] = [
+            {
+                'encrypted_session_key' : self.encode_binary(k),
+                'encrypted_request' : self.encode_binary(r)
+            } for (k, r) in requests ]
+
+        try :
+            response = self._postmsg(request)
+            return [ wire.decode_binary(r) for r in response['results'] ]
+
+        except MessageException as me :
+            logger.warn('unable to contact enclave service (update_contract_batch); %s', me)
+            return None
+
+        except :
+            logger.exception('update_contract_batch')
+            return None
+
+    # -----------------------------------------------------------------
+    # encrypted_session_key -- aes key encrypted with enclave's rsa key or
+    #     to its ecdh agreement key
+    # returns the id of a session bound to the key
+    # -----------------------------------------------------------------
+    def create_session(self, encrypted_session_key) :
+        request = { 'operation' : 'CreateSessionRequest' }
+        request['encrypted_session_key'] = self.encode_binary(encrypted_session_key)
+
+        try :
+            response = self._postmsg(request)
+            return wire.decode_binary(response['session_id'])
+
+        except MessageException as me :
+            logger.warn('unable to contact enclave service (create_session); %s', me)
+            return None
+
+        except :
+            logger.exception('create_session')
+            return None
+
+    # -----------------------------------------------------------------
+    # session_id -- id returned by create_session
+    # encrypted_request -- request encrypted with the session key
+    # returns the encrypted response
+    # -----------------------------------------------------------------
+    def send_to_contract_in_session(self, session_id, encrypted_request) :
+        request = { 'operation' : 'UpdateContractRequest' }
+        request['session_id'] = self.encode_binary(session_id)
+        request['encrypted_request'] = self.encode_binary(encrypted_request)
+
+        try :
+            response = self._postmsg(request)
+            return wire.decode_binary(response['result'])
+
+        except MessageException as me :
+            logger.warn('unable to contact enclave service (update_contract); %s', me)
+            return None
+
+        except :
+            logger.exception('update_contract')
+            return None
+
+    # -----------------------------------------------------------------
+    # encrypted_state -- encrypted contract state
+    # returns the base64 encoded state hash under which it was stored
+    # -----------------------------------------------------------------
+    def push_state_block(self, encrypted_state) :
+        request = { 'operation' : 'PushStateBlockRequest' }
+        request['encrypted_state'] = self.encode_binary(encrypted_state)
+
+        try :
+            response = self._postmsg(request)
+            return response['state_hash']
+
+        except MessageException as me :
+            logger.warn('unable to contact enclave service (push_state_block); %s', me)
+            return None
+
+        except :
+            logger.exception('push_state_block')
+            return None
+
+    # -----------------------------------------------------------------
+    # state_hashes -- list of base64 encoded state hashes
+    # returns the hashes of the states held by the enclave service
+    # -----------------------------------------------------------------
+    def check_state_blocks(self, state_hashes) :
+        request = { 'operation' : 'CheckStateBlockRequest' }
+        request['state_hashes'] = state_hashes
+
+        try :
+            response = self._postmsg(request)
+            return response['state_hashes']
+
+        except MessageException as me :
+            logger.warn('unable to contact enclave service (check_state_blocks); %s', me)
+            return []
+
+        except :
+            logger.exception('check_state_blocks')
+            return []
+
     # -----------------------------------------------------------------
     # contract_id -- 16 character, hex encoded, sha256 hashed, registration transaction signature
     # creator_id -- base64 encoded, sha256 hashed, creator verifying key
@@ -14,10 +14,11 @@
 
 import os
 import sys
-import json
 import urllib.request
 import urllib.error
 
+import pdo.common.wire as wire
+
 import logging
 logger = logging.getLogger(__name__)
 
@@ -29,31 +30,69 @@ class MessageException(Exception) :
 
 class GenericServiceClient(object) :
 
-    def __init__(self, url) :
+    def __init__(self, url, encoding = None) :
+        """encoding forces the message encoding, by default the client
+        offers CBOR and falls back to JSON for servers without it
+        """
         self.ServiceURL = url
         self.ProxyHandler = urllib.request.ProxyHandler({})
+        self.Encoding = encoding or wire.CBOR_ENCODING
+        self.Negotiated = encoding is not None
+
+    def encode_binary(self, value) :
+        """prepare raw bytes for a request field in the current encoding
+        """
+        return wire.encode_binary(value, self.Encoding)
 
     def _postmsg(self, request) :
         """
-        Post a transaction message to the validator, parse the returning JSON and return
-        the corresponding dictionary.
+        Post a transaction message to the service, parse the response
+        and return the corresponding dictionary.
         """
 
-        data = json.dumps(request).encode('utf8')
+        encoding = self.Encoding
+        try :
+            return self.__postmsg(request, encoding)
+
+        except urllib.error.HTTPError as err :
+            # servers that only speak JSON reject the first CBOR request
+            # as a bad request before acting on it
+            if self.Negotiated or err.code not in (400, 415) :
+                logger.warn('operation failed with response: %s', err.code)
+                raise MessageException('operation failed with resonse: {0}'.format(err.code))
+
+        logger.info('%s does not accept %s, falling back to %s', self.ServiceURL, encoding, wire.JSON_ENCODING)
+        self.Encoding = wire.JSON_ENCODING
+        self.Negotiated = True
+        return self._postmsg(self.__reencode(request, encoding))
+
+    def __reencode(self, request, encoding) :
+        # binary fields were prepared for the rejected encoding
+        if isinstance(request, dict) :
+            return { k : self.__reencode(v, encoding) for (k, v) in request.items() }
+        if isinstance(request, list) :
+            return [ self.__reencode(v, encoding) for v in request ]
+        if isinstance(request, bytes) :
+            return self.encode_binary(request)
+        return request
+
+    def __postmsg(self, request, encoding) :
+        data = wire.encode_message(request, encoding)
         datalen = len(data)
 
         url = self.ServiceURL
 
-        logger.debug('post transaction to %s with DATALEN=%d, DATA=<%s>', url, datalen, data)
+        logger.debug('post transaction to %s with DATALEN=%d', url, datalen)
+
+        headers = { 'Content-Type' : encoding, 'Accept' : encoding, 'Content-Length' : datalen }
 
         try :
-            request = urllib.request.Request(url, data, {'Content-Type': 'application/json', 'Content-Length': datalen})
+            request = urllib.request.Request(url, data, headers)
             opener = urllib.request.build_opener(self.ProxyHandler)
             response = opener.open(request, timeout=10)
 
-        except urllib.error.HTTPError as err :
-            logger.warn('operation failed with response: %s', err.code)
-            raise MessageException('operation failed with resonse: {0}'.format(err.code))
+        except urllib.error.HTTPError :
+            raise
 
         except urllib.error.URLError as err :
             logger.warn('operation failed: %s', err.reason)
@@ -67,15 +106,11 @@ class GenericServiceClient(object) :
         headers = response.info()
         response.close()
 
-        encoding = headers.get('Content-Type')
-        if encoding != 'application/json' :
-            logger.info('server responds with message %s of type %s', content, encoding)
+        self.Negotiated = True
+
+        content_type = headers.get('Content-Type')
+        if content_type not in wire.SUPPORTED_ENCODINGS :
+            logger.info('server responds with message %s of type %s', content, content_type)
             return None
 
-        # Attempt to decode the content if it is not already a string
-        try:
-            content = content.decode('utf-8')
-        except AttributeError:
-            pass
-        value = json.loads(content)
-        return value
+        return wire.decode_message(content, content_type)
@@ -22,8 +22,8 @@ class ProvisioningServiceClient(GenericServiceClient) :
     """Class to wrap JSON RPC calls to the provisioning service
     """
 
-    def __init__(self, url) :
-        super().__init__(url);
+    def __init__(self, url, encoding = None) :
+        super().__init__(url, encoding)
 
         self.public_info = self.get_public_info()
         self.verifying_key = self.public_info['pspk']
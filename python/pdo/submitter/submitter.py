@@ -191,7 +191,8 @@ class JsonPayloadBuilder(object):
         previous_state_hash,
         encrypted_state,
         dependency_list,
-        contract_code_hash):
+        contract_code_hash,
+        batch_proof = None):
         jsonblob = dict()
         jsonblob['af'] = "ccl_contract"
         jsonblob['verb'] = verb
@@ -221,6 +222,14 @@ class JsonPayloadBuilder(object):
         state_update['encrypted_state'] = encrypted_state
         state_update['dependency_list'] = dependency_list
         jsonblob['state_update'] = state_update
+        # the enclave signature covers the root of a batch of responses
+        if batch_proof :
+            proof = dict()
+            proof['root'] = batch_proof['Root']
+            proof['index'] = batch_proof['Index']
+            proof['count'] = batch_proof['Count']
+            proof['proof'] = batch_proof['Proof']
+            jsonblob['batch_proof'] = proof
         return jsonblob
 
 class Submitter(object):
@@ -306,6 +315,7 @@ class Submitter(object):
             current_state_hash,
             encrypted_state,
             contract_code_hash,
+            batch_proof = None,
             **extra_params):
         json_input = JsonPayloadBuilder.build_ccl_transaction_from_data(
             contract_creator_private_pem_key,
@@ -320,7 +330,8 @@ class Submitter(object):
             "",     # previous_state_hash,
             encrypted_state,
             [],     # empty dependency_list
-            contract_code_hash)     # contract code hash is necessary for the pdo signature
+            contract_code_hash,     # contract code hash is necessary for the pdo signature
+            batch_proof)
         return self.submit_json(json_input, json_input['af'], **extra_params)
 
     def submit_ccl_update_from_data(
@@ -335,6 +346,7 @@ class Submitter(object):
             previous_state_hash,
             encrypted_state,
             dependency_list,
+            batch_proof = None,
             **extra_params):
         json_input = JsonPayloadBuilder.build_ccl_transaction_from_data(
             "",     #no creator private key, so no pdo signature included
@@ -349,5 +361,6 @@ class Submitter(object):
             previous_state_hash,
             encrypted_state,
             dependency_list,
-            "contract_code_hash is not relevant here")  #no contract hash because no creator's signature is required
+            "contract_code_hash is not relevant here",  #no contract hash because no creator's signature is required
+            batch_proof)
         return self.submit_json(json_input, json_input['af'], **extra_params)
@@ -0,0 +1,48 @@
+# Copyright 2018 Intel Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+pdo_merkle.py -- verification of the Merkle proofs that tie a batched
+update to the root signed by the enclave; the rules must match
+pdo::crypto::merkle in common/crypto/merkle.cpp, which the python
+crypto wrapper test checks against the C++ implementation
+"""
+
+import hashlib
+
+
+def _hash_merkle_node(left, right):
+    return hashlib.sha256(b'\x01' + left + right).digest()
+
+
+def verify_merkle_proof(root, leaf_data, index, count, proof):
+    """Check that leaf_data is leaf number index of the Merkle tree with
+    count leaves and the given root, matching pdo::crypto::merkle
+    """
+    if index >= count:
+        return False
+
+    node = hashlib.sha256(b'\x00' + leaf_data).digest()
+    siblings = iter(proof)
+    while count > 1:
+        # the last node of an odd level is promoted without a sibling
+        if (index ^ 1) < count:
+            sibling = next(siblings, None)
+            if sibling is None:
+                return False
+            node = _hash_merkle_node(sibling, node) if index & 1 else _hash_merkle_node(node, sibling)
+        index //= 2
+        count = (count + 1) // 2
+
+    return next(siblings, None) is None and node == root
@@ -27,6 +27,7 @@ from cryptography.exceptions import InvalidSignature
 from common.sgx.sawtooth_poet_common.sgx_structs._sgx_quote import SgxQuote
 from common.sgx.sawtooth_poet_common.sgx_structs._sgx_report_data import SgxReportData
 
+from common.pdo_merkle import verify_merkle_proof
 from common.sawtooth_signing import create_context
 from common.sawtooth_signing import CryptoFactory
 from common.sawtooth_signing.secp256k1 import Secp256k1PublicKey
@@ -210,6 +211,18 @@ def make_ccl_transaction_hash_input(payload, contract_code_hash, pdo_contract_cr
     return hash_input
 
 
+def make_batch_signature_input(hash_input, batch_proof):
+    """Return the message covered by the enclave signature when responses
+    are signed as a batch, or None if the update is not in the batch
+    """
+    root = base64.b64decode(batch_proof.root)
+    proof = [base64.b64decode(h) for h in batch_proof.proof]
+    if not verify_merkle_proof(root, hash_input, batch_proof.index, batch_proof.count, proof):
+        return None
+
+    return root + batch_proof.count.to_bytes(4, 'big')
+
+
 def verify_ccl_transaction_signature(payload, contract):
     try:
         hash_input = make_ccl_transaction_hash_input(
@@ -218,6 +231,11 @@ def verify_ccl_transaction_signature(payload, contract):
             contract.pdo_contract_creator_pem_key
         )
 
+        if payload.HasField('batch_proof'):
+            hash_input = make_batch_signature_input(hash_input, payload.batch_proof)
+            if hash_input is None:
+                return False
+
         return verify_secp256k1_signature(
             hash_input,
             payload.contract_enclave_signature,